@@ -1,8 +1,29 @@
-mkdir dest obj
-emcc -c src/main.c -o obj/main.o -I include -s USE_SDL=2
-emcc -c src/ccanvas.c -o obj/ccanvas.o -I include -s USE_SDL=2
-emcc -c src/camera.c -o obj/camera.o -I include -s USE_SDL=2
-emcc -c src/point.c -o obj/point.o -I include -s USE_SDL=2
-emcc -c src/scene.c -o obj/scene.o -I include -s USE_SDL=2
-emcc -c src/vec3.c -o obj/vec3.o -I include -s USE_SDL=2
-emcc -O3 obj/main.o obj/ccanvas.o obj/camera.o obj/point.o obj/scene.o obj/vec3.o -o dest/index.html --shell-file index.html -s USE_SDL=2 -s EXPORTED_FUNCTIONS='["_CCanvas_dropEventForSDL","_CCanvas_browserWasResized","_main"]' -s EXPORTED_RUNTIME_METHODS='["ccall","cwrap"]' -s FORCE_FILESYSTEM=1 --preload-file base_scene.obj
\ No newline at end of file
+mkdir -p dest obj obj_simd
+SOURCES="main bench batch png server capture ccanvas camera point scene objparser decompress chunkstore meshfile instances splat vec3 transform workers framebuffer"
+# Frames are rasterized into a framebuffer that is put onto the canvas
+# directly instead of going through SDL's emulated renderer
+BACKEND="-DCCANVAS_FRAMEBUFFER"
+EXPORTS='["_CCanvas_dropEventForSDL","_CCanvas_browserWasResized","_CCanvas_streamBeginForSDL","_CCanvas_streamChunkForSDL","_CCanvas_streamEndForSDL","_CCanvas_pendingStreamChunks","_malloc","_main"]'
+RUNTIME='["ccall","cwrap","HEAPU8"]'
+# Scenes are streamed into the parser as they download instead of being
+# preloaded into the virtual file system, so the heap grows with the geometry
+LINK="-s ALLOW_MEMORY_GROWTH=1"
+
+# Scalar single threaded build, used when the page is not cross-origin isolated
+for f in $SOURCES; do
+    emcc -O3 -c src/$f.c -o obj/$f.o -I include -s USE_SDL=2 $BACKEND
+done
+emcc -O3 obj/*.o -o dest/index.js -s USE_SDL=2 -s EXPORTED_FUNCTIONS="$EXPORTS" -s EXPORTED_RUNTIME_METHODS="$RUNTIME" $LINK
+
+# SIMD128 and pthreads build, it needs SharedArrayBuffer so it can only run on
+# cross-origin isolated pages, the thread pool is sized to the number of
+# logical processors reported by the browser
+for f in $SOURCES; do
+    emcc -O3 -c src/$f.c -o obj_simd/$f.o -I include -s USE_SDL=2 $BACKEND -msimd128 -pthread
+done
+emcc -O3 obj_simd/*.o -o dest/index_simd.js -msimd128 -pthread -s PTHREAD_POOL_SIZE=navigator.hardwareConcurrency -s USE_SDL=2 -s EXPORTED_FUNCTIONS="$EXPORTS" -s EXPORTED_RUNTIME_METHODS="$RUNTIME" $LINK
+
+# The page picks one of the two builds when it is opened, the default scene is
+# fetched by it after startup
+cp index.html dest/index.html
+cp base_scene.obj dest/base_scene.obj
\ No newline at end of file
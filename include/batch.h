@@ -0,0 +1,64 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_BATCH_
+#define _CCANVAS_BATCH_
+
+#include <camera.h>
+#include <framebuffer.h>
+#include <scene.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <workers.h>
+
+/**
+ * Renders one scene from many cameras at once, without a window
+ *
+ * Every view has its own scene for the projected points and the edges to be
+ * drawn, with the geometry pointers shared with the source scene the same
+ * way as the instances of a mesh. Instead of projecting and compacting the
+ * whole scene view by view, the vertices and then the edges are walked once
+ * in blocks of SCENE_PROJECTION_BLOCK, and every block is processed for all
+ * the views while it is still in the cache. The views of a block run on the
+ * worker pool of the source scene
+ * Each view is drawn into its own framebuffer, sized to its camera
+ */
+typedef struct {
+  Scene scene;  // Shares the geometry of the source, owns the projection
+  SceneProjection projection;  // Transforms of the camera of the view
+  Framebuffer target;
+  long int nextRange;   // First range and visible object not finished by the
+  long int nextObject;  // blocks processed so far
+} BatchView;
+
+typedef struct {
+  Scene* source;  // Owns the geometry, its settings are used for every view
+  BatchView* views;
+  int viewCount;
+  int allocatedViews;
+  long int blockBegin, blockEnd;  // Block processed by the running jobs
+  double lineWidth;  // Plain lines if 0, anti-aliased lines otherwise
+  uint32_t background, pixel;
+} Batch;
+
+Batch* Batch_create(Scene* source, Camera* cams, int viewCount);
+void Batch_free(Batch* batch);
+void Batch_setViewCount(Batch* batch, int viewCount);
+void Batch_setCamera(Batch* batch, int index, Camera cam);
+void Batch_render(Batch* batch);
+void Batch_prepareView(void* _batch, int index);
+void Batch_share(Batch* batch, BatchView* view);
+void Batch_run(Batch* batch, workerJobFunc job);
+void Batch_projectView(void* _batch, int index);
+void Batch_compactView(void* _batch, int index);
+void Batch_drawView(void* _batch, int index);
+void Batch_drawScene(Scene* scene, Framebuffer* fb, double lineWidth,
+                     uint32_t pixel);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_BENCH_
+#define _CCANVAS_BENCH_
+
+#include <batch.h>
+#include <camera.h>
+#include <framebuffer.h>
+#include <meshfile.h>
+#include <scene.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <workers.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Headless benchmark of the rendering pipeline, it needs no window
+ * The scene is loaded, then the camera circles around it like the idle camera
+ * of the app while every frame is projected, compacted and drawn into a
+ * framebuffer, once with every edge drawn and once with each culling mode,
+ * then with every edge drawn again with the single precision projection and
+ * with anti-aliased lines
+ * Used for comparing builds and as the training run of the profile guided
+ * optimization build
+ * Bench_views compares rendering many views of the scene one by one with
+ * rendering them in one batch
+ * Bench_load compares the load times of files, for example of a scene and
+ * its compressed copies, with a cold and a warm page cache
+ */
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 768
+// Number of loads of every file, the median time is printed
+#define BENCH_LOAD_RUNS 5
+
+bool Bench_run(const char* fileName, int frames, double weldEpsilon);
+double Bench_pass(Scene* scene, Framebuffer* fb, double radius, int frames,
+                  double lineWidth, double* projectTime,
+                  long int* drawnEdges);
+bool Bench_views(const char* fileName, int viewCount, const char* prefix);
+bool Bench_load(char** fileNames, int count);
+bool Bench_evict(const char* fileName);
+double Bench_median(double* values, int count);
+double Bench_now();
+
+#endif
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 #include <math.h>
 #include <point.h>
+#include <transform.h>
 #include <vec3.h>
 
 /**
@@ -31,6 +32,7 @@ typedef struct {
 
 Camera Camera_new(Vec3 pos, Vec3 up, double hRes, double vRes, double hFov,
                   double vFov);
+bool Camera_equals(Camera* cam1, Camera* cam2);
 void Camera_setLookDirection(Camera* cam, Vec3* direction);
 void Camera_turnLeft(Camera* cam, double angle);
 void Camera_turnRight(Camera* cam, double angle);
@@ -46,5 +48,7 @@ Vec3 Camera_directionRight(Camera* cam);
 Vec3 Camera_directionForwardHorizontal(Camera* cam);
 Point Camera_project(Camera* cam, Vec3* point);
 Point Camera_projectLinear(Camera* cam, Vec3* point);
+Transform Camera_viewTransform(Camera* cam);
+bool Camera_sphereVisible(Camera* cam, Vec3* center, double radius);
 
 #endif
\ No newline at end of file
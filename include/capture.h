@@ -0,0 +1,104 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_CAPTURE_
+#define _CCANVAS_CAPTURE_
+
+#include <png.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <workers.h>
+
+/**
+ * Records the finished frames into a file while the app keeps running
+ *
+ * The render thread only copies the frame into a buffer of a pool, the
+ * buffers are queued for a writer thread that encodes and writes them, then
+ * hands them back to the pool. The pool is the bound of the queue: when every
+ * buffer is waiting for the writer, the frame is either dropped or the render
+ * thread waits for a buffer to be written, depending on the policy
+ *
+ * The frames are written as
+ *   - a Y4M video (4:2:0, BT.601), playable and convertible by most tools
+ *   - raw RGBA rows from the top, one frame after the other
+ *   - a sequence of PNG files, numbered from 0 before the extension
+ * Videos and raw streams keep the size of the first frame, later frames of a
+ * different size are cropped or padded with black
+ * Builds without threads write the frames on the render thread
+ */
+typedef enum {
+  CAPTURE_FORMAT_Y4M,
+  CAPTURE_FORMAT_RGBA,
+  CAPTURE_FORMAT_PNG
+} Capture_Format;
+
+typedef enum {
+  CAPTURE_DROP,  // Frames arriving when the pool is empty are skipped
+  CAPTURE_BLOCK  // The render thread waits for a buffer to be written
+} Capture_Policy;
+
+typedef struct {
+  uint8_t* pixels;  // RGBA rows from the top
+  int width, height;
+  size_t allocated;  // Bytes allocated for the pixels
+  long int index;    // Number of the frame in the recording
+} CaptureFrame;
+
+typedef struct {
+  int format;
+  int policy;
+  char* path;  // File of the video, or the name of the PNG files
+  FILE* file;
+  int frameRate;  // Written into the Y4M header
+  int width, height;  // Size of the video, set by the first frame
+  uint8_t* planes;    // Y4M planes of the frame being written
+  uint8_t* fitted;    // The frame cropped or padded to the size of the video
+  CaptureFrame* frames;  // The pool
+  int depth;             // Number of buffers in the pool
+  int* pool;             // Indices of the buffers free for the next frame
+  int poolCount;
+  int* queue;  // Ring of the indices of the frames waiting for the writer
+  int queueStart, queueCount;
+  long int submitted;  // Frames queued, dropped and written so far
+  long int dropped;
+  long int written;
+  bool failed;  // A write failed, the following frames are thrown away
+#ifndef WORKERS_NO_THREADS
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t frameQueued;  // Signaled for the writer
+  pthread_cond_t frameFreed;   // Signaled for a render thread that blocks
+  bool threaded;  // False if the writer thread could not be started
+  bool quit;
+#endif
+} Capture;
+
+// Buffers in the pool when no depth is given
+#define CAPTURE_DEFAULT_DEPTH 8
+
+Capture* Capture_start(const char* path, int format, int policy, int depth,
+                       int frameRate);
+int Capture_formatOf(const char* path);
+bool Capture_stop(Capture* capture);
+CaptureFrame* Capture_acquire(Capture* capture, int width, int height);
+void Capture_submit(Capture* capture, CaptureFrame* frame);
+bool Capture_frame(Capture* capture, const void* rgba, int width, int height);
+void Capture_release(Capture* capture, CaptureFrame* frame);
+bool Capture_write(Capture* capture, CaptureFrame* frame);
+bool Capture_writeY4M(Capture* capture, CaptureFrame* frame);
+bool Capture_writeRGBA(Capture* capture, CaptureFrame* frame);
+bool Capture_writePNG(Capture* capture, CaptureFrame* frame);
+const uint8_t* Capture_fit(Capture* capture, CaptureFrame* frame);
+#ifndef WORKERS_NO_THREADS
+void* Capture_thread(void* _capture);
+#endif
+
+#endif
\ No newline at end of file
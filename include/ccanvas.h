@@ -14,11 +14,44 @@
 #include <emscripten.h>
 #endif
 
+#include <capture.h>
+#include <framebuffer.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <time.h>
 
+/**
+ * Drawing backends selected at build time
+ * By default every primitive is drawn with the SDL renderer
+ * With CCANVAS_FRAMEBUFFER defined, the frame is rasterized on the CPU into a
+ * Framebuffer, natively it is then uploaded to a streaming texture, in the
+ * browser it is handed directly to the page's canvas with putImageData,
+ * bypassing SDL's emulated renderer
+ */
+#if defined(CCANVAS_FRAMEBUFFER) && defined(__EMSCRIPTEN__)
+#define CCANVAS_DIRECT_PRESENT
+#endif
+
+/**
+ * Pipelined frames
+ * A frame is in flight from its update until it is presented. With one frame
+ * in flight the stages run one after the other. The native framebuffer
+ * backend can have more: the draw function runs on a thread of its own into
+ * the framebuffer of the frame, while the main thread handles the events,
+ * updates the next frame and presents the frames drawn before
+ * Every frame gets a slot, the update and draw functions keep the data they
+ * share in the slot of the frame (the draw function must not read anything
+ * that the next updates change)
+ */
+#if defined(CCANVAS_FRAMEBUFFER) && !defined(__EMSCRIPTEN__)
+#define CCANVAS_PIPELINE
+#include <pthread.h>
+#define CCANVAS_FRAME_SLOTS 3
+#else
+#define CCANVAS_FRAME_SLOTS 1
+#endif
+
 // Struct that holds all the data needed for the program to run
 typedef struct {
   SDL_Window* window;  // SDL window
@@ -27,10 +60,53 @@ typedef struct {
   Uint32 bgColor;
   Uint32 brushColor;
   SDL_Texture* brush;
-  clock_t lastTime,
+  Uint64 lastTime,
       currentTime;    // Variables for measuring elapsed time betwen frames
   bool quit;          // False by default, the program quits when set to true
+  bool redraw;        // The frame is only drawn and presented when set, it is
+                      // set by CCanvas_invalidate and cleared after drawing
+  bool hadInput;      // True if any event arrived since the last frame
+  Sint32 mouseDx, mouseDy;  // Mouse motion not handed to the watcher yet
+  Uint32 idleFrameTime;  // Time in ms the loop sleeps at most waiting for an
+                         // event when nothing changed (the idle frame cap)
   int width, height;  // Current width and height of window
+  // Adaptive resolution: when the scale is below 1 the frame is drawn into the
+  // smaller target texture which is then stretched onto the window
+  // (the framebuffer backend always uploads its pixels to this texture)
+  SDL_Texture* target;
+#ifdef CCANVAS_FRAMEBUFFER
+  // The pixels drawn by the framebuffer backend, one frame for every slot
+  Framebuffer frames[CCANVAS_FRAME_SLOTS];
+  Framebuffer* framebuffer;  // The frame the primitives draw into
+  uint32_t bgPixel, brushPixel;  // The colors in the framebuffer's format
+#else
+  // Pixels drawn on the CPU are put into this layer that is then blended
+  // onto the frame (the framebuffer backend draws into its own pixels)
+  Framebuffer layer;
+  SDL_Texture* layerTexture;
+#endif
+  double renderScale;
+  int renderWidth, renderHeight;  // Size of the area that is drawn to
+  double targetFrameTime;  // Draw stage time budget in ms, 0 disables scaling
+  double minRenderScale;
+  double drawTime;  // Time in ms the draw stage took in the last frame
+  bool refining;    // True while the scale is raised back after movement
+  Capture* capture;  // Records the drawn frames if set, owned by the caller
+  int maxFramesInFlight;
+  int framesInFlight;  // Frames updated but not presented yet
+  int framesDrawn;     // The oldest frames in flight that are drawn already
+  unsigned long frameCount;  // Frames updated so far
+  int updateSlot;  // Slot of the frame being updated
+  int drawSlot;    // Slot of the frame being drawn
+  double slotDrawTime[CCANVAS_FRAME_SLOTS];  // Draw stage time of the frames
+  bool slotRefining[CCANVAS_FRAME_SLOTS];    // and if they raised the scale
+#ifdef CCANVAS_PIPELINE
+  pthread_t drawThread;
+  pthread_mutex_t pipelineLock;
+  pthread_cond_t frameQueued;  // Signaled for the draw thread
+  pthread_cond_t frameDrawn;   // Signaled for the main thread
+  bool stopDrawing;
+#endif
   void* updateFunc;   // Functions given by the user, called every frame in the
                       // main loop
   void* drawFunc;
@@ -42,13 +118,26 @@ typedef struct {
   void* onMouseButtonUp;
   void* onMouseMove;
   void* onFileDrop;
+  void* onFileStream;
   void* onResize;
   // Data pointer
   void* data;
 } CCanvas;
 
 // Define custom event type enum for custom event handling
-enum CCanvas_CustomEventType { CCANVAS_WASM_WINDOW_RESIZED };
+enum CCanvas_CustomEventType {
+  CCANVAS_WASM_WINDOW_RESIZED,
+  CCANVAS_WASM_STREAM_BEGIN,
+  CCANVAS_WASM_STREAM_CHUNK,
+  CCANVAS_WASM_STREAM_END
+};
+
+// Stages of a file stream, passed to the fileStream event function
+enum CCanvas_StreamStage {
+  CCANVAS_STREAM_BEGIN,
+  CCANVAS_STREAM_DATA,
+  CCANVAS_STREAM_END
+};
 
 // Function pointer definitions for main loop functions
 typedef void (*updateFuncDef)(double, CCanvas*);
@@ -64,6 +153,33 @@ void CCanvas_quit(CCanvas* cnv);
 // Main loop function
 void CCanvas_loop(void* _cnv);
 
+// Functions for frame-coherent rendering
+void CCanvas_invalidate(CCanvas* cnv);
+void CCanvas_setIdleFrameCap(CCanvas* cnv, int framesPerSecond);
+
+// Functions for adaptive resolution scaling
+void CCanvas_setFrameBudget(CCanvas* cnv, double targetFrameTime,
+                            double minScale);
+void CCanvas_setRenderScale(CCanvas* cnv, double scale);
+void CCanvas_adaptRenderScale(CCanvas* cnv);
+void CCanvas_createTarget(CCanvas* cnv);
+void CCanvas_present(CCanvas* cnv, int slot);
+
+// Functions for pipelining the frames
+void CCanvas_setFramesInFlight(CCanvas* cnv, int count);
+bool CCanvas_pipelined(CCanvas* cnv);
+void CCanvas_queueFrame(CCanvas* cnv);
+void CCanvas_drawFrame(CCanvas* cnv, int slot);
+int CCanvas_presentNext(CCanvas* cnv, bool wait);
+void CCanvas_finishFrames(CCanvas* cnv);
+#ifdef CCANVAS_PIPELINE
+void* CCanvas_drawThread(void* _cnv);
+#endif
+
+// Functions for recording the frames
+void CCanvas_setCapture(CCanvas* cnv, Capture* capture);
+void CCanvas_captureFrame(CCanvas* cnv, int slot);
+
 // Functions to set "painting" colors
 void CCanvas_setBgColor(CCanvas* cnv, Uint32 color);
 void CCanvas_setBrushColor(CCanvas* cnv, Uint32 color);
@@ -81,6 +197,10 @@ Uint32 rgb(Uint8 r, Uint8 g, Uint8 b);
 void CCanvas_clear(CCanvas* cnv);
 void CCanvas_line(CCanvas* cnv, int x1, int y1, int x2, int y2, int thickness);
 void CCanvas_preciseLine(CCanvas* cnv, int x1, int y1, int x2, int y2);
+void CCanvas_point(CCanvas* cnv, int x, int y);
+Framebuffer* CCanvas_beginLayer(CCanvas* cnv);
+void CCanvas_endLayer(CCanvas* cnv);
+uint32_t CCanvas_brushPixel(CCanvas* cnv);
 
 // Function definitions for event handling
 // The keyDown and keyUp functions recieve an SDL_Keycode that holds wich key
@@ -91,16 +211,25 @@ typedef void (*keyUpFunc)(CCanvas*, SDL_Keycode);
 // current coordinates of the mouse
 typedef void (*mouseButtonDownFunc)(CCanvas*, Uint8, Sint32, Sint32);
 typedef void (*mouseButtonUpFunc)(CCanvas*, Uint8, Sint32, Sint32);
-// The mouseMove function recieves the current coordinates of the mouse
+// The mouseMove function recieves the relative motion of the mouse
+// The motion events are added up and it is called once per frame with the
+// sum, when the input is sampled (see CCanvas_sampleInput)
 typedef void (*mouseMoveFunc)(CCanvas*, Sint32, Sint32);
 // The fileDrop event function recieves a string pointer containing the name of
 // the file dropped
 typedef void (*fileDropFunc)(CCanvas*, char*);
-// The resize event function recieves the new size of the window/canvas
+// The fileStream event function is called when a file arrives in chunks
+// instead of as a whole, first with the BEGIN stage and the name of the file,
+// then with the DATA stage for every chunk and finally with the END stage
+// The data is only valid during the call
+typedef void (*fileStreamFunc)(CCanvas*, int, char*, size_t);
+// The resize event function recieves the new size of the area that is drawn
+// to, it is also called when the adaptive resolution scale changes
 typedef void (*resizeFunc)(CCanvas*, Sint32, Sint32);
 
 // Functions for event handling and for setting up listeners/watchers
 void CCanvas_handleEvents(CCanvas* cnv);
+void CCanvas_sampleInput(CCanvas* cnv);
 void CCancas_resetEventHandlers(CCanvas* cnv);
 void CCanvas_watchKeyDown(CCanvas* cnv, keyDownFunc f);
 void CCanvas_watchKeyUp(CCanvas* cnv, keyUpFunc f);
@@ -108,11 +237,18 @@ void CCanvas_watchMouseButtonDown(CCanvas* cnv, mouseButtonDownFunc f);
 void CCanvas_watchMouseButtonUp(CCanvas* cnv, mouseButtonUpFunc f);
 void CCanvas_watchMouseMove(CCanvas* cnv, mouseMoveFunc f);
 void CCanvas_watchFileDrop(CCanvas* cnv, fileDropFunc f);
+void CCanvas_watchFileStream(CCanvas* cnv, fileStreamFunc f);
 void CCanvas_watchResize(CCanvas* cnv, resizeFunc f);
 
 #ifdef __EMSCRIPTEN__
 int CCanvas_dropEventForSDL(char* fileName);
 int CCanvas_browserWasResized();
+int CCanvas_pushStreamEvent(int code, void* data, size_t length);
+int CCanvas_streamBeginForSDL(char* fileName);
+int CCanvas_streamChunkForSDL(char* data, int length);
+int CCanvas_streamEndForSDL();
+int CCanvas_pendingStreamChunks();
+void CCanvas_fetchFile(const char* url);
 #endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_CHUNKSTORE_
+#define _CCANVAS_CHUNKSTORE_
+
+#include <camera.h>
+#include <scene.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Out-of-core rendering of scenes that do not fit into memory
+ *
+ * An .obj file is preprocessed once into a chunk file: the edges are sorted
+ * into the cells of a uniform grid (by their first vertex) and every cell
+ * becomes a self-contained chunk with its own vertex and edge arrays and a
+ * bounding sphere. The preprocessing itself works on memory mapped temporary
+ * files, so it does not need the whole scene in memory either
+ *
+ * File layout (native byte order, it is a local cache and not an interchange
+ * format): a ChunkFileHeader, then chunkCount ChunkInfo records, then the
+ * data of the chunks, vertices as 3 doubles and edges as 2 int64 indices
+ * into the chunk's vertices
+ *
+ * When rendering, the file is memory mapped and only the chunks intersecting
+ * the view frustum are made resident. Resident chunks are kept in an LRU
+ * cache bounded by a memory budget, chunks that the camera is heading towards
+ * are prefetched asynchronously with madvise
+ */
+#define CHUNKSTORE_MAGIC "CCCHUNK1"
+// Number of edges aimed for in one chunk when preprocessing
+#define CHUNKSTORE_CHUNK_EDGES 65536
+// Alignment of the data of every chunk in the file
+#define CHUNKSTORE_ALIGNMENT 64
+
+typedef struct {
+  char magic[8];
+  int64_t chunkCount;
+  int64_t vertexCount;  // Total number of vertices and edges of all chunks
+  int64_t edgeCount;
+  double min[3], max[3];  // Bounding box of the scene
+} ChunkFileHeader;
+
+typedef struct {
+  double center[3];  // Bounding sphere of the chunk
+  double radius;
+  int64_t vertexOffset, vertexCount;
+  int64_t edgeOffset, edgeCount;
+} ChunkInfo;
+
+/**
+ * A chunk at runtime, its scene refers to the mapped file while resident
+ */
+typedef struct {
+  Scene scene;
+  Vec3 center;
+  double radius;
+  bool resident;
+  bool visible;     // Intersected the frustum in the last update
+  bool prefetched;  // Already requested ahead of the camera
+  bool projected;   // Projected again in the last frame
+  unsigned long lastUsed;  // Last frame the chunk was visible in
+  size_t bytes;            // Memory used while resident
+} Chunk;
+
+typedef struct {
+  int fd;
+  unsigned char* map;
+  size_t mapSize;
+  ChunkFileHeader* header;
+  ChunkInfo* infos;
+  Chunk* chunks;
+  long int chunkCount;
+  long int* visible;  // Indices of the chunks visible in the last update
+  long int visibleCount;
+  long int residentCount;
+  size_t residentBytes;
+  size_t memoryBudget;  // Resident chunks are evicted above this size
+  unsigned long frame;
+} ChunkStore;
+
+bool ChunkStore_build(const char* objFileName, const char* fileName,
+                      long int chunkEdges);
+ChunkStore* ChunkStore_open(const char* fileName, size_t memoryBudget);
+bool ChunkStore_checkRanges(ChunkInfo* infos, int64_t chunkCount,
+                            size_t mapSize);
+bool ChunkStore_checkEdges(const int64_t* edges, int64_t edgeCount,
+                           int64_t vertexCount);
+void ChunkStore_close(ChunkStore* store);
+double ChunkStore_radius(ChunkStore* store);
+bool ChunkStore_update(ChunkStore* store, Camera* cam, Vec3* velocity,
+                       double lookAhead);
+bool ChunkStore_project(ChunkStore* store, Scene* view);
+void ChunkStore_projectChunk(void* _store, int index);
+size_t ChunkStore_chunkBytes(Chunk* chunk);
+void ChunkStore_load(ChunkStore* store, long int index);
+void ChunkStore_evict(ChunkStore* store, long int index);
+void ChunkStore_advise(ChunkStore* store, long int index, int advice);
+
+#ifndef _WIN32
+FILE* ChunkStore_tempFile(const char* fileName, const char* suffix);
+void* ChunkStore_mapFile(FILE* file, size_t size, bool writable);
+void ChunkStore_unmapFile(void* map, size_t size);
+bool ChunkStore_flushEdges(Scene* scene, FILE* file, int64_t* edgeCount);
+long int ChunkStore_cell(Vec3* v, double* min, double* cellSize,
+                         long int cells);
+int ChunkStore_compareEdges(const void* e1, const void* e2);
+int ChunkStore_compareIds(const void* i1, const void* i2);
+int64_t ChunkStore_unique(int64_t* data, int64_t count, int width);
+bool ChunkStore_pad(FILE* file, int64_t* position);
+#endif
+
+#endif
\ No newline at end of file
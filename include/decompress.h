@@ -0,0 +1,153 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_DECOMPRESS_
+#define _CCANVAS_DECOMPRESS_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <workers.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#ifdef CCANVAS_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * Streaming decompression of compressed scene files, recognized by their
+ * first bytes
+ *
+ * A thread reads the compressed input from a file descriptor and decompresses
+ * it into a ring of buffers, the parser takes the filled buffers in order and
+ * hands them back once they are parsed, so decompressing and parsing overlap.
+ * The thread waits when every buffer is filled
+ *
+ * gzip files (also several concatenated members) are inflated without
+ * external libraries and checked against their CRC-32 and size, Huffman
+ * codes of up to DECOMPRESS_FAST_BITS bits are decoded with a single table
+ * lookup. zstd files need the build to be
+ * configured with CCANVAS_ZSTD, which links libzstd
+ * Builds without threads decompress a buffer when the parser asks for it
+ */
+typedef enum {
+  DECOMPRESS_NONE,
+  DECOMPRESS_GZIP,
+  DECOMPRESS_ZSTD
+} Decompress_Format;
+
+// Number of first bytes every format is recognized by
+#define DECOMPRESS_MAGIC_SIZE 4
+// Number and size of the buffers between the thread and the parser
+#define DECOMPRESS_BUFFERS 4
+#define DECOMPRESS_BUFFER_SIZE 262144
+// Size of the reads of the compressed input
+#define DECOMPRESS_INPUT_SIZE 65536
+// Furthest distance deflate can refer back to
+#define DECOMPRESS_WINDOW 32768
+// Codes up to this length are decoded with one lookup
+#define DECOMPRESS_FAST_BITS 10
+
+/**
+ * Canonical Huffman code of deflate
+ */
+typedef struct {
+  uint16_t fast[1 << DECOMPRESS_FAST_BITS];  // Symbol << 4 | length of the
+                                             // short codes, 0 for longer ones
+  uint16_t counts[16];   // Number of codes of every length
+  uint16_t symbols[288];  // Symbols in the order of their codes
+} DecompressCode;
+
+// States of the inflater between two calls
+enum Decompress_States {
+  DECOMPRESS_HEADER,   // A gzip member starts
+  DECOMPRESS_BLOCK,    // A deflate block starts
+  DECOMPRESS_STORED,   // Copying an uncompressed block
+  DECOMPRESS_HUFFMAN,  // Decoding a compressed block
+  DECOMPRESS_TRAILER,  // The member ended, its size follows
+  DECOMPRESS_END
+};
+
+typedef struct {
+  int fd;
+  int format;
+  uint8_t* input;  // Compressed bytes read but not decompressed yet
+  size_t inputStart, inputEnd;
+  bool inputDone;  // The end of the input was reached
+  uint64_t bits;   // Bits taken from the input, the next one is the lowest
+  int bitCount;
+  int state;
+  bool lastBlock;
+  long int remaining;  // Bytes left from the stored block
+  int matchLength;     // Bytes left from the match being copied
+  int matchDistance;
+  uint8_t* window;  // The last DECOMPRESS_WINDOW bytes of the output
+  size_t windowPos;
+  uint64_t total;        // Bytes written before the current call
+  uint64_t memberStart;  // Bytes written before the current gzip member
+  uint32_t crcTable[256];
+  uint32_t crc;  // CRC-32 of the output of the member so far, not inverted
+  DecompressCode literals;
+  DecompressCode distances;
+  uint16_t lengthBase[29];  // Lengths and distances of the symbols, with the
+  uint8_t lengthExtra[29];  // number of extra bits following them
+  uint16_t distanceBase[30];
+  uint8_t distanceExtra[30];
+#ifdef CCANVAS_ZSTD
+  ZSTD_DStream* zstd;
+  size_t zstdResult;  // 0 if the last zstd frame was complete
+#endif
+  uint8_t* buffers[DECOMPRESS_BUFFERS];  // The ring
+  size_t lengths[DECOMPRESS_BUFFERS];
+  int first, filled;  // Oldest buffer and the number of filled buffers
+  bool finished;      // The thread reached the end of the output
+  bool failed;        // The input is corrupt or truncated
+#ifndef WORKERS_NO_THREADS
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t bufferFilled;  // Signaled for the parser
+  pthread_cond_t bufferFreed;   // Signaled for the thread
+  bool threaded;  // False if the thread could not be started
+  bool quit;
+#endif
+} Decompressor;
+
+int Decompress_formatOf(const void* data, size_t length);
+Decompressor* Decompress_start(int fd, int format, const void* prefix,
+                               size_t length);
+void Decompress_stop(Decompressor* stream);
+long int Decompress_next(Decompressor* stream, const char** data, bool wait);
+void Decompress_release(Decompressor* stream);
+size_t Decompress_fill(Decompressor* stream, uint8_t* out, size_t size);
+bool Decompress_readInput(Decompressor* stream);
+bool Decompress_stopping(Decompressor* stream);
+bool Decompress_refill(Decompressor* stream, int count);
+uint32_t Decompress_bits(Decompressor* stream, int count);
+size_t Decompress_inflate(Decompressor* stream, uint8_t* out, size_t size);
+void Decompress_crc(Decompressor* stream, const uint8_t* data, size_t size);
+bool Decompress_readHeader(Decompressor* stream);
+bool Decompress_readBlock(Decompressor* stream);
+bool Decompress_readCodes(Decompressor* stream);
+bool Decompress_buildCode(DecompressCode* code, const uint8_t* lengths,
+                          int count);
+int Decompress_decode(Decompressor* stream, DecompressCode* code);
+#ifdef CCANVAS_ZSTD
+size_t Decompress_zstd(Decompressor* stream, uint8_t* out, size_t size);
+#endif
+#ifndef WORKERS_NO_THREADS
+void* Decompress_thread(void* _stream);
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_FRAMEBUFFER_
+#define _CCANVAS_FRAMEBUFFER_
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Struct for an image in memory that can be drawn into on the CPU
+ * The bytes of every pixel are stored in R, G, B, A order, which is the layout
+ * of the browser's ImageData, so the buffer can be handed over without
+ * conversion
+ */
+typedef struct {
+  uint32_t* pixels;
+  int width, height;
+} Framebuffer;
+
+/**
+ * Ends of the thick lines: butt caps stop at the endpoints, square caps go on
+ * for half the width and round caps are half circles around the endpoints
+ */
+enum Framebuffer_LineCap {
+  FRAMEBUFFER_CAP_BUTT,
+  FRAMEBUFFER_CAP_SQUARE,
+  FRAMEBUFFER_CAP_ROUND
+};
+
+/**
+ * Returns the pixel blended over the destination with the given coverage
+ * (0 to 256), two channels are blended at a time within the 32 bit word
+ * Every channel is blended, so over transparent pixels the result has
+ * premultiplied alpha
+ */
+inline uint32_t Framebuffer_blend(uint32_t dst, uint32_t pixel,
+                                  uint32_t coverage) {
+  uint32_t keep = 256 - coverage;
+  uint32_t rb = (pixel & 0x00FF00FF) * coverage + (dst & 0x00FF00FF) * keep;
+  uint32_t ga = ((pixel >> 8) & 0x00FF00FF) * coverage +
+                ((dst >> 8) & 0x00FF00FF) * keep;
+  return ((rb >> 8) & 0x00FF00FF) | (ga & 0xFF00FF00);
+}
+
+Framebuffer Framebuffer_new(int width, int height);
+void Framebuffer_resize(Framebuffer* fb, int width, int height);
+void Framebuffer_free(Framebuffer* fb);
+uint32_t Framebuffer_color(uint32_t rgba);
+void Framebuffer_clear(Framebuffer* fb, uint32_t pixel);
+void Framebuffer_point(Framebuffer* fb, int x, int y, uint32_t pixel);
+void Framebuffer_line(Framebuffer* fb, int x1, int y1, int x2, int y2,
+                      uint32_t pixel);
+void Framebuffer_lineAA(Framebuffer* fb, double x1, double y1, double x2,
+                        double y2, uint32_t pixel);
+void Framebuffer_thickLine(Framebuffer* fb, double x1, double y1, double x2,
+                           double y2, double width, int cap, uint32_t pixel);
+void Framebuffer_swap(double* a, double* b);
+bool Framebuffer_savePPM(Framebuffer* fb, const char* fileName);
+int Framebuffer_clipLine(Framebuffer* fb, double* x1, double* y1, double* x2,
+                         double* y2);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_INSTANCES_
+#define _CCANVAS_INSTANCES_
+
+#include <camera.h>
+#include <meshfile.h>
+#include <scene.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <transform.h>
+#include <vec3.h>
+
+/**
+ * Scenes built from instances of shared meshes
+ *
+ * Every mesh is loaded once, the instances only store a transform and refer
+ * to the vertices and edges of their mesh (and its single precision copy).
+ * Each instance has its own scene for the projected points and the edges to
+ * be drawn, with the geometry pointers shared and the instance transform set
+ * as the model transform
+ *
+ * Instances are placed with a text file next to the meshes, one command per
+ * line (lines starting with # are comments):
+ *   mesh part.obj              loads a mesh, they are numbered from 0
+ *   instance 0 x y z           places mesh 0 translated by (x, y, z)
+ *   instance 0 m00 ... m23     places mesh 0 with a 3x4 matrix, row by row
+ * Mesh paths are relative to the directory of the instance file
+ */
+#define INSTANCES_EXTENSION ".instances"
+
+typedef struct {
+  Scene scene;  // Owns the geometry
+  Vec3 center;  // Bounding sphere of the vertices in model space
+  double radius;
+} Mesh;
+
+typedef struct {
+  Scene scene;  // Shares the geometry of the mesh, owns the projection
+  long int mesh;
+  Vec3 center;  // Bounding sphere in world space
+  double radius;
+  bool visible;    // Intersected the frustum in the last update
+  bool projected;  // Projected again in the last frame
+} Instance;
+
+typedef struct {
+  Mesh* meshes;
+  long int meshCount;
+  Instance* instances;
+  long int instanceCount;
+  long int allocatedInstances;
+  long int* visible;  // Indices of the instances visible in the last update
+  long int visibleCount;
+} InstanceSet;
+
+InstanceSet* InstanceSet_create();
+InstanceSet* InstanceSet_load(const char* fileName);
+void InstanceSet_free(InstanceSet* set);
+long int InstanceSet_addMesh(InstanceSet* set, const char* fileName);
+bool InstanceSet_addInstance(InstanceSet* set, long int mesh,
+                             Transform* transform);
+double InstanceSet_radius(InstanceSet* set);
+long int InstanceSet_edgeCount(InstanceSet* set);
+bool InstanceSet_update(InstanceSet* set, Camera* cam);
+bool InstanceSet_project(InstanceSet* set, Scene* view);
+void InstanceSet_projectInstance(void* _set, int index);
+void InstanceSet_release(Instance* instance);
+bool InstanceSet_parseLine(InstanceSet* set, char* line, const char* dir);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_MESHFILE_
+#define _CCANVAS_MESHFILE_
+
+#include <ctype.h>
+#include <scene.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Loaders of the binary mesh formats, picked by the extension of the file
+ *   - .ply files in the binary little-endian format (scanners), the x, y and
+ *     z properties of the vertex element, the vertex_indices (or
+ *     vertex_index) list of the face element and the vertex1 and vertex2
+ *     properties of the edge element are loaded, the rest is skipped
+ *   - binary .stl files (CAD tools), the triangles repeat their corners, the
+ *     vertices at the same position are merged with Scene_weldRange
+ * The records are read in blocks of MESHFILE_BLOCK_SIZE bytes and converted
+ * straight from their binary layout. The edges of the faces are added
+ * without looking for duplicates, they are removed with a hash table once
+ * the whole file is loaded
+ * Every other file is loaded as a Wavefront .obj file
+ */
+typedef enum {
+  MESHFILE_OBJ,
+  MESHFILE_PLY,
+  MESHFILE_STL
+} MeshFile_Format;
+
+// Types of the PLY properties
+enum MeshFile_Types {
+  MESHFILE_INVALID,
+  MESHFILE_INT8,
+  MESHFILE_UINT8,
+  MESHFILE_INT16,
+  MESHFILE_UINT16,
+  MESHFILE_INT32,
+  MESHFILE_UINT32,
+  MESHFILE_FLOAT32,
+  MESHFILE_FLOAT64
+};
+
+// What a PLY property is loaded as
+enum MeshFile_Roles {
+  MESHFILE_SKIP,
+  MESHFILE_X,
+  MESHFILE_Y,
+  MESHFILE_Z,
+  MESHFILE_INDICES,  // Vertices of a face
+  MESHFILE_VERTEX1,  // Endpoints of an edge
+  MESHFILE_VERTEX2
+};
+
+typedef struct {
+  int type;       // Type of the value, or of the items of a list
+  int countType;  // Type of the length of a list, MESHFILE_INVALID if the
+                  // property is not a list
+  int role;
+} MeshFileProperty;
+
+#define MESHFILE_MAX_PROPERTIES 32
+// Files with faces of more vertices are not loaded
+#define MESHFILE_MAX_POLYGON 256
+#define MESHFILE_BLOCK_SIZE 1048576
+
+typedef struct {
+  char name[64];
+  long int count;
+  MeshFileProperty properties[MESHFILE_MAX_PROPERTIES];
+  int propertyCount;
+  long int maxSize;  // Size of the largest possible record in bytes
+} MeshFileElement;
+
+// Size of the header and of the triangles of a binary STL file
+#define MESHFILE_STL_HEADER 84
+#define MESHFILE_STL_TRIANGLE 50
+
+int MeshFile_formatOf(const char* fileName);
+bool MeshFile_hasExtension(const char* fileName, const char* extension);
+bool MeshFile_load(Scene* scene, const char* fileName);
+bool MeshFile_loadPly(Scene* scene, const char* fileName);
+int MeshFile_readPlyHeader(FILE* file, MeshFileElement* elements,
+                           int maxCount);
+int MeshFile_typeOf(const char* name);
+int MeshFile_typeSize(int type);
+double MeshFile_value(const uint8_t* data, int type);
+bool MeshFile_readElement(Scene* scene, FILE* file, MeshFileElement* element,
+                          long int base);
+bool MeshFile_loadStl(Scene* scene, const char* fileName);
+float MeshFile_float(const uint8_t* data);
+uint32_t MeshFile_uint32(const uint8_t* data);
+
+#endif
\ No newline at end of file
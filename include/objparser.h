@@ -0,0 +1,62 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_OBJPARSER_
+#define _CCANVAS_OBJPARSER_
+
+#include <decompress.h>
+#include <scene.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Size of the chunks read from files, pipes and sockets
+#define OBJPARSER_CHUNK_SIZE 65536
+
+/**
+ * Incremental Wawefront .obj parser
+ * The file can be fed in chunks of any size as they arrive (for example from a
+ * stream in the browser), every complete line is added to the scene right
+ * away, so the geometry builds up while the rest of the file is still loading
+ * A line that is cut in half by the end of a chunk is kept until the next one
+ * Input can also be pulled from a file descriptor a chunk at a time, so the
+ * caller decides how much is parsed in one go (for example a time budget for
+ * every frame) and can keep drawing while a file, pipe or socket is loading
+ * Input compressed with gzip or zstd is recognized by its first bytes and
+ * decompressed on a thread while it is parsed
+ */
+typedef struct {
+  Scene* scene;
+  char* line;  // The unfinished line carried over between chunks
+  size_t lineLength, lineCapacity;
+  bool started;  // The first bytes of the input were checked for compression
+  char prefix[DECOMPRESS_MAGIC_SIZE];  // First bytes kept until there are
+  size_t prefixLength;                 // enough of them to check
+  Decompressor* decompressor;  // Decompresses the input, NULL for plain text
+} ObjParser;
+
+ObjParser* ObjParser_create(Scene* scene);
+void ObjParser_append(ObjParser* parser, const char* data, size_t length);
+void ObjParser_feed(ObjParser* parser, const char* data, size_t length);
+void ObjParser_finish(ObjParser* parser);
+int ObjParser_openInput(const char* fileName, bool nonBlocking);
+long int ObjParser_read(ObjParser* parser, int fd);
+long int ObjParser_readInput(int fd, char* buffer, size_t size, bool wait);
+long int ObjParser_pull(ObjParser* parser, int fd, bool wait);
+long int ObjParser_readDecompressed(ObjParser* parser, bool wait);
+void ObjParser_closeInput(int fd);
+
+#endif
\ No newline at end of file
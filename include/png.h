@@ -0,0 +1,84 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_PNG_
+#define _CCANVAS_PNG_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Encoder of 8 bit RGBA images (the layout of the framebuffer) into PNG files
+ * without external libraries
+ *
+ * Every row gets the filter (none, sub or up) with the smallest sum of
+ * absolute values, then the rows are compressed into a single deflate block
+ * with the fixed Huffman codes. Matches are found greedily with a hash table
+ * of the last position of every 4 byte sequence, which is fast and does well
+ * on rendered lines, that are mostly long runs of the background
+ */
+typedef struct {
+  uint8_t* out;          // Output of the compressor
+  size_t size;           // Bytes written to it
+  uint64_t bits;         // Bits not written yet, the next one is the lowest
+  int bitCount;
+  uint16_t codes[288];   // Fixed Huffman codes of the literals and lengths,
+  uint8_t lengths[288];  // with their bits reversed as deflate writes them
+  uint32_t matchBits[256];  // Codes and extra bits of the match lengths from
+  uint8_t matchCounts[256];  // 3, ready to be written
+  uint8_t distanceCodes[30];
+  uint8_t distanceSymbols[512];  // Codes of the distances, see Png_putMatch
+  uint32_t crcTable[256];
+} PngEncoder;
+
+// Longest match and furthest distance deflate can refer to
+#define PNG_MAX_MATCH 258
+#define PNG_WINDOW 32768
+// Bits of the hash of the 4 byte sequences
+#define PNG_HASH_BITS 15
+
+/**
+ * Appends the lowest count (at most 32) bits of the value to the output
+ */
+inline void Png_putBits(PngEncoder* encoder, uint32_t value, int count) {
+  encoder->bits |= (uint64_t)value << encoder->bitCount;
+  encoder->bitCount += count;
+  if (encoder->bitCount >= 32) {
+    uint32_t word = (uint32_t)encoder->bits;
+    for (int i = 0; i < 4; i++)
+      encoder->out[encoder->size++] = (uint8_t)(word >> (8 * i));
+    encoder->bits >>= 32;
+    encoder->bitCount -= 32;
+  }
+}
+
+/**
+ * Returns the absolute value of the byte taken as a signed number
+ */
+inline uint8_t Png_magnitude(uint8_t value) {
+  uint8_t negated = -value;
+  return value < negated ? value : negated;
+}
+
+uint8_t* Png_encode(const uint8_t* rgba, int width, int height, size_t* size);
+void Png_init(PngEncoder* encoder);
+uint32_t Png_reverse(uint32_t code, int length);
+size_t Png_filterRows(const uint8_t* rgba, int width, int height,
+                      uint8_t* out);
+void Png_deflate(PngEncoder* encoder, const uint8_t* data, size_t size);
+void Png_putMatch(PngEncoder* encoder, int length, int distance);
+void Png_flushBits(PngEncoder* encoder);
+uint32_t Png_crc(PngEncoder* encoder, const uint8_t* data, size_t size);
+uint32_t Png_adler(const uint8_t* data, size_t size);
+void Png_putUint32(uint8_t* out, uint32_t value);
+void Png_endChunk(PngEncoder* encoder, size_t begin);
+int Png_log2(uint32_t value);
+
+#endif
\ No newline at end of file
@@ -18,9 +18,41 @@ typedef struct {
   double y;
 } Point;
 
-Point Point_new(double x, double y);
-double Point_dist(Point* p1, Point* p2);
-double Point_distSq(Point* p1, Point* p2);
-bool Point_equals(Point* p1, Point* p2);
+// The functions are defined inline so they can be inlined into the loops
+// using them, point.c has their external definitions
+
+/**
+ * Function for creating/initalising a new point struct
+ */
+inline Point Point_new(double x, double y) {
+  Point retVal;
+  retVal.x = x;
+  retVal.y = y;
+  return retVal;
+}
+
+/**
+ * Function for calculating the distance between two points
+ */
+inline double Point_dist(Point* p1, Point* p2) {
+  return sqrt((p1->x - p2->x) * (p1->x - p2->x) +
+              (p1->y - p2->y) * (p1->y - p2->y));
+}
+
+/**
+ * Function for calculating the square of the distance between two points
+ */
+inline double Point_distSq(Point* p1, Point* p2) {
+  return ((p1->x - p2->x) * (p1->x - p2->x) +
+          (p1->y - p2->y) * (p1->y - p2->y));
+}
+
+/**
+ * Function for checking if the two points represent the same point on the 2D
+ * plane or not
+ */
+inline bool Point_equals(Point* p1, Point* p2) {
+  return (p1->x == p2->x) && (p1->y == p2->y);
+}
 
 #endif
\ No newline at end of file
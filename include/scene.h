@@ -14,7 +14,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <transform.h>
 #include <vec3.h>
+#include <workers.h>
 
 /**
  * Struct for storing the vertex indices for the endpoints of an edge wich is
@@ -27,27 +29,205 @@ typedef struct {
 
 Edge Edge_new(long int a, long int b);
 
+/**
+ * The two faces next to an edge, as indices into the faces of the scene
+ * Face 0 is a placeholder that stands for no face
+ */
+typedef struct {
+  long int a;
+  long int b;
+} EdgeFaces;
+
+/**
+ * Plane of a polygon, the points p with dot(normal, p) + offset > 0 are in
+ * front of it
+ */
+typedef struct {
+  Vec3 normal;
+  double offset;
+} SceneFace;
+
+// Dihedral of the edges that do not have exactly two faces (boundaries,
+// polylines), they are always drawn as features
+#define SCENE_OPEN_EDGE -2.0f
+
+/**
+ * An object (an o or g record) of the .obj file: the contiguous ranges of
+ * its edges and of the vertices those edges refer to, with bounds around the
+ * vertices used for culling the whole object at once
+ */
+typedef struct {
+  long int vertexBegin, vertexEnd;
+  long int edgeBegin, edgeEnd;
+  Vec3 min, max;  // Axis aligned bounding box
+  Vec3 center;    // Bounding sphere around the box
+  double radius;
+} SceneObject;
+
+/**
+ * A range of vertices [begin, end) to be projected
+ */
+typedef struct {
+  long int begin, end;
+} SceneRange;
+
+/**
+ * Bits of the per-vertex visibility mask written by Scene_projectPoints
+ * An edge is drawn if both of its endpoints have the FRONT bit set, it is
+ * clipped to the guard band before drawing unless both have the GUARD bit too
+ * The OUTSIDE bits are the vertex's outcode relative to the screen, if both
+ * endpoints of an edge share one of them, the edge is completely off-screen
+ */
+enum Scene_VisibilityBits {
+  SCENE_VISIBLE_FRONT = 0x01,  // In front of the camera
+  SCENE_VISIBLE_GUARD = 0x02,  // Inside the guard band around the screen
+  SCENE_VISIBLE = 0x03,
+  SCENE_OUTSIDE_LEFT = 0x10,
+  SCENE_OUTSIDE_RIGHT = 0x20,
+  SCENE_OUTSIDE_TOP = 0x40,
+  SCENE_OUTSIDE_BOTTOM = 0x80,
+  SCENE_OUTSIDE = 0xF0
+};
+
+// Width of the guard band on each side of the screen, in screen sizes
+// Projected coordinates outside of it could overflow the rasterizer's integers
+#define SCENE_GUARD_BAND 4.0
+
 /**
  * Struct containing the whole scene that can be rendered: the camera and the
  * geometry data, plus the points projected to screen space
  */
 typedef struct {
   Camera cam;
+  Transform model;  // Places the vertices into the world, combined with the
+                    // view transform of the camera when projecting
   Vec3* vertices;
   long int verticesCount;
+  long int allocatedVertices;  // Capacity of the vertex array
+  Vec3 origin;    // Subtracted from the vertices before they are converted to
+                  // floats, so large coordinates keep their precision
+  float* localX;  // Vertices relative to the origin in single precision, one
+  float* localY;  // array per coordinate, only converted for scenes projected
+  float* localZ;  // in single precision
+  long int localCount;  // Number of vertices converted so far
+  long int allocatedLocal;
+  long int allocatedProjection;  // Capacity of the projected point arrays,
+                                 // they are only allocated when projecting
   Point* projectedPoints;
+  unsigned char* visibility;  // Visibility mask of every projected point
   Edge* edges;
   long int edgeCount;
+  long int allocatedEdges;  // Capacity of the per-edge arrays
+  EdgeFaces* edgeFaces;     // Faces next to every edge
+  float* dihedral;  // Cosine of the angle between the faces of every edge
+  SceneFace* faces;  // Planes of the polygons, used for finding silhouettes
+  long int faceCount;
+  long int allocatedFaces;
+  unsigned char* facing;  // 1 for the faces turned towards the camera
+  long int allocatedFacing;
+  SceneObject* objects;     // Objects of the geometry in the order of loading
+  long int objectCount;
+  long int allocatedObjects;
+  long int* visibleObjects;  // Objects intersecting the frustum, only their
+  long int visibleObjectCount;  // vertices are projected and their edges
+  long int allocatedVisibleObjects;  // compacted
+  SceneRange* ranges;  // Blocks of vertices of the visible objects to project
+  long int rangeCount;
+  long int allocatedRanges;
+  Edge* visibleEdges;  // Dense list of the edges that have to be drawn
+  long int visibleEdgeCount;
+  double minEdgeLength;  // Projected length in pixels below which edges are
+                         // not drawn as lines (a setting, it is not erased)
+  bool featureEdges;     // Only draw the silhouette and crease edges
+  bool backfaceCulling;  // Skip the edges of faces turned away from the camera
+  double creaseAngle;    // Angle of the faces above which an edge is a crease
+                         // (settings like minEdgeLength, they are not erased)
+  bool singlePrecision;  // Project the local vertices with floats instead of
+                         // the vertices with doubles (a setting as well)
+  long int* pixels;      // Screen positions (y * width + x) of the pixels
+                         // that the sub-pixel edges were merged into
+  long int pixelCount;
+  long int droppedEdgeCount;  // Visible edges not drawn as lines this frame
+  long int culledEdgeCount;   // Visible edges only next to back faces
+  unsigned char* pixelMask;   // One bit per screen pixel, used for merging
+  long int pixelMaskSize;
+  unsigned long version;  // Incremented whenever the geometry or the settings
+                          // change, the camera is compared separately
+  unsigned long projectedVersion;  // Version and camera used for the last
+  Camera projectedCam;             // projection
+  WorkerPool* workers;  // Pool used for projecting in parallel, serial if NULL
+                        // (a setting like minEdgeLength, it is not erased)
 } Scene;
 
+// Number of vertices projected by one job of the worker pool
+#define SCENE_PROJECTION_BLOCK 16384
+
+/**
+ * Data shared by the jobs projecting the blocks of vertices in parallel
+ */
+typedef struct {
+  Scene* scene;
+  Transform view;
+  float local[3][4];  // Takes the local vertices straight to camera space
+} SceneProjection;
+
+// Default of the singlePrecision setting, chosen at compile time
+#ifdef CCANVAS_SINGLE_PRECISION
+#define SCENE_SINGLE_PRECISION true
+#else
+#define SCENE_SINGLE_PRECISION false
+#endif
+
+void Scene_init(Scene* scene, WorkerPool* workers);
 void Scene_erase(Scene* scene);
 void Scene_setCamera(Scene* scene, Camera cam);
-void Scene_projectPoints(Scene* scene);
+void Scene_markChanged(Scene* scene);
+void Scene_copySettings(Scene* scene, Scene* view);
+bool Scene_changed(Scene* scene);
+bool Scene_projectPoints(Scene* scene);
+void Scene_prepareProjection(Scene* scene, SceneProjection* projection);
+void Scene_reserveProjection(Scene* scene);
+void Scene_cullObjects(Scene* scene);
+int Scene_compareRanges(const void* r1, const void* r2);
+void Scene_classifyFaces(Scene* scene);
+void Scene_projectRange(Scene* scene, Transform* view, long int begin,
+                        long int end);
+unsigned char Scene_pointVisibility(Point p, bool front, double w, double h);
+void Scene_updateLocal(Scene* scene);
+void Scene_localTransform(Scene* scene, Transform* view, float local[3][4]);
+void Scene_projectRangeSingle(Scene* scene, float local[3][4], long int begin,
+                              long int end);
+void Scene_projectBlock(void* _projection, int index);
+void Scene_projectVertices(SceneProjection* projection, long int begin,
+                           long int end);
+void Scene_compactEdges(Scene* scene);
+void Scene_beginCompaction(Scene* scene);
+void Scene_compactRange(Scene* scene, long int begin, long int end);
+bool Scene_edgePoints(Scene* scene, Edge e, Point* a, Point* b);
+bool Scene_clipToGuardBand(Point* a, Point* b, double width, double height);
 void Scene_loadObj(Scene* scene, const char* fileName);
+void Scene_reserveVertices(Scene* scene, long int count);
+void Scene_reserveEdges(Scene* scene, long int count);
+void Scene_pushVertex(Scene* scene, Vec3 vertex);
+void Scene_beginObject(Scene* scene);
+void Scene_extendObject(Scene* scene, long int vertex);
+void Scene_growObject(Scene* scene, SceneObject* object, long int vertex);
+long int Scene_pushFace(Scene* scene, long int* vertexList, int vertexCount);
+void Scene_attachFace(Scene* scene, long int edge, long int face);
+long int Scene_appendEdge(Scene* scene, long int a, long int b);
+long int Scene_weld(Scene* scene, double epsilon);
+long int Scene_weldRange(Scene* scene, double epsilon, long int first);
+void Scene_mergeEdges(Scene* scene, long int firstObject,
+                      const long int* remap, const bool* kept);
+long long Scene_weldCell(double value, double scale);
+long int Scene_hashCell(long long x, long long y, long long z, long int size);
+void Scene_parseObjLine(Scene* scene, char* line);
 void Scene_free(Scene* scene);
 double Scene_radius(Scene* scene);
+double Scene_rangeRadius(Scene* scene, long int begin, long int end);
 
-void readVertexNumbers(char* str, long int* vertexList, int* vertexCount);
-void pushEdgeNoDuplicates(Scene* scene, long a, long b);
+void readVertexNumbers(char* str, long int* vertexList, int* vertexCount,
+                       int maxCount);
+long int pushEdgeNoDuplicates(Scene* scene, long a, long b);
 
 #endif
\ No newline at end of file
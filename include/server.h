@@ -0,0 +1,199 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_SERVER_
+#define _CCANVAS_SERVER_
+
+#include <batch.h>
+#include <bench.h>
+#include <camera.h>
+#include <framebuffer.h>
+#include <png.h>
+#include <scene.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vec3.h>
+#include <workers.h>
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define SERVER_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Render server for previews and thumbnails over a Unix domain socket
+ *
+ * The scenes are loaded once when the server starts and numbered from 0 in
+ * the order they were given. A client sends ServerRequest records and gets a
+ * ServerReply header for each, followed by the bytes of the frame, in the
+ * order of the requests. Requests can be pipelined: the next ones can be sent
+ * before the replies of the earlier ones arrive. Numbers are in native byte
+ * order, the socket is local
+ *
+ * The I/O thread reads the requests of every client and writes the replies,
+ * without ever blocking on a client. The render thread takes the waiting
+ * requests as a batch, renders the views of every scene with one Batch and
+ * encodes the frames on the worker pool, while the I/O thread already reads
+ * the requests of the next batch
+ */
+typedef struct {
+  uint32_t scene;   // Index of the scene
+  uint32_t width;   // Resolution of the frame
+  uint32_t height;
+  uint32_t format;  // One of Server_Format
+  uint32_t flags;   // Bits of Server_Flags
+  uint32_t padding;
+  uint64_t tag;     // Returned in the reply as it is, for the client
+  double pos[3];    // Camera position
+  double look[3];   // Look direction
+  double up[3];     // Up direction, (0, 1, 0) if it is zero
+  double hFov;      // Fields of view in radians
+  double vFov;
+} ServerRequest;
+
+typedef struct {
+  uint32_t status;  // One of Server_Status
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint64_t tag;
+  uint64_t size;  // Bytes of the frame after the header, 0 on errors
+} ServerReply;
+
+/**
+ * Formats of the frames: rows of RGBA bytes from the top or a PNG file
+ */
+enum Server_Format { SERVER_FORMAT_RAW, SERVER_FORMAT_PNG };
+
+/**
+ * With SERVER_POSE_RELATIVE the position is in units of the radius of the
+ * scene, so clients can frame a scene without knowing its size
+ */
+enum Server_Flags { SERVER_POSE_RELATIVE = 0x01 };
+
+enum Server_Status {
+  SERVER_OK,
+  SERVER_UNKNOWN_SCENE,
+  SERVER_INVALID_SIZE,
+  SERVER_INVALID_FORMAT,
+  SERVER_INVALID_CAMERA
+};
+
+// Largest frame side the server renders
+#define SERVER_MAX_SIZE 4096
+// Most requests rendered together, every view of a batch holds a projection
+#define SERVER_MAX_BATCH 32
+// Requests of a client waiting for their replies above which the server
+// stops reading from it until it catches up
+#define SERVER_MAX_IN_FLIGHT 256
+// Bytes of replies waiting for a client above which the same happens
+#define SERVER_MAX_OUTPUT (64 * 1024 * 1024)
+
+#ifdef SERVER_SUPPORTED
+typedef struct {
+  ServerRequest request;
+  uint32_t status;
+  unsigned long connection;  // Id of the client that sent it
+  Framebuffer* frame;        // Rendered frame, in a view of a batch
+  uint8_t* reply;            // Header and frame bytes to send
+  size_t replySize;
+} ServerJob;
+
+typedef struct {
+  int socket;
+  unsigned long id;  // Unique, the slots of closed clients are reused
+  uint8_t request[sizeof(ServerRequest)];  // Request being received
+  size_t received;
+  uint8_t* out;  // Replies not sent yet
+  size_t outSize, outSent, allocatedOut;
+  long int inFlight;  // Requests read that were not replied to yet
+  bool closed;        // No more requests come, closed after the replies
+} ServerConnection;
+
+typedef struct {
+  ServerJob* jobs;
+  long int count;
+  long int allocated;
+} ServerQueue;
+
+typedef struct {
+  Scene* scenes;
+  double* radii;
+  Batch** batches;  // One per scene, reused from batch to batch
+  int sceneCount;
+  WorkerPool* workers;
+  int listener;
+  int wake[2];  // Pipe the render thread wakes the I/O thread up with
+  ServerConnection* connections;
+  int connectionCount;
+  int allocatedConnections;
+  unsigned long nextId;
+  pthread_t renderThread;
+  pthread_mutex_t lock;
+  pthread_cond_t jobsAvailable;
+  ServerQueue pending;  // Read, waiting for the render thread
+  ServerQueue done;     // Rendered, waiting for the I/O thread
+  ServerQueue batch;    // Being rendered, only used by the render thread
+  bool quit;
+} Server;
+#endif
+
+bool Server_run(const char* socketPath, char** fileNames, int sceneCount);
+bool Server_generateLoad(const char* socketPath, long int requests,
+                         int connections, int depth, uint32_t format,
+                         int size);
+
+#ifdef SERVER_SUPPORTED
+int Server_listen(const char* socketPath);
+void Server_accept(Server* server);
+bool Server_canRead(ServerConnection* connection);
+void Server_read(Server* server, ServerConnection* connection,
+                 ServerQueue* received);
+void Server_write(ServerConnection* connection);
+void Server_collectReplies(Server* server, ServerQueue* replies);
+void Server_compact(ServerConnection* connection);
+ServerConnection* Server_findConnection(Server* server, unsigned long id);
+uint32_t Server_validate(Server* server, ServerRequest* request);
+void* Server_renderThread(void* _server);
+void Server_renderBatch(Server* server);
+Camera Server_camera(Server* server, ServerRequest* request);
+void Server_encodeJob(void* _server, int index);
+void Server_push(ServerQueue* queue, ServerJob* job);
+void Server_append(uint8_t** buffer, size_t* size, size_t* allocated,
+                   const uint8_t* data, size_t length);
+void* Server_clientThread(void* _client);
+bool Server_sendAll(int socket, const void* data, size_t size);
+bool Server_receiveAll(int socket, void* data, size_t size);
+int Server_compareTimes(const void* t1, const void* t2);
+
+/**
+ * State of one connection of the load generator
+ */
+typedef struct {
+  const char* socketPath;
+  long int requests;  // Sent on this connection
+  int depth;          // Requests kept in flight
+  uint32_t format;
+  int size;
+  double* latencies;  // Seconds from sending to the end of the reply
+  uint64_t bytes;     // Frame bytes received
+  bool failed;
+} ServerClient;
+#endif
+
+#endif
\ No newline at end of file
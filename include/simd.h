@@ -0,0 +1,426 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_SIMD_
+#define _CCANVAS_SIMD_
+
+#include <stdint.h>
+
+/**
+ * Minimal portable abstraction over 128 bit SIMD vectors of two doubles
+ * The kernels are written once against these functions and compile to SSE2 on
+ * x86, to SIMD128 in the WASM build made with -msimd128 and to plain scalar
+ * code everywhere else
+ */
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SIMD_BACKEND "wasm-simd128"
+typedef v128_t SimdF64;
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_BACKEND "sse2"
+typedef __m128d SimdF64;
+#else
+#include <math.h>
+#define SIMD_BACKEND "scalar"
+typedef struct {
+  double v[2];
+} SimdF64;
+#endif
+
+static inline SimdF64 Simd_set(double a, double b) {
+#if defined(__wasm_simd128__)
+  return wasm_f64x2_make(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_set_pd(b, a);
+#else
+  SimdF64 r = {{a, b}};
+  return r;
+#endif
+}
+
+static inline SimdF64 Simd_splat(double a) { return Simd_set(a, a); }
+
+static inline SimdF64 Simd_add(SimdF64 a, SimdF64 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f64x2_add(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_add_pd(a, b);
+#else
+  return Simd_set(a.v[0] + b.v[0], a.v[1] + b.v[1]);
+#endif
+}
+
+static inline SimdF64 Simd_mul(SimdF64 a, SimdF64 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f64x2_mul(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_mul_pd(a, b);
+#else
+  return Simd_set(a.v[0] * b.v[0], a.v[1] * b.v[1]);
+#endif
+}
+
+static inline SimdF64 Simd_div(SimdF64 a, SimdF64 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f64x2_div(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_div_pd(a, b);
+#else
+  return Simd_set(a.v[0] / b.v[0], a.v[1] / b.v[1]);
+#endif
+}
+
+// Returns a*b+c
+static inline SimdF64 Simd_madd(SimdF64 a, SimdF64 b, SimdF64 c) {
+  return Simd_add(Simd_mul(a, b), c);
+}
+
+/**
+ * Comparisons return a bitmask with bit i set if the comparison is true in
+ * lane i, comparisons with NaN are always false
+ */
+static inline int Simd_lessMask(SimdF64 a, SimdF64 b) {
+#if defined(__wasm_simd128__)
+  return wasm_i64x2_bitmask(wasm_f64x2_lt(a, b));
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_movemask_pd(_mm_cmplt_pd(a, b));
+#else
+  return (a.v[0] < b.v[0]) | (a.v[1] < b.v[1]) << 1;
+#endif
+}
+
+static inline int Simd_lessEqualMask(SimdF64 a, SimdF64 b) {
+#if defined(__wasm_simd128__)
+  return wasm_i64x2_bitmask(wasm_f64x2_le(a, b));
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_movemask_pd(_mm_cmple_pd(a, b));
+#else
+  return (a.v[0] <= b.v[0]) | (a.v[1] <= b.v[1]) << 1;
+#endif
+}
+
+// Returns the lanes of a where the mask bit is set and the lanes of b elsewhere
+static inline SimdF64 Simd_select(int mask, SimdF64 a, SimdF64 b) {
+#if defined(__wasm_simd128__)
+  v128_t m = wasm_i64x2_make(-(long long)(mask & 1), -(long long)(mask >> 1));
+  return wasm_v128_bitselect(a, b, m);
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128d m = _mm_castsi128_pd(
+      _mm_set_epi32(-(mask >> 1), -(mask >> 1), -(mask & 1), -(mask & 1)));
+  return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+#else
+  return Simd_set((mask & 1) ? a.v[0] : b.v[0], (mask & 2) ? a.v[1] : b.v[1]);
+#endif
+}
+
+// Stores the two lanes to the unaligned address
+static inline void Simd_store(double* out, SimdF64 a) {
+#if defined(__wasm_simd128__)
+  wasm_v128_store(out, a);
+#elif defined(__SSE2__) || defined(_M_X64)
+  _mm_storeu_pd(out, a);
+#else
+  out[0] = a.v[0];
+  out[1] = a.v[1];
+#endif
+}
+
+// Stores (a[0], b[0]) to lo and (a[1], b[1]) to hi, used for writing
+// interleaved 2D points
+static inline void Simd_storeInterleaved(double* lo, double* hi, SimdF64 a,
+                                         SimdF64 b) {
+#if defined(__wasm_simd128__)
+  wasm_v128_store(lo, wasm_i64x2_shuffle(a, b, 0, 2));
+  wasm_v128_store(hi, wasm_i64x2_shuffle(a, b, 1, 3));
+#elif defined(__SSE2__) || defined(_M_X64)
+  _mm_storeu_pd(lo, _mm_unpacklo_pd(a, b));
+  _mm_storeu_pd(hi, _mm_unpackhi_pd(a, b));
+#else
+  lo[0] = a.v[0];
+  lo[1] = b.v[0];
+  hi[0] = a.v[1];
+  hi[1] = b.v[1];
+#endif
+}
+
+/**
+ * The same over vectors of four floats, used by the single precision
+ * projection kernel
+ */
+#if defined(__wasm_simd128__)
+typedef v128_t SimdF32;
+#elif defined(__SSE2__) || defined(_M_X64)
+typedef __m128 SimdF32;
+#else
+typedef struct {
+  float v[4];
+} SimdF32;
+#endif
+
+static inline SimdF32 SimdF32_set(float a, float b, float c, float d) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_make(a, b, c, d);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_set_ps(d, c, b, a);
+#else
+  SimdF32 r = {{a, b, c, d}};
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_splat(float a) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_splat(a);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_set1_ps(a);
+#else
+  SimdF32 r = {{a, a, a, a}};
+  return r;
+#endif
+}
+
+// Loads four floats from the unaligned address
+static inline SimdF32 SimdF32_load(const float* in) {
+#if defined(__wasm_simd128__)
+  return wasm_v128_load(in);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_loadu_ps(in);
+#else
+  SimdF32 r = {{in[0], in[1], in[2], in[3]}};
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_add(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_add(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_add_ps(a, b);
+#else
+  SimdF32 r = {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2],
+                a.v[3] + b.v[3]}};
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_mul(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_mul(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_mul_ps(a, b);
+#else
+  SimdF32 r = {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2],
+                a.v[3] * b.v[3]}};
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_div(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_div(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_div_ps(a, b);
+#else
+  SimdF32 r = {{a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2],
+                a.v[3] / b.v[3]}};
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_sub(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_sub(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_sub_ps(a, b);
+#else
+  SimdF32 r = {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2],
+                a.v[3] - b.v[3]}};
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_min(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_pmin(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_min_ps(a, b);
+#else
+  SimdF32 r;
+  for (int k = 0; k < 4; k++) r.v[k] = a.v[k] < b.v[k] ? a.v[k] : b.v[k];
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_max(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_pmax(a, b);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_max_ps(a, b);
+#else
+  SimdF32 r;
+  for (int k = 0; k < 4; k++) r.v[k] = a.v[k] > b.v[k] ? a.v[k] : b.v[k];
+  return r;
+#endif
+}
+
+static inline SimdF32 SimdF32_sqrt(SimdF32 a) {
+#if defined(__wasm_simd128__)
+  return wasm_f32x4_sqrt(a);
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_sqrt_ps(a);
+#else
+  SimdF32 r;
+  for (int k = 0; k < 4; k++) r.v[k] = sqrtf(a.v[k]);
+  return r;
+#endif
+}
+
+// Returns a*b+c
+static inline SimdF32 SimdF32_madd(SimdF32 a, SimdF32 b, SimdF32 c) {
+  return SimdF32_add(SimdF32_mul(a, b), c);
+}
+
+static inline int SimdF32_lessMask(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_i32x4_bitmask(wasm_f32x4_lt(a, b));
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_movemask_ps(_mm_cmplt_ps(a, b));
+#else
+  int mask = 0;
+  for (int k = 0; k < 4; k++) mask |= (a.v[k] < b.v[k]) << k;
+  return mask;
+#endif
+}
+
+static inline int SimdF32_lessEqualMask(SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  return wasm_i32x4_bitmask(wasm_f32x4_le(a, b));
+#elif defined(__SSE2__) || defined(_M_X64)
+  return _mm_movemask_ps(_mm_cmple_ps(a, b));
+#else
+  int mask = 0;
+  for (int k = 0; k < 4; k++) mask |= (a.v[k] <= b.v[k]) << k;
+  return mask;
+#endif
+}
+
+// Returns the lanes of a where the mask bit is set and the lanes of b elsewhere
+static inline SimdF32 SimdF32_select(int mask, SimdF32 a, SimdF32 b) {
+#if defined(__wasm_simd128__)
+  v128_t m = wasm_i32x4_make(-(mask & 1), -((mask >> 1) & 1),
+                             -((mask >> 2) & 1), -((mask >> 3) & 1));
+  return wasm_v128_bitselect(a, b, m);
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128 m = _mm_castsi128_ps(_mm_set_epi32(
+      -((mask >> 3) & 1), -((mask >> 2) & 1), -((mask >> 1) & 1), -(mask & 1)));
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+#else
+  SimdF32 r;
+  for (int k = 0; k < 4; k++) r.v[k] = (mask >> k) & 1 ? a.v[k] : b.v[k];
+  return r;
+#endif
+}
+
+// Stores the four lanes to the unaligned address
+static inline void SimdF32_store(float* out, SimdF32 a) {
+#if defined(__wasm_simd128__)
+  wasm_v128_store(out, a);
+#elif defined(__SSE2__) || defined(_M_X64)
+  _mm_storeu_ps(out, a);
+#else
+  for (int k = 0; k < 4; k++) out[k] = a.v[k];
+#endif
+}
+
+// Blends the pixel over the four 32 bit pixels at the unaligned address, each
+// with the coverage (0 to 1) in its lane, every byte is blended separately as
+// (pixel * a + dst * (256 - a)) / 256 with a the coverage in 1/256
+static inline void SimdF32_blendPixels(uint32_t* out, uint32_t pixel,
+                                       SimdF32 coverage) {
+#if defined(__wasm_simd128__)
+  v128_t a = wasm_i32x4_trunc_sat_f32x4(
+      wasm_f32x4_add(wasm_f32x4_mul(coverage, wasm_f32x4_splat(256)),
+                     wasm_f32x4_splat(0.5f)));
+  // Every 16 bit channel of a pixel gets the coverage of its lane
+  v128_t aLo = wasm_i8x16_shuffle(a, a, 0, 1, 0, 1, 0, 1, 0, 1, 4, 5, 4, 5, 4,
+                                  5, 4, 5);
+  v128_t aHi = wasm_i8x16_shuffle(a, a, 8, 9, 8, 9, 8, 9, 8, 9, 12, 13, 12, 13,
+                                  12, 13, 12, 13);
+  v128_t full = wasm_i16x8_splat(256);
+  v128_t src = wasm_u16x8_extend_low_u8x16(wasm_i32x4_splat(pixel));
+  v128_t dst = wasm_v128_load(out);
+  v128_t lo = wasm_u16x8_shr(
+      wasm_i16x8_add(wasm_i16x8_mul(src, aLo),
+                     wasm_i16x8_mul(wasm_u16x8_extend_low_u8x16(dst),
+                                    wasm_i16x8_sub(full, aLo))),
+      8);
+  v128_t hi = wasm_u16x8_shr(
+      wasm_i16x8_add(wasm_i16x8_mul(src, aHi),
+                     wasm_i16x8_mul(wasm_u16x8_extend_high_u8x16(dst),
+                                    wasm_i16x8_sub(full, aHi))),
+      8);
+  wasm_v128_store(out, wasm_u8x16_narrow_i16x8(lo, hi));
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128i a = _mm_cvtps_epi32(_mm_mul_ps(coverage, _mm_set1_ps(256)));
+  // Every 16 bit channel of a pixel gets the coverage of its lane
+  a = _mm_packs_epi32(a, a);
+  a = _mm_unpacklo_epi16(a, a);
+  __m128i aLo = _mm_unpacklo_epi32(a, a), aHi = _mm_unpackhi_epi32(a, a);
+  __m128i zero = _mm_setzero_si128(), full = _mm_set1_epi16(256);
+  __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((int)pixel), zero);
+  __m128i dst = _mm_loadu_si128((__m128i*)out);
+  __m128i lo = _mm_srli_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(src, aLo),
+                    _mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero),
+                                    _mm_sub_epi16(full, aLo))),
+      8);
+  __m128i hi = _mm_srli_epi16(
+      _mm_add_epi16(_mm_mullo_epi16(src, aHi),
+                    _mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero),
+                                    _mm_sub_epi16(full, aHi))),
+      8);
+  _mm_storeu_si128((__m128i*)out, _mm_packus_epi16(lo, hi));
+#else
+  for (int k = 0; k < 4; k++) {
+    uint32_t a = (uint32_t)(coverage.v[k] * 256 + 0.5f), keep = 256 - a;
+    uint32_t rb = (pixel & 0x00FF00FF) * a + (out[k] & 0x00FF00FF) * keep;
+    uint32_t ga =
+        ((pixel >> 8) & 0x00FF00FF) * a + ((out[k] >> 8) & 0x00FF00FF) * keep;
+    out[k] = ((rb >> 8) & 0x00FF00FF) | (ga & 0xFF00FF00);
+  }
+#endif
+}
+
+// Widens the lanes to doubles and stores them as four interleaved 2D points
+// (x[0], y[0], ..., x[3], y[3]) to the unaligned address
+static inline void SimdF32_storePoints(double* out, SimdF32 x, SimdF32 y) {
+#if defined(__wasm_simd128__)
+  v128_t lo = wasm_i32x4_shuffle(x, y, 0, 4, 1, 5);
+  v128_t hi = wasm_i32x4_shuffle(x, y, 2, 6, 3, 7);
+  wasm_v128_store(out, wasm_f64x2_promote_low_f32x4(lo));
+  wasm_v128_store(out + 2, wasm_f64x2_promote_low_f32x4(
+                               wasm_i64x2_shuffle(lo, lo, 1, 1)));
+  wasm_v128_store(out + 4, wasm_f64x2_promote_low_f32x4(hi));
+  wasm_v128_store(out + 6, wasm_f64x2_promote_low_f32x4(
+                               wasm_i64x2_shuffle(hi, hi, 1, 1)));
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128 lo = _mm_unpacklo_ps(x, y), hi = _mm_unpackhi_ps(x, y);
+  _mm_storeu_pd(out, _mm_cvtps_pd(lo));
+  _mm_storeu_pd(out + 2, _mm_cvtps_pd(_mm_movehl_ps(lo, lo)));
+  _mm_storeu_pd(out + 4, _mm_cvtps_pd(hi));
+  _mm_storeu_pd(out + 6, _mm_cvtps_pd(_mm_movehl_ps(hi, hi)));
+#else
+  for (int k = 0; k < 4; k++) {
+    out[2 * k] = x.v[k];
+    out[2 * k + 1] = y.v[k];
+  }
+#endif
+}
+
+#endif
\ No newline at end of file
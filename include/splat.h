@@ -0,0 +1,61 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_SPLAT_
+#define _CCANVAS_SPLAT_
+
+#include <framebuffer.h>
+#include <scene.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <transform.h>
+#include <workers.h>
+
+// Number of points splatted by one job of the worker pool
+#define SPLAT_BLOCK 65536
+// Number of rows resolved by one job when the depth test is on
+#define SPLAT_ROWS 32
+// Depth of the pixels no point was drawn to
+#define SPLAT_EMPTY 0xFFFFFFFFu
+
+/**
+ * Renders the vertices of a scene as a point cloud, used for scenes without
+ * edges
+ * Every vertex is projected and written straight into a framebuffer as a
+ * square of pointSize pixels, the points are split into blocks that are
+ * projected and splatted in parallel on the worker pool
+ * With the depth test on, the first pass only keeps the depth of the nearest
+ * point in every pixel (with an atomic minimum, so the blocks can run in
+ * parallel), the second pass then colors the covered pixels, darker with the
+ * distance
+ */
+typedef struct {
+  int pointSize;
+  bool depthTest;
+  double fogDistance;  // Distance where the shading reaches its darkest
+  uint32_t* depth;     // Depth buffer, float bits of the view space depth
+  long int depthSize;
+  // State of the frame being drawn, shared by the jobs
+  Scene* scene;
+  Framebuffer* target;
+  Transform view;
+  uint32_t pixel;
+} Splat;
+
+void Splat_init(Splat* splat);
+void Splat_free(Splat* splat);
+void Splat_draw(Splat* splat, Scene* scene, Framebuffer* target,
+                uint32_t pixel);
+void Splat_block(void* _splat, int index);
+void Splat_range(Splat* splat, long int begin, long int end);
+void Splat_write(Splat* splat, double x, double y, double z);
+void Splat_resolveRows(void* _splat, int index);
+void Splat_depthMin(uint32_t* depth, uint32_t value);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_MATH_TRANSFORM_
+#define _CCANVAS_MATH_TRANSFORM_
+
+#include <vec3.h>
+
+/**
+ * Structure representing an affine transformation in 3D space as a 3x4 matrix
+ * The last column is the translation
+ */
+typedef struct {
+  double m[3][4];
+} Transform;
+
+/**
+ * Transforms the given point and returns the result
+ * Defined inline, it is used for every vertex in a few loops
+ */
+inline Vec3 Transform_apply(Transform* t, Vec3* v) {
+  return Vec3_new(
+      t->m[0][0] * v->x + t->m[0][1] * v->y + t->m[0][2] * v->z + t->m[0][3],
+      t->m[1][0] * v->x + t->m[1][1] * v->y + t->m[1][2] * v->z + t->m[1][3],
+      t->m[2][0] * v->x + t->m[2][1] * v->y + t->m[2][2] * v->z + t->m[2][3]);
+}
+
+Transform Transform_identity();
+Transform Transform_fromBasis(Vec3* xAxis, Vec3* yAxis, Vec3* zAxis,
+                              Vec3* origin);
+Transform Transform_multiply(Transform* t1, Transform* t2);
+double Transform_scale(Transform* t);
+Transform Transform_invert(Transform* t);
+
+#endif
\ No newline at end of file
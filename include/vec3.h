@@ -20,25 +20,143 @@ typedef struct {
   double x, y, z;
 } Vec3;
 
-Vec3 Vec3_new(double _x, double _y, double _z);
-Vec3 Vec3_copy(Vec3 *src);
-bool Vec3_equals(Vec3 *v, Vec3 *w);
-double Vec3_length(Vec3 *v);
-double Vec3_sqLength(Vec3 *v);
-void Vec3_mult(Vec3 *v, double num);
-void Vec3_div(Vec3 *v, double num);
-double Vec3_dot(Vec3 *v1, Vec3 *v2);
+// The small functions are defined inline here, so they can be inlined into
+// the loops using them in other files, vec3.c has their external definitions
+
+/**
+ * Creates a new 3-dimensional vector
+ */
+inline Vec3 Vec3_new(double _x, double _y, double _z) {
+  Vec3 v;
+  v.x = _x;
+  v.y = _y;
+  v.z = _z;
+  return v;
+}
+
+/**
+ * Copies the value of a vector into a new variable and returrns it
+ */
+inline Vec3 Vec3_copy(Vec3 *src) {
+  Vec3 ret;
+  ret.x = src->x;
+  ret.y = src->y;
+  ret.z = src->z;
+  return ret;
+}
+
+/**
+ * Compares two vectors and returns true if they are the same
+ */
+inline bool Vec3_equals(Vec3 *v, Vec3 *w) {
+  return (v->x == w->x) && (v->y == w->y) && (v->z == w->z);
+}
+
+/**
+ * Returns the length (magnitude) of the given vector
+ */
+inline double Vec3_length(Vec3 *v) {
+  return sqrt(v->x * v->x + v->y * v->y + v->z * v->z);
+}
+
+/**
+ * Returns the length of the given vector squared
+ * A lot faster than getting the actual length
+ * Useful for comparing two vetors' lengths
+ */
+inline double Vec3_sqLength(Vec3 *v) {
+  return (v->x * v->x + v->y * v->y + v->z * v->z);
+}
+
+/**
+ * Multiplies the vector by the given number
+ */
+inline void Vec3_mult(Vec3 *v, double num) {
+  v->x *= num;
+  v->y *= num;
+  v->z *= num;
+}
+
+/**
+ * Divides the vector by the given number
+ * When divided by 0, nothing happens
+ */
+inline void Vec3_div(Vec3 *v, double num) {
+  if (num == 0) return;
+  v->x /= num;
+  v->y /= num;
+  v->z /= num;
+}
+
+/**
+ * Returns the dot product of the given vectors
+ */
+inline double Vec3_dot(Vec3 *v1, Vec3 *v2) {
+  return v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
+}
+
+/**
+ * Adds the second vector to the first one
+ */
+inline void Vec3_add(Vec3 *v1, Vec3 *v2) {
+  v1->x += v2->x;
+  v1->y += v2->y;
+  v1->z += v2->z;
+}
+
+/**
+ * Subtracts the second vector from the first one
+ */
+inline void Vec3_sub(Vec3 *v1, Vec3 *v2) {
+  v1->x -= v2->x;
+  v1->y -= v2->y;
+  v1->z -= v2->z;
+}
+
+/**
+ * Linearly interpolates between two given vectors and returns the newly created
+ * one If t = 1 then the returned vector equals v2 And if t = 0 the returned
+ * vector equals v1 If t is outside [0, 1], the function is extrapolating
+ */
+inline Vec3 Vec3_lerp(Vec3 *v1, Vec3 *v2, double t) {
+  Vec3 ret = Vec3_copy(v1);
+  ret.x += (v2->x - v1->x) * t;
+  ret.y += (v2->y - v1->y) * t;
+  ret.z += (v2->z - v1->z) * t;
+  return ret;
+}
+
+/**
+ * Keeps the direction of vector v but sets it's length to the given number
+ * In case the length to be set to is negative, the resulting vector is going to
+ * flip direction
+ */
+inline void Vec3_setLength(Vec3 *v, double lenToSet) {
+  double len = Vec3_length(v);
+  if (len == 0) return;
+  double mult = lenToSet / len;
+  v->x *= mult;
+  v->y *= mult;
+  v->z *= mult;
+}
+
+/**
+ * Calculates the cross product of the two given vectors and returns the product
+ */
+inline Vec3 Vec3_cross(Vec3 *v1, Vec3 *v2) {
+  Vec3 v;
+  v.x = v1->y * v2->z - v1->z * v2->y;
+  v.y = v1->z * v2->x - v1->x * v2->z;
+  v.z = v1->x * v2->y - v1->y * v2->x;
+  return v;
+}
+
 double Vec3_dotSq(Vec3 *v1, Vec3 *v2);
-void Vec3_add(Vec3 *v1, Vec3 *v2);
-void Vec3_sub(Vec3 *v1, Vec3 *v2);
 double Vec3_angle(Vec3 *v, Vec3 *w);
-Vec3 Vec3_lerp(Vec3 *v1, Vec3 *v2, double t);
-void Vec3_setLength(Vec3 *v, double lenToSet);
 void Vec3_rotateX(Vec3 *v, double angle);
 void Vec3_rotateY(Vec3 *v, double angle);
 void Vec3_rotateZ(Vec3 *v, double angle);
 void Vec3_rotateAroundAxis(Vec3 *v, Vec3 *axis, double angle);
-Vec3 Vec3_cross(Vec3 *v1, Vec3 *v2);
 Vec3 Vec3_cylindrical(double r, double angle, double z);
 
 #endif
\ No newline at end of file
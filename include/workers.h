@@ -0,0 +1,58 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#ifndef _CCANVAS_WORKERS_
+#define _CCANVAS_WORKERS_
+
+#include <stdbool.h>
+
+// Builds without thread support (like the default WASM build) run every job on
+// the calling thread
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define WORKERS_NO_THREADS
+#else
+#include <pthread.h>
+#endif
+
+// Function type of the jobs, recieves the shared data and the job's index
+typedef void (*workerJobFunc)(void*, int);
+
+/**
+ * Struct for a pool of threads that run batches of jobs in parallel
+ * The thread calling WorkerPool_run also takes jobs, so a pool of size n has
+ * n - 1 threads of its own
+ */
+typedef struct {
+  int size;
+#ifndef WORKERS_NO_THREADS
+  pthread_t* threads;
+  pthread_mutex_t lock;
+  pthread_cond_t workAvailable;
+  pthread_cond_t workDone;
+  workerJobFunc job;  // The batch currently being run
+  void* data;
+  int jobCount;
+  int nextJob;      // Index of the next job to be taken
+  int runningJobs;  // Number of jobs taken but not finished yet
+  unsigned long batch;  // Incremented for every new batch
+  bool quit;
+#endif
+} WorkerPool;
+
+int WorkerPool_defaultSize();
+WorkerPool* WorkerPool_create(int size);
+void WorkerPool_run(WorkerPool* pool, workerJobFunc job, void* data,
+                    int jobCount);
+void WorkerPool_destroy(WorkerPool* pool);
+
+#ifndef WORKERS_NO_THREADS
+void WorkerPool_takeJobs(WorkerPool* pool);
+void* WorkerPool_thread(void* _pool);
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,250 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <batch.h>
+
+/**
+ * Creates the views of the source scene for the given cameras, with white
+ * plain lines on black
+ */
+Batch* Batch_create(Scene* source, Camera* cams, int viewCount) {
+  Batch* batch = (Batch*)malloc(sizeof(Batch));
+  batch->source = source;
+  batch->views = NULL;
+  batch->viewCount = 0;
+  batch->allocatedViews = 0;
+  batch->lineWidth = 0;
+  batch->background = Framebuffer_color(0x000000FF);
+  batch->pixel = Framebuffer_color(0xFFFFFFFF);
+  Batch_setViewCount(batch, viewCount);
+  for (int i = 0; i < viewCount; i++) Batch_setCamera(batch, i, cams[i]);
+  return batch;
+}
+
+/**
+ * Changes the number of views, the new ones have to be given a camera
+ * Views above the count are kept allocated for when the count grows again
+ */
+void Batch_setViewCount(Batch* batch, int viewCount) {
+  if (viewCount > batch->allocatedViews) {
+    batch->views =
+        (BatchView*)realloc(batch->views, viewCount * sizeof(BatchView));
+    for (int i = batch->allocatedViews; i < viewCount; i++) {
+      BatchView* view = &batch->views[i];
+      Scene_init(&view->scene, NULL);
+      view->target.pixels = NULL;
+      view->target.width = view->target.height = 0;
+    }
+    batch->allocatedViews = viewCount;
+  }
+  batch->viewCount = viewCount;
+}
+
+/**
+ * Frees the projections and the framebuffers of the views, the geometry
+ * belongs to the source scene
+ */
+void Batch_free(Batch* batch) {
+  if (batch == NULL) return;
+  for (int i = 0; i < batch->allocatedViews; i++) {
+    Scene* scene = &batch->views[i].scene;
+    free(scene->projectedPoints);
+    free(scene->visibility);
+    free(scene->visibleEdges);
+    free(scene->pixels);
+    free(scene->pixelMask);
+    free(scene->visibleObjects);
+    free(scene->ranges);
+    free(scene->facing);
+    Framebuffer_free(&batch->views[i].target);
+  }
+  free(batch->views);
+  free(batch);
+}
+
+/**
+ * Moves the camera of a view, its framebuffer follows the resolution
+ */
+void Batch_setCamera(Batch* batch, int index, Camera cam) {
+  BatchView* view = &batch->views[index];
+  view->scene.cam = cam;
+  Framebuffer_resize(&view->target, cam.hRes, cam.vRes);
+}
+
+/**
+ * Renders every view into its framebuffer
+ * The views are prepared first (object culling and face classification),
+ * then all of them are projected block by block and compacted block by block,
+ * and finally drawn
+ * Drawing is left to the end: the lines of one view are drawn in one go, as
+ * drawing the blocks of every view in turn keeps evicting the framebuffers
+ */
+void Batch_render(Batch* batch) {
+  Scene* source = batch->source;
+  // Converted once before the jobs start, the views share the result
+  if (source->singlePrecision) Scene_updateLocal(source);
+  Batch_run(batch, Batch_prepareView);
+
+  long int block = SCENE_PROJECTION_BLOCK;
+  for (long int b = 0; b < source->verticesCount; b += block) {
+    batch->blockBegin = b;
+    batch->blockEnd = b + block < source->verticesCount ? b + block
+                                                        : source->verticesCount;
+    Batch_run(batch, Batch_projectView);
+  }
+  for (long int b = 0; b < source->edgeCount; b += block) {
+    batch->blockBegin = b;
+    batch->blockEnd =
+        b + block < source->edgeCount ? b + block : source->edgeCount;
+    Batch_run(batch, Batch_compactView);
+  }
+  Batch_run(batch, Batch_drawView);
+}
+
+/**
+ * Job of the worker pool preparing the projection of the index-th view
+ */
+void Batch_prepareView(void* _batch, int index) {
+  Batch* batch = (Batch*)_batch;
+  BatchView* view = &batch->views[index];
+  Batch_share(batch, view);
+  Scene_prepareProjection(&view->scene, &view->projection);
+  Scene_beginCompaction(&view->scene);
+  view->nextRange = 0;
+  view->nextObject = 0;
+}
+
+/**
+ * Points the scene of the view to the current geometry and settings of the
+ * source, the per-edge arrays grow with the edges
+ */
+void Batch_share(Batch* batch, BatchView* view) {
+  Scene* source = batch->source;
+  Scene* scene = &view->scene;
+  Camera cam = scene->cam;
+  Scene_copySettings(scene, source);
+  scene->cam = cam;
+  scene->model = source->model;
+  scene->vertices = source->vertices;
+  scene->verticesCount = source->verticesCount;
+  scene->edges = source->edges;
+  scene->edgeCount = source->edgeCount;
+  scene->objects = source->objects;
+  scene->objectCount = source->objectCount;
+  scene->edgeFaces = source->edgeFaces;
+  scene->dihedral = source->dihedral;
+  scene->faces = source->faces;
+  scene->faceCount = source->faceCount;
+  if (scene->singlePrecision) {
+    scene->origin = source->origin;
+    scene->localX = source->localX;
+    scene->localY = source->localY;
+    scene->localZ = source->localZ;
+    scene->localCount = source->localCount;
+  }
+  if (scene->edgeCount > scene->allocatedEdges) {
+    scene->visibleEdges = (Edge*)realloc(scene->visibleEdges,
+                                         scene->edgeCount * sizeof(Edge));
+    scene->pixels = (long int*)realloc(scene->pixels,
+                                       scene->edgeCount * sizeof(long int));
+    scene->allocatedEdges = scene->edgeCount;
+  }
+}
+
+/**
+ * Runs a job for every view, on the worker pool of the source if it has one
+ */
+void Batch_run(Batch* batch, workerJobFunc job) {
+  WorkerPool* workers = batch->source->workers;
+  if (workers != NULL && batch->viewCount > 1) {
+    WorkerPool_run(workers, job, batch, batch->viewCount);
+  } else {
+    for (int i = 0; i < batch->viewCount; i++) job(batch, i);
+  }
+}
+
+/**
+ * Job of the worker pool projecting the part of the current block of
+ * vertices that falls into the ranges of the index-th view
+ * The ranges are sorted and do not overlap, so the ones before nextRange are
+ * finished and the first one after the block ends the search
+ */
+void Batch_projectView(void* _batch, int index) {
+  Batch* batch = (Batch*)_batch;
+  BatchView* view = &batch->views[index];
+  Scene* scene = &view->scene;
+  long int begin = batch->blockBegin, end = batch->blockEnd;
+  while (view->nextRange < scene->rangeCount) {
+    SceneRange* range = &scene->ranges[view->nextRange];
+    if (range->begin >= end) break;
+    long int from = range->begin > begin ? range->begin : begin;
+    long int to = range->end < end ? range->end : end;
+    if (from < to) Scene_projectVertices(&view->projection, from, to);
+    if (range->end > end) break;
+    view->nextRange++;
+  }
+}
+
+/**
+ * Job of the worker pool compacting the part of the current block of edges
+ * that belongs to the visible objects of the index-th view, the same way the
+ * ranges are walked when projecting
+ */
+void Batch_compactView(void* _batch, int index) {
+  Batch* batch = (Batch*)_batch;
+  BatchView* view = &batch->views[index];
+  Scene* scene = &view->scene;
+  long int begin = batch->blockBegin, end = batch->blockEnd;
+  if (scene->objectCount == 0) {
+    Scene_compactRange(scene, begin, end);
+    return;
+  }
+  while (view->nextObject < scene->visibleObjectCount) {
+    SceneObject* object =
+        &scene->objects[scene->visibleObjects[view->nextObject]];
+    if (object->edgeBegin >= end) break;
+    long int from = object->edgeBegin > begin ? object->edgeBegin : begin;
+    long int to = object->edgeEnd < end ? object->edgeEnd : end;
+    if (from < to) Scene_compactRange(scene, from, to);
+    if (object->edgeEnd > end) break;
+    view->nextObject++;
+  }
+}
+
+/**
+ * Job of the worker pool drawing the index-th view into its framebuffer
+ */
+void Batch_drawView(void* _batch, int index) {
+  Batch* batch = (Batch*)_batch;
+  BatchView* view = &batch->views[index];
+  Framebuffer_clear(&view->target, batch->background);
+  Batch_drawScene(&view->scene, &view->target, batch->lineWidth, batch->pixel);
+}
+
+/**
+ * Draws the collected edges and pixels the same way the app does, with plain
+ * lines if the width is 0 and anti-aliased lines otherwise
+ */
+void Batch_drawScene(Scene* scene, Framebuffer* fb, double lineWidth,
+                     uint32_t pixel) {
+  for (long int i = 0; i < scene->visibleEdgeCount; i++) {
+    Point a, b;
+    if (!Scene_edgePoints(scene, scene->visibleEdges[i], &a, &b)) continue;
+    if (lineWidth == 0)
+      Framebuffer_line(fb, a.x, a.y, b.x, b.y, pixel);
+    else if (lineWidth == 1)
+      Framebuffer_lineAA(fb, a.x, a.y, b.x, b.y, pixel);
+    else
+      Framebuffer_thickLine(fb, a.x, a.y, b.x, b.y, lineWidth,
+                            FRAMEBUFFER_CAP_ROUND, pixel);
+  }
+  long int width = scene->cam.hRes;
+  for (long int i = 0; i < scene->pixelCount; i++)
+    Framebuffer_point(fb, scene->pixels[i] % width, scene->pixels[i] / width,
+                      pixel);
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <bench.h>
+
+/**
+ * Renders the given number of frames of the scene in every mode and prints
+ * the time spent per frame
+ * The vertices closer than weldEpsilon are merged after loading, unless it is
+ * negative
+ * Returns false if the file could not be loaded
+ */
+bool Bench_run(const char* fileName, int frames, double weldEpsilon) {
+  Scene scene;
+  Scene_init(&scene, WorkerPool_create(WorkerPool_defaultSize()));
+
+  double start = Bench_now();
+  MeshFile_load(&scene, fileName);
+  double loadTime = Bench_now() - start;
+  if (scene.verticesCount == 0) {
+    fprintf(stderr, "Could not load %s\n", fileName);
+    WorkerPool_destroy(scene.workers);
+    return false;
+  }
+  printf("%s: %ld vertices, %ld edges, %ld faces, loaded in %.1f ms\n",
+         fileName, scene.verticesCount, scene.edgeCount, scene.faceCount,
+         loadTime * 1000);
+  if (weldEpsilon >= 0) {
+    long int vertices = scene.verticesCount, edges = scene.edgeCount;
+    start = Bench_now();
+    Scene_weld(&scene, weldEpsilon);
+    printf("welded to %ld vertices (-%.1f%%), %ld edges (-%.1f%%) in %.1f ms\n",
+           scene.verticesCount,
+           100.0 * (vertices - scene.verticesCount) / vertices,
+           scene.edgeCount,
+           edges > 0 ? 100.0 * (edges - scene.edgeCount) / edges : 0.0,
+           (Bench_now() - start) * 1000);
+  }
+
+  Framebuffer fb = Framebuffer_new(BENCH_WIDTH, BENCH_HEIGHT);
+  double radius = Scene_radius(&scene);
+  const char* modes[] = {"all edges",
+                         "back-face culling",
+                         "silhouettes and creases",
+                         "all edges in single precision",
+                         "all edges anti-aliased",
+                         "all edges anti-aliased 3px wide"};
+  for (int mode = 0; mode < 6; mode++) {
+    scene.backfaceCulling = mode == 1;
+    scene.featureEdges = mode == 2;
+    scene.singlePrecision = mode == 3;
+    double lineWidth = mode == 4 ? 1 : mode == 5 ? 3 : 0;
+    double projectTime;
+    long int drawnEdges;
+    double time = Bench_pass(&scene, &fb, radius, frames, lineWidth,
+                             &projectTime, &drawnEdges);
+    printf("%s: %.3f ms per frame (%.3f ms projecting), %ld edges drawn\n",
+           modes[mode], time * 1000 / frames, projectTime * 1000 / frames,
+           drawnEdges / frames);
+  }
+
+  Framebuffer_free(&fb);
+  WorkerPool_destroy(scene.workers);
+  Scene_free(&scene);
+  return true;
+}
+
+/**
+ * Renders the frames of one full circle around the scene, returns the time
+ * it took and the part of it spent on projecting and compacting
+ */
+double Bench_pass(Scene* scene, Framebuffer* fb, double radius, int frames,
+                  double lineWidth, double* projectTime,
+                  long int* drawnEdges) {
+  uint32_t background = Framebuffer_color(0x000000FF);
+  uint32_t brush = Framebuffer_color(0xFFFFFFFF);
+  scene->cam = Camera_new(Vec3_new(0, 0, 0), Vec3_new(0, 1, 0), BENCH_WIDTH,
+                          BENCH_HEIGHT, 3.14 / 3, 3.14 / 3);
+  *projectTime = 0;
+  *drawnEdges = 0;
+
+  double start = Bench_now();
+  for (int i = 0; i < frames; i++) {
+    // The same orbit as the idle camera of the app
+    double angle = 2 * M_PI * i / frames;
+    Vec3 pos = Vec3_cylindrical(radius, angle, radius / 1.2);
+    Vec3 direction = Vec3_copy(&pos);
+    Vec3_setLength(&direction, -1);
+    Camera_setLookDirection(&(scene->cam), &direction);
+    scene->cam.pos = pos;
+
+    double projectStart = Bench_now();
+    if (Scene_projectPoints(scene)) Scene_compactEdges(scene);
+    *projectTime += Bench_now() - projectStart;
+
+    Framebuffer_clear(fb, background);
+    Batch_drawScene(scene, fb, lineWidth, brush);
+    *drawnEdges += scene->visibleEdgeCount;
+  }
+  return Bench_now() - start;
+}
+
+/**
+ * Renders the given number of views on the orbit of Bench_pass, first one by
+ * one and then all at once with a batch, and prints the time spent per view
+ * The frames of the batch are saved as prefixN.ppm if a prefix is given
+ * Returns false if the file could not be loaded or a frame could not be saved
+ */
+bool Bench_views(const char* fileName, int viewCount, const char* prefix) {
+  Scene scene;
+  Scene_init(&scene, WorkerPool_create(WorkerPool_defaultSize()));
+  MeshFile_load(&scene, fileName);
+  if (scene.verticesCount == 0 || viewCount < 1) {
+    fprintf(stderr, "Could not load %s\n", fileName);
+    WorkerPool_destroy(scene.workers);
+    return false;
+  }
+
+  double radius = Scene_radius(&scene);
+  Camera* cams = (Camera*)malloc(viewCount * sizeof(Camera));
+  for (int i = 0; i < viewCount; i++) {
+    cams[i] = Camera_new(Vec3_cylindrical(radius, 2 * M_PI * i / viewCount,
+                                          radius / 1.2),
+                         Vec3_new(0, 1, 0), BENCH_WIDTH, BENCH_HEIGHT,
+                         3.14 / 3, 3.14 / 3);
+    Vec3 direction = Vec3_copy(&cams[i].pos);
+    Vec3_setLength(&direction, -1);
+    Camera_setLookDirection(&cams[i], &direction);
+  }
+
+  // Both ways draw into the framebuffers of the batch, which are touched by a
+  // first render that is not measured
+  Batch* batch = Batch_create(&scene, cams, viewCount);
+  Batch_render(batch);
+  double start = Bench_now();
+  for (int i = 0; i < viewCount; i++) {
+    scene.cam = cams[i];
+    if (Scene_projectPoints(&scene)) Scene_compactEdges(&scene);
+    Framebuffer_clear(&batch->views[i].target, batch->background);
+    Batch_drawScene(&scene, &batch->views[i].target, 0, batch->pixel);
+  }
+  double single = Bench_now() - start;
+
+  start = Bench_now();
+  Batch_render(batch);
+  double batched = Bench_now() - start;
+  printf("%d views: %.3f ms per view one by one, %.3f ms per view batched\n",
+         viewCount, single * 1000 / viewCount, batched * 1000 / viewCount);
+
+  bool saved = true;
+  for (int i = 0; prefix != NULL && i < viewCount; i++) {
+    char name[1024];
+    snprintf(name, sizeof(name), "%s%d.ppm", prefix, i);
+    saved &= Framebuffer_savePPM(&batch->views[i].target, name);
+  }
+
+  Batch_free(batch);
+  free(cams);
+  WorkerPool_destroy(scene.workers);
+  Scene_free(&scene);
+  return saved;
+}
+
+/**
+ * Loads every file BENCH_LOAD_RUNS times with a cold page cache, then as many
+ * times with a warm one, and prints the median load times, compared to the
+ * first file
+ * Returns false if a file could not be loaded
+ */
+bool Bench_load(char** fileNames, int count) {
+  double reference[2] = {0, 0};
+  for (int i = 0; i < count; i++) {
+    double times[2][BENCH_LOAD_RUNS];
+    long int vertices = 0, edges = 0;
+    bool evicted = true;
+    for (int run = 0; run < 2 * BENCH_LOAD_RUNS; run++) {
+      bool cold = run < BENCH_LOAD_RUNS;
+      if (cold) evicted &= Bench_evict(fileNames[i]);
+      Scene scene;
+      Scene_init(&scene, NULL);
+      double start = Bench_now();
+      MeshFile_load(&scene, fileNames[i]);
+      times[cold][run % BENCH_LOAD_RUNS] = Bench_now() - start;
+      vertices = scene.verticesCount;
+      edges = scene.edgeCount;
+      Scene_free(&scene);
+      if (vertices == 0) {
+        fprintf(stderr, "Could not load %s\n", fileNames[i]);
+        return false;
+      }
+    }
+    double cold = Bench_median(times[1], BENCH_LOAD_RUNS);
+    double warm = Bench_median(times[0], BENCH_LOAD_RUNS);
+    // Without dropping the pages the first loads are not cold
+    printf("%s: %ld vertices, %ld edges, loaded in %.1f ms %s, %.1f ms warm",
+           fileNames[i], vertices, edges, cold * 1000,
+           evicted ? "cold" : "(page cache not dropped)", warm * 1000);
+    if (i == 0) {
+      reference[0] = cold;
+      reference[1] = warm;
+      printf("\n");
+    } else {
+      printf(" (%.2fx and %.2fx of %s)\n", cold / reference[0],
+             warm / reference[1], fileNames[0]);
+    }
+  }
+  return true;
+}
+
+/**
+ * Drops the pages of the file from the page cache, so it is read from the
+ * disk again
+ * Returns false where that is not supported
+ */
+bool Bench_evict(const char* fileName) {
+#if defined(POSIX_FADV_DONTNEED) && !defined(__EMSCRIPTEN__)
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0) return false;
+  bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  close(fd);
+  return evicted;
+#else
+  return false;
+#endif
+}
+
+/**
+ * Returns the median of the values, they are sorted in place
+ */
+double Bench_median(double* values, int count) {
+  for (int i = 1; i < count; i++) {
+    double value = values[i];
+    int j = i;
+    for (; j > 0 && values[j - 1] > value; j--) values[j] = values[j - 1];
+    values[j] = value;
+  }
+  return values[count / 2];
+}
+
+/**
+ * Returns a monotonic time in seconds
+ */
+double Bench_now() {
+#ifdef _WIN32
+  return (double)clock() / CLOCKS_PER_SEC;
+#else
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+#endif
+}
\ No newline at end of file
@@ -27,6 +27,18 @@ Camera Camera_new(Vec3 pos, Vec3 up, double hRes, double vRes, double hFov,
   return cam;
 }
 
+/**
+ * Compares two cameras and returns true if they would project every point to
+ * the same place on the screen
+ */
+bool Camera_equals(Camera* cam1, Camera* cam2) {
+  return Vec3_equals(&(cam1->pos), &(cam2->pos)) &&
+         Vec3_equals(&(cam1->up), &(cam2->up)) &&
+         Vec3_equals(&(cam1->lookDirection), &(cam2->lookDirection)) &&
+         cam1->hRes == cam2->hRes && cam1->vRes == cam2->vRes &&
+         cam1->hFov == cam2->hFov && cam1->vFov == cam2->vFov;
+}
+
 /**
  * Sets the looking direction of the camera
  */
@@ -210,4 +222,38 @@ Point Camera_projectLinear(Camera* cam, Vec3* point) {
   // Perform the transformation to screen space and scale
   return Point_new(cam->hRes * (1 + x / z) / 2,
                    cam->vRes * (1 + (cam->hRes / cam->vRes) * y / z) / 2);
+}
+
+/**
+ * Returns the transformation from world space to the camera's coordinate system
+ * used by Camera_projectLinear (x points right, y points down on the screen
+ * and z is the looking direction)
+ * Computing it once per frame saves the cross products and square roots that
+ * Camera_projectLinear does for every single point
+ */
+Transform Camera_viewTransform(Camera* cam) {
+  Vec3 right = Vec3_cross(&(cam->up), &cam->lookDirection);
+  Vec3_setLength(&right, 1);
+  Vec3 perspectiveUp = Vec3_cross(&right, &cam->lookDirection);
+  Vec3_setLength(&perspectiveUp, 1);
+  return Transform_fromBasis(&right, &perspectiveUp, &(cam->lookDirection),
+                             &(cam->pos));
+}
+
+/**
+ * Returns true if the sphere with the given center and radius is at least
+ * partially inside the field of view used by Camera_projectLinear
+ * Objects behind the camera or outside one of the four sides of the view
+ * frustum are rejected, the test is conservative near the corners
+ */
+bool Camera_sphereVisible(Camera* cam, Vec3* center, double radius) {
+  Transform view = Camera_viewTransform(cam);
+  Vec3 p = Transform_apply(&view, center);
+  // The sides of the frustum are the planes x = +-z and y = +-aspect * z
+  double aspect = cam->vRes / cam->hRes;
+  if (p.z < -radius) return false;
+  if (fabs(p.x) - p.z > radius * sqrt(2)) return false;
+  if (fabs(p.y) - aspect * p.z > radius * sqrt(1 + aspect * aspect))
+    return false;
+  return true;
 }
\ No newline at end of file
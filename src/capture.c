@@ -0,0 +1,348 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <capture.h>
+
+/**
+ * Opens the output and starts the writer thread with a pool of depth buffers
+ * The buffers are allocated for the first frames that are put into them
+ * Returns NULL if the output file could not be created
+ */
+Capture* Capture_start(const char* path, int format, int policy, int depth,
+                       int frameRate) {
+  FILE* file = NULL;
+  if (format != CAPTURE_FORMAT_PNG) {
+    file = fopen(path, "wb");
+    if (file == NULL) return NULL;
+  }
+
+  Capture* capture = (Capture*)malloc(sizeof(Capture));
+  capture->format = format;
+  capture->policy = policy;
+  capture->path = (char*)malloc(strlen(path) + 1);
+  strcpy(capture->path, path);
+  capture->file = file;
+  capture->frameRate = frameRate > 0 ? frameRate : 60;
+  capture->width = capture->height = 0;
+  capture->planes = NULL;
+  capture->fitted = NULL;
+  capture->depth = depth > 0 ? depth : CAPTURE_DEFAULT_DEPTH;
+  capture->frames =
+      (CaptureFrame*)calloc(capture->depth, sizeof(CaptureFrame));
+  capture->pool = (int*)malloc(capture->depth * sizeof(int));
+  capture->queue = (int*)malloc(capture->depth * sizeof(int));
+  for (int i = 0; i < capture->depth; i++) capture->pool[i] = i;
+  capture->poolCount = capture->depth;
+  capture->queueStart = capture->queueCount = 0;
+  capture->submitted = capture->dropped = capture->written = 0;
+  capture->failed = false;
+#ifndef WORKERS_NO_THREADS
+  pthread_mutex_init(&capture->lock, NULL);
+  pthread_cond_init(&capture->frameQueued, NULL);
+  pthread_cond_init(&capture->frameFreed, NULL);
+  capture->quit = false;
+  capture->threaded =
+      pthread_create(&capture->thread, NULL, Capture_thread, capture) == 0;
+#endif
+  return capture;
+}
+
+/**
+ * Returns the format a file name asks for: .y4m videos, .rgba or .raw
+ * streams, and PNG sequences for anything else
+ */
+int Capture_formatOf(const char* path) {
+  const char* extension = strrchr(path, '.');
+  if (extension == NULL) return CAPTURE_FORMAT_PNG;
+  if (strcmp(extension, ".y4m") == 0) return CAPTURE_FORMAT_Y4M;
+  if (strcmp(extension, ".rgba") == 0 || strcmp(extension, ".raw") == 0)
+    return CAPTURE_FORMAT_RGBA;
+  return CAPTURE_FORMAT_PNG;
+}
+
+/**
+ * Waits for the queued frames to be written, stops the writer, closes the
+ * output and prints how many frames were recorded
+ * Returns false if any of the frames could not be written
+ */
+bool Capture_stop(Capture* capture) {
+  if (capture == NULL) return true;
+#ifndef WORKERS_NO_THREADS
+  if (capture->threaded) {
+    pthread_mutex_lock(&capture->lock);
+    capture->quit = true;
+    pthread_cond_signal(&capture->frameQueued);
+    pthread_mutex_unlock(&capture->lock);
+    pthread_join(capture->thread, NULL);
+  }
+  pthread_mutex_destroy(&capture->lock);
+  pthread_cond_destroy(&capture->frameQueued);
+  pthread_cond_destroy(&capture->frameFreed);
+#endif
+  bool written = !capture->failed;
+  if (capture->file != NULL) written &= fclose(capture->file) == 0;
+  printf("Captured %ld frames into %s, %ld dropped%s\n", capture->written,
+         capture->path, capture->dropped, written ? "" : ", writing failed");
+
+  for (int i = 0; i < capture->depth; i++) free(capture->frames[i].pixels);
+  free(capture->frames);
+  free(capture->pool);
+  free(capture->queue);
+  free(capture->planes);
+  free(capture->fitted);
+  free(capture->path);
+  free(capture);
+  return written;
+}
+
+/**
+ * Takes a buffer from the pool for a frame of the given size, for the render
+ * thread to fill and submit
+ * If every buffer is waiting for the writer, the frame is dropped and NULL is
+ * returned, or with the blocking policy it waits until one is written
+ */
+CaptureFrame* Capture_acquire(Capture* capture, int width, int height) {
+  int index = -1;
+#ifndef WORKERS_NO_THREADS
+  pthread_mutex_lock(&capture->lock);
+  while (capture->poolCount == 0 && capture->policy == CAPTURE_BLOCK)
+    pthread_cond_wait(&capture->frameFreed, &capture->lock);
+  if (capture->poolCount > 0)
+    index = capture->pool[--capture->poolCount];
+  else
+    capture->dropped++;
+  pthread_mutex_unlock(&capture->lock);
+#else
+  index = capture->pool[--capture->poolCount];
+#endif
+  if (index < 0) return NULL;
+
+  // Buffers only grow, so they are allocated again only when the window does
+  CaptureFrame* frame = &capture->frames[index];
+  size_t size = (size_t)width * height * 4;
+  if (size > frame->allocated) {
+    free(frame->pixels);
+    frame->pixels = (uint8_t*)malloc(size);
+    frame->allocated = size;
+  }
+  frame->width = width;
+  frame->height = height;
+  return frame;
+}
+
+/**
+ * Queues a filled buffer for the writer
+ * Without a writer thread the frame is written right away
+ */
+void Capture_submit(Capture* capture, CaptureFrame* frame) {
+  int index = (int)(frame - capture->frames);
+#ifndef WORKERS_NO_THREADS
+  if (capture->threaded) {
+    pthread_mutex_lock(&capture->lock);
+    frame->index = capture->submitted++;
+    int end = (capture->queueStart + capture->queueCount) % capture->depth;
+    capture->queue[end] = index;
+    capture->queueCount++;
+    pthread_cond_signal(&capture->frameQueued);
+    pthread_mutex_unlock(&capture->lock);
+    return;
+  }
+#endif
+  frame->index = capture->submitted++;
+  if (!capture->failed) capture->failed = !Capture_write(capture, frame);
+  if (!capture->failed) capture->written++;
+  Capture_release(capture, frame);
+}
+
+/**
+ * Records a frame of RGBA rows, this is the only copy made of it on the
+ * calling thread
+ * Returns false if the frame was dropped
+ */
+bool Capture_frame(Capture* capture, const void* rgba, int width, int height) {
+  CaptureFrame* frame = Capture_acquire(capture, width, height);
+  if (frame == NULL) return false;
+  memcpy(frame->pixels, rgba, (size_t)width * height * 4);
+  Capture_submit(capture, frame);
+  return true;
+}
+
+/**
+ * Puts a buffer back into the pool and wakes the render thread if it waits
+ * for one
+ */
+void Capture_release(Capture* capture, CaptureFrame* frame) {
+#ifndef WORKERS_NO_THREADS
+  pthread_mutex_lock(&capture->lock);
+  capture->pool[capture->poolCount++] = (int)(frame - capture->frames);
+  pthread_cond_signal(&capture->frameFreed);
+  pthread_mutex_unlock(&capture->lock);
+#else
+  capture->pool[capture->poolCount++] = (int)(frame - capture->frames);
+#endif
+}
+
+#ifndef WORKERS_NO_THREADS
+
+/**
+ * The writer thread, it writes the queued frames in order until the capture
+ * is stopped and the queue is empty
+ */
+void* Capture_thread(void* _capture) {
+  Capture* capture = (Capture*)_capture;
+  pthread_mutex_lock(&capture->lock);
+  while (true) {
+    if (capture->queueCount == 0) {
+      if (capture->quit) break;
+      pthread_cond_wait(&capture->frameQueued, &capture->lock);
+      continue;
+    }
+    CaptureFrame* frame = &capture->frames[capture->queue[capture->queueStart]];
+    capture->queueStart = (capture->queueStart + 1) % capture->depth;
+    capture->queueCount--;
+    pthread_mutex_unlock(&capture->lock);
+
+    // Only this thread sets the failure, the frames after it are thrown away
+    bool written = !capture->failed && Capture_write(capture, frame);
+    Capture_release(capture, frame);
+
+    pthread_mutex_lock(&capture->lock);
+    if (written)
+      capture->written++;
+    else
+      capture->failed = true;
+  }
+  pthread_mutex_unlock(&capture->lock);
+  return NULL;
+}
+
+#endif
+
+/**
+ * Encodes and writes one frame in the format of the capture
+ * Returns false if it could not be written
+ */
+bool Capture_write(Capture* capture, CaptureFrame* frame) {
+  switch (capture->format) {
+    case CAPTURE_FORMAT_Y4M:
+      return Capture_writeY4M(capture, frame);
+    case CAPTURE_FORMAT_RGBA:
+      return Capture_writeRGBA(capture, frame);
+    default:
+      return Capture_writePNG(capture, frame);
+  }
+}
+
+/**
+ * Converts the frame to limited range BT.601 YUV with the chroma averaged
+ * over 2x2 pixels and appends it to the video, the header is written with the
+ * first frame
+ */
+bool Capture_writeY4M(Capture* capture, CaptureFrame* frame) {
+  const uint8_t* rgba = Capture_fit(capture, frame);
+  int width = capture->width, height = capture->height;
+  int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+  size_t lumaSize = (size_t)width * height;
+  size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+  if (capture->planes == NULL) {
+    capture->planes = (uint8_t*)malloc(lumaSize + 2 * chromaSize);
+    if (fprintf(capture->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                width, height, capture->frameRate) < 0)
+      return false;
+  }
+
+  uint8_t* luma = capture->planes;
+  uint8_t *u = luma + lumaSize, *v = u + chromaSize;
+  for (size_t i = 0; i < lumaSize; i++) {
+    const uint8_t* p = &rgba[i * 4];
+    luma[i] = (uint8_t)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+  }
+  for (int y = 0; y < chromaHeight; y++) {
+    // The last row and column are repeated for odd sizes
+    const uint8_t* top = &rgba[(size_t)(2 * y) * width * 4];
+    const uint8_t* bottom =
+        2 * y + 1 < height ? top + (size_t)width * 4 : top;
+    for (int x = 0; x < chromaWidth; x++) {
+      int left = 2 * x * 4, right = 2 * x + 1 < width ? left + 4 : left;
+      int sum[3];
+      for (int c = 0; c < 3; c++)
+        sum[c] = top[left + c] + top[right + c] + bottom[left + c] +
+                 bottom[right + c];
+      int r = sum[0], g = sum[1], b = sum[2];
+      size_t i = (size_t)y * chromaWidth + x;
+      // The sums are 4 times the average, the shift makes up for it
+      u[i] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+      v[i] = (uint8_t)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+    }
+  }
+
+  return fputs("FRAME\n", capture->file) >= 0 &&
+         fwrite(capture->planes, 1, lumaSize + 2 * chromaSize,
+                capture->file) == lumaSize + 2 * chromaSize;
+}
+
+/**
+ * Appends the RGBA rows of the frame to the raw stream
+ */
+bool Capture_writeRGBA(Capture* capture, CaptureFrame* frame) {
+  const uint8_t* rgba = Capture_fit(capture, frame);
+  size_t size = (size_t)capture->width * capture->height * 4;
+  return fwrite(rgba, 1, size, capture->file) == size;
+}
+
+/**
+ * Writes the frame into its own PNG file, the number of the frame is put
+ * before the .png extension of the capture's name (or after the name if it
+ * has none)
+ */
+bool Capture_writePNG(Capture* capture, CaptureFrame* frame) {
+  size_t length = strlen(capture->path);
+  if (length >= 4 && strcmp(capture->path + length - 4, ".png") == 0)
+    length -= 4;
+  char name[1024];
+  snprintf(name, sizeof(name), "%.*s%06ld.png", (int)length, capture->path,
+           frame->index);
+
+  size_t size;
+  uint8_t* png = Png_encode(frame->pixels, frame->width, frame->height, &size);
+  FILE* file = fopen(name, "wb");
+  bool written = file != NULL && fwrite(png, 1, size, file) == size;
+  if (file != NULL) written &= fclose(file) == 0;
+  free(png);
+  return written;
+}
+
+/**
+ * Returns the pixels of the frame at the size of the video, which is set by
+ * the first frame
+ * Frames of another size are copied to the top left of a black frame
+ */
+const uint8_t* Capture_fit(Capture* capture, CaptureFrame* frame) {
+  if (capture->width == 0) {
+    capture->width = frame->width;
+    capture->height = frame->height;
+  }
+  int width = capture->width, height = capture->height;
+  if (frame->width == width && frame->height == height) return frame->pixels;
+
+  size_t size = (size_t)width * height * 4;
+  if (capture->fitted == NULL) capture->fitted = (uint8_t*)malloc(size);
+  int copyWidth = frame->width < width ? frame->width : width;
+  for (int y = 0; y < height; y++) {
+    uint8_t* row = &capture->fitted[(size_t)y * width * 4];
+    int copied = y < frame->height ? copyWidth : 0;
+    if (copied > 0)
+      memcpy(row, &frame->pixels[(size_t)y * frame->width * 4],
+             (size_t)copied * 4);
+    for (int x = copied; x < width; x++) {
+      row[x * 4] = row[x * 4 + 1] = row[x * 4 + 2] = 0;
+      row[x * 4 + 3] = 255;
+    }
+  }
+  return capture->fitted;
+}
\ No newline at end of file
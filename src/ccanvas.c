@@ -11,6 +11,34 @@
 #ifdef __EMSCRIPTEN__
 EM_JS(int, getBrowserWidth, (), { return window.innerWidth; });
 EM_JS(int, getBrowserHeight, (), { return window.innerHeight; });
+EM_JS(void, streamFromUrl, (const char* url),
+      { Module['streamFromUrl'](UTF8ToString(url)); });
+
+// Number of stream chunks pushed from JS that are not processed yet, the page
+// waits with reading the stream while it is high
+int pendingStreamChunks = 0;
+#endif
+
+#ifdef CCANVAS_DIRECT_PRESENT
+/**
+ * Puts the framebuffer onto the page's canvas with a single putImageData call
+ * The ImageData is a view on the WASM heap, so the pixels are not copied,
+ * except in the threaded build where the heap is a SharedArrayBuffer wich
+ * ImageData does not accept
+ * The canvas is resized to the framebuffer and stretched to the window by CSS,
+ * that is how lower resolution frames get upscaled
+ */
+EM_JS(void, putFramebuffer, (uint32_t * pixels, int width, int height), {
+  var canvas = Module['canvas'];
+  if (canvas.width != width || canvas.height != height) {
+    canvas.width = width;
+    canvas.height = height;
+  }
+  if (!Module['context2d']) Module['context2d'] = canvas.getContext('2d');
+  var data = new Uint8ClampedArray(HEAPU8.buffer, pixels, width * height * 4);
+  if (!(HEAPU8.buffer instanceof ArrayBuffer)) data = data.slice();
+  Module['context2d'].putImageData(new ImageData(data, width, height), 0, 0);
+});
 #endif
 
 /**
@@ -33,8 +61,15 @@ void CCanvas_create(initFuncDef initFunc, updateFuncDef updateFunc,
   windowWidth = getBrowserWidth();
   windowHeight = getBrowserHeight();
 #endif
+#ifdef CCANVAS_DIRECT_PRESENT
+  // No SDL renderer is needed, the window is only used for events
+  cnv->window = SDL_CreateWindow(NULL, 0, 0, windowWidth, windowHeight,
+                                 SDL_WINDOW_RESIZABLE);
+  cnv->renderer = NULL;
+#else
   SDL_CreateWindowAndRenderer(windowWidth, windowHeight, SDL_WINDOW_RESIZABLE,
                               &(cnv->window), &(cnv->renderer));
+#endif
 
   // Set CCanvas member values
   CCancas_resetEventHandlers(cnv);
@@ -42,14 +77,49 @@ void CCanvas_create(initFuncDef initFunc, updateFuncDef updateFunc,
   cnv->updateFunc = updateFunc;
   cnv->drawFunc = drawFunc;
   cnv->quit = false;
+  cnv->redraw = true;
+  cnv->hadInput = false;
+  cnv->mouseDx = cnv->mouseDy = 0;
+  CCanvas_setIdleFrameCap(cnv, 10);
   cnv->width = windowWidth;
   cnv->height = windowHeight;
+  cnv->target = NULL;
+  cnv->renderScale = 1;
+  cnv->renderWidth = windowWidth;
+  cnv->renderHeight = windowHeight;
+  cnv->targetFrameTime = 0;
+  cnv->minRenderScale = 1;
+  cnv->drawTime = 0;
+  cnv->refining = false;
+  cnv->capture = NULL;
+  cnv->maxFramesInFlight = 1;
+  cnv->framesInFlight = cnv->framesDrawn = 0;
+  cnv->frameCount = 0;
+  cnv->updateSlot = cnv->drawSlot = 0;
   cnv->lastTime = cnv->currentTime =
-      clock();  // Set clock values for the first time
-
+      SDL_GetPerformanceCounter();  // Set clock values for the first time
+#ifdef CCANVAS_FRAMEBUFFER
+  for (int i = 0; i < CCANVAS_FRAME_SLOTS; i++)
+    cnv->frames[i] = Framebuffer_new(windowWidth, windowHeight);
+  cnv->framebuffer = &(cnv->frames[0]);
+  cnv->brush = NULL;
+#else
+  cnv->layer = Framebuffer_new(0, 0);
+  cnv->layerTexture = NULL;
   // Create the texture containing the single pixel used for lines
   cnv->brush = SDL_CreateTexture(cnv->renderer, SDL_PIXELFORMAT_RGBA8888,
                                  SDL_TEXTUREACCESS_STREAMING, 1, 1);
+#endif
+  CCanvas_createTarget(cnv);
+#ifdef CCANVAS_PIPELINE
+  pthread_mutex_init(&cnv->pipelineLock, NULL);
+  pthread_cond_init(&cnv->frameQueued, NULL);
+  pthread_cond_init(&cnv->frameDrawn, NULL);
+  cnv->stopDrawing = false;
+  // Frames are drawn on the main thread if the thread can not be started
+  if (pthread_create(&cnv->drawThread, NULL, CCanvas_drawThread, cnv) != 0)
+    cnv->stopDrawing = true;
+#endif
 
   // Set default colors (white for background and black for painting)
   CCanvas_setBgColor(cnv, rgb(255, 255, 255));
@@ -73,8 +143,31 @@ void CCanvas_create(initFuncDef initFunc, updateFuncDef updateFunc,
   }
 #endif
 
-  // Free up allocated memory and close window upon quitting
-  SDL_DestroyRenderer(cnv->renderer);
+  // Show the frames still in flight, stop the draw thread, then free up
+  // allocated memory and close window upon quitting
+  CCanvas_finishFrames(cnv);
+#ifdef CCANVAS_PIPELINE
+  if (!cnv->stopDrawing) {
+    pthread_mutex_lock(&cnv->pipelineLock);
+    cnv->stopDrawing = true;
+    pthread_cond_signal(&cnv->frameQueued);
+    pthread_mutex_unlock(&cnv->pipelineLock);
+    pthread_join(cnv->drawThread, NULL);
+  }
+  pthread_mutex_destroy(&cnv->pipelineLock);
+  pthread_cond_destroy(&cnv->frameQueued);
+  pthread_cond_destroy(&cnv->frameDrawn);
+#endif
+#ifdef CCANVAS_FRAMEBUFFER
+  for (int i = 0; i < CCANVAS_FRAME_SLOTS; i++)
+    Framebuffer_free(&(cnv->frames[i]));
+#else
+  Framebuffer_free(&(cnv->layer));
+  if (cnv->layerTexture != NULL) SDL_DestroyTexture(cnv->layerTexture);
+#endif
+  if (cnv->target != NULL) SDL_DestroyTexture(cnv->target);
+  if (cnv->brush != NULL) SDL_DestroyTexture(cnv->brush);
+  if (cnv->renderer != NULL) SDL_DestroyRenderer(cnv->renderer);
   SDL_DestroyWindow(cnv->window);
 
   SDL_Quit();
@@ -88,7 +181,12 @@ void CCanvas_create(initFuncDef initFunc, updateFuncDef updateFunc,
  * to be called manually for greater control (there may be some cases when you
  * want to keep the frame from the last update and draw on it additionally)
  */
-void CCanvas_setBgColor(CCanvas* cnv, Uint32 color) { cnv->bgColor = color; }
+void CCanvas_setBgColor(CCanvas* cnv, Uint32 color) {
+  cnv->bgColor = color;
+#ifdef CCANVAS_FRAMEBUFFER
+  cnv->bgPixel = Framebuffer_color(color);
+#endif
+}
 
 /**
  * Sets the brush color for drawing shapes
@@ -97,7 +195,9 @@ void CCanvas_setBgColor(CCanvas* cnv, Uint32 color) { cnv->bgColor = color; }
  */
 void CCanvas_setBrushColor(CCanvas* cnv, Uint32 color) {
   cnv->brushColor = color;
-
+#ifdef CCANVAS_FRAMEBUFFER
+  cnv->brushPixel = Framebuffer_color(color);
+#else
   void* pixel;
   SDL_Rect bRect;
   int pitch = 1;
@@ -109,6 +209,7 @@ void CCanvas_setBrushColor(CCanvas* cnv, Uint32 color) {
   Uint32* upixel = (Uint32*)pixel;
   *upixel = color;
   SDL_UnlockTexture(cnv->brush);
+#endif
 }
 
 /**
@@ -140,17 +241,177 @@ Uint32 rgb(Uint8 r, Uint8 g, Uint8 b) {
  * Fills the whole canvas with the set background color
  */
 void CCanvas_clear(CCanvas* cnv) {
+#ifdef CCANVAS_FRAMEBUFFER
+  Framebuffer_clear(cnv->framebuffer, cnv->bgPixel);
+#else
   SDL_SetRenderDrawColor(cnv->renderer, getR(cnv->bgColor), getG(cnv->bgColor),
                          getB(cnv->bgColor), getA(cnv->bgColor));
   SDL_RenderClear(cnv->renderer);
   SDL_SetRenderDrawColor(cnv->renderer, getR(cnv->brushColor),
                          getG(cnv->brushColor), getB(cnv->brushColor),
                          getA(cnv->brushColor));
+#endif
+}
+
+/**
+ * Marks the current frame as changed so the draw function gets called and the
+ * screen gets updated at the end of the current loop cycle
+ * If it is not called in a cycle the previous frame stays on the screen
+ */
+void CCanvas_invalidate(CCanvas* cnv) { cnv->redraw = true; }
+
+/**
+ * Sets how many times per second the main loop runs at most while nothing
+ * changes and no events arrive
+ */
+void CCanvas_setIdleFrameCap(CCanvas* cnv, int framesPerSecond) {
+  cnv->idleFrameTime = 1000 / (framesPerSecond > 0 ? framesPerSecond : 1);
+}
+
+/**
+ * Enables adaptive resolution scaling
+ * When drawing takes longer than targetFrameTime (in ms), the frame is drawn
+ * at a lower resolution, but the scale never goes below minScale
+ * Passing 0 as the target frame time disables scaling
+ */
+void CCanvas_setFrameBudget(CCanvas* cnv, double targetFrameTime,
+                            double minScale) {
+  cnv->targetFrameTime = targetFrameTime;
+  cnv->minRenderScale = fmin(fmax(minScale, 0.0625), 1);
+  CCanvas_setRenderScale(cnv, targetFrameTime > 0 ? cnv->renderScale : 1);
+}
+
+/**
+ * Sets the ratio of the resolution that is drawn and the window size
+ * The scale is rounded up to sixteenths so small fluctuations of the frame time
+ * do not recreate the target texture every frame
+ * The resize event function is called with the new drawing size if it changed
+ */
+void CCanvas_setRenderScale(CCanvas* cnv, double scale) {
+  scale = fmin(fmax(scale, cnv->minRenderScale), 1);
+  scale = ceil(scale * 16) / 16;
+  int w = fmax(cnv->width * scale, 1), h = fmax(cnv->height * scale, 1);
+  cnv->renderScale = scale;
+  bool changed = w != cnv->renderWidth || h != cnv->renderHeight;
+#ifndef CCANVAS_FRAMEBUFFER
+  // The SDL backend only uses the target texture below full resolution
+  changed |= (cnv->target != NULL) != (scale < 1);
+#endif
+  if (!changed) return;
+
+  cnv->renderWidth = w;
+  cnv->renderHeight = h;
+  CCanvas_createTarget(cnv);
+
+  if (cnv->onResize != NULL) ((resizeFunc)cnv->onResize)(cnv, w, h);
+  CCanvas_invalidate(cnv);
+}
+
+/**
+ * Creates the surface that is drawn into for the current drawing size
+ * For the SDL backend it is a target texture if the scale is below 1, for the
+ * framebuffer backend it is the framebuffer (plus the streaming texture it is
+ * uploaded to if it is not presented directly)
+ */
+void CCanvas_createTarget(CCanvas* cnv) {
+  int w = cnv->renderWidth, h = cnv->renderHeight;
+  // The frames in flight are shown at the size they were drawn at
+  CCanvas_finishFrames(cnv);
+#ifdef CCANVAS_FRAMEBUFFER
+  for (int i = 0; i < CCANVAS_FRAME_SLOTS; i++)
+    Framebuffer_resize(&(cnv->frames[i]), w, h);
+#endif
+#ifndef CCANVAS_DIRECT_PRESENT
+  if (cnv->target != NULL) SDL_DestroyTexture(cnv->target);
+  cnv->target = NULL;
+#ifdef CCANVAS_FRAMEBUFFER
+  cnv->target = SDL_CreateTexture(cnv->renderer, SDL_PIXELFORMAT_RGBA32,
+                                  SDL_TEXTUREACCESS_STREAMING, w, h);
+#else
+  if (cnv->renderScale < 1)
+    cnv->target = SDL_CreateTexture(cnv->renderer, SDL_PIXELFORMAT_RGBA8888,
+                                    SDL_TEXTUREACCESS_TARGET, w, h);
+#endif
+#endif
+}
+
+/**
+ * Shows the finished frame of the slot in the window
+ * The frame is stretched to the window size if it was drawn at a lower
+ * resolution
+ */
+void CCanvas_present(CCanvas* cnv, int slot) {
+#ifdef CCANVAS_DIRECT_PRESENT
+  Framebuffer* frame = &(cnv->frames[slot]);
+  putFramebuffer(frame->pixels, frame->width, frame->height);
+#else
+#ifdef CCANVAS_FRAMEBUFFER
+  Framebuffer* frame = &(cnv->frames[slot]);
+  SDL_UpdateTexture(cnv->target, NULL, frame->pixels,
+                    frame->width * sizeof(uint32_t));
+#else
+  if (cnv->target != NULL) SDL_SetRenderTarget(cnv->renderer, NULL);
+#endif
+  if (cnv->target != NULL)
+    SDL_RenderCopy(cnv->renderer, cnv->target, NULL, NULL);
+  SDL_RenderPresent(cnv->renderer);
+#endif
+}
+
+/**
+ * Starts recording every drawn frame into the capture, or stops it with NULL
+ * The capture is not stopped or freed by the canvas
+ */
+void CCanvas_setCapture(CCanvas* cnv, Capture* capture) {
+  cnv->capture = capture;
+}
+
+/**
+ * Hands the frame of the slot to the capture, before it is presented
+ * The framebuffer backend copies its pixels into a buffer of the capture, the
+ * SDL backend reads them back from the renderer into it
+ */
+void CCanvas_captureFrame(CCanvas* cnv, int slot) {
+#ifdef CCANVAS_FRAMEBUFFER
+  Framebuffer* frame = &(cnv->frames[slot]);
+  Capture_frame(cnv->capture, frame->pixels, frame->width, frame->height);
+#else
+  int w = cnv->renderWidth, h = cnv->renderHeight;
+  CaptureFrame* frame = Capture_acquire(cnv->capture, w, h);
+  if (frame == NULL) return;
+  // The target texture is still the render target below full resolution
+  SDL_RenderReadPixels(cnv->renderer, NULL, SDL_PIXELFORMAT_RGBA32,
+                       frame->pixels, w * 4);
+  Capture_submit(cnv->capture, frame);
+#endif
+}
+
+/**
+ * Adjusts the resolution scale based on how long the last draw stage took
+ * Over budget the scale is lowered right away, well under budget it is raised
+ * slowly, so the frame time stays close to the target while moving
+ */
+void CCanvas_adaptRenderScale(CCanvas* cnv) {
+  if (cnv->targetFrameTime <= 0 || cnv->drawTime <= 0) return;
+  double ratio = cnv->targetFrameTime / cnv->drawTime;
+  if (ratio < 1)
+    CCanvas_setRenderScale(cnv, cnv->renderScale * fmax(ratio, 0.5));
+  else if (ratio > 2)
+    CCanvas_setRenderScale(cnv, cnv->renderScale * 1.1);
 }
 
 /**
  * This funciton is called every frame
- * It calls the given update and draw functions then updates the screen
+ * It calls the given update function, then hands the frame to the draw
+ * function and updates the screen
+ * Drawing and presenting is skipped if the frame was not invalidated, then the
+ * loop sleeps until the next event arrives (or the idle frame time passes)
+ * In the browser requestAnimationFrame does the waiting and the canvas simply
+ * keeps showing the previous frame
+ * If the frame was drawn at a lower resolution, unchanged frames are used to
+ * raise it step by step back to the full window size
+ * With more frames in flight the frame is drawn while the next loop cycles
+ * run, the frames are presented in order as soon as they are drawn
  */
 void CCanvas_loop(void* _cnv) {
   // Cast the cnv struct pointer into the right type for easier use
@@ -159,10 +420,21 @@ void CCanvas_loop(void* _cnv) {
   // Handle events first
   CCanvas_handleEvents(cnv);
 
-  // Calculate elapsed time
-  cnv->currentTime = clock();
+  // Calculate elapsed wall time, the CPU time of the process grows faster
+  // than it with the draw thread and the workers, and not at all while waiting
+  // for events
+  cnv->currentTime = SDL_GetPerformanceCounter();
   double dt = ((double)(cnv->currentTime - cnv->lastTime) * 1000.0) /
-              ((double)CLOCKS_PER_SEC);
+              ((double)SDL_GetPerformanceFrequency());
+
+  // Hand the mouse motion of the frame to the watcher
+  CCanvas_sampleInput(cnv);
+
+  // The slot of the oldest frame is taken over when every frame is in flight,
+  // so it has to be presented first
+  if (cnv->framesInFlight == cnv->maxFramesInFlight)
+    CCanvas_presentNext(cnv, true);
+  cnv->updateSlot = cnv->frameCount % CCANVAS_FRAME_SLOTS;
 
   // Call the update function with the elapsed time since the last update in
   // milliseconds
@@ -171,21 +443,177 @@ void CCanvas_loop(void* _cnv) {
   // Then set current time as the last one for the next update
   cnv->lastTime = cnv->currentTime;
 
-  // Call draw function
+  bool queued = cnv->redraw;
+  if (cnv->redraw) {
+    CCanvas_queueFrame(cnv);
+    cnv->redraw = false;
+  } else if (cnv->renderScale < 1) {
+    cnv->refining = true;
+    CCanvas_setRenderScale(cnv, cnv->renderScale + 0.125);
+  }
+#ifndef __EMSCRIPTEN__
+  else if (!cnv->hadInput && cnv->framesInFlight == 0) {
+    // Passing NULL leaves the event in the queue for the next cycle
+    SDL_WaitEventTimeout(NULL, cnv->idleFrameTime);
+  }
+#endif
+
+  // Show the frames that are drawn, waiting for them only with a single frame
+  // in flight or when nothing else is happening
+  // Frames drawn for raising the resolution back do not lower it again
+  bool wait = cnv->maxFramesInFlight == 1 || (!queued && !cnv->hadInput);
+  int slot;
+  while ((slot = CCanvas_presentNext(cnv, wait)) >= 0) {
+    if (!cnv->slotRefining[slot]) CCanvas_adaptRenderScale(cnv);
+    wait = false;
+  }
+}
+
+/**
+ * Sets how many frames can be in flight at once, 1 runs the stages of every
+ * frame one after the other for the lowest latency, more frames overlap them
+ * for a higher frame rate
+ * Only the native framebuffer backend pipelines the frames, it allows up to
+ * CCANVAS_FRAME_SLOTS
+ */
+void CCanvas_setFramesInFlight(CCanvas* cnv, int count) {
+  count = count < 1 ? 1 : count > CCANVAS_FRAME_SLOTS ? CCANVAS_FRAME_SLOTS
+                                                      : count;
+  if (count < cnv->maxFramesInFlight) CCanvas_finishFrames(cnv);
+  cnv->maxFramesInFlight = count;
+}
+
+/**
+ * Returns true if the draw function can run while the next frame is updated
+ */
+bool CCanvas_pipelined(CCanvas* cnv) { return cnv->maxFramesInFlight > 1; }
+
+/**
+ * Hands the frame that was just updated to the draw thread, or draws it right
+ * away without one
+ */
+void CCanvas_queueFrame(CCanvas* cnv) {
+  int slot = cnv->frameCount % CCANVAS_FRAME_SLOTS;
+  cnv->slotRefining[slot] = cnv->refining;
+  cnv->refining = false;
+#ifdef CCANVAS_PIPELINE
+  if (!cnv->stopDrawing) {
+    pthread_mutex_lock(&cnv->pipelineLock);
+    cnv->frameCount++;
+    cnv->framesInFlight++;
+    pthread_cond_signal(&cnv->frameQueued);
+    pthread_mutex_unlock(&cnv->pipelineLock);
+    return;
+  }
+#endif
+  cnv->frameCount++;
+  cnv->framesInFlight++;
+  CCanvas_drawFrame(cnv, slot);
+  cnv->framesDrawn++;
+}
+
+/**
+ * Calls the draw function for the frame of the slot, into its framebuffer or
+ * into the smaller target if the scale is lowered, and measures how long it
+ * takes
+ */
+void CCanvas_drawFrame(CCanvas* cnv, int slot) {
+  Uint64 start = SDL_GetPerformanceCounter();
+  cnv->drawSlot = slot;
+#ifdef CCANVAS_FRAMEBUFFER
+  cnv->framebuffer = &(cnv->frames[slot]);
+#else
+  if (cnv->target != NULL) SDL_SetRenderTarget(cnv->renderer, cnv->target);
+#endif
   ((drawFuncDef)cnv->drawFunc)(cnv);
-  // Update screen after rendering
-  SDL_RenderPresent(cnv->renderer);
+  cnv->slotDrawTime[slot] = (double)(SDL_GetPerformanceCounter() - start) *
+                            1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Presents the oldest frame in flight if it is drawn, optionally waiting for
+ * it to be drawn, and records it if a capture is set
+ * Returns the slot of the frame, or -1 if none was presented
+ */
+int CCanvas_presentNext(CCanvas* cnv, bool wait) {
+  if (cnv->framesInFlight == 0) return -1;
+#ifdef CCANVAS_PIPELINE
+  pthread_mutex_lock(&cnv->pipelineLock);
+  while (wait && cnv->framesDrawn == 0)
+    pthread_cond_wait(&cnv->frameDrawn, &cnv->pipelineLock);
+  bool drawn = cnv->framesDrawn > 0;
+  pthread_mutex_unlock(&cnv->pipelineLock);
+  if (!drawn) return -1;
+#endif
+
+  int slot = (cnv->frameCount - cnv->framesInFlight) % CCANVAS_FRAME_SLOTS;
+  if (cnv->capture != NULL) CCanvas_captureFrame(cnv, slot);
+  CCanvas_present(cnv, slot);
+  cnv->drawTime = cnv->slotDrawTime[slot];
+#ifdef CCANVAS_PIPELINE
+  pthread_mutex_lock(&cnv->pipelineLock);
+#endif
+  cnv->framesInFlight--;
+  cnv->framesDrawn--;
+#ifdef CCANVAS_PIPELINE
+  pthread_mutex_unlock(&cnv->pipelineLock);
+#endif
+  return slot;
+}
+
+/**
+ * Waits for the frames in flight to be drawn and presents them
+ */
+void CCanvas_finishFrames(CCanvas* cnv) {
+  while (cnv->framesInFlight > 0) CCanvas_presentNext(cnv, true);
+}
+
+#ifdef CCANVAS_PIPELINE
+
+/**
+ * The draw thread, it draws the frames in the order they were updated until
+ * the canvas is closed
+ */
+void* CCanvas_drawThread(void* _cnv) {
+  CCanvas* cnv = (CCanvas*)_cnv;
+  pthread_mutex_lock(&cnv->pipelineLock);
+  while (true) {
+    if (cnv->framesDrawn == cnv->framesInFlight) {
+      if (cnv->stopDrawing) break;
+      pthread_cond_wait(&cnv->frameQueued, &cnv->pipelineLock);
+      continue;
+    }
+    int slot = (cnv->frameCount - cnv->framesInFlight + cnv->framesDrawn) %
+               CCANVAS_FRAME_SLOTS;
+    pthread_mutex_unlock(&cnv->pipelineLock);
+
+    CCanvas_drawFrame(cnv, slot);
+
+    pthread_mutex_lock(&cnv->pipelineLock);
+    cnv->framesDrawn++;
+    pthread_cond_signal(&cnv->frameDrawn);
+  }
+  pthread_mutex_unlock(&cnv->pipelineLock);
+  return NULL;
 }
 
+#endif
+
 /**
  * Function for drawing lines with arbitrary thickness
  * It uses the 1x1 brush texture for srawing
  * It streches the texture then rotates it to fit the desired footprint
+ * The framebuffer backend rasterizes the footprint on the CPU instead
  */
 void CCanvas_line(CCanvas* cnv, int x1, int y1, int x2, int y2, int thickness) {
   // Does not do anything if the line has length zero
   if (x1 == x2 && y1 == y2) return;
 
+#ifdef CCANVAS_FRAMEBUFFER
+  // The framebuffer backend rasterizes the same rectangle anti-aliased
+  Framebuffer_thickLine(cnv->framebuffer, x1, y1, x2, y2, thickness,
+                        FRAMEBUFFER_CAP_BUTT, cnv->brushPixel);
+#else
   // Select the 1x1 texture
   SDL_Rect srcRect;
   srcRect.x = 0;
@@ -212,6 +640,7 @@ void CCanvas_line(CCanvas* cnv, int x1, int y1, int x2, int y2, int thickness) {
   // Render the rectangle while rotating it
   SDL_RenderCopyEx(cnv->renderer, cnv->brush, &srcRect, &dst,
                    angle * 180 / M_PI, NULL, SDL_FLIP_NONE);
+#endif
 }
 
 /**
@@ -219,13 +648,81 @@ void CCanvas_line(CCanvas* cnv, int x1, int y1, int x2, int y2, int thickness) {
  * It the default SDL line rendering method
  */
 void CCanvas_preciseLine(CCanvas* cnv, int x1, int y1, int x2, int y2) {
+#ifdef CCANVAS_FRAMEBUFFER
+  Framebuffer_line(cnv->framebuffer, x1, y1, x2, y2, cnv->brushPixel);
+#else
   SDL_RenderDrawLine(cnv->renderer, x1, y1, x2, y2);
+#endif
+}
+
+/**
+ * Function for drawing a single pixel with the brush color
+ */
+void CCanvas_point(CCanvas* cnv, int x, int y) {
+#ifdef CCANVAS_FRAMEBUFFER
+  Framebuffer_point(cnv->framebuffer, x, y, cnv->brushPixel);
+#else
+  SDL_RenderDrawPoint(cnv->renderer, x, y);
+#endif
+}
+
+/**
+ * Returns a framebuffer of the size of the drawing area for drawing pixels
+ * directly on the CPU, it is put onto the frame by CCanvas_endLayer
+ * With the framebuffer backend it is the frame itself, otherwise it is a
+ * transparent layer blended over what was drawn before
+ */
+Framebuffer* CCanvas_beginLayer(CCanvas* cnv) {
+#ifdef CCANVAS_FRAMEBUFFER
+  return cnv->framebuffer;
+#else
+  Framebuffer* layer = &(cnv->layer);
+  if (layer->width != cnv->renderWidth || layer->height != cnv->renderHeight ||
+      cnv->layerTexture == NULL) {
+    Framebuffer_resize(layer, cnv->renderWidth, cnv->renderHeight);
+    if (cnv->layerTexture != NULL) SDL_DestroyTexture(cnv->layerTexture);
+    cnv->layerTexture =
+        SDL_CreateTexture(cnv->renderer, SDL_PIXELFORMAT_RGBA32,
+                          SDL_TEXTUREACCESS_STREAMING, layer->width,
+                          layer->height);
+    // Anti-aliased pixels are blended into the transparent layer with
+    // premultiplied alpha
+    SDL_SetTextureBlendMode(
+        cnv->layerTexture,
+        SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE,
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD));
+  }
+  Framebuffer_clear(layer, 0);
+  return layer;
+#endif
+}
+
+/**
+ * Puts the pixels drawn into the layer onto the frame
+ */
+void CCanvas_endLayer(CCanvas* cnv) {
+#ifndef CCANVAS_FRAMEBUFFER
+  SDL_UpdateTexture(cnv->layerTexture, NULL, cnv->layer.pixels,
+                    cnv->layer.width * sizeof(uint32_t));
+  SDL_RenderCopy(cnv->renderer, cnv->layerTexture, NULL, NULL);
+#endif
+}
+
+/**
+ * Returns the brush color in the format of the framebuffers
+ */
+uint32_t CCanvas_brushPixel(CCanvas* cnv) {
+  return Framebuffer_color(cnv->brushColor);
 }
 
 void CCanvas_handleEvents(CCanvas* cnv) {
+  cnv->hadInput = false;
   // Fetch all events from SDL
   while (SDL_PollEvent(&(cnv->event))) {
     SDL_Event* event = &(cnv->event);
+    cnv->hadInput = true;
 
     // Call the corresponding function based on what's happened
     switch (event->type) {
@@ -254,10 +751,11 @@ void CCanvas_handleEvents(CCanvas* cnv) {
               cnv, event->button.button, event->button.x, event->button.y);
         break;
 
+        // Mice with high polling rates send thousands of these per second,
+        // the motion is added up and handled once per frame
       case SDL_MOUSEMOTION:
-        if (cnv->onMouseMove != NULL)
-          ((mouseMoveFunc)cnv->onMouseMove)(cnv, event->motion.xrel,
-                                            event->motion.yrel);
+        cnv->mouseDx += event->motion.xrel;
+        cnv->mouseDy += event->motion.yrel;
         break;
 
         // When a file is dropped SDL provides a pointer to the filename and it
@@ -269,14 +767,16 @@ void CCanvas_handleEvents(CCanvas* cnv) {
         break;
 
       case SDL_WINDOWEVENT:
+        // The window content has to be drawn again if it got lost
+        if (event->window.event == SDL_WINDOWEVENT_EXPOSED)
+          CCanvas_invalidate(cnv);
         // Store the new size when the window is resized
         // (also call the corresponding event function if is watched)
         if (event->window.event == SDL_WINDOWEVENT_RESIZED) {
+          CCanvas_invalidate(cnv);
           cnv->width = event->window.data1;
           cnv->height = event->window.data2;
-          if (cnv->onResize != NULL)
-            ((resizeFunc)cnv->onResize)(cnv, event->window.data1,
-                                        event->window.data2);
+          CCanvas_setRenderScale(cnv, cnv->renderScale);
         }
         break;
 
@@ -288,11 +788,32 @@ void CCanvas_handleEvents(CCanvas* cnv) {
             // scaling of the canvas is handled in JS
             // And also the event is fired from JS
           case CCANVAS_WASM_WINDOW_RESIZED:
+            CCanvas_invalidate(cnv);
             cnv->width = *((int*)(event->user.data1));
             cnv->height = *((int*)(event->user.data2));
             SDL_SetWindowSize(cnv->window, cnv->width, cnv->height);
-            if (cnv->onResize != NULL)
-              ((resizeFunc)cnv->onResize)(cnv, cnv->width, cnv->height);
+            CCanvas_setRenderScale(cnv, cnv->renderScale);
+            break;
+            // Chunks of a file streamed from JS, the chunk data is allocated
+            // by the page and freed here after the watcher is done with it
+          case CCANVAS_WASM_STREAM_BEGIN:
+            if (cnv->onFileStream != NULL)
+              ((fileStreamFunc)cnv->onFileStream)(
+                  cnv, CCANVAS_STREAM_BEGIN, (char*)event->user.data1, 0);
+            free(event->user.data1);
+            break;
+          case CCANVAS_WASM_STREAM_CHUNK:
+            if (cnv->onFileStream != NULL)
+              ((fileStreamFunc)cnv->onFileStream)(
+                  cnv, CCANVAS_STREAM_DATA, (char*)event->user.data1,
+                  (size_t)event->user.data2);
+            free(event->user.data1);
+            pendingStreamChunks--;
+            break;
+          case CCANVAS_WASM_STREAM_END:
+            if (cnv->onFileStream != NULL)
+              ((fileStreamFunc)cnv->onFileStream)(cnv, CCANVAS_STREAM_END,
+                                                  NULL, 0);
             break;
 #endif
         }
@@ -301,6 +822,34 @@ void CCanvas_handleEvents(CCanvas* cnv) {
   }
 }
 
+/**
+ * Adds the mouse motion that arrived since the events were handled to the
+ * motion of the frame, then calls the mouseMove watcher once with all of it
+ * It is called by the loop before the update function, and it can be called
+ * again in the update right before the camera is used, so the frame shows
+ * the latest position of the mouse
+ * Other events are left in the queue for the next frame
+ */
+void CCanvas_sampleInput(CCanvas* cnv) {
+  SDL_Event events[64];
+  int count;
+  SDL_PumpEvents();
+  do {
+    count = SDL_PeepEvents(events, 64, SDL_GETEVENT, SDL_MOUSEMOTION,
+                           SDL_MOUSEMOTION);
+    for (int i = 0; i < count; i++) {
+      cnv->mouseDx += events[i].motion.xrel;
+      cnv->mouseDy += events[i].motion.yrel;
+    }
+    if (count > 0) cnv->hadInput = true;
+  } while (count == 64);
+
+  if (cnv->mouseDx == 0 && cnv->mouseDy == 0) return;
+  if (cnv->onMouseMove != NULL)
+    ((mouseMoveFunc)cnv->onMouseMove)(cnv, cnv->mouseDx, cnv->mouseDy);
+  cnv->mouseDx = cnv->mouseDy = 0;
+}
+
 /**
  * Sets all event handler function pointers to NULL
  */
@@ -311,6 +860,7 @@ void CCancas_resetEventHandlers(CCanvas* cnv) {
   cnv->onMouseButtonUp = NULL;
   cnv->onMouseMove = NULL;
   cnv->onFileDrop = NULL;
+  cnv->onFileStream = NULL;
   cnv->onResize = NULL;
 }
 
@@ -332,6 +882,9 @@ void CCanvas_watchMouseMove(CCanvas* cnv, mouseMoveFunc f) {
 void CCanvas_watchFileDrop(CCanvas* cnv, fileDropFunc f) {
   cnv->onFileDrop = f;
 }
+void CCanvas_watchFileStream(CCanvas* cnv, fileStreamFunc f) {
+  cnv->onFileStream = f;
+}
 void CCanvas_watchResize(CCanvas* cnv, resizeFunc f) { cnv->onResize = f; }
 
 /**
@@ -395,4 +948,66 @@ int CCanvas_browserWasResized() {
   return retVal;
 }
 
+/**
+ * Pushes a custom event carrying a stream stage to the SDL event queue
+ */
+int CCanvas_pushStreamEvent(int code, void* data, size_t length) {
+  SDL_Event e;
+  SDL_zero(e);
+  e.type = SDL_USEREVENT;
+  e.user.type = SDL_USEREVENT;
+  e.user.timestamp = SDL_GetTicks();
+  e.user.windowID = 1;
+  e.user.code = code;
+  e.user.data1 = data;
+  e.user.data2 = (void*)length;
+  int retVal = SDL_PushEvent(&e);
+  // The event owns the data, it is lost if the event could not be queued
+  if (retVal <= 0) free(data);
+  return retVal;
+}
+
+/**
+ * Called from JS when a file starts streaming in (dropped on the canvas or
+ * fetched), recieves the name of the file
+ * Unlike CCanvas_dropEventForSDL the file is not written to the virtual file
+ * system, the content arrives through CCanvas_streamChunkForSDL
+ */
+int CCanvas_streamBeginForSDL(char* fileName) {
+  size_t memLen = strlen(fileName) + 1;
+  char* name = malloc(memLen);
+  memcpy(name, fileName, memLen);
+  return CCanvas_pushStreamEvent(CCANVAS_WASM_STREAM_BEGIN, name, 0);
+}
+
+/**
+ * Called from JS with the next chunk of the streamed file
+ * The buffer has to be allocated with _malloc, its ownership is passed over
+ * and it is freed once the chunk is processed
+ */
+int CCanvas_streamChunkForSDL(char* data, int length) {
+  int retVal = CCanvas_pushStreamEvent(CCANVAS_WASM_STREAM_CHUNK, data, length);
+  if (retVal > 0) pendingStreamChunks++;
+  return retVal;
+}
+
+/**
+ * Called from JS when the whole file has been streamed
+ */
+int CCanvas_streamEndForSDL() {
+  return CCanvas_pushStreamEvent(CCANVAS_WASM_STREAM_END, NULL, 0);
+}
+
+/**
+ * Returns the number of chunks waiting in the event queue, used by JS to only
+ * read as much of the stream as the parser keeps up with
+ */
+int CCanvas_pendingStreamChunks() { return pendingStreamChunks; }
+
+/**
+ * Starts streaming the file at the given URL, the content arrives in the same
+ * way as for a dropped file
+ */
+void CCanvas_fetchFile(const char* url) { streamFromUrl(url); }
+
 #endif
\ No newline at end of file
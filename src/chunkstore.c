@@ -0,0 +1,639 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <chunkstore.h>
+
+#ifndef _WIN32
+
+/**
+ * Creates a temporary file next to the given file, the temporary data can be
+ * as large as the scene so the system's temporary directory (that may be in
+ * memory) is avoided
+ * The file is unlinked right away, it is deleted when it is closed
+ */
+FILE* ChunkStore_tempFile(const char* fileName, const char* suffix) {
+  size_t length = strlen(fileName) + strlen(suffix) + 1;
+  char* name = (char*)malloc(length);
+  snprintf(name, length, "%s%s", fileName, suffix);
+  FILE* file = fopen(name, "w+b");
+  if (file != NULL) unlink(name);
+  free(name);
+  return file;
+}
+
+/**
+ * Maps the content of an open file into memory, returns NULL on failure
+ * A read-only file has to hold the whole array and the blocks of a writable
+ * one are allocated up front, so accessing the map never raises SIGBUS
+ */
+void* ChunkStore_mapFile(FILE* file, size_t size, bool writable) {
+  struct stat info;
+  if (fflush(file) != 0 || fstat(fileno(file), &info) != 0) return NULL;
+  if (!writable && (size_t)info.st_size < size) return NULL;
+  if (size == 0) size = 1;
+  if (writable && posix_fallocate(fileno(file), 0, size) != 0) return NULL;
+  void* map = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   MAP_SHARED, fileno(file), 0);
+  return map == MAP_FAILED ? NULL : map;
+}
+
+/**
+ * Unmaps a file mapped with ChunkStore_mapFile
+ */
+void ChunkStore_unmapFile(void* map, size_t size) {
+  if (map != NULL) munmap(map, size == 0 ? 1 : size);
+}
+
+/**
+ * Appends the edges parsed into the scene to the temporary edge file and
+ * removes them with the faces from the scene, only the vertices are kept
+ * Returns false if they could not be written
+ */
+bool ChunkStore_flushEdges(Scene* scene, FILE* file, int64_t* edgeCount) {
+  for (long int i = 0; i < scene->edgeCount; i++) {
+    int64_t edge[2] = {scene->edges[i].a, scene->edges[i].b};
+    if (fwrite(edge, sizeof(edge), 1, file) != 1) return false;
+  }
+  *edgeCount += scene->edgeCount;
+  scene->edgeCount = 0;
+  scene->faceCount = 0;
+  return true;
+}
+
+/**
+ * Returns the index of the grid cell containing the point
+ */
+long int ChunkStore_cell(Vec3* v, double* min, double* cellSize,
+                         long int cells) {
+  double coords[3] = {v->x, v->y, v->z};
+  long int index = 0;
+  for (int i = 2; i >= 0; i--) {
+    long int c = (coords[i] - min[i]) / cellSize[i];
+    if (c < 0) c = 0;
+    if (c >= cells) c = cells - 1;
+    index = index * cells + c;
+  }
+  return index;
+}
+
+/**
+ * Comparison functions for sorting edges and vertex indices with qsort
+ */
+int ChunkStore_compareEdges(const void* e1, const void* e2) {
+  const int64_t *a = (const int64_t*)e1, *b = (const int64_t*)e2;
+  if (a[0] != b[0]) return a[0] < b[0] ? -1 : 1;
+  if (a[1] != b[1]) return a[1] < b[1] ? -1 : 1;
+  return 0;
+}
+int ChunkStore_compareIds(const void* i1, const void* i2) {
+  int64_t a = *(const int64_t*)i1, b = *(const int64_t*)i2;
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/**
+ * Removes the repeated elements of a sorted array, returns the new length
+ */
+int64_t ChunkStore_unique(int64_t* data, int64_t count, int width) {
+  int64_t length = 0;
+  for (int64_t i = 0; i < count; i++) {
+    if (length > 0 && memcmp(data + (length - 1) * width, data + i * width,
+                             width * sizeof(int64_t)) == 0)
+      continue;
+    memmove(data + length * width, data + i * width, width * sizeof(int64_t));
+    length++;
+  }
+  return length;
+}
+
+/**
+ * Writes zeros to the file until the position is aligned for the next array
+ * Returns false if they could not be written
+ */
+bool ChunkStore_pad(FILE* file, int64_t* position) {
+  static const char zeros[CHUNKSTORE_ALIGNMENT] = {0};
+  int64_t padding = (CHUNKSTORE_ALIGNMENT - *position % CHUNKSTORE_ALIGNMENT) %
+                    CHUNKSTORE_ALIGNMENT;
+  *position += padding;
+  return fwrite(zeros, 1, padding, file) == (size_t)padding;
+}
+
+#endif
+
+/**
+ * Preprocesses a Wawefront .obj file into a chunk file for out-of-core
+ * rendering, aiming for the given number of edges in one chunk
+ * The lines are parsed like the scenes loaded for rendering. Only the
+ * vertices are kept in memory, the edges are streamed into temporary files
+ * that are then memory mapped
+ * Returns false if a file could not be read or written, an incomplete chunk
+ * file is removed
+ */
+bool ChunkStore_build(const char* objFileName, const char* fileName,
+                      long int chunkEdges) {
+#ifdef _WIN32
+  return false;
+#else
+  FILE* obj = fopen(objFileName, "r");
+  if (obj == NULL) return false;
+  FILE* edgeFile = ChunkStore_tempFile(fileName, ".edges");
+  FILE* sortedFile = ChunkStore_tempFile(fileName, ".sorted");
+  if (edgeFile == NULL || sortedFile == NULL) {
+    if (edgeFile != NULL) fclose(edgeFile);
+    if (sortedFile != NULL) fclose(sortedFile);
+    fclose(obj);
+    return false;
+  }
+
+  // First pass: collect the vertices and stream out the edges of the faces
+  // and polylines line by line, the duplicates are removed in every chunk
+  Scene scene;
+  Scene_init(&scene, NULL);
+  int64_t edgeCount = 0;
+  char* line = NULL;
+  size_t lineCapacity = 0;
+  bool success = true;
+  while (success && getline(&line, &lineCapacity, obj) != -1) {
+    Scene_parseObjLine(&scene, line);
+    success = ChunkStore_flushEdges(&scene, edgeFile, &edgeCount);
+  }
+  success = success && ferror(obj) == 0;
+  free(line);
+  fclose(obj);
+
+  ChunkFileHeader header;
+  memcpy(header.magic, CHUNKSTORE_MAGIC, sizeof(header.magic));
+  for (int i = 0; i < 3; i++) {
+    header.min[i] = INFINITY;
+    header.max[i] = -INFINITY;
+  }
+  Vec3* vertices = scene.vertices;
+  for (long int v = 0; v < scene.verticesCount; v++) {
+    double coords[3] = {vertices[v].x, vertices[v].y, vertices[v].z};
+    for (int i = 0; i < 3; i++) {
+      header.min[i] = fmin(header.min[i], coords[i]);
+      header.max[i] = fmax(header.max[i], coords[i]);
+    }
+  }
+
+  size_t edgeBytes = edgeCount * 2 * sizeof(int64_t);
+  int64_t* edges =
+      success ? (int64_t*)ChunkStore_mapFile(edgeFile, edgeBytes, false) : NULL;
+  int64_t* sorted =
+      edges != NULL ? (int64_t*)ChunkStore_mapFile(sortedFile, edgeBytes, true)
+                    : NULL;
+  FILE* out = sorted != NULL ? fopen(fileName, "wb") : NULL;
+  if (out == NULL) {
+    ChunkStore_unmapFile(edges, edgeBytes);
+    ChunkStore_unmapFile(sorted, edgeBytes);
+    fclose(edgeFile);
+    fclose(sortedFile);
+    Scene_free(&scene);
+    return false;
+  }
+
+  // Set up a grid with about the wanted number of edges in every cell
+  long int cells = ceil(cbrt((double)edgeCount / chunkEdges));
+  if (cells < 1) cells = 1;
+  if (cells > 128) cells = 128;
+  long int cellCount = cells * cells * cells;
+  double cellSize[3];
+  for (int i = 0; i < 3; i++) {
+    cellSize[i] = (header.max[i] - header.min[i]) / cells;
+    if (!(cellSize[i] > 0)) cellSize[i] = 1;
+  }
+
+  // Second pass: sort the edges by the cell of their first vertex
+  int64_t* offsets = (int64_t*)calloc(cellCount + 1, sizeof(int64_t));
+  int64_t* fill = (int64_t*)malloc(cellCount * sizeof(int64_t));
+  for (int64_t e = 0; e < edgeCount; e++) {
+    offsets[ChunkStore_cell(&vertices[edges[2 * e]], header.min, cellSize,
+                            cells) +
+            1]++;
+  }
+  long int chunkCount = 0;
+  for (long int c = 0; c < cellCount; c++) {
+    chunkCount += offsets[c + 1] > 0;
+    offsets[c + 1] += offsets[c];
+    fill[c] = offsets[c];
+  }
+  for (int64_t e = 0; e < edgeCount; e++) {
+    long int c =
+        ChunkStore_cell(&vertices[edges[2 * e]], header.min, cellSize, cells);
+    sorted[2 * fill[c]] = edges[2 * e];
+    sorted[2 * fill[c] + 1] = edges[2 * e + 1];
+    fill[c]++;
+  }
+  ChunkStore_unmapFile(edges, edgeBytes);
+  fclose(edgeFile);
+
+  // Third pass: write the cells as self-contained chunks
+  ChunkInfo* infos = (ChunkInfo*)calloc(chunkCount + 1, sizeof(ChunkInfo));
+  int64_t position = sizeof(ChunkFileHeader) + chunkCount * sizeof(ChunkInfo);
+  success = fseeko(out, position, SEEK_SET) == 0 &&
+            ChunkStore_pad(out, &position);
+  header.chunkCount = 0;
+  header.vertexCount = 0;
+  header.edgeCount = 0;
+  for (long int c = 0; c < cellCount && success; c++) {
+    int64_t count = offsets[c + 1] - offsets[c];
+    if (count == 0) continue;
+    // Remove the duplicates of the edges shared by faces
+    int64_t* chunkEdges = (int64_t*)malloc(count * 2 * sizeof(int64_t));
+    memcpy(chunkEdges, sorted + 2 * offsets[c], count * 2 * sizeof(int64_t));
+    qsort(chunkEdges, count, 2 * sizeof(int64_t), ChunkStore_compareEdges);
+    count = ChunkStore_unique(chunkEdges, count, 2);
+    // Collect the vertices used by the chunk and index them locally
+    int64_t* ids = (int64_t*)malloc(count * 2 * sizeof(int64_t));
+    memcpy(ids, chunkEdges, count * 2 * sizeof(int64_t));
+    qsort(ids, count * 2, sizeof(int64_t), ChunkStore_compareIds);
+    int64_t idCount = ChunkStore_unique(ids, count * 2, 1);
+    for (int64_t i = 0; i < count * 2; i++) {
+      int64_t* local = (int64_t*)bsearch(&chunkEdges[i], ids, idCount,
+                                         sizeof(int64_t),
+                                         ChunkStore_compareIds);
+      chunkEdges[i] = local - ids;
+    }
+    // Bounding sphere around the center of the bounding box
+    Vec3 min = vertices[ids[0]], max = vertices[ids[0]];
+    for (int64_t i = 1; i < idCount; i++) {
+      Vec3* v = &vertices[ids[i]];
+      min = Vec3_new(fmin(min.x, v->x), fmin(min.y, v->y), fmin(min.z, v->z));
+      max = Vec3_new(fmax(max.x, v->x), fmax(max.y, v->y), fmax(max.z, v->z));
+    }
+    Vec3 center = Vec3_new((min.x + max.x) / 2, (min.y + max.y) / 2,
+                           (min.z + max.z) / 2);
+    double radiusSq = 0;
+    for (int64_t i = 0; i < idCount; i++) {
+      Vec3 d = Vec3_copy(&vertices[ids[i]]);
+      Vec3_sub(&d, &center);
+      radiusSq = fmax(radiusSq, Vec3_sqLength(&d));
+    }
+
+    ChunkInfo* info = &infos[header.chunkCount++];
+    info->center[0] = center.x;
+    info->center[1] = center.y;
+    info->center[2] = center.z;
+    info->radius = sqrt(radiusSq);
+    info->vertexOffset = position;
+    info->vertexCount = idCount;
+    for (int64_t i = 0; i < idCount && success; i++)
+      success = fwrite(&vertices[ids[i]], sizeof(Vec3), 1, out) == 1;
+    position += idCount * sizeof(Vec3);
+    success = success && ChunkStore_pad(out, &position);
+    info->edgeOffset = position;
+    info->edgeCount = count;
+    success = success && fwrite(chunkEdges, 2 * sizeof(int64_t), count,
+                                out) == (size_t)count;
+    position += count * 2 * sizeof(int64_t);
+    success = success && ChunkStore_pad(out, &position);
+    header.vertexCount += idCount;
+    header.edgeCount += count;
+    free(ids);
+    free(chunkEdges);
+  }
+
+  success = success && fseeko(out, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(ChunkFileHeader), 1, out) == 1 &&
+            fwrite(infos, sizeof(ChunkInfo), header.chunkCount, out) ==
+                (size_t)header.chunkCount;
+  success = (fclose(out) == 0) && success;
+  if (!success) remove(fileName);
+
+  free(infos);
+  free(fill);
+  free(offsets);
+  ChunkStore_unmapFile(sorted, edgeBytes);
+  fclose(sortedFile);
+  Scene_free(&scene);
+  return success;
+#endif
+}
+
+/**
+ * Opens a chunk file for rendering, no chunk is resident at first
+ * Returns NULL if the file could not be opened or is not a chunk file
+ */
+ChunkStore* ChunkStore_open(const char* fileName, size_t memoryBudget) {
+#ifdef _WIN32
+  return NULL;
+#else
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(ChunkFileHeader)) {
+    close(fd);
+    return NULL;
+  }
+  unsigned char* map =
+      (unsigned char*)mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return NULL;
+  }
+  ChunkFileHeader* header = (ChunkFileHeader*)map;
+  size_t mapSize = info.st_size;
+  if (memcmp(header->magic, CHUNKSTORE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->chunkCount < 0 ||
+      (uint64_t)header->chunkCount >
+          (mapSize - sizeof(ChunkFileHeader)) / sizeof(ChunkInfo) ||
+      !ChunkStore_checkRanges((ChunkInfo*)(map + sizeof(ChunkFileHeader)),
+                              header->chunkCount, mapSize)) {
+    fprintf(stderr, "%s is not a valid chunk file\n", fileName);
+    munmap(map, info.st_size);
+    close(fd);
+    return NULL;
+  }
+  // The chunks are read in the order the camera needs them, readahead of the
+  // neighbouring data would mostly load chunks that are not needed
+  madvise(map, info.st_size, MADV_RANDOM);
+
+  ChunkStore* store = (ChunkStore*)malloc(sizeof(ChunkStore));
+  store->fd = fd;
+  store->map = map;
+  store->mapSize = info.st_size;
+  store->header = header;
+  store->infos = (ChunkInfo*)(map + sizeof(ChunkFileHeader));
+  store->chunkCount = header->chunkCount;
+  store->chunks = (Chunk*)calloc(store->chunkCount + 1, sizeof(Chunk));
+  store->visible = (long int*)malloc((store->chunkCount + 1) * sizeof(long));
+  store->visibleCount = 0;
+  store->residentCount = 0;
+  store->residentBytes = 0;
+  store->memoryBudget = memoryBudget;
+  store->frame = 0;
+  for (long int i = 0; i < store->chunkCount; i++) {
+    Chunk* chunk = &store->chunks[i];
+    ChunkInfo* chunkInfo = &store->infos[i];
+    Scene_init(&chunk->scene, NULL);
+    chunk->center = Vec3_new(chunkInfo->center[0], chunkInfo->center[1],
+                             chunkInfo->center[2]);
+    chunk->radius = chunkInfo->radius;
+  }
+  return store;
+#endif
+}
+
+/**
+ * Checks that the vertices and edges of every chunk are inside the mapped
+ * file, so a truncated or stale file is not read out of bounds
+ */
+bool ChunkStore_checkRanges(ChunkInfo* infos, int64_t chunkCount,
+                            size_t mapSize) {
+  for (int64_t i = 0; i < chunkCount; i++) {
+    ChunkInfo* info = &infos[i];
+    const int64_t ranges[2][3] = {
+        {info->vertexOffset, info->vertexCount, sizeof(Vec3)},
+        {info->edgeOffset, info->edgeCount, 2 * sizeof(int64_t)}};
+    for (int k = 0; k < 2; k++) {
+      int64_t offset = ranges[k][0], count = ranges[k][1];
+      // The arrays are read in place, they have to be aligned as well
+      if (offset < 0 || count < 0 || (uint64_t)offset > mapSize ||
+          offset % sizeof(int64_t) != 0 ||
+          (uint64_t)count > (mapSize - offset) / ranges[k][2] ||
+          count > LONG_MAX)
+        return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Checks that the edges only refer to the vertices of their chunk
+ */
+bool ChunkStore_checkEdges(const int64_t* edges, int64_t edgeCount,
+                           int64_t vertexCount) {
+  for (int64_t i = 0; i < edgeCount * 2; i++)
+    if (edges[i] < 0 || edges[i] >= vertexCount) return false;
+  return true;
+}
+
+/**
+ * Evicts every chunk and unmaps the file
+ */
+void ChunkStore_close(ChunkStore* store) {
+  if (store == NULL) return;
+#ifndef _WIN32
+  for (long int i = 0; i < store->chunkCount; i++)
+    if (store->chunks[i].resident) ChunkStore_evict(store, i);
+  munmap(store->map, store->mapSize);
+  close(store->fd);
+#endif
+  free(store->chunks);
+  free(store->visible);
+  free(store);
+}
+
+/**
+ * Returns the distance to the origo from the furthest point of the scene
+ * (estimated from the bounding spheres of the chunks)
+ */
+double ChunkStore_radius(ChunkStore* store) {
+  double max = 0;
+  for (long int i = 0; i < store->chunkCount; i++) {
+    Chunk* chunk = &store->chunks[i];
+    max = fmax(max, Vec3_length(&chunk->center) + chunk->radius);
+  }
+  return max;
+}
+
+/**
+ * Decides which chunks are needed for the frame seen by the camera
+ * Chunks intersecting the frustum are made resident, the ones that would
+ * intersect it after moving with the velocity for lookAhead seconds are
+ * prefetched, then the least recently used chunks are evicted until the
+ * resident ones fit into the memory budget (visible chunks are never evicted)
+ * Returns true if the set of visible chunks changed
+ */
+bool ChunkStore_update(ChunkStore* store, Camera* cam, Vec3* velocity,
+                       double lookAhead) {
+  bool changed = false;
+  store->frame++;
+  Camera ahead = *cam;
+  Vec3 step = Vec3_copy(velocity);
+  Vec3_mult(&step, lookAhead);
+  Vec3_add(&ahead.pos, &step);
+  bool moving = Vec3_sqLength(&step) > 0;
+
+  store->visibleCount = 0;
+  for (long int i = 0; i < store->chunkCount; i++) {
+    Chunk* chunk = &store->chunks[i];
+    bool visible = Camera_sphereVisible(cam, &chunk->center, chunk->radius);
+    changed |= visible != chunk->visible;
+    chunk->visible = visible;
+    if (visible) {
+      if (!chunk->resident) ChunkStore_load(store, i);
+      chunk->lastUsed = store->frame;
+      store->visible[store->visibleCount++] = i;
+    } else if (!chunk->resident) {
+      // Let the system read the chunks the camera is heading towards in the
+      // background, so they are in memory by the time they are needed
+      bool needed =
+          moving && Camera_sphereVisible(&ahead, &chunk->center, chunk->radius);
+#ifndef _WIN32
+      if (needed && !chunk->prefetched)
+        ChunkStore_advise(store, i, MADV_WILLNEED);
+#endif
+      chunk->prefetched = needed;
+    }
+  }
+
+  while (store->residentBytes > store->memoryBudget) {
+    long int oldest = -1;
+    for (long int i = 0; i < store->chunkCount; i++) {
+      Chunk* chunk = &store->chunks[i];
+      if (chunk->resident && !chunk->visible &&
+          (oldest < 0 || chunk->lastUsed < store->chunks[oldest].lastUsed))
+        oldest = i;
+    }
+    if (oldest < 0) break;
+    ChunkStore_evict(store, oldest);
+  }
+
+  return changed;
+}
+
+/**
+ * Projects the visible chunks with the camera and settings of the view scene
+ * and collects their edges to be drawn, the chunks are distributed over the
+ * worker pool of the view
+ * Returns true if any of them was projected again
+ */
+bool ChunkStore_project(ChunkStore* store, Scene* view) {
+  for (long int k = 0; k < store->visibleCount; k++) {
+    Scene* scene = &store->chunks[store->visible[k]].scene;
+    Scene_copySettings(scene, view);
+  }
+  if (view->workers != NULL && store->visibleCount > 1) {
+    WorkerPool_run(view->workers, ChunkStore_projectChunk, store,
+                   store->visibleCount);
+  } else {
+    for (long int k = 0; k < store->visibleCount; k++)
+      ChunkStore_projectChunk(store, k);
+  }
+
+  bool changed = false;
+  for (long int k = 0; k < store->visibleCount; k++) {
+    Chunk* chunk = &store->chunks[store->visible[k]];
+    changed |= chunk->projected;
+    // The pixel mask and the single precision vertices are only allocated
+    // when the chunk is first projected
+    size_t bytes = ChunkStore_chunkBytes(chunk);
+    store->residentBytes += bytes - chunk->bytes;
+    chunk->bytes = bytes;
+  }
+  return changed;
+}
+
+/**
+ * Job of the worker pool projecting the index-th visible chunk
+ */
+void ChunkStore_projectChunk(void* _store, int index) {
+  ChunkStore* store = (ChunkStore*)_store;
+  Chunk* chunk = &store->chunks[store->visible[index]];
+  chunk->projected = Scene_projectPoints(&chunk->scene);
+  if (chunk->projected) Scene_compactEdges(&chunk->scene);
+}
+
+/**
+ * Returns the memory used by a resident chunk
+ */
+size_t ChunkStore_chunkBytes(Chunk* chunk) {
+  Scene* scene = &chunk->scene;
+  return scene->verticesCount * (sizeof(Vec3) + sizeof(Point) + 1) +
+         scene->allocatedLocal * 3 * sizeof(float) +
+         scene->edgeCount * (2 * sizeof(Edge) + sizeof(long int)) +
+         (scene->pixelMask != NULL ? scene->pixelMaskSize / 8 + 1 : 0);
+}
+
+/**
+ * Makes a chunk resident: its geometry is pointed into the mapped file and
+ * the arrays for projecting it are allocated
+ */
+void ChunkStore_load(ChunkStore* store, long int index) {
+  Chunk* chunk = &store->chunks[index];
+  ChunkInfo* info = &store->infos[index];
+  Scene* scene = &chunk->scene;
+  long int vertexCount = info->vertexCount, edgeCount = info->edgeCount;
+
+  Scene_erase(scene);
+  // The indices are only read when the chunk is needed, a chunk referring to
+  // vertices it does not have is left empty
+  int64_t* edges = (int64_t*)(store->map + info->edgeOffset);
+  if (!ChunkStore_checkEdges(edges, edgeCount, vertexCount)) {
+    fprintf(stderr, "Chunk %ld has edges with invalid vertices\n", index);
+    vertexCount = edgeCount = 0;
+  }
+  scene->vertices = (Vec3*)(store->map + info->vertexOffset);
+  scene->verticesCount = vertexCount;
+  // The edges can be used in place where long int is 64 bits wide, otherwise
+  // they are converted
+  if (sizeof(long int) == sizeof(int64_t)) {
+    scene->edges = (Edge*)edges;
+  } else {
+    scene->edges = (Edge*)malloc(edgeCount * sizeof(Edge));
+    for (long int i = 0; i < edgeCount; i++)
+      scene->edges[i] = Edge_new(edges[2 * i], edges[2 * i + 1]);
+  }
+  scene->edgeCount = edgeCount;
+  scene->projectedPoints = (Point*)malloc(vertexCount * sizeof(Point));
+  scene->visibility = (unsigned char*)malloc(vertexCount);
+  scene->allocatedProjection = vertexCount;
+  scene->visibleEdges = (Edge*)malloc(edgeCount * sizeof(Edge));
+  scene->pixels = (long int*)malloc(edgeCount * sizeof(long int));
+
+  chunk->resident = true;
+  chunk->bytes = ChunkStore_chunkBytes(chunk);
+  store->residentBytes += chunk->bytes;
+  store->residentCount++;
+#ifndef _WIN32
+  if (!chunk->prefetched) ChunkStore_advise(store, index, MADV_WILLNEED);
+#endif
+}
+
+/**
+ * Frees the arrays of a resident chunk and lets the system drop its pages
+ */
+void ChunkStore_evict(ChunkStore* store, long int index) {
+  Chunk* chunk = &store->chunks[index];
+  Scene* scene = &chunk->scene;
+  free(scene->projectedPoints);
+  free(scene->visibility);
+  free(scene->visibleEdges);
+  free(scene->pixels);
+  free(scene->pixelMask);
+  free(scene->ranges);
+  free(scene->localX);
+  free(scene->localY);
+  free(scene->localZ);
+  if (sizeof(long int) != sizeof(int64_t)) free(scene->edges);
+  Scene_erase(scene);
+#ifndef _WIN32
+  ChunkStore_advise(store, index, MADV_DONTNEED);
+#endif
+
+  chunk->resident = false;
+  chunk->prefetched = false;
+  store->residentBytes -= chunk->bytes;
+  store->residentCount--;
+  chunk->bytes = 0;
+}
+
+/**
+ * Gives advice to the system about the pages of a chunk in the mapped file
+ */
+void ChunkStore_advise(ChunkStore* store, long int index, int advice) {
+#ifndef _WIN32
+  ChunkInfo* info = &store->infos[index];
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t begin = info->vertexOffset / page * page;
+  size_t end = info->edgeOffset + info->edgeCount * 2 * sizeof(int64_t);
+  end = (end + page - 1) / page * page;
+  if (end > store->mapSize) end = store->mapSize;
+  if (end > begin) madvise(store->map + begin, end - begin, advice);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,642 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <decompress.h>
+
+/**
+ * Returns the compression of the data from its first bytes, DECOMPRESS_NONE
+ * if it is not compressed
+ */
+int Decompress_formatOf(const void* data, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  if (length >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B)
+    return DECOMPRESS_GZIP;
+  if (length >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 &&
+      bytes[2] == 0x2F && bytes[3] == 0xFD)
+    return DECOMPRESS_ZSTD;
+  return DECOMPRESS_NONE;
+}
+
+/**
+ * Starts decompressing the input of the file descriptor, the bytes already
+ * read from it (at least the ones that identified the format) are given as
+ * the prefix
+ * Returns NULL if the format is not supported by the build
+ */
+Decompressor* Decompress_start(int fd, int format, const void* prefix,
+                               size_t length) {
+#ifndef CCANVAS_ZSTD
+  if (format == DECOMPRESS_ZSTD) {
+    fprintf(stderr, "zstd input needs a build with CCANVAS_ZSTD\n");
+    return NULL;
+  }
+#endif
+  if (format == DECOMPRESS_NONE) return NULL;
+
+  Decompressor* stream = (Decompressor*)malloc(sizeof(Decompressor));
+  stream->fd = fd;
+  stream->format = format;
+  stream->input = (uint8_t*)malloc(
+      length > DECOMPRESS_INPUT_SIZE ? length : DECOMPRESS_INPUT_SIZE);
+  memcpy(stream->input, prefix, length);
+  stream->inputStart = 0;
+  stream->inputEnd = length;
+  stream->inputDone = false;
+  stream->bits = 0;
+  stream->bitCount = 0;
+  stream->state = DECOMPRESS_HEADER;
+  stream->lastBlock = false;
+  stream->remaining = 0;
+  stream->matchLength = stream->matchDistance = 0;
+  stream->window = (uint8_t*)malloc(DECOMPRESS_WINDOW);
+  stream->windowPos = 0;
+  stream->total = stream->memberStart = 0;
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    stream->crcTable[i] = c;
+  }
+  stream->crc = 0xFFFFFFFF;
+  // Length symbols 257 to 284 come in groups of 4 with one more extra bit in
+  // every group, distances in groups of 2
+  for (int i = 0, base = 3; i < 28; i++) {
+    stream->lengthBase[i] = base;
+    stream->lengthExtra[i] = i < 8 ? 0 : i / 4 - 1;
+    base += 1 << stream->lengthExtra[i];
+  }
+  stream->lengthBase[28] = 258;
+  stream->lengthExtra[28] = 0;
+  for (int i = 0, base = 1; i < 30; i++) {
+    stream->distanceBase[i] = base;
+    stream->distanceExtra[i] = i < 2 ? 0 : i / 2 - 1;
+    base += 1 << stream->distanceExtra[i];
+  }
+#ifdef CCANVAS_ZSTD
+  stream->zstd = NULL;
+  if (format == DECOMPRESS_ZSTD) {
+    stream->zstd = ZSTD_createDStream();
+    ZSTD_initDStream(stream->zstd);
+  }
+  stream->zstdResult = 1;
+#endif
+  for (int i = 0; i < DECOMPRESS_BUFFERS; i++)
+    stream->buffers[i] = (uint8_t*)malloc(DECOMPRESS_BUFFER_SIZE);
+  stream->first = stream->filled = 0;
+  stream->finished = false;
+  stream->failed = false;
+#ifndef WORKERS_NO_THREADS
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->bufferFilled, NULL);
+  pthread_cond_init(&stream->bufferFreed, NULL);
+  stream->quit = false;
+  stream->threaded =
+      pthread_create(&stream->thread, NULL, Decompress_thread, stream) == 0;
+#endif
+  return stream;
+}
+
+/**
+ * Stops the thread and frees the decompressor, the file descriptor is left
+ * open
+ */
+void Decompress_stop(Decompressor* stream) {
+  if (stream == NULL) return;
+#ifndef WORKERS_NO_THREADS
+  if (stream->threaded) {
+    pthread_mutex_lock(&stream->lock);
+    stream->quit = true;
+    pthread_cond_signal(&stream->bufferFreed);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+  }
+  pthread_mutex_destroy(&stream->lock);
+  pthread_cond_destroy(&stream->bufferFilled);
+  pthread_cond_destroy(&stream->bufferFreed);
+#endif
+  if (stream->failed)
+    fprintf(stderr, "The compressed input is corrupt or truncated\n");
+#ifdef CCANVAS_ZSTD
+  ZSTD_freeDStream(stream->zstd);
+#endif
+  for (int i = 0; i < DECOMPRESS_BUFFERS; i++) free(stream->buffers[i]);
+  free(stream->input);
+  free(stream->window);
+  free(stream);
+}
+
+/**
+ * Points data to the oldest buffer filled by the thread, it has to be handed
+ * back with Decompress_release once it is used
+ * Waits for the thread to fill a buffer if wait is set
+ * Returns the length of the buffer, 0 at the end of the output and -1 if no
+ * buffer is filled yet
+ */
+long int Decompress_next(Decompressor* stream, const char** data, bool wait) {
+  *data = (const char*)stream->buffers[stream->first];
+#ifndef WORKERS_NO_THREADS
+  if (stream->threaded) {
+    pthread_mutex_lock(&stream->lock);
+    while (wait && stream->filled == 0 && !stream->finished)
+      pthread_cond_wait(&stream->bufferFilled, &stream->lock);
+    long int length = -1;
+    if (stream->filled > 0) {
+      length = stream->lengths[stream->first];
+    } else if (stream->finished) {
+      length = 0;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return length;
+  }
+#endif
+  // Without the thread the buffer is filled now
+  if (stream->filled == 0 && !stream->finished) {
+    size_t length = Decompress_fill(stream, stream->buffers[stream->first],
+                                    DECOMPRESS_BUFFER_SIZE);
+    stream->lengths[stream->first] = length;
+    stream->filled = length > 0;
+    stream->finished = length == 0;
+  }
+  return stream->filled > 0 ? (long int)stream->lengths[stream->first] : 0;
+}
+
+/**
+ * Hands the oldest buffer back to the thread
+ */
+void Decompress_release(Decompressor* stream) {
+#ifndef WORKERS_NO_THREADS
+  if (stream->threaded) pthread_mutex_lock(&stream->lock);
+#endif
+  stream->first = (stream->first + 1) % DECOMPRESS_BUFFERS;
+  stream->filled--;
+#ifndef WORKERS_NO_THREADS
+  if (stream->threaded) {
+    pthread_cond_signal(&stream->bufferFreed);
+    pthread_mutex_unlock(&stream->lock);
+  }
+#endif
+}
+
+/**
+ * Decompresses the next part of the output into the buffer
+ * Returns the number of bytes written, it is only less than the size at the
+ * end of the output (or of the input if it is truncated)
+ */
+size_t Decompress_fill(Decompressor* stream, uint8_t* out, size_t size) {
+#ifdef CCANVAS_ZSTD
+  if (stream->format == DECOMPRESS_ZSTD)
+    return Decompress_zstd(stream, out, size);
+#endif
+  return Decompress_inflate(stream, out, size);
+}
+
+/**
+ * Reads the next part of the compressed input once the previous one is used
+ * up, waiting for pipes that have no data yet
+ * Returns false at the end of the input, on errors and when the thread is
+ * stopped
+ */
+bool Decompress_readInput(Decompressor* stream) {
+  stream->inputStart = stream->inputEnd = 0;
+  while (!stream->inputDone) {
+#ifdef _WIN32
+    long int length = _read(stream->fd, stream->input, DECOMPRESS_INPUT_SIZE);
+#else
+    // The thread only reads once there is input, so it checks regularly
+    // whether it has to stop while it waits, even on a blocking descriptor
+    // whose writer stays idle
+    struct pollfd wait = {stream->fd, POLLIN, 0};
+    if (poll(&wait, 1, 50) <= 0) {
+      if (Decompress_stopping(stream)) break;
+      continue;
+    }
+    long int length = read(stream->fd, stream->input, DECOMPRESS_INPUT_SIZE);
+    if (length < 0 &&
+        (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      continue;
+#endif
+    if (length <= 0) break;
+    stream->inputEnd = length;
+    return true;
+  }
+  stream->inputDone = true;
+  return false;
+}
+
+/**
+ * Returns true if the thread was asked to stop
+ */
+bool Decompress_stopping(Decompressor* stream) {
+  bool quit = false;
+#ifndef WORKERS_NO_THREADS
+  pthread_mutex_lock(&stream->lock);
+  quit = stream->quit;
+  pthread_mutex_unlock(&stream->lock);
+#endif
+  return quit;
+}
+
+/**
+ * Moves input into the bit buffer until it has at least the given number of
+ * bits, more input is only read if it is needed for that
+ * Returns false if the input ended first
+ */
+bool Decompress_refill(Decompressor* stream, int count) {
+  while (stream->bitCount <= 56) {
+    if (stream->inputStart == stream->inputEnd &&
+        (stream->bitCount >= count || !Decompress_readInput(stream)))
+      break;
+    stream->bits |= (uint64_t)stream->input[stream->inputStart++]
+                    << stream->bitCount;
+    stream->bitCount += 8;
+  }
+  return stream->bitCount >= count;
+}
+
+/**
+ * Takes the given number of bits (at most 32) from the input, the first one
+ * is the lowest
+ * Marks the stream failed if the input ended
+ */
+uint32_t Decompress_bits(Decompressor* stream, int count) {
+  if (stream->bitCount < count && !Decompress_refill(stream, count)) {
+    stream->failed = true;
+    return 0;
+  }
+  uint32_t value = (uint32_t)(stream->bits & ((1ull << count) - 1));
+  stream->bits >>= count;
+  stream->bitCount -= count;
+  return value;
+}
+
+/**
+ * Inflates the gzip input into the buffer, see Decompress_fill
+ */
+size_t Decompress_inflate(Decompressor* stream, uint8_t* out, size_t size) {
+  size_t count = 0, checked = 0;
+  uint8_t* window = stream->window;
+  size_t mask = DECOMPRESS_WINDOW - 1;
+  while (count < size && !stream->failed &&
+         stream->state != DECOMPRESS_END) {
+    switch (stream->state) {
+      case DECOMPRESS_HEADER:
+        stream->memberStart = stream->total + count;
+        if (Decompress_readHeader(stream)) stream->state = DECOMPRESS_BLOCK;
+        break;
+
+      case DECOMPRESS_BLOCK:
+        if (stream->lastBlock) {
+          stream->state = DECOMPRESS_TRAILER;
+        } else {
+          Decompress_readBlock(stream);
+        }
+        break;
+
+      case DECOMPRESS_STORED:
+        while (count < size && stream->remaining > 0 && !stream->failed) {
+          uint8_t byte = (uint8_t)Decompress_bits(stream, 8);
+          out[count++] = window[stream->windowPos] = byte;
+          stream->windowPos = (stream->windowPos + 1) & mask;
+          stream->remaining--;
+        }
+        if (stream->remaining == 0) stream->state = DECOMPRESS_BLOCK;
+        break;
+
+      case DECOMPRESS_HUFFMAN:
+        while (count < size && !stream->failed) {
+          // A match cut off by the end of the last buffer is finished first
+          if (stream->matchLength > 0) {
+            size_t from = (stream->windowPos - stream->matchDistance) & mask;
+            while (stream->matchLength > 0 && count < size) {
+              uint8_t byte = window[from];
+              from = (from + 1) & mask;
+              out[count++] = window[stream->windowPos] = byte;
+              stream->windowPos = (stream->windowPos + 1) & mask;
+              stream->matchLength--;
+            }
+            continue;
+          }
+
+          int symbol = Decompress_decode(stream, &stream->literals);
+          if (symbol < 0) break;
+          if (symbol < 256) {
+            out[count++] = window[stream->windowPos] = (uint8_t)symbol;
+            stream->windowPos = (stream->windowPos + 1) & mask;
+            continue;
+          }
+          if (symbol == 256) {
+            stream->state = DECOMPRESS_BLOCK;
+            break;
+          }
+          // The extra bits of the length come before the distance code
+          symbol -= 257;
+          if (symbol >= 29) {
+            stream->failed = true;
+            break;
+          }
+          int length = stream->lengthBase[symbol] +
+                       Decompress_bits(stream, stream->lengthExtra[symbol]);
+          int distanceSymbol = Decompress_decode(stream, &stream->distances);
+          if (distanceSymbol < 0 || distanceSymbol >= 30) {
+            stream->failed = true;
+            break;
+          }
+          int distance =
+              stream->distanceBase[distanceSymbol] +
+              Decompress_bits(stream, stream->distanceExtra[distanceSymbol]);
+          if ((uint64_t)distance > stream->total + count) {
+            stream->failed = true;
+            break;
+          }
+          stream->matchLength = length;
+          stream->matchDistance = distance;
+        }
+        break;
+
+      case DECOMPRESS_TRAILER: {
+        Decompress_crc(stream, &out[checked], count - checked);
+        checked = count;
+        Decompress_bits(stream, stream->bitCount % 8);
+        uint32_t crc = Decompress_bits(stream, 32);
+        uint32_t memberSize = Decompress_bits(stream, 32);
+        if (crc != (stream->crc ^ 0xFFFFFFFF) ||
+            memberSize != (uint32_t)(stream->total + count -
+                                     stream->memberStart))
+          stream->failed = true;
+        stream->crc = 0xFFFFFFFF;
+        // Another member may follow, anything else after the end is ignored
+        // like gzip does
+        stream->state = DECOMPRESS_END;
+        if (Decompress_refill(stream, 16) &&
+            (stream->bits & 0xFFFF) == 0x8B1F)
+          stream->state = DECOMPRESS_HEADER;
+        stream->lastBlock = false;
+        break;
+      }
+    }
+  }
+  Decompress_crc(stream, &out[checked], count - checked);
+  stream->total += count;
+  return count;
+}
+
+/**
+ * Adds the output to the CRC-32 of the gzip member
+ */
+void Decompress_crc(Decompressor* stream, const uint8_t* data, size_t size) {
+  uint32_t c = stream->crc;
+  for (size_t i = 0; i < size; i++)
+    c = stream->crcTable[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+  stream->crc = c;
+}
+
+/**
+ * Reads the header of a gzip member, the optional fields are skipped
+ * Returns false if it is not a deflate compressed gzip member
+ */
+bool Decompress_readHeader(Decompressor* stream) {
+  uint32_t magic = Decompress_bits(stream, 16);
+  uint32_t method = Decompress_bits(stream, 8);
+  uint32_t flags = Decompress_bits(stream, 8);
+  if (magic != 0x8B1F || method != 8) stream->failed = true;
+  // Modification time, extra flags and operating system
+  Decompress_bits(stream, 32);
+  Decompress_bits(stream, 16);
+  if (flags & 0x04) {
+    long int length = Decompress_bits(stream, 16);
+    while (length-- > 0 && !stream->failed) Decompress_bits(stream, 8);
+  }
+  // File name and comment, both end with a zero byte
+  if (flags & 0x08)
+    while (Decompress_bits(stream, 8) != 0 && !stream->failed) continue;
+  if (flags & 0x10)
+    while (Decompress_bits(stream, 8) != 0 && !stream->failed) continue;
+  if (flags & 0x02) Decompress_bits(stream, 16);
+  return !stream->failed;
+}
+
+/**
+ * Reads the header of the next deflate block and prepares for its data
+ * Returns false if the block is invalid
+ */
+bool Decompress_readBlock(Decompressor* stream) {
+  stream->lastBlock = Decompress_bits(stream, 1);
+  uint32_t type = Decompress_bits(stream, 2);
+  if (type == 0) {
+    Decompress_bits(stream, stream->bitCount % 8);
+    uint32_t length = Decompress_bits(stream, 16);
+    uint32_t check = Decompress_bits(stream, 16);
+    if (length != (~check & 0xFFFF)) stream->failed = true;
+    stream->remaining = length;
+    stream->state = DECOMPRESS_STORED;
+  } else if (type == 1) {
+    uint8_t lengths[288];
+    for (int i = 0; i < 288; i++)
+      lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    Decompress_buildCode(&stream->literals, lengths, 288);
+    memset(lengths, 5, 30);
+    Decompress_buildCode(&stream->distances, lengths, 30);
+    stream->state = DECOMPRESS_HUFFMAN;
+  } else if (type == 2) {
+    if (Decompress_readCodes(stream)) stream->state = DECOMPRESS_HUFFMAN;
+  } else {
+    stream->failed = true;
+  }
+  return !stream->failed;
+}
+
+/**
+ * Reads the Huffman codes of a block with dynamic codes, they are described
+ * by their code lengths, which are themselves Huffman coded
+ * Returns false if the codes are invalid
+ */
+bool Decompress_readCodes(Decompressor* stream) {
+  const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                             11, 4,  12, 3, 13, 2, 14, 1, 15};
+  int literalCount = Decompress_bits(stream, 5) + 257;
+  int distanceCount = Decompress_bits(stream, 5) + 1;
+  int lengthCount = Decompress_bits(stream, 4) + 4;
+  uint8_t lengths[320];
+  memset(lengths, 0, 19);
+  for (int i = 0; i < lengthCount; i++)
+    lengths[order[i]] = Decompress_bits(stream, 3);
+  DecompressCode lengthCode;
+  if (stream->failed || literalCount > 286 || distanceCount > 30 ||
+      !Decompress_buildCode(&lengthCode, lengths, 19)) {
+    stream->failed = true;
+    return false;
+  }
+
+  // 16 repeats the previous length, 17 and 18 repeat zeros
+  int count = literalCount + distanceCount;
+  for (int i = 0; i < count && !stream->failed;) {
+    int symbol = Decompress_decode(stream, &lengthCode);
+    if (symbol < 16) {
+      if (symbol >= 0) lengths[i++] = symbol;
+      continue;
+    }
+    int repeat, value = 0;
+    if (symbol == 16) {
+      if (i == 0) stream->failed = true;
+      value = i > 0 ? lengths[i - 1] : 0;
+      repeat = 3 + Decompress_bits(stream, 2);
+    } else if (symbol == 17) {
+      repeat = 3 + Decompress_bits(stream, 3);
+    } else {
+      repeat = 11 + Decompress_bits(stream, 7);
+    }
+    if (i + repeat > count) stream->failed = true;
+    while (repeat-- > 0 && i < count) lengths[i++] = value;
+  }
+  if (stream->failed || lengths[256] == 0 ||
+      !Decompress_buildCode(&stream->literals, lengths, literalCount) ||
+      !Decompress_buildCode(&stream->distances, &lengths[literalCount],
+                            distanceCount)) {
+    stream->failed = true;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Builds the canonical Huffman code with the given code lengths of the
+ * symbols, codes may be incomplete but not over-subscribed
+ * Returns false if the lengths do not make up a code
+ */
+bool Decompress_buildCode(DecompressCode* code, const uint8_t* lengths,
+                          int count) {
+  memset(code->counts, 0, sizeof(code->counts));
+  for (int i = 0; i < count; i++) code->counts[lengths[i]]++;
+  code->counts[0] = 0;
+  int left = 1;
+  for (int length = 1; length < 16; length++) {
+    left = (left << 1) - code->counts[length];
+    if (left < 0) return false;
+  }
+
+  uint16_t offsets[16];
+  offsets[1] = 0;
+  for (int length = 1; length < 15; length++)
+    offsets[length + 1] = offsets[length] + code->counts[length];
+  for (int i = 0; i < count; i++)
+    if (lengths[i] != 0) code->symbols[offsets[lengths[i]]++] = i;
+
+  // The codes are read from the lowest bit, so the table is indexed with the
+  // reversed codes, every entry whose low bits match a code is filled
+  memset(code->fast, 0, sizeof(code->fast));
+  int value = 0, index = 0;
+  for (int length = 1; length <= DECOMPRESS_FAST_BITS; length++) {
+    for (int i = 0; i < code->counts[length]; i++, index++, value++) {
+      int reversed = 0;
+      for (int bit = 0; bit < length; bit++)
+        reversed |= ((value >> bit) & 1) << (length - 1 - bit);
+      for (int entry = reversed; entry < 1 << DECOMPRESS_FAST_BITS;
+           entry += 1 << length)
+        code->fast[entry] = code->symbols[index] << 4 | length;
+    }
+    value <<= 1;
+  }
+  return true;
+}
+
+/**
+ * Decodes the next symbol of the code from the input
+ * Returns -1 and marks the stream failed if the input has no valid code
+ */
+int Decompress_decode(Decompressor* stream, DecompressCode* code) {
+  if (stream->bitCount < 15) Decompress_refill(stream, 15);
+  uint16_t entry =
+      code->fast[stream->bits & ((1 << DECOMPRESS_FAST_BITS) - 1)];
+  if (entry != 0 && (entry & 15) <= stream->bitCount) {
+    stream->bits >>= entry & 15;
+    stream->bitCount -= entry & 15;
+    return entry >> 4;
+  }
+
+  // Longer codes are found one bit at a time, the codes of every length
+  // follow the codes of the previous length
+  int value = 0, first = 0, index = 0;
+  for (int length = 1; length < 16 && length <= stream->bitCount; length++) {
+    value |= (stream->bits >> (length - 1)) & 1;
+    int count = code->counts[length];
+    if (value - first < count) {
+      stream->bits >>= length;
+      stream->bitCount -= length;
+      return code->symbols[index + value - first];
+    }
+    index += count;
+    first = (first + count) << 1;
+    value <<= 1;
+  }
+  stream->failed = true;
+  return -1;
+}
+
+#ifdef CCANVAS_ZSTD
+/**
+ * Decompresses the zstd input into the buffer with libzstd, see
+ * Decompress_fill
+ */
+size_t Decompress_zstd(Decompressor* stream, uint8_t* out, size_t size) {
+  ZSTD_outBuffer output = {out, size, 0};
+  while (output.pos < output.size) {
+    ZSTD_inBuffer input = {stream->input + stream->inputStart,
+                           stream->inputEnd - stream->inputStart, 0};
+    size_t written = output.pos;
+    size_t result = ZSTD_decompressStream(stream->zstd, &output, &input);
+    stream->inputStart += input.pos;
+    if (ZSTD_isError(result)) {
+      stream->failed = true;
+      break;
+    }
+    // A call without input after the end of a frame asks for the next one,
+    // that does not make the frame incomplete
+    if (input.pos > 0 || output.pos > written) stream->zstdResult = result;
+    // Once the input is used up with room left in the output, everything
+    // decompressed so far was written
+    if (stream->inputStart == stream->inputEnd &&
+        output.pos < output.size && !Decompress_readInput(stream)) {
+      if (stream->zstdResult != 0) stream->failed = true;
+      break;
+    }
+  }
+  return output.pos;
+}
+#endif
+
+#ifndef WORKERS_NO_THREADS
+/**
+ * Function of the thread, fills the free buffers of the ring in order until
+ * the end of the output or until it is stopped
+ */
+void* Decompress_thread(void* _stream) {
+  Decompressor* stream = (Decompressor*)_stream;
+  pthread_mutex_lock(&stream->lock);
+  while (true) {
+    while (stream->filled == DECOMPRESS_BUFFERS && !stream->quit)
+      pthread_cond_wait(&stream->bufferFreed, &stream->lock);
+    if (stream->quit) break;
+    int index = (stream->first + stream->filled) % DECOMPRESS_BUFFERS;
+    pthread_mutex_unlock(&stream->lock);
+
+    size_t length = Decompress_fill(stream, stream->buffers[index],
+                                    DECOMPRESS_BUFFER_SIZE);
+
+    pthread_mutex_lock(&stream->lock);
+    if (length == 0) {
+      stream->finished = true;
+      pthread_cond_signal(&stream->bufferFilled);
+      break;
+    }
+    stream->lengths[index] = length;
+    stream->filled++;
+    pthread_cond_signal(&stream->bufferFilled);
+  }
+  pthread_mutex_unlock(&stream->lock);
+  return NULL;
+}
+#endif
\ No newline at end of file
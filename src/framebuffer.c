@@ -0,0 +1,345 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <framebuffer.h>
+#include <simd.h>
+
+extern inline uint32_t Framebuffer_blend(uint32_t dst, uint32_t pixel,
+                                         uint32_t coverage);
+
+/**
+ * Creates a new framebuffer with the given size
+ */
+Framebuffer Framebuffer_new(int width, int height) {
+  Framebuffer fb;
+  fb.width = width;
+  fb.height = height;
+  fb.pixels = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+  return fb;
+}
+
+/**
+ * Changes the size of the framebuffer, the content is lost
+ */
+void Framebuffer_resize(Framebuffer* fb, int width, int height) {
+  if (fb->width == width && fb->height == height) return;
+  free(fb->pixels);
+  *fb = Framebuffer_new(width, height);
+}
+
+/**
+ * Frees up the memory of the pixels
+ */
+void Framebuffer_free(Framebuffer* fb) {
+  free(fb->pixels);
+  fb->pixels = NULL;
+  fb->width = fb->height = 0;
+}
+
+/**
+ * Converts a color given as 0xRRGGBBAA (the format used by CCanvas) to the
+ * pixel format of the framebuffer
+ */
+uint32_t Framebuffer_color(uint32_t rgba) {
+  uint8_t bytes[4] = {(uint8_t)(rgba >> 24), (uint8_t)(rgba >> 16),
+                      (uint8_t)(rgba >> 8), (uint8_t)rgba};
+  uint32_t pixel;
+  memcpy(&pixel, bytes, sizeof(pixel));
+  return pixel;
+}
+
+/**
+ * Fills the whole framebuffer with the given pixel
+ */
+void Framebuffer_clear(Framebuffer* fb, uint32_t pixel) {
+  size_t count = (size_t)fb->width * fb->height;
+  for (size_t i = 0; i < count; i++) fb->pixels[i] = pixel;
+}
+
+/**
+ * Sets a single pixel if it is inside the framebuffer
+ */
+void Framebuffer_point(Framebuffer* fb, int x, int y, uint32_t pixel) {
+  if (x < 0 || y < 0 || x >= fb->width || y >= fb->height) return;
+  fb->pixels[(size_t)y * fb->width + x] = pixel;
+}
+
+/**
+ * Draws an anti-aliased line with thickness of 1 using Xiaolin Wu's algorithm
+ * Every step along the major axis blends the two pixels nearest to the line
+ * by their coverage, the position on the minor axis is tracked in 16.16 fixed
+ * point, the pixels at the ends are weighted by how much of them the line
+ * reaches into
+ * The line is clipped first, so the endpoints can be outside the framebuffer
+ */
+void Framebuffer_lineAA(Framebuffer* fb, double x1, double y1, double x2,
+                        double y2, uint32_t pixel) {
+  if (!Framebuffer_clipLine(fb, &x1, &y1, &x2, &y2)) return;
+
+  // Walk along the major axis a in increasing order, b is the minor axis
+  bool steep = fabs(y2 - y1) > fabs(x2 - x1);
+  double a1 = steep ? y1 : x1, b1 = steep ? x1 : y1;
+  double a2 = steep ? y2 : x2, b2 = steep ? x2 : y2;
+  if (a1 > a2) {
+    Framebuffer_swap(&a1, &a2);
+    Framebuffer_swap(&b1, &b2);
+  }
+  size_t majorStride = steep ? fb->width : 1;
+  size_t minorStride = steep ? 1 : fb->width;
+  int minorLimit = steep ? fb->width : fb->height;
+
+  double gradient = a2 > a1 ? (b2 - b1) / (a2 - a1) : 0;
+  int begin = (int)(a1 + 0.5), end = (int)(a2 + 0.5);
+  // Share of the end pixels covered by the line, in 1/256
+  int firstWeight = (int)((begin + 0.5 - a1) * 256);
+  int lastWeight = (int)((a2 - end + 0.5) * 256);
+  if (begin == end) firstWeight = lastWeight = (int)((a2 - a1) * 256) + 1;
+
+  // The pixel centers are at the integer coordinates
+  int64_t b = (int64_t)((b1 + gradient * (begin - a1)) * 65536);
+  int64_t step = (int64_t)(gradient * 65536);
+  uint32_t* pixels = fb->pixels;
+  for (int a = begin; a <= end; a++, b += step) {
+    int minor = (int)(b >> 16);
+    uint32_t upper = (uint32_t)(b >> 8) & 0xFF;
+    uint32_t lower = 256 - upper;
+    if (a == begin || a == end) {
+      int weight = a == begin ? firstWeight : lastWeight;
+      upper = upper * weight >> 8;
+      lower = lower * weight >> 8;
+    }
+    uint32_t* p = &(pixels[a * majorStride + minor * minorStride]);
+    if (minor >= 0) *p = Framebuffer_blend(*p, pixel, lower);
+    if (minor + 1 < minorLimit)
+      p[minorStride] = Framebuffer_blend(p[minorStride], pixel, upper);
+  }
+}
+
+/**
+ * Draws an anti-aliased line of the given width with butt, square or round
+ * caps
+ * The coverage of every pixel is estimated from the distance of its center to
+ * the line: butt and square caps multiply the coverage across the line with
+ * the one along it, round caps use the distance from the segment between the
+ * endpoints
+ * Each row is filled in a single span, the pixels whose centers are inside
+ * the rectangle of the line widened by half a pixel, and the coverage of four
+ * pixels of the span is computed at a time
+ */
+void Framebuffer_thickLine(Framebuffer* fb, double x1, double y1, double x2,
+                           double y2, double width, int cap, uint32_t pixel) {
+  double dx = x2 - x1, dy = y2 - y1;
+  double length = sqrt(dx * dx + dy * dy);
+  // Lines without length are just the dots of their caps
+  if (length < 1e-6) {
+    if (cap == FRAMEBUFFER_CAP_BUTT) return;
+    dx = 1;
+    dy = 0;
+    length = 0;
+  } else {
+    dx /= length;
+    dy /= length;
+  }
+  double radius = width / 2;
+  double extension = cap == FRAMEBUFFER_CAP_BUTT ? 0 : radius;
+
+  // The covered pixel centers are at most this far across the line and
+  // along it, measured from the start point
+  double across = radius + 0.5;
+  double before = -(extension + 0.5), after = length + extension + 0.5;
+  double reach = fabs(dx) * across;
+  double top = y1 + (dy > 0 ? dy * before : dy * after) - reach;
+  double bottom = y1 + (dy > 0 ? dy * after : dy * before) + reach;
+  if (top < 0) top = 0;
+  if (bottom > fb->height - 1) bottom = fb->height - 1;
+  if (top > bottom) return;
+  int firstRow = (int)top;
+  if (firstRow < top) firstRow++;
+  int lastRow = (int)bottom;
+  double inverseX = dx != 0 ? 1 / dx : 0, inverseY = dy != 0 ? 1 / dy : 0;
+
+  SimdF32 zero = SimdF32_splat(0), one = SimdF32_splat(1);
+  SimdF32 directionX = SimdF32_splat(dx), directionY = SimdF32_splat(dy);
+  SimdF32 segment = SimdF32_splat(length);
+  SimdF32 inside = SimdF32_splat(across);
+  SimdF32 ends = SimdF32_splat(extension + 0.5);
+  SimdF32 lanes = SimdF32_set(0, 1, 2, 3);
+  bool round = cap == FRAMEBUFFER_CAP_ROUND;
+  float coverage[4];
+
+  for (int y = firstRow; y <= lastRow; y++) {
+    // The span is where the row is inside both pairs of sides
+    double py = y - y1;
+    double left = -x1, right = fb->width - 1 - x1;
+    if (dy != 0) {
+      double a = (py * dx - across) * inverseY;
+      double b = (py * dx + across) * inverseY;
+      if (a > b) Framebuffer_swap(&a, &b);
+      if (a > left) left = a;
+      if (b < right) right = b;
+    } else if (fabs(py) > across) {
+      continue;
+    }
+    if (dx != 0) {
+      double a = (before - py * dy) * inverseX;
+      double b = (after - py * dy) * inverseX;
+      if (a > b) Framebuffer_swap(&a, &b);
+      if (a > left) left = a;
+      if (b < right) right = b;
+    }
+    if (left > right) continue;
+    left += x1;
+    right += x1;
+    int begin = (int)left;
+    if (begin < left) begin++;
+    int end = (int)right;
+
+    uint32_t* row = &(fb->pixels[(size_t)y * fb->width]);
+    SimdF32 rowY = SimdF32_splat(py);
+    for (int x = begin; x <= end; x += 4) {
+      SimdF32 px = SimdF32_add(SimdF32_splat(x - x1), lanes);
+      // Distances along the line from the start point and across it
+      SimdF32 s = SimdF32_madd(px, directionX, SimdF32_mul(rowY, directionY));
+      SimdF32 t = SimdF32_sub(SimdF32_mul(rowY, directionX),
+                              SimdF32_mul(px, directionY));
+      SimdF32 c;
+      if (round) {
+        SimdF32 past =
+            SimdF32_sub(s, SimdF32_min(SimdF32_max(s, zero), segment));
+        SimdF32 distance =
+            SimdF32_sqrt(SimdF32_madd(past, past, SimdF32_mul(t, t)));
+        c = SimdF32_sub(inside, distance);
+      } else {
+        SimdF32 sideways =
+            SimdF32_sub(inside, SimdF32_max(t, SimdF32_sub(zero, t)));
+        SimdF32 lengthwise =
+            SimdF32_add(SimdF32_min(s, SimdF32_sub(segment, s)), ends);
+        c = SimdF32_mul(SimdF32_min(SimdF32_max(sideways, zero), one),
+                        SimdF32_min(SimdF32_max(lengthwise, zero), one));
+      }
+      // The lanes past the end of the span are left as they are
+      c = SimdF32_min(SimdF32_max(c, zero), one);
+      c = SimdF32_select(SimdF32_lessMask(lanes, SimdF32_splat(end - x + 1)),
+                         c, zero);
+      if (x + 4 <= fb->width) {
+        SimdF32_blendPixels(&(row[x]), pixel, c);
+      } else {
+        SimdF32_store(coverage, c);
+        for (int k = 0; x + k <= end; k++)
+          row[x + k] = Framebuffer_blend(
+              row[x + k], pixel, (uint32_t)(coverage[k] * 256 + 0.5f));
+      }
+    }
+  }
+}
+
+/**
+ * Exchanges the two values
+ */
+void Framebuffer_swap(double* a, double* b) {
+  double c = *a;
+  *a = *b;
+  *b = c;
+}
+
+/**
+ * Clips the line segment to the area of the framebuffer with the
+ * Cohen-Sutherland algorithm
+ * Returns 0 if no part of the line is inside
+ */
+int Framebuffer_clipLine(Framebuffer* fb, double* x1, double* y1, double* x2,
+                         double* y2) {
+  double maxX = fb->width - 1, maxY = fb->height - 1;
+  for (;;) {
+    int code1 = (*x1 < 0) | (*x1 > maxX) << 1 | (*y1 < 0) << 2 |
+                (*y1 > maxY) << 3;
+    int code2 = (*x2 < 0) | (*x2 > maxX) << 1 | (*y2 < 0) << 2 |
+                (*y2 > maxY) << 3;
+    if ((code1 | code2) == 0) return 1;
+    if (code1 & code2) return 0;
+
+    // Move the endpoint that is outside onto the border it crosses
+    int code = code1 ? code1 : code2;
+    double x, y;
+    if (code & 1) {
+      y = *y1 + (*y2 - *y1) * (0 - *x1) / (*x2 - *x1);
+      x = 0;
+    } else if (code & 2) {
+      y = *y1 + (*y2 - *y1) * (maxX - *x1) / (*x2 - *x1);
+      x = maxX;
+    } else if (code & 4) {
+      x = *x1 + (*x2 - *x1) * (0 - *y1) / (*y2 - *y1);
+      y = 0;
+    } else {
+      x = *x1 + (*x2 - *x1) * (maxY - *y1) / (*y2 - *y1);
+      y = maxY;
+    }
+    if (code == code1) {
+      *x1 = x;
+      *y1 = y;
+    } else {
+      *x2 = x;
+      *y2 = y;
+    }
+  }
+}
+
+/**
+ * Draws a line with thickness of 1 using Bresenham's algorithm
+ * The line is clipped first, so the endpoints can be outside the framebuffer
+ */
+void Framebuffer_line(Framebuffer* fb, int x1, int y1, int x2, int y2,
+                      uint32_t pixel) {
+  double cx1 = x1, cy1 = y1, cx2 = x2, cy2 = y2;
+  if (!Framebuffer_clipLine(fb, &cx1, &cy1, &cx2, &cy2)) return;
+  x1 = (int)(cx1 + 0.5);
+  y1 = (int)(cy1 + 0.5);
+  x2 = (int)(cx2 + 0.5);
+  y2 = (int)(cy2 + 0.5);
+
+  int dx = abs(x2 - x1), dy = -abs(y2 - y1);
+  int stepX = x1 < x2 ? 1 : -1, stepY = y1 < y2 ? fb->width : -fb->width;
+  int yDir = y1 < y2 ? 1 : -1;
+  int error = dx + dy;
+  uint32_t* p = &(fb->pixels[(size_t)y1 * fb->width + x1]);
+  for (;;) {
+    *p = pixel;
+    if (x1 == x2 && y1 == y2) break;
+    int e2 = 2 * error;
+    if (e2 >= dy) {
+      error += dy;
+      x1 += stepX;
+      p += stepX;
+    }
+    if (e2 <= dx) {
+      error += dx;
+      y1 += yDir;
+      p += stepY;
+    }
+  }
+}
+
+/**
+ * Saves the framebuffer as a binary .ppm image, the alpha channel is dropped
+ * Returns false if the file could not be written
+ */
+bool Framebuffer_savePPM(Framebuffer* fb, const char* fileName) {
+  FILE* file = fopen(fileName, "wb");
+  if (file == NULL) return false;
+  fprintf(file, "P6\n%d %d\n255\n", fb->width, fb->height);
+  uint8_t* row = (uint8_t*)malloc((size_t)fb->width * 3);
+  bool written = true;
+  for (int y = 0; y < fb->height && written; y++) {
+    uint8_t* pixels = (uint8_t*)&(fb->pixels[(size_t)y * fb->width]);
+    for (int x = 0; x < fb->width; x++)
+      memcpy(&row[x * 3], &pixels[x * 4], 3);
+    written = fwrite(row, 3, fb->width, file) == (size_t)fb->width;
+  }
+  free(row);
+  return fclose(file) == 0 && written;
+}
\ No newline at end of file
@@ -0,0 +1,333 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <instances.h>
+
+/**
+ * Creates an empty set without meshes and instances
+ */
+InstanceSet* InstanceSet_create() {
+  InstanceSet* set = (InstanceSet*)malloc(sizeof(InstanceSet));
+  set->meshes = NULL;
+  set->meshCount = 0;
+  set->instances = NULL;
+  set->instanceCount = 0;
+  set->allocatedInstances = 0;
+  set->visible = NULL;
+  set->visibleCount = 0;
+  return set;
+}
+
+/**
+ * Loads the meshes and places the instances listed in the given instance file
+ * Returns NULL if the file could not be opened or one of its meshes could not
+ * be loaded, so no instance is left without geometry
+ */
+InstanceSet* InstanceSet_load(const char* fileName) {
+  FILE* file = fopen(fileName, "r");
+  if (file == NULL) return NULL;
+
+  // Mesh paths are relative to the directory of the instance file
+  const char* slash = strrchr(fileName, '/');
+  const char* backslash = strrchr(fileName, '\\');
+  if (backslash > slash) slash = backslash;
+  size_t dirLength = slash == NULL ? 0 : slash - fileName + 1;
+  char* dir = (char*)malloc(dirLength + 1);
+  memcpy(dir, fileName, dirLength);
+  dir[dirLength] = '\0';
+
+  InstanceSet* set = InstanceSet_create();
+  char line[1024];
+  bool loaded = true;
+  while (loaded && fgets(line, sizeof(line), file) != NULL)
+    loaded = InstanceSet_parseLine(set, line, dir);
+
+  free(dir);
+  fclose(file);
+  if (!loaded) {
+    InstanceSet_free(set);
+    return NULL;
+  }
+  return set;
+}
+
+/**
+ * Frees the projections of the instances and the geometry of the meshes
+ */
+void InstanceSet_free(InstanceSet* set) {
+  if (set == NULL) return;
+  for (long int i = 0; i < set->instanceCount; i++)
+    InstanceSet_release(&set->instances[i]);
+  for (long int i = 0; i < set->meshCount; i++)
+    Scene_free(&set->meshes[i].scene);
+  free(set->meshes);
+  free(set->instances);
+  free(set->visible);
+  free(set);
+}
+
+/**
+ * Loads a mesh from an .obj, .ply or .stl file and computes its bounding
+ * sphere
+ * Returns the index of the mesh for placing its instances, -1 if the file
+ * could not be loaded
+ */
+long int InstanceSet_addMesh(InstanceSet* set, const char* fileName) {
+  set->meshes =
+      (Mesh*)realloc(set->meshes, (set->meshCount + 1) * sizeof(Mesh));
+  Mesh* mesh = &set->meshes[set->meshCount];
+  Scene* scene = &mesh->scene;
+  Scene_init(scene, NULL);
+  if (!MeshFile_load(scene, fileName)) {
+    fprintf(stderr, "Could not load the mesh %s\n", fileName);
+    Scene_free(scene);
+    return -1;
+  }
+
+  // The sphere is centered on the bounding box of the vertices
+  Vec3 min = Vec3_new(0, 0, 0), max = Vec3_new(0, 0, 0);
+  for (long int i = 0; i < scene->verticesCount; i++) {
+    Vec3* v = &scene->vertices[i];
+    if (i == 0) min = max = *v;
+    min = Vec3_new(fmin(min.x, v->x), fmin(min.y, v->y), fmin(min.z, v->z));
+    max = Vec3_new(fmax(max.x, v->x), fmax(max.y, v->y), fmax(max.z, v->z));
+  }
+  mesh->center =
+      Vec3_new((min.x + max.x) / 2, (min.y + max.y) / 2, (min.z + max.z) / 2);
+  double radius = 0;
+  for (long int i = 0; i < scene->verticesCount; i++) {
+    Vec3 d = Vec3_copy(&scene->vertices[i]);
+    Vec3_sub(&d, &mesh->center);
+    radius = fmax(radius, Vec3_sqLength(&d));
+  }
+  mesh->radius = sqrt(radius);
+
+  return set->meshCount++;
+}
+
+/**
+ * Places an instance of the given mesh into the world with the transform
+ * Returns false if there is no such mesh
+ */
+bool InstanceSet_addInstance(InstanceSet* set, long int mesh,
+                             Transform* transform) {
+  if (mesh < 0 || mesh >= set->meshCount) return false;
+  if (set->instanceCount == set->allocatedInstances) {
+    long int allocate = set->allocatedInstances * 2;
+    if (allocate < 16) allocate = 16;
+    set->instances =
+        (Instance*)realloc(set->instances, allocate * sizeof(Instance));
+    set->visible = (long int*)realloc(set->visible, allocate * sizeof(long));
+    set->allocatedInstances = allocate;
+  }
+  Instance* instance = &set->instances[set->instanceCount++];
+  Mesh* source = &set->meshes[mesh];
+  Scene* scene = &instance->scene;
+  Scene_init(scene, NULL);
+  scene->vertices = source->scene.vertices;
+  scene->verticesCount = source->scene.verticesCount;
+  scene->edges = source->scene.edges;
+  scene->edgeCount = source->scene.edgeCount;
+  scene->objects = source->scene.objects;
+  scene->objectCount = source->scene.objectCount;
+  scene->edgeFaces = source->scene.edgeFaces;
+  scene->dihedral = source->scene.dihedral;
+  scene->faces = source->scene.faces;
+  scene->faceCount = source->scene.faceCount;
+  scene->model = *transform;
+  instance->mesh = mesh;
+  instance->visible = false;
+  instance->projected = false;
+
+  instance->center = Transform_apply(transform, &source->center);
+  instance->radius = source->radius * Transform_scale(transform);
+  return true;
+}
+
+/**
+ * Returns the distance to the origo from the furthest point of the scene
+ * (estimated from the bounding spheres of the instances)
+ */
+double InstanceSet_radius(InstanceSet* set) {
+  double max = 0;
+  for (long int i = 0; i < set->instanceCount; i++) {
+    Instance* instance = &set->instances[i];
+    max = fmax(max, Vec3_length(&instance->center) + instance->radius);
+  }
+  return max;
+}
+
+/**
+ * Returns the number of edges of all the instances together
+ */
+long int InstanceSet_edgeCount(InstanceSet* set) {
+  long int count = 0;
+  for (long int i = 0; i < set->instanceCount; i++)
+    count += set->instances[i].scene.edgeCount;
+  return count;
+}
+
+/**
+ * Collects the instances whose bounding sphere intersects the frustum of the
+ * camera, the projection of the instances that left it is freed
+ * Returns true if the set of visible instances changed
+ */
+bool InstanceSet_update(InstanceSet* set, Camera* cam) {
+  bool changed = false;
+  set->visibleCount = 0;
+  for (long int i = 0; i < set->instanceCount; i++) {
+    Instance* instance = &set->instances[i];
+    bool visible =
+        Camera_sphereVisible(cam, &instance->center, instance->radius);
+    changed |= visible != instance->visible;
+    if (instance->visible && !visible) InstanceSet_release(instance);
+    instance->visible = visible;
+    if (visible) set->visible[set->visibleCount++] = i;
+  }
+  return changed;
+}
+
+/**
+ * Projects the visible instances with the camera and settings of the view
+ * scene and collects their edges to be drawn, the instances are distributed
+ * over the worker pool of the view
+ * Returns true if any of them was projected again
+ */
+bool InstanceSet_project(InstanceSet* set, Scene* view) {
+  for (long int k = 0; k < set->visibleCount; k++) {
+    Instance* instance = &set->instances[set->visible[k]];
+    Scene* scene = &instance->scene;
+    Scene_copySettings(scene, view);
+    // The local vertices are converted once for the mesh and shared as well,
+    // before the jobs start
+    if (scene->singlePrecision) {
+      Scene* mesh = &set->meshes[instance->mesh].scene;
+      Scene_updateLocal(mesh);
+      scene->origin = mesh->origin;
+      scene->localX = mesh->localX;
+      scene->localY = mesh->localY;
+      scene->localZ = mesh->localZ;
+      scene->localCount = mesh->localCount;
+    }
+  }
+  if (view->workers != NULL && set->visibleCount > 1) {
+    WorkerPool_run(view->workers, InstanceSet_projectInstance, set,
+                   set->visibleCount);
+  } else {
+    for (long int k = 0; k < set->visibleCount; k++)
+      InstanceSet_projectInstance(set, k);
+  }
+
+  bool changed = false;
+  for (long int k = 0; k < set->visibleCount; k++)
+    changed |= set->instances[set->visible[k]].projected;
+  return changed;
+}
+
+/**
+ * Job of the worker pool projecting the index-th visible instance
+ * The per-edge arrays are allocated when the instance is first projected
+ */
+void InstanceSet_projectInstance(void* _set, int index) {
+  InstanceSet* set = (InstanceSet*)_set;
+  Instance* instance = &set->instances[set->visible[index]];
+  Scene* scene = &instance->scene;
+  if (scene->visibleEdges == NULL && scene->edgeCount > 0) {
+    scene->visibleEdges = (Edge*)malloc(scene->edgeCount * sizeof(Edge));
+    scene->pixels = (long int*)malloc(scene->edgeCount * sizeof(long int));
+  }
+  instance->projected = Scene_projectPoints(scene);
+  if (instance->projected) Scene_compactEdges(scene);
+}
+
+/**
+ * Frees the projection of an instance, the shared geometry, objects and
+ * faces are kept
+ */
+void InstanceSet_release(Instance* instance) {
+  Scene* scene = &instance->scene;
+  free(scene->projectedPoints);
+  free(scene->visibility);
+  free(scene->visibleEdges);
+  free(scene->pixels);
+  free(scene->pixelMask);
+  free(scene->visibleObjects);
+  free(scene->ranges);
+  free(scene->facing);
+  scene->projectedPoints = NULL;
+  scene->visibility = NULL;
+  scene->visibleEdges = NULL;
+  scene->pixels = NULL;
+  scene->pixelMask = NULL;
+  scene->visibleObjects = NULL;
+  scene->ranges = NULL;
+  scene->facing = NULL;
+  scene->allocatedProjection = 0;
+  scene->allocatedFacing = 0;
+  scene->visibleObjectCount = 0;
+  scene->allocatedVisibleObjects = 0;
+  scene->rangeCount = 0;
+  scene->allocatedRanges = 0;
+  scene->visibleEdgeCount = 0;
+  scene->pixelCount = 0;
+  scene->droppedEdgeCount = 0;
+  scene->culledEdgeCount = 0;
+  scene->pixelMaskSize = 0;
+  // Make sure it is projected again when it comes back into view
+  Scene_markChanged(scene);
+}
+
+/**
+ * Processes one line of an instance file
+ * Instances with a number of values other than 3 or 12 are skipped
+ * Returns false if the mesh of the line could not be loaded
+ */
+bool InstanceSet_parseLine(InstanceSet* set, char* line, const char* dir) {
+  // Cut the line break and the trailing spaces
+  size_t length = strlen(line);
+  while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' ||
+                        line[length - 1] == ' ' || line[length - 1] == '\t'))
+    line[--length] = '\0';
+
+  if (strncmp(line, "mesh ", 5) == 0) {
+    char* name = &(line[5]);
+    while (*name == ' ') name++;
+    if (*name == '\0') return true;
+    bool absolute = name[0] == '/' || name[0] == '\\' ||
+                    (name[0] != '\0' && name[1] == ':');
+    char* path = (char*)malloc(strlen(dir) + strlen(name) + 1);
+    strcpy(path, absolute ? "" : dir);
+    strcat(path, name);
+    long int mesh = InstanceSet_addMesh(set, path);
+    free(path);
+    return mesh >= 0;
+  } else if (strncmp(line, "instance ", 9) == 0) {
+    char *current = &(line[9]), *next;
+    long int mesh = strtol(current, &next, 10);
+    if (next == current) return true;
+    double values[12];
+    int count = 0;
+    for (; count < 12; count++) {
+      current = next;
+      values[count] = strtod(current, &next);
+      if (next == current) break;
+    }
+
+    Transform transform = Transform_identity();
+    if (count == 3) {
+      for (int i = 0; i < 3; i++) transform.m[i][3] = values[i];
+    } else if (count == 12) {
+      for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 4; j++) transform.m[i][j] = values[i * 4 + j];
+    } else {
+      return true;
+    }
+    InstanceSet_addInstance(set, mesh, &transform);
+  }
+  return true;
+}
\ No newline at end of file
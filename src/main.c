@@ -10,14 +10,37 @@
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
+#include <bench.h>
 #include <camera.h>
+#include <capture.h>
 #include <ccanvas.h>
+#include <chunkstore.h>
+#include <instances.h>
+#include <meshfile.h>
+#include <objparser.h>
 #include <point.h>
 #include <scene.h>
+#include <server.h>
+#include <splat.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <vec3.h>
+#include <workers.h>
+
+// The lines and pixels of a frame, copied from the scenes in the update when
+// the frames are pipelined, so the draw stage does not read the scenes while
+// the next updates change them
+typedef struct {
+  Point *lines;  // The two end points of every line
+  long int lineCount, allocatedLines;
+  long int *pixels;
+  long int pixelCount, allocatedPixels;
+  long int width;    // Width of the frame, the pixels are indices into it
+  double lineWidth;  // Line width of the app when the frame was updated
+  bool recorded;     // False if the frame is drawn from the scenes
+} DrawList;
 
 // A struct to hold all the data needed for the program
 typedef struct SoftwareRenderer {
@@ -30,6 +53,32 @@ typedef struct SoftwareRenderer {
                        // default camera distance is calculated from it
   Uint32 lastInput;    // Time of the last mouse or keyboard input
   Uint32 currentTick;  // Time at the start of the current loop cycle
+  Uint32 statsTick;    // Time when the statistics were last shown
+  int statsFrames;     // Frames rendered since the statistics were last shown
+  const char *inputName;  // File loaded at startup, "-" is the standard input
+  ObjParser *parser;  // Parser of the file being loaded, NULL otherwise
+  int inputFd;        // Descriptor the parser reads from, -1 if the data is
+                      // pushed to the parser instead (streams in the browser)
+  double parseBudget;       // Time in ms spent on loading in every frame
+  double weldEpsilon;  // Loaded vertices closer than this are merged, the
+                       // loaded scene is not welded if negative
+  long int radiusVertices;  // Number of vertices the radius was computed from
+  ChunkStore *chunks;  // Chunks of an out-of-core scene, NULL if the scene is
+                       // loaded into memory
+  size_t chunkBudget;  // Memory budget for the resident chunks in bytes
+  InstanceSet *instances;  // Instances of shared meshes, NULL if the scene
+                           // is a single .obj file
+  Splat splat;         // Draws scenes without edges as point clouds
+  double lineWidth;    // 0 for plain lines, 1 for anti-aliased lines, wider
+                       // lines are anti-aliased with round caps
+  Capture *capture;         // Records the frames, NULL if not recording
+  const char *capturePath;  // File the frames are recorded into
+  int capturePolicy;        // What happens when the writer falls behind
+  int captureCount;         // Number of recordings started
+  DrawList drawLists[CCANVAS_FRAME_SLOTS];  // One for every frame in flight
+  int framesInFlight;  // 1 for the lowest latency, more for throughput
+  long int statsInFlight;  // Sum of the frames in flight since the
+                           // statistics were last shown
 } SoftwareRenderer;
 
 void init(CCanvas *cnv);
@@ -38,18 +87,130 @@ void draw(CCanvas *cnv);
 void onMouseButtonDown(CCanvas *cnv, Uint8 button, Sint32 x, Sint32 y);
 void onMouseMove(CCanvas *cnv, Sint32 dx, Sint32 dy);
 void onFileDrop(CCanvas *cnv, char *fileName);
+void onFileStream(CCanvas *cnv, int stage, char *data, size_t length);
+void loadFile(SoftwareRenderer *app, const char *fileName);
+void beginLoading(SoftwareRenderer *app, int fd);
+void continueLoading(SoftwareRenderer *app);
+void finishLoading(SoftwareRenderer *app);
+void updateLoadedRadius(SoftwareRenderer *app);
+void weldScene(SoftwareRenderer *app);
+void openChunkStore(SoftwareRenderer *app, const char *fileName);
+void openInstances(SoftwareRenderer *app, const char *fileName);
+void openMeshFile(SoftwareRenderer *app, const char *fileName);
+void closeScene(SoftwareRenderer *app);
+void drawScene(CCanvas *cnv, Scene *scene, Framebuffer *layer);
+void recordFrame(CCanvas *cnv, DrawList *list);
+void recordScene(DrawList *list, Scene *scene);
+void drawList(CCanvas *cnv, DrawList *list, Framebuffer *layer);
 void onKeyDown(CCanvas *cnv, SDL_Keycode code);
 void onKeyUp(CCanvas *cnv, SDL_Keycode code);
 void onResize(CCanvas *cnv, Sint32 newWidth, Sint32 newHeight);
 void calculateSceneRadius(SoftwareRenderer *app);
 void calculateCameraPosAndSpeed(SoftwareRenderer *app);
+void showStats(CCanvas *cnv);
+void toggleCapture(CCanvas *cnv);
 
 // The main function just starts the app
+// The scene to open can be given as an argument, "-" reads it from the
+// standard input (for example piped from another program)
+// gzip (and with CCANVAS_ZSTD zstd) compressed scenes are decompressed while
+// they load
+// Scenes too large for the memory can be preprocessed for out-of-core
+// rendering with: --chunk scene.obj scene.chunks
+// When opening a .chunks file the memory budget in MB can follow the name
+// An .instances file places copies of shared meshes into the world
+// The rendering can be benchmarked without a window with:
+// --bench [scene.obj] [frames]
+// The load times of scene files (for example compressed copies of the same
+// scene) are compared with a cold and a warm page cache with:
+// --loadbench scene.obj [scene.obj.gz ...]
+// Many views of the scene are rendered at once into .ppm files with:
+// --views [scene.obj] [count] [prefix]
+// Scenes are kept loaded and rendered for other programs on a Unix socket:
+// --serve socket scene.obj [more.obj ...]
+// and the server is measured with a load generator:
+// --load socket [requests] [connections] [depth] [raw|png] [size]
+// The frames are recorded from the start (or when pressing R) with:
+// --capture out.y4m [drop|block] [scene.obj] ...
+// where .rgba files get raw frames and other names a sequence of PNG files
+// Vertices repeated at the same position (or closer than epsilon) are merged
+// after loading, in the app and the benchmark, when the arguments start with:
+// --weld [epsilon] ...
 int main(int argc, char *argv[]) {
+  double weldEpsilon = -1;
+  if (argc > 1 && strcmp(argv[1], "--weld") == 0) {
+    char *end = NULL;
+    weldEpsilon = argc > 2 ? strtod(argv[2], &end) : 0;
+    bool given = end != NULL && end != argv[2] && *end == '\0';
+    if (!given || weldEpsilon < 0) weldEpsilon = 0;
+    argc -= given ? 2 : 1;
+    argv += given ? 2 : 1;
+  }
+  if (argc > 3 && strcmp(argv[1], "--chunk") == 0)
+    return ChunkStore_build(argv[2], argv[3], CHUNKSTORE_CHUNK_EDGES) ? 0 : 1;
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+    return Bench_run(argc > 2 ? argv[2] : "base_scene.obj",
+                     argc > 3 ? atoi(argv[3]) : 1000, weldEpsilon)
+               ? 0
+               : 1;
+  if (argc > 2 && strcmp(argv[1], "--loadbench") == 0)
+    return Bench_load(&argv[2], argc - 2) ? 0 : 1;
+  if (argc > 1 && strcmp(argv[1], "--views") == 0)
+    return Bench_views(argc > 2 ? argv[2] : "base_scene.obj",
+                       argc > 3 ? atoi(argv[3]) : 36, argc > 4 ? argv[4] : NULL)
+               ? 0
+               : 1;
+  if (argc > 3 && strcmp(argv[1], "--serve") == 0)
+    return Server_run(argv[2], &argv[3], argc - 3) ? 0 : 1;
+  if (argc > 2 && strcmp(argv[1], "--load") == 0)
+    return Server_generateLoad(
+               argv[2], argc > 3 ? atol(argv[3]) : 1000,
+               argc > 4 ? atoi(argv[4]) : 4, argc > 5 ? atoi(argv[5]) : 8,
+               argc > 6 && strcmp(argv[6], "raw") == 0 ? SERVER_FORMAT_RAW
+                                                       : SERVER_FORMAT_PNG,
+               argc > 7 ? atoi(argv[7]) : 256)
+               ? 0
+               : 1;
+
   SoftwareRenderer app;
+  app.weldEpsilon = weldEpsilon;
+  app.capture = NULL;
+  app.capturePath = NULL;
+  app.capturePolicy = CAPTURE_DROP;
+  app.captureCount = 0;
+  if (argc > 2 && strcmp(argv[1], "--capture") == 0) {
+    app.capturePath = argv[2];
+    int skip = 2;
+    if (argc > 3 && (strcmp(argv[3], "drop") == 0 ||
+                     strcmp(argv[3], "block") == 0)) {
+      app.capturePolicy =
+          strcmp(argv[3], "block") == 0 ? CAPTURE_BLOCK : CAPTURE_DROP;
+      skip = 3;
+    }
+    argc -= skip;
+    argv += skip;
+  }
+  app.inputName = argc > 1 ? argv[1] : "base_scene.obj";
+  app.chunkBudget = (size_t)(argc > 2 ? atof(argv[2]) : 512) * 1024 * 1024;
+  app.chunks = NULL;
+  app.instances = NULL;
+  app.lineWidth = 0;
+  app.framesInFlight = CCANVAS_FRAME_SLOTS;
+  memset(app.drawLists, 0, sizeof(app.drawLists));
+  Splat_init(&app.splat);
+  // Use every core for projecting the vertices
+  app.scene.workers = WorkerPool_create(WorkerPool_defaultSize());
   CCanvas_create(init, update, draw, 512, 512, &app);
-  // Free up geometry memory after the quit signal
-  Scene_free(&(app.scene));
+  // Finish writing the recording and free up geometry memory after the quit
+  // signal
+  Capture_stop(app.capture);
+  for (int i = 0; i < CCANVAS_FRAME_SLOTS; i++) {
+    free(app.drawLists[i].lines);
+    free(app.drawLists[i].pixels);
+  }
+  closeScene(&app);
+  Splat_free(&app.splat);
+  WorkerPool_destroy(app.scene.workers);
   return 0;
 }
 
@@ -65,6 +226,12 @@ void init(CCanvas *cnv) {
   // Set initial tick counts
   app->currentTick = SDL_GetTicks();
   app->lastInput = 0;
+  app->statsTick = app->currentTick;
+  app->statsFrames = 0;
+  app->statsInFlight = 0;
+  app->parser = NULL;
+  app->inputFd = -1;
+  app->parseBudget = 8;
 
   // Set brush colors
   CCanvas_setBgColor(cnv, rgb(0, 0, 0));
@@ -75,16 +242,21 @@ void init(CCanvas *cnv) {
   app->moveForce = 1;
   app->movingBackward = app->movingDown = app->movingForward = app->movingLeft =
       app->movingRight = app->movingUp = false;
-  Scene_erase(scene);
+  // The worker pool is created by main before the setup
+  Scene_init(scene, scene->workers);
   Scene_setCamera(scene,
                   Camera_new(Vec3_new(0, 0, 0), Vec3_new(0, 1, 0), cnv->width,
                              cnv->height, 3.14 / 3,
                              3.14 / 3));  // Put camera in some default position
 
-  // Then load the base scene
-  Scene_loadObj(&(app->scene), "base_scene.obj");
-  calculateSceneRadius(app);
-  calculateCameraPosAndSpeed(app);
+  // Then start loading the base scene, it shows up while it is being parsed
+  // In the browser it is fetched after startup and streamed in
+  app->sceneRadius = 0;
+#ifdef __EMSCRIPTEN__
+  CCanvas_fetchFile(app->inputName);
+#else
+  loadFile(app, app->inputName);
+#endif
 
   // Set watchers/event listeners
   CCanvas_watchKeyDown(cnv, onKeyDown);
@@ -92,7 +264,13 @@ void init(CCanvas *cnv) {
   CCanvas_watchMouseButtonDown(cnv, onMouseButtonDown);
   CCanvas_watchMouseMove(cnv, onMouseMove);
   CCanvas_watchFileDrop(cnv, onFileDrop);
+  CCanvas_watchFileStream(cnv, onFileStream);
   CCanvas_watchResize(cnv, onResize);
+
+  // Lower the resolution when drawing would not fit into a 60 fps frame
+  CCanvas_setFrameBudget(cnv, 1000.0 / 60.0, 0.25);
+
+  if (app->capturePath != NULL) toggleCapture(cnv);
 }
 
 /**
@@ -106,6 +284,19 @@ void update(double dt, CCanvas *cnv) {
   // Save time of current cycle
   app->currentTick = SDL_GetTicks();
 
+  // Parse the next part of the file being loaded
+  continueLoading(app);
+
+  // Parsing can take most of the frame, so the mouse is sampled again after
+  // it, right before the camera is moved and the points are projected
+  CCanvas_sampleInput(cnv);
+
+  // Point clouds are projected while they are drawn, so their frames can not
+  // overlap the next update
+  bool pointCloud = app->instances == NULL && app->chunks == NULL &&
+                    scene->edgeCount == 0;
+  CCanvas_setFramesInFlight(cnv, pointCloud ? 1 : app->framesInFlight);
+
   // Calculate forces accelerating the camera based on the moving direction
   Vec3 force = Vec3_new(0, 0, 0), temp;
   temp = Camera_directionForwardHorizontal(&scene->cam);
@@ -125,7 +316,11 @@ void update(double dt, CCanvas *cnv) {
   Vec3_add(&app->vel, &force);
 
   // Apply "air friction" to the camera for natural feeling movement
+  // Stop the camera completely when it gets very slow, otherwise it would keep
+  // creeping and every frame would have to be redrawn
   Vec3_mult(&app->vel, pow(0.00001, dt / 1000));
+  if (Vec3_length(&app->vel) < app->sceneRadius * 0.0001)
+    app->vel = Vec3_new(0, 0, 0);
 
   // Change the camera position based on its current velocity
   Vec3 displacement = Vec3_copy(&app->vel);
@@ -138,8 +333,35 @@ void update(double dt, CCanvas *cnv) {
     calculateCameraPosAndSpeed(app);
   }
 
-  // Project points into screen space
-  Scene_projectPoints(scene);
+  // Project points into screen space then collect the edges to be drawn
+  // If neither the camera nor the scene changed, the last frame is kept
+  // Out-of-core scenes first select the chunks in view, prefetching the ones
+  // that come into view in the next second at the current velocity
+  // Instanced scenes only project the instances in view
+  if (app->chunks != NULL) {
+    bool changed = ChunkStore_update(app->chunks, &scene->cam, &app->vel, 1);
+    if (ChunkStore_project(app->chunks, scene) || changed)
+      CCanvas_invalidate(cnv);
+  } else if (app->instances != NULL) {
+    bool changed = InstanceSet_update(app->instances, &scene->cam);
+    if (InstanceSet_project(app->instances, scene) || changed)
+      CCanvas_invalidate(cnv);
+  } else if (scene->edgeCount == 0) {
+    // Scenes without edges are drawn as point clouds, the points are
+    // projected while they are drawn
+    if (Scene_changed(scene)) CCanvas_invalidate(cnv);
+  } else if (Scene_projectPoints(scene)) {
+    Scene_compactEdges(scene);
+    CCanvas_invalidate(cnv);
+  }
+
+  // The slot of the frame is not in flight, its list can be overwritten
+  DrawList *list = &app->drawLists[cnv->updateSlot];
+  list->recorded = false;
+  if (cnv->redraw) {
+    if (CCanvas_pipelined(cnv)) recordFrame(cnv, list);
+    showStats(cnv);
+  }
 }
 
 /**
@@ -147,24 +369,160 @@ void update(double dt, CCanvas *cnv) {
  */
 void draw(CCanvas *cnv) {
   SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
-  Scene *scene = &app->scene;
 
   // Clear canvas before drawing
   CCanvas_clear(cnv);
 
-  // Loop through all the geometry
-  for (long int i = 0; i < scene->edgeCount; i++) {
-    Edge e = scene->edges[i];
-    if (scene->projectedPoints[e.a].x != NAN &&
-        scene->projectedPoints[e.b].x != NAN &&
-        scene->projectedPoints[e.a].y != NAN &&
-        scene->projectedPoints[e.b].y != NAN) {
-      // Use precise lines for drawing because it looks better than with thick
-      // lines
-      CCanvas_preciseLine(
-          cnv, scene->projectedPoints[e.a].x, scene->projectedPoints[e.a].y,
-          scene->projectedPoints[e.b].x, scene->projectedPoints[e.b].y);
-    }
+  // Pipelined frames only read their own list, the rest of the app is
+  // already working on the next frame
+  DrawList *list = &app->drawLists[cnv->drawSlot];
+  if (list->recorded) {
+    Framebuffer *layer =
+        list->lineWidth > 0 ? CCanvas_beginLayer(cnv) : NULL;
+    drawList(cnv, list, layer);
+    if (layer != NULL) CCanvas_endLayer(cnv);
+    return;
+  }
+
+  // Point clouds and anti-aliased lines are drawn on the CPU into a layer
+  // (the frame itself with the framebuffer backend)
+  ChunkStore *chunks = app->chunks;
+  InstanceSet *instances = app->instances;
+  bool pointCloud =
+      instances == NULL && chunks == NULL && app->scene.edgeCount == 0;
+  Framebuffer *layer = NULL;
+  if (pointCloud || app->lineWidth > 0) layer = CCanvas_beginLayer(cnv);
+
+  if (instances != NULL) {
+    for (long int i = 0; i < instances->visibleCount; i++)
+      drawScene(cnv, &instances->instances[instances->visible[i]].scene,
+                layer);
+  } else if (pointCloud) {
+    // Points are shaded by their distance up to the far side of the scene
+    Scene *scene = &app->scene;
+    app->splat.fogDistance =
+        Vec3_length(&(scene->cam.pos)) + app->sceneRadius;
+    Splat_draw(&app->splat, scene, layer, CCanvas_brushPixel(cnv));
+  } else if (chunks == NULL) {
+    drawScene(cnv, &app->scene, layer);
+  } else {
+    for (long int i = 0; i < chunks->visibleCount; i++)
+      drawScene(cnv, &chunks->chunks[chunks->visible[i]].scene, layer);
+  }
+  if (layer != NULL) CCanvas_endLayer(cnv);
+}
+
+/**
+ * Draws the edges and pixels collected in the update, into the layer if
+ * anti-aliased lines are drawn
+ */
+void drawScene(CCanvas *cnv, Scene *scene, Framebuffer *layer) {
+  SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
+  uint32_t pixel = CCanvas_brushPixel(cnv);
+  // Loop through the edges that were found visible in the update
+  // Use precise lines for drawing because it looks better than with thick
+  // lines
+  for (long int i = 0; i < scene->visibleEdgeCount; i++) {
+    Point a, b;
+    if (!Scene_edgePoints(scene, scene->visibleEdges[i], &a, &b)) continue;
+    if (layer == NULL)
+      CCanvas_preciseLine(cnv, a.x, a.y, b.x, b.y);
+    else if (app->lineWidth == 1)
+      Framebuffer_lineAA(layer, a.x, a.y, b.x, b.y, pixel);
+    else
+      Framebuffer_thickLine(layer, a.x, a.y, b.x, b.y, app->lineWidth,
+                            FRAMEBUFFER_CAP_ROUND, pixel);
+  }
+  // Then the pixels that the sub-pixel edges were merged into
+  long int width = scene->cam.hRes;
+  for (long int i = 0; i < scene->pixelCount; i++) {
+    long int x = scene->pixels[i] % width, y = scene->pixels[i] / width;
+    if (layer == NULL)
+      CCanvas_point(cnv, x, y);
+    else
+      Framebuffer_point(layer, x, y, pixel);
+  }
+}
+
+/**
+ * Copies the lines and pixels of the scenes in view into the list of the
+ * frame, to be drawn while the next frame is updated
+ */
+void recordFrame(CCanvas *cnv, DrawList *list) {
+  SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
+  ChunkStore *chunks = app->chunks;
+  InstanceSet *instances = app->instances;
+  list->lineCount = list->pixelCount = 0;
+  // Chunks and instances project with the camera of the app
+  list->width = app->scene.cam.hRes;
+  list->lineWidth = app->lineWidth;
+  list->recorded = true;
+
+  if (instances != NULL) {
+    for (long int i = 0; i < instances->visibleCount; i++)
+      recordScene(list, &instances->instances[instances->visible[i]].scene);
+  } else if (chunks != NULL) {
+    for (long int i = 0; i < chunks->visibleCount; i++)
+      recordScene(list, &chunks->chunks[chunks->visible[i]].scene);
+  } else {
+    recordScene(list, &app->scene);
+  }
+}
+
+/**
+ * Appends the edges and pixels collected in the update of the scene to the
+ * list
+ */
+void recordScene(DrawList *list, Scene *scene) {
+  long int lineCount = list->lineCount + scene->visibleEdgeCount;
+  if (lineCount > list->allocatedLines) {
+    list->allocatedLines *= 2;
+    if (list->allocatedLines < lineCount) list->allocatedLines = lineCount;
+    list->lines = (Point *)realloc(
+        list->lines, list->allocatedLines * 2 * sizeof(Point));
+  }
+  long int pixelCount = list->pixelCount + scene->pixelCount;
+  if (pixelCount > list->allocatedPixels) {
+    list->allocatedPixels *= 2;
+    if (list->allocatedPixels < pixelCount) list->allocatedPixels = pixelCount;
+    list->pixels = (long int *)realloc(
+        list->pixels, list->allocatedPixels * sizeof(long int));
+  }
+
+  // Edges that miss the guard band entirely are left out
+  for (long int i = 0; i < scene->visibleEdgeCount; i++) {
+    Point *line = &list->lines[list->lineCount * 2];
+    if (Scene_edgePoints(scene, scene->visibleEdges[i], &line[0], &line[1]))
+      list->lineCount++;
+  }
+  if (scene->pixelCount > 0)
+    memcpy(&list->pixels[list->pixelCount], scene->pixels,
+           scene->pixelCount * sizeof(long int));
+  list->pixelCount = pixelCount;
+}
+
+/**
+ * Draws a recorded frame the same way drawScene draws the scenes
+ */
+void drawList(CCanvas *cnv, DrawList *list, Framebuffer *layer) {
+  uint32_t pixel = CCanvas_brushPixel(cnv);
+  for (long int i = 0; i < list->lineCount; i++) {
+    Point a = list->lines[i * 2], b = list->lines[i * 2 + 1];
+    if (layer == NULL)
+      CCanvas_preciseLine(cnv, a.x, a.y, b.x, b.y);
+    else if (list->lineWidth == 1)
+      Framebuffer_lineAA(layer, a.x, a.y, b.x, b.y, pixel);
+    else
+      Framebuffer_thickLine(layer, a.x, a.y, b.x, b.y, list->lineWidth,
+                            FRAMEBUFFER_CAP_ROUND, pixel);
+  }
+  for (long int i = 0; i < list->pixelCount; i++) {
+    long int x = list->pixels[i] % list->width,
+             y = list->pixels[i] / list->width;
+    if (layer == NULL)
+      CCanvas_point(cnv, x, y);
+    else
+      Framebuffer_point(layer, x, y, pixel);
   }
 }
 
@@ -184,23 +542,205 @@ void onMouseMove(CCanvas *cnv, Sint32 dx, Sint32 dy) {
   Scene *scene = &app->scene;
   app->lastInput = app->currentTick;
 
-  // Turn the camera based off of the mouse movement
+  // Turn the camera based off of the mouse movement of the whole frame, it is
+  // called once per frame with the sum of the motion events
   Camera_turnRight(&scene->cam, dx / 1000.0);
   Camera_tiltDown(&scene->cam, dy / 1000.0);
 }
 
 void onFileDrop(CCanvas *cnv, char *fileName) {
   SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
-  // Free memory of the old geometry then proceed to load the new scene from the
-  // given file
+  // Drop the old geometry then proceed to load the new scene from the given
+  // file, a part of it in every frame
+  loadFile(app, fileName);
+}
+
+/**
+ * Builds up the scene from a file that arrives in chunks
+ * Every chunk is parsed right away, so the geometry already loaded is shown
+ * while the rest of the file is still downloading
+ */
+void onFileStream(CCanvas *cnv, int stage, char *data, size_t length) {
+  SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
+
+  switch (stage) {
+    case CCANVAS_STREAM_BEGIN:
+      beginLoading(app, -1);
+      break;
+    case CCANVAS_STREAM_DATA:
+      if (app->parser == NULL) return;
+      ObjParser_feed(app->parser, data, length);
+      updateLoadedRadius(app);
+      break;
+    case CCANVAS_STREAM_END:
+      if (app->parser == NULL) return;
+      finishLoading(app);
+      break;
+  }
+}
+
+/**
+ * Starts loading the scene from the given file, or from the standard input if
+ * the name is "-"
+ */
+void loadFile(SoftwareRenderer *app, const char *fileName) {
+  size_t length = strlen(fileName);
+  if (length > 7 && strcmp(fileName + length - 7, ".chunks") == 0) {
+    openChunkStore(app, fileName);
+    return;
+  }
+  size_t extension = strlen(INSTANCES_EXTENSION);
+  if (length > extension &&
+      strcmp(fileName + length - extension, INSTANCES_EXTENSION) == 0) {
+    openInstances(app, fileName);
+    return;
+  }
+  if (MeshFile_formatOf(fileName) != MESHFILE_OBJ) {
+    openMeshFile(app, fileName);
+    return;
+  }
+  int fd = ObjParser_openInput(fileName, true);
+  beginLoading(app, fd);
+  // Leave an empty scene if the file could not be opened
+  if (fd < 0) finishLoading(app);
+}
+
+/**
+ * Frees the old geometry and sets up a parser for the new scene
+ * The data is read from the given descriptor in every frame, or pushed to the
+ * parser by the caller if it is -1
+ */
+void beginLoading(SoftwareRenderer *app, int fd) {
+  closeScene(app);
+  app->parser = ObjParser_create(&(app->scene));
+  app->inputFd = fd;
+  app->sceneRadius = 0;
+  app->radiusVertices = 0;
+}
+
+/**
+ * Opens a preprocessed scene for out-of-core rendering, its chunks are loaded
+ * while they are in view
+ */
+void openChunkStore(SoftwareRenderer *app, const char *fileName) {
+  closeScene(app);
+  app->chunks = ChunkStore_open(fileName, app->chunkBudget);
+  if (app->chunks == NULL) return;
+  app->sceneRadius = ChunkStore_radius(app->chunks);
+  calculateCameraPosAndSpeed(app);
+}
+
+/**
+ * Loads the meshes of an instanced scene and places their instances, the
+ * meshes are loaded at once
+ */
+void openInstances(SoftwareRenderer *app, const char *fileName) {
+  closeScene(app);
+  app->instances = InstanceSet_load(fileName);
+  if (app->instances == NULL) return;
+  app->sceneRadius = InstanceSet_radius(app->instances);
+  calculateCameraPosAndSpeed(app);
+}
+
+/**
+ * Loads a binary .ply or .stl file, they are read at once since their blocks
+ * of records are converted without parsing
+ */
+void openMeshFile(SoftwareRenderer *app, const char *fileName) {
+  closeScene(app);
+  MeshFile_load(&(app->scene), fileName);
+  weldScene(app);
+  calculateSceneRadius(app);
+  calculateCameraPosAndSpeed(app);
+}
+
+/**
+ * Frees the current scene, stops loading the previous file if it is not done
+ * yet and closes the out-of-core or instanced scene if one is open
+ */
+void closeScene(SoftwareRenderer *app) {
+  if (app->parser != NULL) {
+    ObjParser_finish(app->parser);
+    ObjParser_closeInput(app->inputFd);
+    app->parser = NULL;
+    app->inputFd = -1;
+  }
+  ChunkStore_close(app->chunks);
+  app->chunks = NULL;
+  InstanceSet_free(app->instances);
+  app->instances = NULL;
   Scene_free(&(app->scene));
-  Scene_loadObj(&(app->scene), fileName);
+  app->sceneRadius = 0;
+}
+
+/**
+ * Reads and parses chunks from the input until the time budget of the frame is
+ * used up, the input runs out for now or the file ends
+ */
+void continueLoading(SoftwareRenderer *app) {
+  if (app->parser == NULL || app->inputFd < 0) return;
+  Uint32 start = SDL_GetTicks();
+  bool grew = false;
+
+  do {
+    long int length = ObjParser_read(app->parser, app->inputFd);
+    if (length == 0) {
+      finishLoading(app);
+      return;
+    }
+    if (length < 0) break;
+    grew = true;
+  } while (SDL_GetTicks() - start < app->parseBudget);
+
+  if (grew) updateLoadedRadius(app);
+}
+
+/**
+ * Parses what is left of the file, frees the parser and puts the camera to an
+ * overlook position over the complete scene
+ */
+void finishLoading(SoftwareRenderer *app) {
+  ObjParser_finish(app->parser);
+  ObjParser_closeInput(app->inputFd);
+  app->parser = NULL;
+  app->inputFd = -1;
+  weldScene(app);
   // Set camera speed for new scene
   calculateSceneRadius(app);
-  // Put the camera to an overlook position over the scene
   calculateCameraPosAndSpeed(app);
 }
 
+/**
+ * Merges the repeated vertices of the loaded scene if welding is enabled and
+ * prints how much smaller the scene got
+ */
+void weldScene(SoftwareRenderer *app) {
+  Scene *scene = &(app->scene);
+  if (app->weldEpsilon < 0 || scene->verticesCount == 0) return;
+  long int vertices = scene->verticesCount, edges = scene->edgeCount;
+  Scene_weld(scene, app->weldEpsilon);
+  printf("Welded %ld -> %ld vertices, %ld -> %ld edges\n", vertices,
+         scene->verticesCount, edges, scene->edgeCount);
+}
+
+/**
+ * Called when the scene grew during loading
+ * Only the new vertices are checked for updating the radius
+ */
+void updateLoadedRadius(SoftwareRenderer *app) {
+  Scene *scene = &(app->scene);
+  double r =
+      Scene_rangeRadius(scene, app->radiusVertices, scene->verticesCount);
+  app->radiusVertices = scene->verticesCount;
+  if (r > app->sceneRadius) {
+    // Give the camera an overview position once there is something to see
+    bool first = app->sceneRadius == 0;
+    app->sceneRadius = r;
+    if (first) calculateCameraPosAndSpeed(app);
+  }
+  Scene_markChanged(scene);
+}
+
 void onKeyDown(CCanvas *cnv, SDL_Keycode code) {
   SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
   Scene *scene = &app->scene;
@@ -227,6 +767,68 @@ void onKeyDown(CCanvas *cnv, SDL_Keycode code) {
     case SDLK_LSHIFT:
       app->movingDown = true;
       break;
+      // Change the length under which edges are merged into pixels
+    case SDLK_LEFTBRACKET:
+      scene->minEdgeLength = fmax(scene->minEdgeLength - 0.5, 0);
+      Scene_markChanged(scene);
+      break;
+    case SDLK_RIGHTBRACKET:
+      scene->minEdgeLength += 0.5;
+      Scene_markChanged(scene);
+      break;
+      // Point size and depth test of point clouds
+    case SDLK_MINUS:
+      if (app->splat.pointSize > 1) app->splat.pointSize--;
+      Scene_markChanged(scene);
+      break;
+    case SDLK_EQUALS:
+      if (app->splat.pointSize < 16) app->splat.pointSize++;
+      Scene_markChanged(scene);
+      break;
+    case SDLK_z:
+      app->splat.depthTest = !app->splat.depthTest;
+      Scene_markChanged(scene);
+      break;
+      // Skip the edges of the faces turned away from the camera
+    case SDLK_b:
+      scene->backfaceCulling = !scene->backfaceCulling;
+      Scene_markChanged(scene);
+      break;
+      // Draw only the silhouette and crease edges, and change the angle of
+      // the faces above which an edge is a crease
+    case SDLK_f:
+      scene->featureEdges = !scene->featureEdges;
+      Scene_markChanged(scene);
+      break;
+    case SDLK_COMMA:
+      scene->creaseAngle = fmax(scene->creaseAngle - M_PI / 36, 0);
+      Scene_markChanged(scene);
+      break;
+    case SDLK_PERIOD:
+      scene->creaseAngle = fmin(scene->creaseAngle + M_PI / 36, M_PI);
+      Scene_markChanged(scene);
+      break;
+      // Cycle through plain lines and anti-aliased lines of 1, 2 and 3 pixels
+    case SDLK_l:
+      app->lineWidth = app->lineWidth >= 3 ? 0 : app->lineWidth + 1;
+      CCanvas_invalidate(cnv);
+      break;
+      // Switch between projecting with doubles and with floats
+    case SDLK_p:
+      scene->singlePrecision = !scene->singlePrecision;
+      Scene_markChanged(scene);
+      break;
+      // Switch between drawing every frame before the next one is updated and
+      // overlapping them
+    case SDLK_t:
+      app->framesInFlight =
+          app->framesInFlight == 1 ? CCANVAS_FRAME_SLOTS : 1;
+      CCanvas_invalidate(cnv);
+      break;
+      // Start or stop recording the frames
+    case SDLK_r:
+      toggleCapture(cnv);
+      break;
       // Unlock the mouse when pressing ESC
     case SDLK_ESCAPE:
       SDL_SetRelativeMouseMode(SDL_FALSE);
@@ -297,4 +899,156 @@ void calculateCameraPosAndSpeed(SoftwareRenderer *app) {
 
   Camera_setLookDirection(cam, &newDirection);
   cam->pos = newPos;
+}
+
+/**
+ * Counts the rendered frames and shows the frame rate and the ratio of the
+ * drawn edges in the window title once every second
+ * Called from the update of every frame that is drawn, the frames in flight
+ * are counted with it
+ */
+void showStats(CCanvas *cnv) {
+  SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
+  Scene *scene = &app->scene;
+
+  app->statsFrames++;
+  app->statsInFlight += cnv->framesInFlight + 1;
+  Uint32 elapsed = app->currentTick - app->statsTick;
+  if (elapsed < 1000) return;
+
+  // Out-of-core and instanced scenes sum up the statistics of the visible
+  // chunks or instances
+  long int edgeCount = scene->edgeCount,
+           visibleEdgeCount = scene->visibleEdgeCount,
+           droppedEdgeCount = scene->droppedEdgeCount,
+           culledEdgeCount = scene->culledEdgeCount,
+           pixelCount = scene->pixelCount;
+  char chunkStats[96] = "";
+  ChunkStore *chunks = app->chunks;
+  InstanceSet *instances = app->instances;
+  if (instances != NULL) {
+    edgeCount = InstanceSet_edgeCount(instances);
+    visibleEdgeCount = droppedEdgeCount = culledEdgeCount = pixelCount = 0;
+    for (long int i = 0; i < instances->visibleCount; i++) {
+      Scene *instance = &instances->instances[instances->visible[i]].scene;
+      visibleEdgeCount += instance->visibleEdgeCount;
+      droppedEdgeCount += instance->droppedEdgeCount;
+      culledEdgeCount += instance->culledEdgeCount;
+      pixelCount += instance->pixelCount;
+    }
+    snprintf(chunkStats, sizeof(chunkStats),
+             " - %ld/%ld instances of %ld meshes in view",
+             instances->visibleCount, instances->instanceCount,
+             instances->meshCount);
+  } else if (chunks == NULL && edgeCount == 0) {
+    snprintf(chunkStats, sizeof(chunkStats),
+             " - %ld points of %dpx, depth test %s", scene->verticesCount,
+             app->splat.pointSize, app->splat.depthTest ? "on" : "off");
+  } else if (chunks != NULL) {
+    edgeCount = chunks->header->edgeCount;
+    visibleEdgeCount = droppedEdgeCount = culledEdgeCount = pixelCount = 0;
+    for (long int i = 0; i < chunks->visibleCount; i++) {
+      Scene *chunk = &chunks->chunks[chunks->visible[i]].scene;
+      visibleEdgeCount += chunk->visibleEdgeCount;
+      droppedEdgeCount += chunk->droppedEdgeCount;
+      culledEdgeCount += chunk->culledEdgeCount;
+      pixelCount += chunk->pixelCount;
+    }
+    snprintf(chunkStats, sizeof(chunkStats),
+             " - %ld/%ld chunks resident (%.0f MB)", chunks->residentCount,
+             chunks->chunkCount, chunks->residentBytes / 1048576.0);
+  } else {
+    snprintf(chunkStats, sizeof(chunkStats), " - %ld/%ld objects in view",
+             scene->visibleObjectCount, scene->objectCount);
+  }
+
+  char featureStats[128] = "";
+  int length = 0;
+  if (scene->featureEdges)
+    length = snprintf(featureStats, sizeof(featureStats),
+                      " - silhouettes and creases over %.0f deg",
+                      scene->creaseAngle * 180 / M_PI);
+  // The reduction is relative to the edges that would be drawn without
+  // culling (as lines or merged pixels)
+  if (scene->backfaceCulling) {
+    long int total = visibleEdgeCount + droppedEdgeCount + culledEdgeCount;
+    snprintf(featureStats + length, sizeof(featureStats) - length,
+             " - %ld back-facing edges culled (%.0f%% fewer drawn)",
+             culledEdgeCount, total == 0 ? 0 : 100.0 * culledEdgeCount / total);
+  }
+
+  char lineStats[48] = "";
+  if (app->lineWidth > 0)
+    snprintf(lineStats, sizeof(lineStats), " - %.0fpx anti-aliased lines",
+             app->lineWidth);
+
+  char pipelineStats[48] = "";
+  if (CCanvas_pipelined(cnv))
+    snprintf(pipelineStats, sizeof(pipelineStats),
+             " - %.1f/%d frames in flight",
+             (double)app->statsInFlight / app->statsFrames,
+             cnv->maxFramesInFlight);
+
+  // Only the render thread counts the dropped frames
+  char captureStats[48] = "";
+  if (app->capture != NULL)
+    snprintf(captureStats, sizeof(captureStats),
+             " - recording, %ld frames dropped", app->capture->dropped);
+
+  char title[640];
+  double ratio = edgeCount == 0 ? 0 : 100.0 * visibleEdgeCount / edgeCount;
+  snprintf(title, sizeof(title),
+           "Software Renderer - %.0f fps - %ld/%ld edges visible (%.1f%%) - "
+           "%ld under %.1fpx merged into %ld pixels - %.0f%% resolution"
+           "%s%s%s%s%s%s",
+           app->statsFrames * 1000.0 / elapsed, visibleEdgeCount, edgeCount,
+           ratio, droppedEdgeCount, scene->minEdgeLength, pixelCount,
+           cnv->renderScale * 100, chunkStats, featureStats,
+           scene->singlePrecision ? " - single precision" : "", lineStats,
+           pipelineStats, captureStats);
+  SDL_SetWindowTitle(cnv->window, title);
+
+  app->statsTick = app->currentTick;
+  app->statsFrames = 0;
+  app->statsInFlight = 0;
+}
+
+/**
+ * Starts recording the frames, or stops the recording in progress
+ * Recordings after the first get their number before the extension of the
+ * file name, so the earlier ones are kept
+ * The resolution is not lowered while recording, every frame of the video is
+ * of the size of the window
+ */
+void toggleCapture(CCanvas *cnv) {
+  SoftwareRenderer *app = (SoftwareRenderer *)cnv->data;
+  if (app->capture != NULL) {
+    CCanvas_setCapture(cnv, NULL);
+    Capture_stop(app->capture);
+    app->capture = NULL;
+    CCanvas_setFrameBudget(cnv, 1000.0 / 60.0, 0.25);
+    return;
+  }
+
+  const char *path =
+      app->capturePath != NULL ? app->capturePath : "capture.y4m";
+  char name[1024];
+  const char *extension = strrchr(path, '.');
+  if (extension == NULL || strchr(extension, '/') != NULL)
+    extension = path + strlen(path);
+  if (app->captureCount == 0)
+    snprintf(name, sizeof(name), "%s", path);
+  else
+    snprintf(name, sizeof(name), "%.*s-%d%s", (int)(extension - path), path,
+             app->captureCount + 1, extension);
+
+  app->capture = Capture_start(name, Capture_formatOf(name),
+                               app->capturePolicy, CAPTURE_DEFAULT_DEPTH, 60);
+  if (app->capture == NULL) {
+    fprintf(stderr, "Could not create %s\n", name);
+    return;
+  }
+  app->captureCount++;
+  CCanvas_setFrameBudget(cnv, 0, 1);
+  CCanvas_setCapture(cnv, app->capture);
 }
\ No newline at end of file
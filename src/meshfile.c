@@ -0,0 +1,399 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <meshfile.h>
+
+/**
+ * Returns the format of the mesh file from its extension
+ */
+int MeshFile_formatOf(const char* fileName) {
+  if (MeshFile_hasExtension(fileName, ".ply")) return MESHFILE_PLY;
+  if (MeshFile_hasExtension(fileName, ".stl")) return MESHFILE_STL;
+  return MESHFILE_OBJ;
+}
+
+/**
+ * Returns true if the file name ends with the extension, ignoring the case
+ * (CAD tools often write them in capitals)
+ */
+bool MeshFile_hasExtension(const char* fileName, const char* extension) {
+  size_t length = strlen(fileName), extensionLength = strlen(extension);
+  if (length <= extensionLength) return false;
+  const char* end = fileName + length - extensionLength;
+  for (size_t i = 0; i < extensionLength; i++)
+    if (tolower((unsigned char)end[i]) != tolower((unsigned char)extension[i]))
+      return false;
+  return true;
+}
+
+/**
+ * Loads the mesh file into the scene with the loader of its format
+ * Returns false if the file could not be opened or read
+ */
+bool MeshFile_load(Scene* scene, const char* fileName) {
+  switch (MeshFile_formatOf(fileName)) {
+    case MESHFILE_PLY:
+      return MeshFile_loadPly(scene, fileName);
+    case MESHFILE_STL:
+      return MeshFile_loadStl(scene, fileName);
+  }
+  Scene_loadObj(scene, fileName);
+  return scene->verticesCount > 0;
+}
+
+/**
+ * Loads a binary little-endian PLY file into the scene as a new object
+ * Returns false if it is not such a file or it is truncated, the part that
+ * could be read is kept
+ */
+bool MeshFile_loadPly(Scene* scene, const char* fileName) {
+  FILE* file = fopen(fileName, "rb");
+  if (file == NULL) return false;
+  MeshFileElement elements[16];
+  int count = MeshFile_readPlyHeader(file, elements, 16);
+  if (count < 0) {
+    fprintf(stderr, "%s is not a binary little-endian PLY file\n", fileName);
+    fclose(file);
+    return false;
+  }
+
+  long int base = scene->verticesCount;
+  Scene_beginObject(scene);
+  long int object = scene->objectCount - 1;
+  bool loaded = true;
+  for (int i = 0; i < count && loaded; i++) {
+    MeshFileElement* element = &elements[i];
+    bool used = false, fixedSize = true;
+    for (int j = 0; j < element->propertyCount; j++) {
+      used |= element->properties[j].role != MESHFILE_SKIP;
+      fixedSize &= element->properties[j].countType == MESHFILE_INVALID;
+    }
+    // Elements of records with a fixed size are skipped at once
+    if (!used && fixedSize) {
+      loaded = fseek(file, element->count * element->maxSize, SEEK_CUR) == 0;
+      continue;
+    }
+    if (strcmp(element->name, "vertex") == 0)
+      Scene_reserveVertices(scene, scene->verticesCount + element->count);
+    if (strcmp(element->name, "face") == 0)
+      Scene_reserveEdges(scene, scene->edgeCount + 3 * element->count);
+    loaded = MeshFile_readElement(scene, file, element, base);
+  }
+  if (!loaded) fprintf(stderr, "%s is truncated or corrupt\n", fileName);
+  fclose(file);
+  // Only the edges of the new object are merged, the rest of the scene stays
+  // in place
+  Scene_mergeEdges(scene, object, NULL, NULL);
+  return loaded;
+}
+
+/**
+ * Reads the header of a PLY file up to the binary data, the elements are
+ * stored in order with their properties and the role of each property
+ * Returns the number of elements, -1 if the file is not a binary
+ * little-endian PLY file or it has too many elements or properties
+ */
+int MeshFile_readPlyHeader(FILE* file, MeshFileElement* elements,
+                           int maxCount) {
+  char line[1024];
+  if (fgets(line, sizeof(line), file) == NULL || strncmp(line, "ply", 3) != 0)
+    return -1;
+  int count = 0;
+  bool binary = false;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    char format[64], name[64], type[64], countType[64];
+    long int elementCount;
+    if (strncmp(line, "end_header", 10) == 0) return binary ? count : -1;
+    if (sscanf(line, "format %63s", format) == 1) {
+      binary = strcmp(format, "binary_little_endian") == 0;
+    } else if (sscanf(line, "element %63s %ld", name, &elementCount) == 2) {
+      if (count == maxCount || elementCount < 0) return -1;
+      MeshFileElement* element = &elements[count++];
+      strcpy(element->name, name);
+      element->count = elementCount;
+      element->propertyCount = 0;
+      element->maxSize = 0;
+    } else if (strncmp(line, "property ", 9) == 0) {
+      if (count == 0) return -1;
+      MeshFileElement* element = &elements[count - 1];
+      if (element->propertyCount == MESHFILE_MAX_PROPERTIES) return -1;
+      MeshFileProperty* property =
+          &element->properties[element->propertyCount++];
+      property->countType = MESHFILE_INVALID;
+      if (sscanf(line, "property list %63s %63s %63s", countType, type,
+                 name) == 3) {
+        property->countType = MeshFile_typeOf(countType);
+        property->type = MeshFile_typeOf(type);
+        if (property->countType == MESHFILE_INVALID) return -1;
+        element->maxSize += MeshFile_typeSize(property->countType) +
+                            MESHFILE_MAX_POLYGON *
+                                MeshFile_typeSize(property->type);
+      } else if (sscanf(line, "property %63s %63s", type, name) == 2) {
+        property->type = MeshFile_typeOf(type);
+        element->maxSize += MeshFile_typeSize(property->type);
+      } else {
+        return -1;
+      }
+      if (property->type == MESHFILE_INVALID) return -1;
+
+      bool list = property->countType != MESHFILE_INVALID;
+      property->role = MESHFILE_SKIP;
+      if (strcmp(element->name, "vertex") == 0 && !list) {
+        if (strcmp(name, "x") == 0) property->role = MESHFILE_X;
+        if (strcmp(name, "y") == 0) property->role = MESHFILE_Y;
+        if (strcmp(name, "z") == 0) property->role = MESHFILE_Z;
+      } else if (strcmp(element->name, "face") == 0 && list) {
+        if (strcmp(name, "vertex_indices") == 0 ||
+            strcmp(name, "vertex_index") == 0)
+          property->role = MESHFILE_INDICES;
+      } else if (strcmp(element->name, "edge") == 0 && !list) {
+        if (strcmp(name, "vertex1") == 0) property->role = MESHFILE_VERTEX1;
+        if (strcmp(name, "vertex2") == 0) property->role = MESHFILE_VERTEX2;
+      }
+    }
+    // Comments and obj_info lines are skipped
+  }
+  return -1;
+}
+
+/**
+ * Returns the type with the given PLY name (both the old and the sized names
+ * are accepted), MESHFILE_INVALID for unknown names
+ */
+int MeshFile_typeOf(const char* name) {
+  const char* names[] = {"char",  "uchar",  "short",   "ushort", "int",
+                         "uint",  "float",  "double",  "int8",   "uint8",
+                         "int16", "uint16", "int32",   "uint32", "float32",
+                         "float64"};
+  for (int i = 0; i < 16; i++)
+    if (strcmp(name, names[i]) == 0) return MESHFILE_INT8 + i % 8;
+  return MESHFILE_INVALID;
+}
+
+/**
+ * Returns the size of a value of the type in bytes
+ */
+int MeshFile_typeSize(int type) {
+  switch (type) {
+    case MESHFILE_INT8:
+    case MESHFILE_UINT8:
+      return 1;
+    case MESHFILE_INT16:
+    case MESHFILE_UINT16:
+      return 2;
+    case MESHFILE_INT32:
+    case MESHFILE_UINT32:
+    case MESHFILE_FLOAT32:
+      return 4;
+    case MESHFILE_FLOAT64:
+      return 8;
+  }
+  return 0;
+}
+
+/**
+ * Converts the little-endian value of the type at data
+ */
+double MeshFile_value(const uint8_t* data, int type) {
+  switch (type) {
+    case MESHFILE_INT8:
+      return (int8_t)data[0];
+    case MESHFILE_UINT8:
+      return data[0];
+    case MESHFILE_INT16:
+      return (int16_t)(data[0] | data[1] << 8);
+    case MESHFILE_UINT16:
+      return (uint16_t)(data[0] | data[1] << 8);
+    case MESHFILE_INT32:
+      return (int32_t)MeshFile_uint32(data);
+    case MESHFILE_UINT32:
+      return MeshFile_uint32(data);
+    case MESHFILE_FLOAT32:
+      return MeshFile_float(data);
+    case MESHFILE_FLOAT64: {
+      uint64_t bits = MeshFile_uint32(data) |
+                      (uint64_t)MeshFile_uint32(data + 4) << 32;
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Reads the records of an element in blocks and adds the vertices, faces or
+ * edges they describe to the scene, base is the index of the first vertex of
+ * the file in the scene
+ * Returns false if the file ended first or a face has too many vertices
+ */
+bool MeshFile_readElement(Scene* scene, FILE* file, MeshFileElement* element,
+                          long int base) {
+  uint8_t* buffer = (uint8_t*)malloc(MESHFILE_BLOCK_SIZE);
+  size_t length = 0, offset = 0;
+  bool vertices = strcmp(element->name, "vertex") == 0;
+  bool read = true;
+  long int indices[MESHFILE_MAX_POLYGON];
+  for (long int i = 0; i < element->count && read; i++) {
+    // The buffer always holds the largest possible record, unless the file
+    // ends first
+    if (length - offset < (size_t)element->maxSize) {
+      memmove(buffer, buffer + offset, length - offset);
+      length -= offset;
+      offset = 0;
+      length += fread(buffer + length, 1, MESHFILE_BLOCK_SIZE - length, file);
+    }
+
+    double position[3] = {0, 0, 0};
+    long int a = -1, b = -1;
+    int indexCount = 0;
+    for (int j = 0; j < element->propertyCount && read; j++) {
+      MeshFileProperty* property = &element->properties[j];
+      size_t size = MeshFile_typeSize(property->type), count = 1;
+      if (property->countType != MESHFILE_INVALID) {
+        size_t countSize = MeshFile_typeSize(property->countType);
+        double value = -1;
+        if (offset + countSize <= length)
+          value = MeshFile_value(&buffer[offset], property->countType);
+        read = value >= 0 && value <= MESHFILE_MAX_POLYGON;
+        offset += countSize;
+        count = read ? (size_t)value : 0;
+      }
+      if (!read || offset + count * size > length) {
+        read = false;
+        break;
+      }
+
+      const uint8_t* data = &buffer[offset];
+      switch (property->role) {
+        case MESHFILE_X:
+        case MESHFILE_Y:
+        case MESHFILE_Z:
+          position[property->role - MESHFILE_X] =
+              MeshFile_value(data, property->type);
+          break;
+        case MESHFILE_INDICES:
+          // Scene_pushFace takes 1 based indices like the .obj files
+          for (size_t k = 0; k < count; k++)
+            indices[k] = base + 1 +
+                         (long int)MeshFile_value(&data[k * size],
+                                                  property->type);
+          indexCount = (int)count;
+          break;
+        case MESHFILE_VERTEX1:
+          a = base + (long int)MeshFile_value(data, property->type);
+          break;
+        case MESHFILE_VERTEX2:
+          b = base + (long int)MeshFile_value(data, property->type);
+          break;
+      }
+      offset += count * size;
+    }
+    if (!read) break;
+
+    if (vertices) {
+      Scene_pushVertex(scene, Vec3_new(position[0], position[1], position[2]));
+    } else if (indexCount >= 3) {
+      long int face = Scene_pushFace(scene, indices, indexCount);
+      for (int k = 0; k < indexCount && face != 0; k++) {
+        long int edge = Scene_appendEdge(scene, indices[k] - 1,
+                                         indices[(k + 1) % indexCount] - 1);
+        Scene_attachFace(scene, edge, face);
+      }
+    } else if (a >= 0 && b >= 0 && a < scene->verticesCount &&
+               b < scene->verticesCount) {
+      Scene_appendEdge(scene, a, b);
+    }
+  }
+  // The records are read ahead, the file position is put back to the end of
+  // the element for the next one
+  if (read) fseek(file, -(long int)(length - offset), SEEK_CUR);
+  free(buffer);
+  return read;
+}
+
+/**
+ * Loads a binary STL file into the scene as a new object, the repeated
+ * corners of the triangles are merged, a file without triangles is valid
+ * Returns false if it is not a binary STL file or it is truncated
+ */
+bool MeshFile_loadStl(Scene* scene, const char* fileName) {
+  FILE* file = fopen(fileName, "rb");
+  if (file == NULL) return false;
+  uint8_t header[MESHFILE_STL_HEADER];
+  fseek(file, 0, SEEK_END);
+  long int size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  long int count = -1;
+  if (fread(header, 1, MESHFILE_STL_HEADER, file) == MESHFILE_STL_HEADER)
+    count = MeshFile_uint32(&header[80]);
+  // Text STL files start with "solid", their size gives them away (binary
+  // files may start with it too, their size matches their triangles)
+  long int expected = MESHFILE_STL_HEADER + count * MESHFILE_STL_TRIANGLE;
+  if (count < 0 || size < expected ||
+      (memcmp(header, "solid", 5) == 0 && size != expected)) {
+    fprintf(stderr, "%s is not a binary STL file\n", fileName);
+    fclose(file);
+    return false;
+  }
+
+  long int first = scene->verticesCount;
+  Scene_beginObject(scene);
+  Scene_reserveVertices(scene, first + 3 * count);
+  Scene_reserveEdges(scene, scene->edgeCount + 3 * count);
+  long int blockCount = MESHFILE_BLOCK_SIZE / MESHFILE_STL_TRIANGLE;
+  uint8_t* buffer = (uint8_t*)malloc(blockCount * MESHFILE_STL_TRIANGLE);
+  bool loaded = true;
+  for (long int i = 0; i < count && loaded; i += blockCount) {
+    long int triangles = count - i < blockCount ? count - i : blockCount;
+    loaded = fread(buffer, MESHFILE_STL_TRIANGLE, triangles, file) ==
+             (size_t)triangles;
+    for (long int j = 0; j < triangles && loaded; j++) {
+      // The corners follow the normal, which is computed from them instead
+      const uint8_t* corner = &buffer[j * MESHFILE_STL_TRIANGLE + 12];
+      long int corners[3];
+      for (int k = 0; k < 3; k++, corner += 12) {
+        Scene_pushVertex(scene,
+                         Vec3_new(MeshFile_float(corner),
+                                  MeshFile_float(corner + 4),
+                                  MeshFile_float(corner + 8)));
+        corners[k] = scene->verticesCount;
+      }
+      long int face = Scene_pushFace(scene, corners, 3);
+      for (int k = 0; k < 3; k++) {
+        long int edge = Scene_appendEdge(scene, corners[k] - 1,
+                                         corners[(k + 1) % 3] - 1);
+        Scene_attachFace(scene, edge, face);
+      }
+    }
+  }
+  if (!loaded) fprintf(stderr, "%s is truncated\n", fileName);
+  free(buffer);
+  fclose(file);
+  // Only the new vertices are merged, the rest of the scene stays in place
+  Scene_weldRange(scene, 0, first);
+  return loaded;
+}
+
+/**
+ * Converts the little-endian float at data
+ */
+float MeshFile_float(const uint8_t* data) {
+  uint32_t bits = MeshFile_uint32(data);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/**
+ * Converts the little-endian unsigned integer at data
+ */
+uint32_t MeshFile_uint32(const uint8_t* data) {
+  return (uint32_t)data[0] | (uint32_t)data[1] << 8 |
+         (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <objparser.h>
+
+/**
+ * Creates a parser that adds the geometry it reads to the given scene
+ */
+ObjParser* ObjParser_create(Scene* scene) {
+  ObjParser* parser = (ObjParser*)malloc(sizeof(ObjParser));
+  parser->scene = scene;
+  parser->lineCapacity = 256;
+  parser->line = (char*)malloc(parser->lineCapacity);
+  parser->lineLength = 0;
+  parser->started = false;
+  parser->prefixLength = 0;
+  parser->decompressor = NULL;
+  return parser;
+}
+
+/**
+ * Appends bytes to the unfinished line, growing the buffer if needed
+ */
+void ObjParser_append(ObjParser* parser, const char* data, size_t length) {
+  if (parser->lineLength + length + 1 > parser->lineCapacity) {
+    while (parser->lineLength + length + 1 > parser->lineCapacity)
+      parser->lineCapacity *= 2;
+    parser->line = (char*)realloc(parser->line, parser->lineCapacity);
+  }
+  memcpy(parser->line + parser->lineLength, data, length);
+  parser->lineLength += length;
+  parser->line[parser->lineLength] = '\0';
+}
+
+/**
+ * Processes the next chunk of the file
+ * Every line completed by the chunk is parsed, the remainder is stored
+ */
+void ObjParser_feed(ObjParser* parser, const char* data, size_t length) {
+  const char* end = data + length;
+  while (data < end) {
+    const char* newLine = (const char*)memchr(data, '\n', end - data);
+    if (newLine == NULL) {
+      ObjParser_append(parser, data, end - data);
+      return;
+    }
+    ObjParser_append(parser, data, newLine - data);
+    Scene_parseObjLine(parser->scene, parser->line);
+    parser->lineLength = 0;
+    data = newLine + 1;
+  }
+}
+
+/**
+ * Parses the last line if the file did not end with a line break and frees
+ * the parser
+ * The decompression of the input is stopped, what was not parsed yet is lost
+ */
+void ObjParser_finish(ObjParser* parser) {
+  Decompress_stop(parser->decompressor);
+  if (parser->lineLength > 0) {
+    parser->line[parser->lineLength] = '\0';
+    Scene_parseObjLine(parser->scene, parser->line);
+  }
+  Scene_markChanged(parser->scene);
+  free(parser->line);
+  free(parser);
+}
+
+/**
+ * Opens a file for reading with ObjParser_read, the name "-" stands for the
+ * standard input
+ * On POSIX systems the descriptor can be made non-blocking so reading from a
+ * pipe that has no data yet does not stall the caller, loaders that read the
+ * whole file at once keep it blocking
+ * Returns -1 if the file could not be opened
+ */
+int ObjParser_openInput(const char* fileName, bool nonBlocking) {
+  int fd;
+#ifdef _WIN32
+  if (strcmp(fileName, "-") == 0) {
+    fd = 0;
+    _setmode(fd, _O_BINARY);
+  } else {
+    fd = _open(fileName, _O_RDONLY | _O_BINARY);
+  }
+#else
+  fd = strcmp(fileName, "-") == 0 ? 0 : open(fileName, O_RDONLY);
+  if (fd >= 0 && nonBlocking)
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#endif
+  return fd;
+}
+
+/**
+ * Reads the next chunk from the file descriptor and feeds it to the parser
+ * Returns the number of bytes parsed, 0 at the end of the input (or on an
+ * error) and -1 if no data is available yet
+ */
+long int ObjParser_read(ObjParser* parser, int fd) {
+  return ObjParser_pull(parser, fd, false);
+}
+
+/**
+ * Reads up to size bytes from the file descriptor, if wait is set it waits
+ * for them instead of returning -1
+ * Returns the number of bytes read, 0 at the end of the input (or on an
+ * error) and -1 if no data is available yet
+ */
+long int ObjParser_readInput(int fd, char* buffer, size_t size, bool wait) {
+#ifdef _WIN32
+  long int length = _read(fd, buffer, size);
+#else
+  long int length = read(fd, buffer, size);
+  while (length < 0 &&
+         (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    if (!wait) return -1;
+    // The descriptor may be non-blocking anyway (an inherited standard input)
+    struct pollfd input = {fd, POLLIN, 0};
+    poll(&input, 1, -1);
+    length = read(fd, buffer, size);
+  }
+#endif
+  return length < 0 ? 0 : length;
+}
+
+/**
+ * Reads and parses the next chunk like ObjParser_read, if wait is set it
+ * waits for input (also for compressed input to be decompressed) instead of
+ * returning -1
+ * Compressed input is recognized by its first bytes, from then on the chunks
+ * are taken from the decompressor
+ */
+long int ObjParser_pull(ObjParser* parser, int fd, bool wait) {
+  if (parser->decompressor != NULL)
+    return ObjParser_readDecompressed(parser, wait);
+  char buffer[OBJPARSER_CHUNK_SIZE];
+  // Until the format is known the input starts with the bytes kept from the
+  // earlier reads, a pipe or socket may deliver the first bytes in parts
+  size_t kept = parser->prefixLength;
+  memcpy(buffer, parser->prefix, kept);
+  long int length;
+  while ((length = ObjParser_readInput(fd, buffer + kept,
+                                       sizeof(buffer) - kept, wait)) > 0 &&
+         !parser->started && kept + length < DECOMPRESS_MAGIC_SIZE) {
+    kept += length;
+    memcpy(parser->prefix, buffer, kept);
+    parser->prefixLength = kept;
+  }
+  if (length < 0) return -1;
+  length += kept;
+  if (!parser->started) {
+    // Enough bytes to tell the format arrived, or the input ended before
+    parser->started = true;
+    parser->prefixLength = 0;
+    int format = Decompress_formatOf(buffer, length);
+    if (format != DECOMPRESS_NONE) {
+      parser->decompressor = Decompress_start(fd, format, buffer, length);
+      if (parser->decompressor == NULL) return 0;
+      return ObjParser_readDecompressed(parser, wait);
+    }
+  }
+  if (length == 0) return 0;
+  ObjParser_feed(parser, buffer, length);
+  return length;
+}
+
+/**
+ * Parses the next buffer of decompressed input
+ * Returns the number of bytes parsed, 0 at the end of the input and -1 if the
+ * next buffer is not decompressed yet
+ */
+long int ObjParser_readDecompressed(ObjParser* parser, bool wait) {
+  const char* data;
+  long int length = Decompress_next(parser->decompressor, &data, wait);
+  if (length <= 0) return length;
+  ObjParser_feed(parser, data, length);
+  Decompress_release(parser->decompressor);
+  return length;
+}
+
+/**
+ * Closes a descriptor opened by ObjParser_openInput, the standard input is
+ * left open but made blocking again, since its file description is shared
+ * with the shell and the other processes of the pipeline
+ */
+void ObjParser_closeInput(int fd) {
+  if (fd < 0) return;
+#ifdef _WIN32
+  if (fd > 0) _close(fd);
+#else
+  if (fd == 0)
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  else
+    close(fd);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,328 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <png.h>
+
+extern inline void Png_putBits(PngEncoder* encoder, uint32_t value,
+                               int count);
+extern inline uint8_t Png_magnitude(uint8_t value);
+
+/**
+ * Encodes the image into a PNG file in memory, the size of the file is stored
+ * in size
+ * Returns the file, it has to be freed by the caller
+ */
+uint8_t* Png_encode(const uint8_t* rgba, int width, int height, size_t* size) {
+  size_t rawSize = ((size_t)width * 4 + 1) * height;
+  uint8_t* raw = (uint8_t*)malloc(rawSize);
+  Png_filterRows(rgba, width, height, raw);
+
+  PngEncoder encoder;
+  Png_init(&encoder);
+  // Literals take at most 9 bits, on top of that come the signature, the
+  // zlib header and checksum and the 3 chunks
+  size_t bound = rawSize + rawSize / 8 + 128;
+  encoder.out = (uint8_t*)malloc(bound);
+  uint8_t* out = encoder.out;
+  const uint8_t signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+  memcpy(out, signature, 8);
+  encoder.size = 8;
+
+  size_t chunk = encoder.size;
+  memcpy(&out[chunk + 4], "IHDR", 4);
+  Png_putUint32(&out[chunk + 8], width);
+  Png_putUint32(&out[chunk + 12], height);
+  out[chunk + 16] = 8;  // Bits per channel
+  out[chunk + 17] = 6;  // RGBA
+  out[chunk + 18] = 0;  // Deflate
+  out[chunk + 19] = 0;  // Filters chosen per row
+  out[chunk + 20] = 0;  // Not interlaced
+  encoder.size = chunk + 21;
+  Png_endChunk(&encoder, chunk);
+
+  chunk = encoder.size;
+  memcpy(&out[chunk + 4], "IDAT", 4);
+  // zlib header: deflate with a 32K window, fastest compression
+  out[chunk + 8] = 0x78;
+  out[chunk + 9] = 0x01;
+  encoder.size = chunk + 10;
+  Png_deflate(&encoder, raw, rawSize);
+  Png_putUint32(&out[encoder.size], Png_adler(raw, rawSize));
+  encoder.size += 4;
+  Png_endChunk(&encoder, chunk);
+
+  chunk = encoder.size;
+  memcpy(&out[chunk + 4], "IEND", 4);
+  encoder.size = chunk + 8;
+  Png_endChunk(&encoder, chunk);
+
+  free(raw);
+  *size = encoder.size;
+  return out;
+}
+
+/**
+ * Builds the code tables of the encoder
+ */
+void Png_init(PngEncoder* encoder) {
+  encoder->size = 0;
+  encoder->bits = 0;
+  encoder->bitCount = 0;
+  for (int symbol = 0; symbol < 288; symbol++) {
+    uint32_t code;
+    int length;
+    if (symbol < 144) {
+      code = 0x30 + symbol;
+      length = 8;
+    } else if (symbol < 256) {
+      code = 0x190 + symbol - 144;
+      length = 9;
+    } else if (symbol < 280) {
+      code = symbol - 256;
+      length = 7;
+    } else {
+      code = 0xC0 + symbol - 280;
+      length = 8;
+    }
+    encoder->codes[symbol] = Png_reverse(code, length);
+    encoder->lengths[symbol] = length;
+  }
+  for (int code = 0; code < 30; code++)
+    encoder->distanceCodes[code] = Png_reverse(code, 5);
+
+  // Lengths 3 to 10 have a symbol each, then every 4 symbols cover twice as
+  // many lengths as the previous 4, with one more extra bit, up to 257
+  for (int offset = 0; offset < 256; offset++) {
+    int symbol = 257 + offset, extra = 0;
+    if (offset >= 8) {
+      int log = Png_log2(offset);
+      extra = log - 2;
+      symbol = 257 + 4 * (log - 1) + ((offset >> extra) & 3);
+    }
+    uint32_t bits = offset & ((1 << extra) - 1);
+    encoder->matchBits[offset] =
+        encoder->codes[symbol] | bits << encoder->lengths[symbol];
+    encoder->matchCounts[offset] = encoder->lengths[symbol] + extra;
+  }
+  // 258 has a symbol of its own
+  encoder->matchBits[255] = encoder->codes[285];
+  encoder->matchCounts[255] = encoder->lengths[285];
+  // Distances 1 to 4 have a code each, then every 2 codes cover twice as many
+  // distances as the previous 2, the table is indexed with the distance - 1
+  // up to 256 and with 256 + (distance - 1) / 128 above
+  for (int i = 0; i < 512; i++) {
+    int offset = i < 256 ? i : (i - 256) << 7;
+    int code = offset;
+    if (offset >= 4) {
+      int log = Png_log2(offset);
+      code = 2 * log + ((offset >> (log - 1)) & 1);
+    }
+    encoder->distanceSymbols[i] = code;
+  }
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    encoder->crcTable[n] = c;
+  }
+}
+
+/**
+ * Returns the code with the order of its lowest length bits reversed
+ */
+uint32_t Png_reverse(uint32_t code, int length) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < length; i++)
+    reversed |= ((code >> i) & 1) << (length - 1 - i);
+  return reversed;
+}
+
+/**
+ * Writes the rows of the image into out, each one starting with the type of
+ * the filter it was filtered with
+ * The filter giving the smallest sum of absolute values (with the bytes taken
+ * as signed) is chosen for every row, the loops have no branches so they are
+ * vectorized
+ * Returns the number of bytes written
+ */
+size_t Png_filterRows(const uint8_t* rgba, int width, int height,
+                      uint8_t* out) {
+  size_t stride = (size_t)width * 4;
+  for (int y = 0; y < height; y++) {
+    const uint8_t* row = &rgba[y * stride];
+    const uint8_t* above = row - stride;
+    unsigned long none = 0, sub = 0, up = 0;
+    for (size_t i = 0; i < stride; i++) none += Png_magnitude(row[i]);
+    for (size_t i = 0; i < 4 && i < stride; i++) sub += Png_magnitude(row[i]);
+    for (size_t i = 4; i < stride; i++)
+      sub += Png_magnitude(row[i] - row[i - 4]);
+    // The first row has nothing above it, up is the same as none there
+    up = none;
+    if (y > 0) {
+      up = 0;
+      for (size_t i = 0; i < stride; i++)
+        up += Png_magnitude(row[i] - above[i]);
+    }
+    int filter = sub < none ? (up < sub ? 2 : 1) : (up < none ? 2 : 0);
+
+    uint8_t* filtered = &out[y * (stride + 1)];
+    *(filtered++) = filter;
+    if (filter == 0) {
+      memcpy(filtered, row, stride);
+    } else if (filter == 1) {
+      memcpy(filtered, row, stride < 4 ? stride : 4);
+      for (size_t i = 4; i < stride; i++) filtered[i] = row[i] - row[i - 4];
+    } else {
+      for (size_t i = 0; i < stride; i++) filtered[i] = row[i] - above[i];
+    }
+  }
+  return (stride + 1) * height;
+}
+
+/**
+ * Compresses the data into a single final deflate block with the fixed codes
+ * A match is looked for at the last position the next 4 bytes were seen, and
+ * it is taken as long as it goes. Of long matches only the start and the last
+ * 4 positions are hashed, the latter are where runs of pixels continue from
+ */
+void Png_deflate(PngEncoder* encoder, const uint8_t* data, size_t size) {
+  size_t hashSize = (size_t)1 << PNG_HASH_BITS;
+  int32_t* head = (int32_t*)malloc(hashSize * sizeof(int32_t));
+  memset(head, 0xFF, hashSize * sizeof(int32_t));
+
+  Png_putBits(encoder, 1, 1);  // Final block
+  Png_putBits(encoder, 1, 2);  // Fixed codes
+  size_t i = 0;
+  while (i + 4 <= size) {
+    uint32_t sequence;
+    memcpy(&sequence, &data[i], 4);
+    uint32_t hash = (sequence * 2654435761u) >> (32 - PNG_HASH_BITS);
+    long int candidate = head[hash];
+    head[hash] = i;
+    if (candidate < 0 || (long int)i - candidate > PNG_WINDOW ||
+        memcmp(&data[candidate], &data[i], 4) != 0) {
+      Png_putBits(encoder, encoder->codes[data[i]], encoder->lengths[data[i]]);
+      i++;
+      continue;
+    }
+
+    // Extended 8 bytes at a time, then byte by byte
+    size_t length = 4;
+    size_t max = size - i < PNG_MAX_MATCH ? size - i : PNG_MAX_MATCH;
+    while (length + 8 <= max) {
+      uint64_t a, b;
+      memcpy(&a, &data[candidate + length], 8);
+      memcpy(&b, &data[i + length], 8);
+      if (a != b) break;
+      length += 8;
+    }
+    while (length < max && data[candidate + length] == data[i + length])
+      length++;
+    Png_putMatch(encoder, length, i - candidate);
+    for (size_t k = length > 8 ? length - 4 : 1; k < length; k++) {
+      if (i + k + 4 > size) break;
+      memcpy(&sequence, &data[i + k], 4);
+      head[(sequence * 2654435761u) >> (32 - PNG_HASH_BITS)] = i + k;
+    }
+    i += length;
+  }
+  for (; i < size; i++)
+    Png_putBits(encoder, encoder->codes[data[i]], encoder->lengths[data[i]]);
+  Png_putBits(encoder, encoder->codes[256], encoder->lengths[256]);
+  Png_flushBits(encoder);
+  free(head);
+}
+
+/**
+ * Writes a match of the given length (3 to 258) and distance (1 to 32768)
+ */
+void Png_putMatch(PngEncoder* encoder, int length, int distance) {
+  Png_putBits(encoder, encoder->matchBits[length - 3],
+              encoder->matchCounts[length - 3]);
+  uint32_t offset = distance - 1;
+  int code = encoder->distanceSymbols[offset < 256 ? offset
+                                                   : 256 + (offset >> 7)];
+  // Codes 0 to 3 have no extra bits, then 1 more for every 2 codes
+  int extra = code < 4 ? 0 : (code >> 1) - 1;
+  uint32_t base = code < 4 ? (uint32_t)code : (2u | (code & 1)) << extra;
+  Png_putBits(encoder,
+              encoder->distanceCodes[code] | (offset - base) << 5, 5 + extra);
+}
+
+/**
+ * Writes out the bits left in the bit buffer, padding the last byte
+ */
+void Png_flushBits(PngEncoder* encoder) {
+  while (encoder->bitCount > 0) {
+    encoder->out[encoder->size++] = (uint8_t)encoder->bits;
+    encoder->bits >>= 8;
+    encoder->bitCount -= 8;
+  }
+  encoder->bits = 0;
+  encoder->bitCount = 0;
+}
+
+/**
+ * Returns the CRC-32 of the data, as used by the chunks
+ */
+uint32_t Png_crc(PngEncoder* encoder, const uint8_t* data, size_t size) {
+  uint32_t c = 0xFFFFFFFF;
+  for (size_t i = 0; i < size; i++)
+    c = encoder->crcTable[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFF;
+}
+
+/**
+ * Returns the Adler-32 checksum of the data, as used by zlib streams
+ * The sums are reduced every 5552 bytes, before they could overflow
+ */
+uint32_t Png_adler(const uint8_t* data, size_t size) {
+  uint32_t a = 1, b = 0;
+  while (size > 0) {
+    size_t block = size < 5552 ? size : 5552;
+    for (size_t i = 0; i < block; i++) {
+      a += data[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    data += block;
+    size -= block;
+  }
+  return (b << 16) | a;
+}
+
+/**
+ * Stores the value in big endian byte order, as the numbers of PNG files are
+ */
+void Png_putUint32(uint8_t* out, uint32_t value) {
+  out[0] = value >> 24;
+  out[1] = value >> 16;
+  out[2] = value >> 8;
+  out[3] = value;
+}
+
+/**
+ * Fills in the length of the chunk starting at begin and appends its CRC, the
+ * type and the data have to be written already
+ */
+void Png_endChunk(PngEncoder* encoder, size_t begin) {
+  Png_putUint32(&encoder->out[begin], encoder->size - begin - 8);
+  uint32_t crc = Png_crc(encoder, &encoder->out[begin + 4],
+                         encoder->size - begin - 4);
+  Png_putUint32(&encoder->out[encoder->size], crc);
+  encoder->size += 4;
+}
+
+/**
+ * Returns the index of the highest set bit of a positive value
+ */
+int Png_log2(uint32_t value) {
+  int log = 0;
+  while (value >>= 1) log++;
+  return log;
+}
\ No newline at end of file
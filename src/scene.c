@@ -7,6 +7,22 @@
  */
 
 #include <scene.h>
+#include <objparser.h>
+#include <simd.h>
+
+/**
+ * Makes the scene empty and sets every setting to its default, the projection
+ * runs on the given worker pool (serially if it is NULL)
+ */
+void Scene_init(Scene* scene, WorkerPool* workers) {
+  Scene_erase(scene);
+  scene->workers = workers;
+  scene->minEdgeLength = 1;
+  scene->featureEdges = false;
+  scene->backfaceCulling = false;
+  scene->creaseAngle = M_PI / 6;
+  scene->singlePrecision = SCENE_SINGLE_PRECISION;
+}
 
 /**
  * Erases the geometry data from the scene by setting the pointers to NULL
@@ -14,9 +30,47 @@
 void Scene_erase(Scene* scene) {
   scene->vertices = NULL;
   scene->projectedPoints = NULL;
+  scene->visibility = NULL;
   scene->edges = NULL;
+  scene->visibleEdges = NULL;
+  scene->pixels = NULL;
+  scene->pixelMask = NULL;
   scene->edgeCount = 0;
+  scene->visibleEdgeCount = 0;
+  scene->pixelCount = 0;
+  scene->droppedEdgeCount = 0;
+  scene->culledEdgeCount = 0;
+  scene->pixelMaskSize = 0;
   scene->verticesCount = 0;
+  scene->allocatedVertices = 0;
+  scene->allocatedProjection = 0;
+  scene->origin = Vec3_new(0, 0, 0);
+  scene->localX = NULL;
+  scene->localY = NULL;
+  scene->localZ = NULL;
+  scene->localCount = 0;
+  scene->allocatedLocal = 0;
+  scene->allocatedEdges = 0;
+  scene->edgeFaces = NULL;
+  scene->dihedral = NULL;
+  scene->faces = NULL;
+  scene->faceCount = 0;
+  scene->allocatedFaces = 0;
+  scene->facing = NULL;
+  scene->allocatedFacing = 0;
+  scene->objects = NULL;
+  scene->objectCount = 0;
+  scene->allocatedObjects = 0;
+  scene->visibleObjects = NULL;
+  scene->visibleObjectCount = 0;
+  scene->allocatedVisibleObjects = 0;
+  scene->ranges = NULL;
+  scene->rangeCount = 0;
+  scene->allocatedRanges = 0;
+  scene->model = Transform_identity();
+  // Make sure the next projection is not skipped
+  scene->version = 0;
+  scene->projectedVersion = (unsigned long)-1;
 }
 
 /**
@@ -24,14 +78,627 @@ void Scene_erase(Scene* scene) {
  */
 void Scene_setCamera(Scene* scene, Camera cam) { scene->cam = cam; }
 
+/**
+ * Signals that the geometry or the settings of the scene changed so the points
+ * have to be projected again even if the camera did not move
+ */
+void Scene_markChanged(Scene* scene) { scene->version++; }
+
+/**
+ * Takes the camera and the drawing settings of the view, used by scenes that
+ * are drawn as parts of the view (chunks, instances)
+ */
+void Scene_copySettings(Scene* scene, Scene* view) {
+  scene->cam = view->cam;
+  if (scene->minEdgeLength != view->minEdgeLength ||
+      scene->featureEdges != view->featureEdges ||
+      scene->backfaceCulling != view->backfaceCulling ||
+      scene->creaseAngle != view->creaseAngle ||
+      scene->singlePrecision != view->singlePrecision) {
+    scene->minEdgeLength = view->minEdgeLength;
+    scene->featureEdges = view->featureEdges;
+    scene->backfaceCulling = view->backfaceCulling;
+    scene->creaseAngle = view->creaseAngle;
+    scene->singlePrecision = view->singlePrecision;
+    Scene_markChanged(scene);
+  }
+}
+
+/**
+ * Returns true if the camera or the scene changed since the last call (or the
+ * last projection), the current state is stored for the next comparison
+ */
+bool Scene_changed(Scene* scene) {
+  if (scene->projectedVersion == scene->version &&
+      Camera_equals(&(scene->cam), &(scene->projectedCam)))
+    return false;
+  scene->projectedVersion = scene->version;
+  scene->projectedCam = scene->cam;
+  return true;
+}
+
+/**
+ * Makes sure the arrays for the projected points can hold every vertex
+ * They are allocated on the first projection, so scenes that are never
+ * projected this way (point clouds) do not pay for them
+ */
+void Scene_reserveProjection(Scene* scene) {
+  if (scene->verticesCount <= scene->allocatedProjection) return;
+  long int allocate = scene->allocatedVertices > scene->verticesCount
+                          ? scene->allocatedVertices
+                          : scene->verticesCount;
+  scene->projectedPoints =
+      (Point*)realloc(scene->projectedPoints, allocate * sizeof(Point));
+  scene->visibility = (unsigned char*)realloc(scene->visibility, allocate);
+  scene->allocatedProjection = allocate;
+}
+
 /**
  * Projects all the vertices in the scene to screen space and stores the
  * coordinates in member projectedPoints in the same order
+ * The visibility mask of every vertex is stored in member visibility
+ * Nothing is done if neither the camera nor the scene changed since the last
+ * projection, returns true if the points were projected again
+ * The vertices are split into blocks that are projected on the worker pool
+ * The model transform is combined with the view once, so instances sharing
+ * the vertices of a mesh cost no more to project than the mesh itself
+ * Only the vertices of the objects intersecting the frustum are projected,
+ * the points of the other vertices are left as they were
+ * In single precision the vertices relative to the origin are projected
+ * instead, with a transform that is relative to the camera
+ */
+bool Scene_projectPoints(Scene* scene) {
+  if (!Scene_changed(scene)) return false;
+
+  SceneProjection projection;
+  Scene_prepareProjection(scene, &projection);
+  if (scene->workers != NULL && scene->rangeCount > 1) {
+    WorkerPool_run(scene->workers, Scene_projectBlock, &projection,
+                   scene->rangeCount);
+  } else {
+    for (long int k = 0; k < scene->rangeCount; k++)
+      Scene_projectBlock(&projection, k);
+  }
+
+  return true;
+}
+
+/**
+ * Everything of a projection before the vertices are projected: reserves the
+ * arrays, combines the transforms, culls the objects into ranges and
+ * classifies the faces if the edge modes need them
+ */
+void Scene_prepareProjection(Scene* scene, SceneProjection* projection) {
+  Scene_reserveProjection(scene);
+  projection->scene = scene;
+  Transform view = Camera_viewTransform(&(scene->cam));
+  projection->view = Transform_multiply(&view, &(scene->model));
+  if (scene->singlePrecision) {
+    Scene_updateLocal(scene);
+    Scene_localTransform(scene, &projection->view, projection->local);
+  }
+  Scene_cullObjects(scene);
+  if ((scene->featureEdges || scene->backfaceCulling) && scene->faceCount > 0)
+    Scene_classifyFaces(scene);
+}
+
+/**
+ * Tests the bounding sphere of every object against the frustum of the camera
+ * and collects the visible ones, then lists the vertices they refer to as
+ * blocks of at most SCENE_PROJECTION_BLOCK vertices in member ranges
+ * Scenes without objects (chunks of out-of-core scenes) are projected whole
  */
-void Scene_projectPoints(Scene* scene) {
-  for (long int i = 0; i < scene->verticesCount; i++) {
-    (scene->projectedPoints)[i] =
-        Camera_projectLinear(&(scene->cam), &((scene->vertices)[i]));
+void Scene_cullObjects(Scene* scene) {
+  // Every visible object gives at most one range more than the number of
+  // blocks the vertices fill
+  long int maxRanges =
+      scene->objectCount + scene->verticesCount / SCENE_PROJECTION_BLOCK + 1;
+  if (maxRanges > scene->allocatedRanges) {
+    scene->ranges = (SceneRange*)realloc(scene->ranges,
+                                         maxRanges * sizeof(SceneRange));
+    scene->allocatedRanges = maxRanges;
+  }
+  if (scene->objectCount > scene->allocatedVisibleObjects) {
+    scene->visibleObjects = (long int*)realloc(
+        scene->visibleObjects, scene->objectCount * sizeof(long int));
+    scene->allocatedVisibleObjects = scene->objectCount;
+  }
+
+  SceneRange* ranges = scene->ranges;
+  long int count = 0;
+  scene->visibleObjectCount = 0;
+  if (scene->objectCount == 0) {
+    ranges[0].begin = 0;
+    ranges[0].end = scene->verticesCount;
+    count = scene->verticesCount > 0 ? 1 : 0;
+  } else {
+    double scale = Transform_scale(&(scene->model));
+    for (long int i = 0; i < scene->objectCount; i++) {
+      SceneObject* object = &scene->objects[i];
+      if (object->vertexEnd <= object->vertexBegin) continue;
+      Vec3 center = Transform_apply(&(scene->model), &(object->center));
+      if (!Camera_sphereVisible(&(scene->cam), &center,
+                                object->radius * scale))
+        continue;
+      scene->visibleObjects[scene->visibleObjectCount++] = i;
+      ranges[count].begin = object->vertexBegin;
+      ranges[count++].end = object->vertexEnd;
+    }
+
+    // Objects can share vertices, overlapping ranges are merged so no vertex
+    // is projected twice (possibly by two jobs at the same time)
+    qsort(ranges, count, sizeof(SceneRange), Scene_compareRanges);
+    long int merged = 0;
+    for (long int k = 0; k < count; k++) {
+      if (merged > 0 && ranges[k].begin <= ranges[merged - 1].end) {
+        if (ranges[k].end > ranges[merged - 1].end)
+          ranges[merged - 1].end = ranges[k].end;
+      } else {
+        ranges[merged++] = ranges[k];
+      }
+    }
+    count = merged;
+  }
+
+  // Split the ranges into blocks in place, starting from the last one so the
+  // blocks only overwrite ranges that were already split
+  long int blocks = 0;
+  for (long int k = 0; k < count; k++)
+    blocks += (ranges[k].end - ranges[k].begin + SCENE_PROJECTION_BLOCK - 1) /
+              SCENE_PROJECTION_BLOCK;
+  long int next = blocks;
+  for (long int k = count - 1; k >= 0; k--) {
+    SceneRange range = ranges[k];
+    long int n = (range.end - range.begin + SCENE_PROJECTION_BLOCK - 1) /
+                 SCENE_PROJECTION_BLOCK;
+    next -= n;
+    for (long int j = 0; j < n; j++) {
+      ranges[next + j].begin = range.begin + j * SCENE_PROJECTION_BLOCK;
+      ranges[next + j].end = range.begin + (j + 1) * SCENE_PROJECTION_BLOCK;
+      if (ranges[next + j].end > range.end) ranges[next + j].end = range.end;
+    }
+  }
+  scene->rangeCount = blocks;
+}
+
+/**
+ * Orders ranges by their first vertex
+ */
+int Scene_compareRanges(const void* r1, const void* r2) {
+  long int b1 = ((SceneRange*)r1)->begin, b2 = ((SceneRange*)r2)->begin;
+  return (b1 > b2) - (b1 < b2);
+}
+
+/**
+ * Finds the faces turned towards the camera for detecting silhouettes and
+ * culling back-facing edges
+ * The camera is taken into the space of the vertices, so the planes of the
+ * faces can be used as they are, two faces are tested at a time
+ */
+void Scene_classifyFaces(Scene* scene) {
+  if (scene->faceCount > scene->allocatedFacing) {
+    scene->facing = (unsigned char*)realloc(scene->facing, scene->faceCount);
+    scene->allocatedFacing = scene->faceCount;
+  }
+  Transform inverse = Transform_invert(&(scene->model));
+  Vec3 eye = Transform_apply(&inverse, &(scene->cam.pos));
+  SceneFace* faces = scene->faces;
+  unsigned char* facing = scene->facing;
+
+  SimdF64 x = Simd_splat(eye.x), y = Simd_splat(eye.y), z = Simd_splat(eye.z);
+  SimdF64 zero = Simd_splat(0);
+  long int i = 0;
+  for (; i + 1 < scene->faceCount; i += 2) {
+    SceneFace* f = &(faces[i]);
+    SimdF64 d = Simd_madd(
+        Simd_set(f[0].normal.x, f[1].normal.x), x,
+        Simd_madd(Simd_set(f[0].normal.y, f[1].normal.y), y,
+                  Simd_madd(Simd_set(f[0].normal.z, f[1].normal.z), z,
+                            Simd_set(f[0].offset, f[1].offset))));
+    int front = Simd_lessMask(zero, d);
+    facing[i] = front & 1;
+    facing[i + 1] = (front >> 1) & 1;
+  }
+  for (; i < scene->faceCount; i++)
+    facing[i] = Vec3_dot(&(faces[i].normal), &eye) + faces[i].offset > 0;
+  // Edges without faces are never culled
+  facing[0] = 1;
+}
+
+/**
+ * Job function for projecting one block of vertices on the worker pool
+ */
+void Scene_projectBlock(void* _projection, int index) {
+  SceneProjection* projection = (SceneProjection*)_projection;
+  SceneRange* range = &(projection->scene->ranges[index]);
+  Scene_projectVertices(projection, range->begin, range->end);
+}
+
+/**
+ * Projects the vertices with indices in [begin, end) with the kernel of the
+ * precision set in the scene
+ */
+void Scene_projectVertices(SceneProjection* projection, long int begin,
+                           long int end) {
+  Scene* scene = projection->scene;
+  if (scene->singlePrecision)
+    Scene_projectRangeSingle(scene, projection->local, begin, end);
+  else
+    Scene_projectRange(scene, &projection->view, begin, end);
+}
+
+/**
+ * The projection kernel: projects the vertices with indices in [begin, end)
+ * with the given view transform the same way Camera_projectLinear does and
+ * computes their visibility masks
+ * Two vertices are processed at a time with the portable SIMD functions
+ */
+void Scene_projectRange(Scene* scene, Transform* view, long int begin,
+                        long int end) {
+  Vec3* vertices = scene->vertices;
+  Point* points = scene->projectedPoints;
+  unsigned char* visibility = scene->visibility;
+  double (*m)[4] = view->m;
+  double w = scene->cam.hRes, h = scene->cam.vRes;
+
+  // The screen coordinates are w / 2 + (w / 2) * x / z and
+  // h / 2 + (w / 2) * y / z
+  SimdF64 halfW = Simd_splat(w / 2), halfH = Simd_splat(h / 2);
+  SimdF64 zero = Simd_splat(0), nan = Simd_splat(NAN);
+  SimdF64 width = Simd_splat(w), height = Simd_splat(h);
+  SimdF64 minX = Simd_splat(-SCENE_GUARD_BAND * w);
+  SimdF64 maxX = Simd_splat((1 + SCENE_GUARD_BAND) * w);
+  SimdF64 minY = Simd_splat(-SCENE_GUARD_BAND * h);
+  SimdF64 maxY = Simd_splat((1 + SCENE_GUARD_BAND) * h);
+  SimdF64 r[3][4];
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 4; j++) r[i][j] = Simd_splat(m[i][j]);
+
+  long int i = begin;
+  for (; i + 1 < end; i += 2) {
+    Vec3* v = &(vertices[i]);
+    SimdF64 vx = Simd_set(v[0].x, v[1].x);
+    SimdF64 vy = Simd_set(v[0].y, v[1].y);
+    SimdF64 vz = Simd_set(v[0].z, v[1].z);
+    SimdF64 c[3];
+    for (int k = 0; k < 3; k++)
+      c[k] = Simd_madd(r[k][0], vx,
+                       Simd_madd(r[k][1], vy, Simd_madd(r[k][2], vz, r[k][3])));
+
+    // Points behind the camera get NaN coordinates
+    int front = Simd_lessMask(zero, c[2]);
+    SimdF64 scale = Simd_div(halfW, c[2]);
+    SimdF64 x = Simd_select(front, Simd_madd(c[0], scale, halfW), nan);
+    SimdF64 y = Simd_select(front, Simd_madd(c[1], scale, halfH), nan);
+    Simd_storeInterleaved(&(points[i].x), &(points[i + 1].x), x, y);
+
+    // Every comparison with NaN is false, so points behind the camera get
+    // neither the guard band bit nor any outcode bits
+    int guard = Simd_lessEqualMask(minX, x) & Simd_lessEqualMask(x, maxX) &
+                Simd_lessEqualMask(minY, y) & Simd_lessEqualMask(y, maxY);
+    int left = Simd_lessMask(x, zero), right = Simd_lessEqualMask(width, x);
+    int top = Simd_lessMask(y, zero), bottom = Simd_lessEqualMask(height, y);
+    for (int k = 0; k < 2; k++) {
+      visibility[i + k] = ((front >> k) & 1) * SCENE_VISIBLE_FRONT |
+                          ((guard >> k) & 1) * SCENE_VISIBLE_GUARD |
+                          ((left >> k) & 1) * SCENE_OUTSIDE_LEFT |
+                          ((right >> k) & 1) * SCENE_OUTSIDE_RIGHT |
+                          ((top >> k) & 1) * SCENE_OUTSIDE_TOP |
+                          ((bottom >> k) & 1) * SCENE_OUTSIDE_BOTTOM;
+    }
+  }
+
+  // Project the last vertex one by one if the count was odd
+  for (; i < end; i++) {
+    Vec3 c = Transform_apply(view, &(vertices[i]));
+    Point p = Point_new(NAN, NAN);
+    if (c.z > 0)
+      p = Point_new(w / 2 + (w / 2) * c.x / c.z, h / 2 + (w / 2) * c.y / c.z);
+    points[i] = p;
+    visibility[i] = Scene_pointVisibility(p, c.z > 0, w, h);
+  }
+}
+
+/**
+ * Returns the visibility mask of a projected point, for the vertices that do
+ * not fill a whole SIMD vector
+ */
+unsigned char Scene_pointVisibility(Point p, bool front, double w, double h) {
+  unsigned char mask = front ? SCENE_VISIBLE_FRONT : 0;
+  if (p.x >= -SCENE_GUARD_BAND * w && p.x <= (1 + SCENE_GUARD_BAND) * w &&
+      p.y >= -SCENE_GUARD_BAND * h && p.y <= (1 + SCENE_GUARD_BAND) * h)
+    mask |= SCENE_VISIBLE_GUARD;
+  if (p.x < 0) mask |= SCENE_OUTSIDE_LEFT;
+  if (p.x >= w) mask |= SCENE_OUTSIDE_RIGHT;
+  if (p.y < 0) mask |= SCENE_OUTSIDE_TOP;
+  if (p.y >= h) mask |= SCENE_OUTSIDE_BOTTOM;
+  return mask;
+}
+
+/**
+ * Converts the vertices added since the last call to floats relative to the
+ * origin, which is put at the center of the bounding box of the vertices
+ * converted first
+ * The vertices are only ever appended (while loading), the ones converted
+ * before keep their values and the same origin
+ */
+void Scene_updateLocal(Scene* scene) {
+  if (scene->localCount >= scene->verticesCount) return;
+  if (scene->verticesCount > scene->allocatedLocal) {
+    long int allocate = scene->allocatedVertices > scene->verticesCount
+                            ? scene->allocatedVertices
+                            : scene->verticesCount;
+    scene->localX = (float*)realloc(scene->localX, allocate * sizeof(float));
+    scene->localY = (float*)realloc(scene->localY, allocate * sizeof(float));
+    scene->localZ = (float*)realloc(scene->localZ, allocate * sizeof(float));
+    scene->allocatedLocal = allocate;
+  }
+
+  Vec3* vertices = scene->vertices;
+  if (scene->localCount == 0) {
+    Vec3 min = vertices[0], max = vertices[0];
+    for (long int i = 1; i < scene->verticesCount; i++) {
+      Vec3* v = &(vertices[i]);
+      min = Vec3_new(fmin(min.x, v->x), fmin(min.y, v->y), fmin(min.z, v->z));
+      max = Vec3_new(fmax(max.x, v->x), fmax(max.y, v->y), fmax(max.z, v->z));
+    }
+    scene->origin =
+        Vec3_new((min.x + max.x) / 2, (min.y + max.y) / 2, (min.z + max.z) / 2);
+  }
+  Vec3 origin = scene->origin;
+  for (long int i = scene->localCount; i < scene->verticesCount; i++) {
+    scene->localX[i] = (float)(vertices[i].x - origin.x);
+    scene->localY[i] = (float)(vertices[i].y - origin.y);
+    scene->localZ[i] = (float)(vertices[i].z - origin.z);
+  }
+  scene->localCount = scene->verticesCount;
+}
+
+/**
+ * Computes the single precision transform of the local vertices from the
+ * view transform of the vertices
+ * Its translation is the origin in camera space computed with doubles, so the
+ * large coordinates of the origin and the camera cancel out before anything
+ * is rounded to floats
+ */
+void Scene_localTransform(Scene* scene, Transform* view, float local[3][4]) {
+  Vec3 origin = Transform_apply(view, &(scene->origin));
+  double translation[3] = {origin.x, origin.y, origin.z};
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) local[i][j] = (float)view->m[i][j];
+    local[i][3] = (float)translation[i];
+  }
+}
+
+/**
+ * The single precision projection kernel: the same as Scene_projectRange but
+ * four local vertices are processed at a time with floats
+ */
+void Scene_projectRangeSingle(Scene* scene, float local[3][4], long int begin,
+                              long int end) {
+  float *lx = scene->localX, *ly = scene->localY, *lz = scene->localZ;
+  Point* points = scene->projectedPoints;
+  unsigned char* visibility = scene->visibility;
+  float w = scene->cam.hRes, h = scene->cam.vRes;
+
+  SimdF32 halfW = SimdF32_splat(w / 2), halfH = SimdF32_splat(h / 2);
+  SimdF32 zero = SimdF32_splat(0), nan = SimdF32_splat(NAN);
+  SimdF32 width = SimdF32_splat(w), height = SimdF32_splat(h);
+  SimdF32 minX = SimdF32_splat(-SCENE_GUARD_BAND * w);
+  SimdF32 maxX = SimdF32_splat((1 + SCENE_GUARD_BAND) * w);
+  SimdF32 minY = SimdF32_splat(-SCENE_GUARD_BAND * h);
+  SimdF32 maxY = SimdF32_splat((1 + SCENE_GUARD_BAND) * h);
+  SimdF32 r[3][4];
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 4; j++) r[i][j] = SimdF32_splat(local[i][j]);
+
+  long int i = begin;
+  for (; i + 3 < end; i += 4) {
+    SimdF32 vx = SimdF32_load(&(lx[i]));
+    SimdF32 vy = SimdF32_load(&(ly[i]));
+    SimdF32 vz = SimdF32_load(&(lz[i]));
+    SimdF32 c[3];
+    for (int k = 0; k < 3; k++)
+      c[k] = SimdF32_madd(
+          r[k][0], vx,
+          SimdF32_madd(r[k][1], vy, SimdF32_madd(r[k][2], vz, r[k][3])));
+
+    int front = SimdF32_lessMask(zero, c[2]);
+    SimdF32 scale = SimdF32_div(halfW, c[2]);
+    SimdF32 x = SimdF32_select(front, SimdF32_madd(c[0], scale, halfW), nan);
+    SimdF32 y = SimdF32_select(front, SimdF32_madd(c[1], scale, halfH), nan);
+    SimdF32_storePoints(&(points[i].x), x, y);
+
+    int guard = SimdF32_lessEqualMask(minX, x) &
+                SimdF32_lessEqualMask(x, maxX) &
+                SimdF32_lessEqualMask(minY, y) & SimdF32_lessEqualMask(y, maxY);
+    int left = SimdF32_lessMask(x, zero);
+    int right = SimdF32_lessEqualMask(width, x);
+    int top = SimdF32_lessMask(y, zero);
+    int bottom = SimdF32_lessEqualMask(height, y);
+    for (int k = 0; k < 4; k++) {
+      visibility[i + k] = ((front >> k) & 1) * SCENE_VISIBLE_FRONT |
+                          ((guard >> k) & 1) * SCENE_VISIBLE_GUARD |
+                          ((left >> k) & 1) * SCENE_OUTSIDE_LEFT |
+                          ((right >> k) & 1) * SCENE_OUTSIDE_RIGHT |
+                          ((top >> k) & 1) * SCENE_OUTSIDE_TOP |
+                          ((bottom >> k) & 1) * SCENE_OUTSIDE_BOTTOM;
+    }
+  }
+
+  // Project the remaining vertices one by one, with floats as well
+  for (; i < end; i++) {
+    float c[3];
+    for (int k = 0; k < 3; k++)
+      c[k] = local[k][0] * lx[i] + local[k][1] * ly[i] + local[k][2] * lz[i] +
+             local[k][3];
+    Point p = Point_new(NAN, NAN);
+    if (c[2] > 0) {
+      float scale = (w / 2) / c[2];
+      p = Point_new(c[0] * scale + w / 2, c[1] * scale + h / 2);
+    }
+    points[i] = p;
+    visibility[i] = Scene_pointVisibility(p, c[2] > 0, w, h);
+  }
+}
+
+/**
+ * Collects the edges that have to be drawn into the dense visibleEdges array
+ * Only the edges of the objects found visible in the projection are tested
+ * In feature edge mode only the silhouettes (edges between a face turned
+ * towards the camera and one turned away) and the creases are kept
+ * With back-face culling the edges whose faces are all turned away from the
+ * camera are dropped, they would be hidden behind the front of closed meshes
+ * An edge is kept if both endpoints are visible and it is not completely on
+ * one side outside of the screen
+ * Visible edges with a projected length below minEdgeLength are dropped and
+ * merged into single pixels instead, every pixel is only listed once in the
+ * pixels array no matter how many edges fell into it
+ * The loop is branchless for the common case: every edge is written to the end
+ * of the output and the output counter only advances if it is drawable, so the
+ * loop does not suffer from mispredictions when visibility is random
+ */
+void Scene_compactEdges(Scene* scene) {
+  Scene_beginCompaction(scene);
+  if (scene->objectCount == 0) {
+    Scene_compactRange(scene, 0, scene->edgeCount);
+    return;
+  }
+  for (long int k = 0; k < scene->visibleObjectCount; k++) {
+    SceneObject* object = &scene->objects[scene->visibleObjects[k]];
+    Scene_compactRange(scene, object->edgeBegin, object->edgeEnd);
+  }
+}
+
+/**
+ * Empties the edges and pixels of the last frame before the edges are
+ * compacted again
+ */
+void Scene_beginCompaction(Scene* scene) {
+  long int width = scene->cam.hRes, height = scene->cam.vRes;
+  // Resize the pixel mask to the resolution if needed, otherwise only unset
+  // the bits set in the last frame
+  if (scene->pixelMaskSize != width * height) {
+    free(scene->pixelMask);
+    scene->pixelMaskSize = width * height;
+    scene->pixelMask = (unsigned char*)calloc(scene->pixelMaskSize / 8 + 1, 1);
+  } else {
+    for (long int i = 0; i < scene->pixelCount; i++)
+      scene->pixelMask[scene->pixels[i] >> 3] = 0;
+  }
+  scene->pixelCount = 0;
+  scene->droppedEdgeCount = 0;
+  scene->visibleEdgeCount = 0;
+  scene->culledEdgeCount = 0;
+}
+
+/**
+ * Compacts the edges with indices in [begin, end), appending them to the
+ * edges and pixels collected since Scene_beginCompaction
+ */
+void Scene_compactRange(Scene* scene, long int begin, long int end) {
+  Edge* edges = scene->edges;
+  Edge* out = scene->visibleEdges;
+  Point* points = scene->projectedPoints;
+  unsigned char* visibility = scene->visibility;
+  long int width = scene->cam.hRes, height = scene->cam.vRes;
+  double minLengthSq = scene->minEdgeLength * scene->minEdgeLength;
+  long int count = scene->visibleEdgeCount;
+  int allEdges = !scene->featureEdges, allFaces = !scene->backfaceCulling;
+  EdgeFaces* edgeFaces =
+      !(allEdges && allFaces) && scene->faceCount > 0 ? scene->edgeFaces : NULL;
+  float* dihedral = scene->dihedral;
+  unsigned char* facing = scene->facing;
+  float minDihedral = cos(scene->creaseAngle);
+  long int culled = 0;
+
+  for (long int i = begin; i < end; i++) {
+    Edge e = edges[i];
+    unsigned char both = visibility[e.a] & visibility[e.b];
+    // Edges leaving the guard band are clipped to it when they are drawn
+    int drawable = ((both & SCENE_VISIBLE_FRONT) != 0) &
+                   ((both & SCENE_OUTSIDE) == 0);
+    if (edgeFaces != NULL) {
+      EdgeFaces f = edgeFaces[i];
+      int front = facing[f.a] | facing[f.b];
+      drawable &= allEdges | (facing[f.a] != facing[f.b]) |
+                  (dihedral[i] < minDihedral);
+      culled += drawable & !(allFaces | front);
+      drawable &= allFaces | front;
+    }
+    double dx = points[e.a].x - points[e.b].x;
+    double dy = points[e.a].y - points[e.b].y;
+    int isShort = dx * dx + dy * dy < minLengthSq;
+    out[count] = e;
+    count += drawable & !isShort;
+
+    if (drawable & isShort) {
+      scene->droppedEdgeCount++;
+      double px = points[e.a].x, py = points[e.a].y;
+      if (!(px >= 0 && py >= 0 && px < width && py < height)) continue;
+      long int x = px, y = py;
+      long int pixel = y * width + x;
+      unsigned char bit = 1 << (pixel & 7);
+      if (scene->pixelMask[pixel >> 3] & bit) continue;
+      scene->pixelMask[pixel >> 3] |= bit;
+      scene->pixels[scene->pixelCount++] = pixel;
+    }
+  }
+
+  scene->visibleEdgeCount = count;
+  scene->culledEdgeCount += culled;
+}
+
+/**
+ * Gets the projected endpoints of a visible edge, clipped to the guard band if
+ * one of them is outside of it
+ * Returns false if no part of the edge is inside the guard band
+ */
+bool Scene_edgePoints(Scene* scene, Edge e, Point* a, Point* b) {
+  *a = scene->projectedPoints[e.a];
+  *b = scene->projectedPoints[e.b];
+  unsigned char both = scene->visibility[e.a] & scene->visibility[e.b];
+  if (both & SCENE_VISIBLE_GUARD) return true;
+  return Scene_clipToGuardBand(a, b, scene->cam.hRes, scene->cam.vRes);
+}
+
+/**
+ * Clips the segment to the guard band around a screen of the given size with
+ * the Cohen-Sutherland algorithm, so its endpoints fit in the integers of the
+ * rasterizers
+ * Returns false if no part of the segment is inside
+ */
+bool Scene_clipToGuardBand(Point* a, Point* b, double width, double height) {
+  // A point right in front of the camera can project to infinity
+  if (!isfinite(a->x + a->y + b->x + b->y)) return false;
+  double minX = -SCENE_GUARD_BAND * width;
+  double maxX = (1 + SCENE_GUARD_BAND) * width;
+  double minY = -SCENE_GUARD_BAND * height;
+  double maxY = (1 + SCENE_GUARD_BAND) * height;
+  for (;;) {
+    int codeA = (a->x < minX) | (a->x > maxX) << 1 | (a->y < minY) << 2 |
+                (a->y > maxY) << 3;
+    int codeB = (b->x < minX) | (b->x > maxX) << 1 | (b->y < minY) << 2 |
+                (b->y > maxY) << 3;
+    if ((codeA | codeB) == 0) return true;
+    if (codeA & codeB) return false;
+
+    // Move the endpoint that is outside onto the border it crosses
+    int code = codeA ? codeA : codeB;
+    Point p;
+    if (code & 1) {
+      p = Point_new(minX, a->y + (b->y - a->y) * (minX - a->x) / (b->x - a->x));
+    } else if (code & 2) {
+      p = Point_new(maxX, a->y + (b->y - a->y) * (maxX - a->x) / (b->x - a->x));
+    } else if (code & 4) {
+      p = Point_new(a->x + (b->x - a->x) * (minY - a->y) / (b->y - a->y), minY);
+    } else {
+      p = Point_new(a->x + (b->x - a->x) * (maxY - a->y) / (b->y - a->y), maxY);
+    }
+    if (code == codeA)
+      *a = p;
+    else
+      *b = p;
   }
 }
 
@@ -48,106 +715,440 @@ Edge Edge_new(long int a, long int b) {
 /**
  * Goes through the Wawefront .obj file at the given path and loads the
  * geometry into the scene
+ * The file is read in chunks and handed to the incremental parser, compressed
+ * files are decompressed on a thread while they are parsed
  */
 void Scene_loadObj(Scene* scene, const char* fileName) {
-  // Open file for reading
-  FILE* filePointer;
-  filePointer = fopen(fileName, "r");
-  if (filePointer == NULL) return;
-  char line[256];
-
-  // Allocate memory for a default number of vertices and edges
-  long allocatedVertices = 512;
-  scene->vertices = (Vec3*)malloc(allocatedVertices * sizeof(Vec3));
-  scene->verticesCount = 0;
+  int fd = ObjParser_openInput(fileName, false);
+  if (fd < 0) return;
+  ObjParser* parser = ObjParser_create(scene);
+  while (ObjParser_pull(parser, fd, true) > 0) continue;
+  ObjParser_finish(parser);
+  ObjParser_closeInput(fd);
+}
 
-  long allocatedEdges = 1024;
-  scene->edges = (Edge*)malloc(allocatedEdges * sizeof(Edge));
-  scene->edgeCount = 0;
+/**
+ * Makes sure there is memory allocated for at least the given number of
+ * vertices
+ * The capacity is at least doubled every time so pushing is amortized O(1)
+ */
+void Scene_reserveVertices(Scene* scene, long int count) {
+  if (count <= scene->allocatedVertices) return;
+  long int allocate = scene->allocatedVertices * 2;
+  if (allocate < count) allocate = count;
+  if (allocate < 512) allocate = 512;
+  scene->vertices = (Vec3*)realloc(scene->vertices, allocate * sizeof(Vec3));
+  scene->allocatedVertices = allocate;
+}
 
-  // Read the file line by line
-  while (fgets(line, sizeof(line), filePointer) != NULL) {
-    // Skip empty lines
-    if (line[0] == '\0' || line[0] == '\n') {
-      continue;
+/**
+ * Makes sure there is memory allocated for at least the given number of edges
+ * and for the per frame edge lists
+ */
+void Scene_reserveEdges(Scene* scene, long int count) {
+  if (count <= scene->allocatedEdges) return;
+  long int allocate = scene->allocatedEdges * 2;
+  if (allocate < count) allocate = count;
+  if (allocate < 1024) allocate = 1024;
+  scene->edges = (Edge*)realloc(scene->edges, allocate * sizeof(Edge));
+  scene->edgeFaces =
+      (EdgeFaces*)realloc(scene->edgeFaces, allocate * sizeof(EdgeFaces));
+  scene->dihedral = (float*)realloc(scene->dihedral, allocate * sizeof(float));
+  scene->visibleEdges =
+      (Edge*)realloc(scene->visibleEdges, allocate * sizeof(Edge));
+  scene->pixels =
+      (long int*)realloc(scene->pixels, allocate * sizeof(long int));
+  scene->allocatedEdges = allocate;
+}
+
+/**
+ * Adds a vertex to the end of the vertex array and to the current object
+ */
+void Scene_pushVertex(Scene* scene, Vec3 vertex) {
+  Scene_reserveVertices(scene, scene->verticesCount + 1);
+  scene->vertices[scene->verticesCount++] = vertex;
+  if (scene->objectCount == 0) Scene_beginObject(scene);
+  Scene_extendObject(scene, scene->verticesCount - 1);
+}
+
+/**
+ * Adds the plane of the polygon with the given (1 based) vertex indices
+ * Returns the index of the face, or 0 (no face) if the polygon refers to
+ * vertices that do not exist
+ */
+long int Scene_pushFace(Scene* scene, long int* vertexList, int vertexCount) {
+  for (int i = 0; i < vertexCount; i++)
+    if (vertexList[i] < 1 || vertexList[i] > scene->verticesCount) return 0;
+
+  // The normal is computed with Newell's method, which also works for
+  // polygons that are not exactly planar
+  Vec3 normal = Vec3_new(0, 0, 0), center = Vec3_new(0, 0, 0);
+  for (int i = 0; i < vertexCount; i++) {
+    Vec3* v = &(scene->vertices[vertexList[i] - 1]);
+    Vec3* w = &(scene->vertices[vertexList[(i + 1) % vertexCount] - 1]);
+    normal.x += (v->y - w->y) * (v->z + w->z);
+    normal.y += (v->z - w->z) * (v->x + w->x);
+    normal.z += (v->x - w->x) * (v->y + w->y);
+    Vec3_add(&center, v);
+  }
+  if (Vec3_sqLength(&normal) > 0) Vec3_setLength(&normal, 1);
+  Vec3_mult(&center, 1.0 / vertexCount);
+
+  // Face 0 is the placeholder for edges without a face
+  if (scene->faceCount + 2 > scene->allocatedFaces) {
+    long int allocate = scene->allocatedFaces * 2;
+    if (allocate < 1024) allocate = 1024;
+    scene->faces =
+        (SceneFace*)realloc(scene->faces, allocate * sizeof(SceneFace));
+    scene->allocatedFaces = allocate;
+  }
+  if (scene->faceCount == 0) {
+    scene->faces[0].normal = Vec3_new(0, 0, 0);
+    scene->faces[0].offset = 0;
+    scene->faceCount = 1;
+  }
+  SceneFace* face = &(scene->faces[scene->faceCount]);
+  face->normal = normal;
+  face->offset = -Vec3_dot(&normal, &center);
+  return scene->faceCount++;
+}
+
+/**
+ * Records that the face is next to the edge, the dihedral of the edge is
+ * computed once it has two faces
+ */
+void Scene_attachFace(Scene* scene, long int edge, long int face) {
+  if (edge < 0 || face == 0) return;
+  EdgeFaces* faces = &(scene->edgeFaces[edge]);
+  if (faces->a == 0) {
+    faces->a = face;
+  } else if (faces->b == 0) {
+    faces->b = face;
+    scene->dihedral[edge] = Vec3_dot(&(scene->faces[faces->a].normal),
+                                     &(scene->faces[face].normal));
+  } else {
+    // Edges shared by more than two faces are always drawn
+    scene->dihedral[edge] = SCENE_OPEN_EDGE;
+  }
+}
+
+/**
+ * Starts a new object, the geometry added from now on belongs to it
+ * The last object is reused if nothing was added to it (an o record is often
+ * followed by a g record)
+ */
+void Scene_beginObject(Scene* scene) {
+  SceneObject* object = NULL;
+  if (scene->objectCount > 0) {
+    object = &scene->objects[scene->objectCount - 1];
+    if (object->vertexEnd > object->vertexBegin) object = NULL;
+  }
+  if (object == NULL) {
+    if (scene->objectCount == scene->allocatedObjects) {
+      long int allocate = scene->allocatedObjects * 2;
+      if (allocate < 16) allocate = 16;
+      scene->objects = (SceneObject*)realloc(scene->objects,
+                                             allocate * sizeof(SceneObject));
+      scene->allocatedObjects = allocate;
     }
-    // If the line starts with the letter v, then it contains a vertex
-    if (line[0] == 'v' && line[1] == ' ') {
-      // If running out of allocated memory for vertices then allocate more for
-      // them, copy the already read data to the new location and free the old
-      // pointer
-      if ((scene->verticesCount) >= (allocatedVertices - 16)) {
-        Vec3* old = scene->vertices;
-        scene->vertices = (Vec3*)malloc(2 * allocatedVertices * sizeof(Vec3));
-        memcpy(scene->vertices, old, allocatedVertices * sizeof(Vec3));
-        free(old);
-        allocatedVertices *= 2;
-      }
-      // Read vertex
-      double x, y, z;
-      char *nextPtr, *currPtr;
-      currPtr = &(line[2]);
-      // Strod is used to read and convert to double the three consecutive
-      // coordinates after the letter v divided by spaces
-      x = strtod(currPtr, &nextPtr);
-      currPtr = nextPtr;
-      y = strtod(currPtr, &nextPtr);
-      currPtr = nextPtr;
-      z = strtod(currPtr, &nextPtr);
-      // Push the vertex to the list
-      scene->vertices[scene->verticesCount++] = Vec3_new(x, y, z);
+    object = &scene->objects[scene->objectCount++];
+  }
+  object->vertexBegin = object->vertexEnd = scene->verticesCount;
+  object->edgeBegin = object->edgeEnd = scene->edgeCount;
+  object->min = Vec3_new(INFINITY, INFINITY, INFINITY);
+  object->max = Vec3_new(-INFINITY, -INFINITY, -INFINITY);
+  object->center = Vec3_new(0, 0, 0);
+  object->radius = 0;
+}
+
+/**
+ * Adds a vertex to the vertex range and the bounds of the current object
+ * Called for the vertices of the object and for the endpoints of its edges,
+ * which may belong to earlier objects
+ */
+void Scene_extendObject(Scene* scene, long int vertex) {
+  Scene_growObject(scene, &scene->objects[scene->objectCount - 1], vertex);
+}
+
+/**
+ * Adds a vertex to the vertex range and the bounds of the given object
+ */
+void Scene_growObject(Scene* scene, SceneObject* object, long int vertex) {
+  if (object->vertexEnd == object->vertexBegin) {
+    object->vertexBegin = vertex;
+    object->vertexEnd = vertex + 1;
+  }
+  if (vertex < object->vertexBegin) object->vertexBegin = vertex;
+  if (vertex >= object->vertexEnd) object->vertexEnd = vertex + 1;
+  Vec3* v = &(scene->vertices[vertex]);
+  Vec3 *min = &(object->min), *max = &(object->max);
+  *min = Vec3_new(fmin(min->x, v->x), fmin(min->y, v->y), fmin(min->z, v->z));
+  *max = Vec3_new(fmax(max->x, v->x), fmax(max->y, v->y), fmax(max->z, v->z));
+  Vec3 diagonal = Vec3_copy(max);
+  Vec3_sub(&diagonal, min);
+  object->center = Vec3_copy(min);
+  Vec3_mult(&diagonal, 0.5);
+  Vec3_add(&(object->center), &diagonal);
+  object->radius = Vec3_length(&diagonal);
+}
+
+/**
+ * Merges the vertices closer to each other than epsilon (with epsilon 0 only
+ * the ones at the exact same position), then remaps the edges to the merged
+ * vertices and removes the edges that became duplicates or collapsed to a
+ * point
+ * Exporters often repeat the vertices of every face or UV seam, which would
+ * be projected and have their edges drawn more than once. The faces of the
+ * merged edges are combined, so edges along seams get their dihedral
+ * The vertices are looked up in a spatial hash of cells of size epsilon, only
+ * the cells next to the cell of a vertex are searched
+ * Called once the scene is loaded, returns the number of vertices removed
+ */
+long int Scene_weld(Scene* scene, double epsilon) {
+  return Scene_weldRange(scene, epsilon, 0);
+}
+
+/**
+ * Welds the vertices from the first one on like Scene_weld, only among each
+ * other, the vertices before them keep their place and are not merged
+ * Used by loaders adding a file to a scene that may already have geometry
+ */
+long int Scene_weldRange(Scene* scene, double epsilon, long int first) {
+  long int count = scene->verticesCount;
+  if (first >= count || epsilon < 0) return 0;
+  long int size = 1024;
+  while (size < (count - first) * 2) size *= 2;
+  long int* cells = (long int*)malloc(size * sizeof(long int));
+  long int* next = (long int*)malloc(count * sizeof(long int));
+  long int* remap = (long int*)malloc(count * sizeof(long int));
+  bool* kept = (bool*)malloc(count * sizeof(bool));
+  for (long int i = 0; i < size; i++) cells[i] = -1;
+  for (long int i = 0; i < first; i++) {
+    remap[i] = i;
+    kept[i] = true;
+  }
+
+  // The kept vertices are moved to the front of the array as they are found,
+  // the buckets chain their new indices
+  Vec3* vertices = scene->vertices;
+  double scale = epsilon > 0 ? 1 / epsilon : 0;
+  int reach = epsilon > 0 ? 1 : 0;
+  long int weldedCount = first;
+  for (long int i = first; i < count; i++) {
+    Vec3 v = vertices[i];
+    long long x = Scene_weldCell(v.x, scale), y = Scene_weldCell(v.y, scale),
+              z = Scene_weldCell(v.z, scale);
+    long int match = -1;
+    for (int dx = -reach; dx <= reach && match < 0; dx++)
+      for (int dy = -reach; dy <= reach && match < 0; dy++)
+        for (int dz = -reach; dz <= reach && match < 0; dz++) {
+          long int j = cells[Scene_hashCell(x + dx, y + dy, z + dz, size)];
+          for (; j >= 0 && match < 0; j = next[j]) {
+            Vec3 d = Vec3_new(v.x - vertices[j].x, v.y - vertices[j].y,
+                              v.z - vertices[j].z);
+            if (Vec3_sqLength(&d) <= epsilon * epsilon) match = j;
+          }
+        }
+    kept[i] = match < 0;
+    if (match >= 0) {
+      remap[i] = match;
+      continue;
     }
-    // If the line starts with the letter f, it contains a polygon
-    // It lists the indices for the vertices of the polygon
-    else if (line[0] == 'f' && line[1] == ' ') {
-      // Allocate more memory if running out of space
-      if ((scene->edgeCount) >= (allocatedEdges - 32)) {
-        Edge* old = scene->edges;
-        scene->edges = (Edge*)malloc(2 * allocatedEdges * sizeof(Edge));
-        memcpy(scene->edges, old, allocatedEdges * sizeof(Edge));
-        free(old);
-        allocatedEdges *= 2;
-      }
-      // Read polygon
-      long int vertexNumbers[32];
-      int vCount = 0;
-      // Read and push all edges of the poligon to the edge array while making
-      // sure to exclude duplicates
-      readVertexNumbers(&(line[2]), vertexNumbers, &vCount);
-      for (int i = 1; i < vCount; i++) {
-        pushEdgeNoDuplicates(scene, vertexNumbers[i - 1] - 1,
-                             vertexNumbers[i] - 1);
+    long int* cell = &cells[Scene_hashCell(x, y, z, size)];
+    vertices[weldedCount] = v;
+    next[weldedCount] = *cell;
+    *cell = weldedCount;
+    remap[i] = weldedCount++;
+  }
+
+  free(cells);
+  free(next);
+  // The objects holding vertices of the range are merged
+  long int firstObject = scene->objectCount;
+  while (firstObject > 0 && scene->objects[firstObject - 1].vertexEnd > first)
+    firstObject--;
+  Scene_mergeEdges(scene, firstObject, remap, kept);
+  free(remap);
+  free(kept);
+  scene->verticesCount = weldedCount;
+  // The single precision vertices are converted again
+  scene->localCount = 0;
+  return count - weldedCount;
+}
+
+/**
+ * Maps the endpoints of the edges to new vertices, then removes the edges
+ * that became duplicates or collapsed to a point, the faces of the removed
+ * duplicates are attached to the edge that is kept
+ * The vertex ranges and bounds of the objects are rebuilt from the vertices
+ * kept and the endpoints of their edges
+ * Without a remap the vertices stay in place and only the duplicate edges
+ * are removed, for loaders that add the edges of every face without looking
+ * for duplicates
+ * Only the objects from firstObject on are merged, the ones before it are
+ * left as they are (the remap has to keep their vertices in place)
+ */
+void Scene_mergeEdges(Scene* scene, long int firstObject,
+                      const long int* remap, const bool* kept) {
+  if (firstObject >= scene->objectCount) return;
+  // The edges are remapped object by object, so they stay in the ranges of
+  // their objects, and looked up in a hash table of the kept edges
+  long int edgeCount = scene->objects[firstObject].edgeBegin;
+  long int size = 1024;
+  while (size < (scene->edgeCount - edgeCount) * 2) size *= 2;
+  long int* cells = (long int*)malloc(size * sizeof(long int));
+  for (long int i = 0; i < size; i++) cells[i] = -1;
+  for (long int o = firstObject; o < scene->objectCount; o++) {
+    SceneObject* object = &scene->objects[o];
+    long int vertexBegin = object->vertexBegin, vertexEnd = object->vertexEnd;
+    long int edgeBegin = object->edgeBegin, edgeEnd = object->edgeEnd;
+    object->vertexBegin = object->vertexEnd = 0;
+    object->min = Vec3_new(INFINITY, INFINITY, INFINITY);
+    object->max = Vec3_new(-INFINITY, -INFINITY, -INFINITY);
+    for (long int i = vertexBegin; i < vertexEnd; i++)
+      if (kept == NULL || kept[i])
+        Scene_growObject(scene, object, remap != NULL ? remap[i] : i);
+
+    object->edgeBegin = edgeCount;
+    for (long int i = edgeBegin; i < edgeEnd; i++) {
+      long int a = scene->edges[i].a, b = scene->edges[i].b;
+      if (remap != NULL) {
+        a = remap[a];
+        b = remap[b];
       }
-      pushEdgeNoDuplicates(scene, vertexNumbers[0] - 1,
-                           vertexNumbers[vCount - 1] - 1);
-    }
-    // It is not commonly used but obj files can also contain 'polylines'
-    // They are pretty much handled the same way as polygons except that there
-    // does not have to be an edge between the last and the firs polyon
-    else if (line[0] == 'l' && line[1] == ' ') {
-      // Allocate more memory if running out of space
-      if ((scene->edgeCount) >= (allocatedEdges - 64)) {
-        Edge* old = scene->edges;
-        scene->edges = (Edge*)malloc(2 * allocatedEdges * sizeof(Edge));
-        memcpy(scene->edges, old, allocatedEdges * sizeof(Edge));
-        free(old);
-        allocatedEdges *= 2;
+      if (a == b) continue;
+      if (a > b) {
+        long int swap = b;
+        b = a;
+        a = swap;
       }
-      // Read polyline
-      long int vertexNumbers[64];
-      int vCount = 0;
-      readVertexNumbers(&(line[2]), vertexNumbers, &vCount);
-      for (int i = 1; i < vCount; i++) {
-        pushEdgeNoDuplicates(scene, vertexNumbers[i - 1] - 1,
-                             vertexNumbers[i] - 1);
+      long int slot = Scene_hashCell(a, b, 0, size), k;
+      while ((k = cells[slot]) >= 0 &&
+             (scene->edges[k].a != a || scene->edges[k].b != b))
+        slot = (slot + 1) & (size - 1);
+      if (k >= 0) {
+        EdgeFaces faces = scene->edgeFaces[i];
+        Scene_attachFace(scene, k, faces.a);
+        Scene_attachFace(scene, k, faces.b);
+        if (scene->dihedral[i] == SCENE_OPEN_EDGE && faces.b != 0)
+          scene->dihedral[k] = SCENE_OPEN_EDGE;
+        continue;
       }
+      scene->edges[edgeCount] = Edge_new(a, b);
+      scene->edgeFaces[edgeCount] = scene->edgeFaces[i];
+      scene->dihedral[edgeCount] = scene->dihedral[i];
+      cells[slot] = edgeCount++;
+      Scene_growObject(scene, object, a);
+      Scene_growObject(scene, object, b);
     }
+    object->edgeEnd = edgeCount;
   }
 
-  // Allocate enough memory for the projected points as well
-  scene->projectedPoints = (Point*)malloc(allocatedVertices * sizeof(Point));
+  free(cells);
+  scene->edgeCount = edgeCount;
+  Scene_markChanged(scene);
+}
+
+/**
+ * Returns the coordinate of the cell of the spatial hash the value is in, or
+ * the bits of the value if the scale is 0 (only equal values are welded)
+ */
+long long Scene_weldCell(double value, double scale) {
+  if (scale == 0) {
+    long long bits;
+    value += 0.0;  // Turns -0 into 0
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+  double cell = floor(value * scale);
+  if (!(cell > -1e18)) return (long long)-1e18;
+  if (cell > 1e18) return (long long)1e18;
+  return (long long)cell;
+}
+
+/**
+ * Returns the bucket of a cell in a hash table of the given size (a power of
+ * two)
+ * The products only carry bits upwards, so the high bits are mixed down
+ * before masking, the bits of whole numbers as doubles differ only there
+ */
+long int Scene_hashCell(long long x, long long y, long long z, long int size) {
+  unsigned long long hash = (unsigned long long)x * 0x9E3779B97F4A7C15ULL ^
+                            (unsigned long long)y * 0xC2B2AE3D27D4EB4FULL ^
+                            (unsigned long long)z * 0x165667B19E3779F9ULL;
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  return (long int)(hash & (unsigned long long)(size - 1));
+}
 
-  fclose(filePointer);
+/**
+ * Processes one line of a Wawefront .obj file and adds the geometry it
+ * describes to the scene
+ * Used by both the file loader and the incremental parser
+ */
+void Scene_parseObjLine(Scene* scene, char* line) {
+  // Skip empty lines
+  if (line[0] == '\0' || line[0] == '\n') {
+    return;
+  }
+  // If the line starts with the letter v, then it contains a vertex
+  if (line[0] == 'v' && line[1] == ' ') {
+    // Read vertex
+    double x, y, z;
+    char *nextPtr, *currPtr;
+    currPtr = &(line[2]);
+    // Strod is used to read and convert to double the three consecutive
+    // coordinates after the letter v divided by spaces
+    x = strtod(currPtr, &nextPtr);
+    currPtr = nextPtr;
+    y = strtod(currPtr, &nextPtr);
+    currPtr = nextPtr;
+    z = strtod(currPtr, &nextPtr);
+    // Push the vertex to the list
+    Scene_pushVertex(scene, Vec3_new(x, y, z));
+  }
+  // Objects and groups start a new object, the edges in them can be culled
+  // together
+  else if ((line[0] == 'o' || line[0] == 'g') &&
+           (line[1] == ' ' || line[1] == '\0' || line[1] == '\n' ||
+            line[1] == '\r')) {
+    Scene_beginObject(scene);
+  }
+  // If the line starts with the letter f, it contains a polygon
+  // It lists the indices for the vertices of the polygon
+  else if (line[0] == 'f' && line[1] == ' ') {
+    // Read polygon
+    long int vertexNumbers[32];
+    int vCount = 0;
+    // Read and push all edges of the poligon to the edge array while making
+    // sure to exclude duplicates
+    readVertexNumbers(&(line[2]), vertexNumbers, &vCount, 32);
+    if (vCount == 0) return;
+    // The faces next to every edge are kept for finding silhouettes
+    long int face = Scene_pushFace(scene, vertexNumbers, vCount);
+    for (int i = 1; i < vCount; i++) {
+      long int edge = pushEdgeNoDuplicates(scene, vertexNumbers[i - 1] - 1,
+                                           vertexNumbers[i] - 1);
+      Scene_attachFace(scene, edge, face);
+    }
+    long int edge = pushEdgeNoDuplicates(scene, vertexNumbers[0] - 1,
+                                         vertexNumbers[vCount - 1] - 1);
+    Scene_attachFace(scene, edge, face);
+  }
+  // It is not commonly used but obj files can also contain 'polylines'
+  // They are pretty much handled the same way as polygons except that there
+  // does not have to be an edge between the last and the firs polyon
+  else if (line[0] == 'l' && line[1] == ' ') {
+    // Read polyline
+    long int vertexNumbers[64];
+    int vCount = 0;
+    readVertexNumbers(&(line[2]), vertexNumbers, &vCount, 64);
+    for (int i = 1; i < vCount; i++) {
+      pushEdgeNoDuplicates(scene, vertexNumbers[i - 1] - 1,
+                           vertexNumbers[i] - 1);
+    }
+  }
 }
 
 /**
@@ -155,8 +1156,22 @@ void Scene_loadObj(Scene* scene, const char* fileName) {
  */
 void Scene_free(Scene* scene) {
   free(scene->vertices);
+  free(scene->localX);
+  free(scene->localY);
+  free(scene->localZ);
   free(scene->edges);
+  free(scene->edgeFaces);
+  free(scene->dihedral);
+  free(scene->faces);
+  free(scene->facing);
   free(scene->projectedPoints);
+  free(scene->visibility);
+  free(scene->visibleEdges);
+  free(scene->pixels);
+  free(scene->pixelMask);
+  free(scene->objects);
+  free(scene->visibleObjects);
+  free(scene->ranges);
   Scene_erase(scene);
 }
 
@@ -164,9 +1179,18 @@ void Scene_free(Scene* scene) {
  * Returns the distance to the origo from the furthest point in the scene
  */
 double Scene_radius(Scene* scene) {
+  return Scene_rangeRadius(scene, 0, scene->verticesCount);
+}
+
+/**
+ * Returns the distance to the origo from the furthest of the vertices with
+ * indices in [begin, end)
+ * Used for updating the radius while the scene is being loaded
+ */
+double Scene_rangeRadius(Scene* scene, long int begin, long int end) {
   double max = 0;
 
-  for (int i = 0; i < scene->verticesCount; i++) {
+  for (long int i = begin; i < end; i++) {
     Vec3* v = &(scene->vertices[i]);
     double r = v->x * v->x + v->y * v->y + v->z * v->z;
     max = max < r ? r : max;
@@ -178,8 +1202,11 @@ double Scene_radius(Scene* scene) {
 /**
  * Function for loading any number of integers inside a string divided by spaces
  * to the array at vertexList
+ * At most maxCount numbers are read
  */
-void readVertexNumbers(char* str, long int* vertexList, int* vertexCount) {
+void readVertexNumbers(char* str, long int* vertexList, int* vertexCount,
+                       int maxCount) {
+  if (maxCount <= 0) return;
   char* current = str;
   char* next;
   vertexList[0] = strtol(current, &next, 10);
@@ -193,20 +1220,41 @@ void readVertexNumbers(char* str, long int* vertexList, int* vertexCount) {
     current = &(current[1]);
     if (*current == '\n' || *current == '\0') return;
   }
-  readVertexNumbers(current, &(vertexList[1]), vertexCount);
+  readVertexNumbers(current, &(vertexList[1]), vertexCount, maxCount - 1);
 }
 
 /**
  * Pushes an edge to the array of edges if it is not a duplicate
+ * Edges referring to vertices that do not exist (yet) are skipped
+ * Returns the index of the new or the already existing edge, -1 if skipped
  */
-void pushEdgeNoDuplicates(Scene* scene, long a, long b) {
+long int pushEdgeNoDuplicates(Scene* scene, long a, long b) {
+  if (a < 0 || b < 0 || a >= scene->verticesCount || b >= scene->verticesCount)
+    return -1;
   if (a > b) {
     int swap = b;
     b = a;
     a = swap;
   }
   for (long i = scene->edgeCount - 1; i >= 0; i--) {
-    if (scene->edges[i].a == a && scene->edges[i].b == b) return;
+    if (scene->edges[i].a == a && scene->edges[i].b == b) return i;
   }
-  scene->edges[scene->edgeCount++] = Edge_new(a, b);
+  return Scene_appendEdge(scene, a, b);
+}
+
+/**
+ * Adds an edge to the end of the edge array and to the current object without
+ * looking for duplicates, the endpoints have to exist
+ * Returns the index of the new edge
+ */
+long int Scene_appendEdge(Scene* scene, long int a, long int b) {
+  Scene_reserveEdges(scene, scene->edgeCount + 1);
+  long int index = scene->edgeCount++;
+  scene->edges[index] = Edge_new(a, b);
+  scene->edgeFaces[index].a = scene->edgeFaces[index].b = 0;
+  scene->dihedral[index] = SCENE_OPEN_EDGE;
+  scene->objects[scene->objectCount - 1].edgeEnd = scene->edgeCount;
+  Scene_extendObject(scene, a);
+  Scene_extendObject(scene, b);
+  return index;
 }
\ No newline at end of file
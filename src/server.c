@@ -0,0 +1,696 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <server.h>
+
+/**
+ * Loads the scenes and serves the requests coming on the socket until the
+ * process is killed
+ * Returns false if a scene could not be loaded, the socket could not be
+ * opened or polling it failed
+ */
+bool Server_run(const char* socketPath, char** fileNames, int sceneCount) {
+#ifndef SERVER_SUPPORTED
+  fprintf(stderr, "The render server needs Unix domain sockets\n");
+  return false;
+#else
+  Server server;
+  server.workers = WorkerPool_create(WorkerPool_defaultSize());
+  server.scenes = (Scene*)malloc(sceneCount * sizeof(Scene));
+  server.radii = (double*)malloc(sceneCount * sizeof(double));
+  server.batches = (Batch**)malloc(sceneCount * sizeof(Batch*));
+  server.sceneCount = 0;
+  server.listener = -1;
+  bool loaded = true;
+  for (int i = 0; i < sceneCount && loaded; i++) {
+    Scene* scene = &server.scenes[i];
+    Scene_init(scene, server.workers);
+    MeshFile_load(scene, fileNames[i]);
+    server.radii[i] = Scene_radius(scene);
+    server.batches[i] = Batch_create(scene, NULL, 0);
+    server.sceneCount++;
+    loaded = scene->verticesCount > 0;
+    if (loaded)
+      printf("Scene %d: %s, %ld vertices, %ld edges\n", i, fileNames[i],
+             scene->verticesCount, scene->edgeCount);
+    else
+      fprintf(stderr, "Could not load %s\n", fileNames[i]);
+  }
+  if (loaded) {
+    server.listener = Server_listen(socketPath);
+    if (server.listener < 0)
+      fprintf(stderr, "Could not listen on %s\n", socketPath);
+  }
+  if (server.listener < 0 || pipe(server.wake) != 0) {
+    for (int i = 0; i < server.sceneCount; i++) {
+      Batch_free(server.batches[i]);
+      Scene_free(&server.scenes[i]);
+    }
+    if (server.listener >= 0) close(server.listener);
+    free(server.scenes);
+    free(server.radii);
+    free(server.batches);
+    WorkerPool_destroy(server.workers);
+    return false;
+  }
+
+  fcntl(server.wake[0], F_SETFL, O_NONBLOCK);
+  fcntl(server.wake[1], F_SETFL, O_NONBLOCK);
+  // Writing to a client that went away fails instead of killing the server
+  signal(SIGPIPE, SIG_IGN);
+  server.connections = NULL;
+  server.connectionCount = 0;
+  server.allocatedConnections = 0;
+  server.nextId = 1;
+  memset(&server.pending, 0, sizeof(ServerQueue));
+  memset(&server.done, 0, sizeof(ServerQueue));
+  memset(&server.batch, 0, sizeof(ServerQueue));
+  server.quit = false;
+  pthread_mutex_init(&server.lock, NULL);
+  pthread_cond_init(&server.jobsAvailable, NULL);
+  pthread_create(&server.renderThread, NULL, Server_renderThread, &server);
+  printf("Listening on %s\n", socketPath);
+  fflush(stdout);
+
+  // The I/O loop, the first two descriptors are the listener and the pipe
+  struct pollfd* fds = NULL;
+  int allocatedFds = 0;
+  ServerQueue received = {NULL, 0, 0}, replies = {NULL, 0, 0};
+  while (true) {
+    int count = server.connectionCount + 2;
+    if (count > allocatedFds) {
+      allocatedFds = count * 2;
+      fds = (struct pollfd*)realloc(fds, allocatedFds * sizeof(struct pollfd));
+    }
+    fds[0].fd = server.listener;
+    fds[1].fd = server.wake[0];
+    fds[0].events = fds[1].events = POLLIN;
+    for (int i = 0; i < server.connectionCount; i++) {
+      ServerConnection* connection = &server.connections[i];
+      short events = 0;
+      if (Server_canRead(connection)) events |= POLLIN;
+      if (connection->outSent < connection->outSize) events |= POLLOUT;
+      // Clients waiting for replies are left out, a hung up socket would
+      // wake the loop up all the time
+      fds[i + 2].fd = events != 0 ? connection->socket : -1;
+      fds[i + 2].events = events;
+    }
+    for (int i = 0; i < count; i++) fds[i].revents = 0;
+    if (poll(fds, count, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char drain[64];
+      while (read(server.wake[0], drain, sizeof(drain)) > 0) continue;
+      Server_collectReplies(&server, &replies);
+    }
+    received.count = 0;
+    for (int i = 0; i < server.connectionCount; i++) {
+      if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))
+        Server_read(&server, &server.connections[i], &received);
+    }
+    if (received.count > 0) {
+      pthread_mutex_lock(&server.lock);
+      for (long int i = 0; i < received.count; i++)
+        Server_push(&server.pending, &received.jobs[i]);
+      pthread_cond_signal(&server.jobsAvailable);
+      pthread_mutex_unlock(&server.lock);
+    }
+    for (int i = 0; i < server.connectionCount; i++) {
+      ServerConnection* connection = &server.connections[i];
+      Server_write(connection);
+      if (connection->closed && connection->inFlight == 0 &&
+          connection->outSent == connection->outSize) {
+        close(connection->socket);
+        free(connection->out);
+        *connection = server.connections[--server.connectionCount];
+        i--;
+      }
+    }
+    if (fds[0].revents & POLLIN) Server_accept(&server);
+  }
+
+  pthread_mutex_lock(&server.lock);
+  server.quit = true;
+  pthread_cond_signal(&server.jobsAvailable);
+  pthread_mutex_unlock(&server.lock);
+  pthread_join(server.renderThread, NULL);
+  for (int i = 0; i < server.connectionCount; i++) {
+    close(server.connections[i].socket);
+    free(server.connections[i].out);
+  }
+  for (long int i = 0; i < server.done.count; i++)
+    free(server.done.jobs[i].reply);
+  close(server.listener);
+  close(server.wake[0]);
+  close(server.wake[1]);
+  unlink(socketPath);
+  free(fds);
+  free(received.jobs);
+  free(replies.jobs);
+  free(server.pending.jobs);
+  free(server.done.jobs);
+  free(server.batch.jobs);
+  free(server.connections);
+  for (int i = 0; i < server.sceneCount; i++) {
+    Batch_free(server.batches[i]);
+    Scene_free(&server.scenes[i]);
+  }
+  free(server.scenes);
+  free(server.radii);
+  free(server.batches);
+  pthread_mutex_destroy(&server.lock);
+  pthread_cond_destroy(&server.jobsAvailable);
+  WorkerPool_destroy(server.workers);
+  return false;
+#endif
+}
+
+#ifdef SERVER_SUPPORTED
+
+/**
+ * Creates the listening socket at the given path, a socket file left there
+ * by a server that was killed is removed
+ * Returns -1 on failure or if a running server listens on the path
+ */
+int Server_listen(const char* socketPath) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(socketPath) >= sizeof(address.sun_path)) return -1;
+  strcpy(address.sun_path, socketPath);
+
+  // The socket file is only taken over if no server answers on it
+  struct stat info;
+  if (stat(socketPath, &info) == 0 && S_ISSOCK(info.st_mode)) {
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool running = probe >= 0 && connect(probe, (struct sockaddr*)&address,
+                                         sizeof(address)) == 0;
+    if (probe >= 0) close(probe);
+    if (running) {
+      fprintf(stderr, "A server is already running on %s\n", socketPath);
+      return -1;
+    }
+    unlink(socketPath);
+  }
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) return -1;
+  if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      listen(listener, 64) != 0) {
+    close(listener);
+    return -1;
+  }
+  fcntl(listener, F_SETFL, O_NONBLOCK);
+  return listener;
+}
+
+/**
+ * Accepts the clients waiting on the listening socket
+ */
+void Server_accept(Server* server) {
+  while (true) {
+    int client = accept(server->listener, NULL, NULL);
+    if (client < 0) return;
+    fcntl(client, F_SETFL, O_NONBLOCK);
+    if (server->connectionCount == server->allocatedConnections) {
+      int allocate = server->allocatedConnections * 2;
+      if (allocate < 16) allocate = 16;
+      server->connections = (ServerConnection*)realloc(
+          server->connections, allocate * sizeof(ServerConnection));
+      server->allocatedConnections = allocate;
+    }
+    ServerConnection* connection =
+        &server->connections[server->connectionCount++];
+    connection->socket = client;
+    connection->id = server->nextId++;
+    connection->received = 0;
+    connection->out = NULL;
+    connection->outSize = connection->outSent = connection->allocatedOut = 0;
+    connection->inFlight = 0;
+    connection->closed = false;
+  }
+}
+
+/**
+ * Returns true if more requests are taken from the client: it is still
+ * sending and it is not too far behind with reading the replies
+ */
+bool Server_canRead(ServerConnection* connection) {
+  return !connection->closed &&
+         connection->inFlight < SERVER_MAX_IN_FLIGHT &&
+         connection->outSize - connection->outSent < SERVER_MAX_OUTPUT;
+}
+
+/**
+ * Reads what the client sent, the complete requests are validated and added
+ * to the received jobs
+ * The connection is marked closed when the client stops sending
+ */
+void Server_read(Server* server, ServerConnection* connection,
+                 ServerQueue* received) {
+  while (Server_canRead(connection)) {
+    ssize_t count = recv(connection->socket,
+                         &connection->request[connection->received],
+                         sizeof(ServerRequest) - connection->received, 0);
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) {
+      connection->closed = true;
+      return;
+    }
+    connection->received += count;
+    if (connection->received < sizeof(ServerRequest)) continue;
+
+    ServerJob job;
+    memcpy(&job.request, connection->request, sizeof(ServerRequest));
+    job.status = Server_validate(server, &job.request);
+    job.connection = connection->id;
+    job.frame = NULL;
+    job.reply = NULL;
+    job.replySize = 0;
+    Server_push(received, &job);
+    connection->received = 0;
+    connection->inFlight++;
+  }
+}
+
+/**
+ * Sends as much of the waiting replies as the socket takes without blocking
+ * If the client went away the replies are dropped
+ */
+void Server_write(ServerConnection* connection) {
+  while (connection->outSent < connection->outSize) {
+    ssize_t count = send(connection->socket,
+                         &connection->out[connection->outSent],
+                         connection->outSize - connection->outSent, 0);
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    if (count < 0 && errno == EINTR) continue;
+    if (count < 0) {
+      connection->closed = true;
+      break;
+    }
+    connection->outSent += count;
+  }
+  connection->outSent = connection->outSize = 0;
+}
+
+/**
+ * Moves the replies finished by the render thread to the output of their
+ * clients, the queue given is swapped with the finished one so the lock is
+ * only held for the swap
+ */
+void Server_collectReplies(Server* server, ServerQueue* replies) {
+  replies->count = 0;
+  pthread_mutex_lock(&server->lock);
+  ServerQueue done = server->done;
+  server->done = *replies;
+  *replies = done;
+  pthread_mutex_unlock(&server->lock);
+
+  for (long int i = 0; i < replies->count; i++) {
+    ServerJob* job = &replies->jobs[i];
+    ServerConnection* connection =
+        Server_findConnection(server, job->connection);
+    if (connection != NULL) {
+      Server_compact(connection);
+      Server_append(&connection->out, &connection->outSize,
+                    &connection->allocatedOut, job->reply, job->replySize);
+      connection->inFlight--;
+    }
+    free(job->reply);
+  }
+}
+
+/**
+ * Moves the replies not sent yet to the front of the output of the client,
+ * so the buffer only grows with what a slow client has not read yet
+ */
+void Server_compact(ServerConnection* connection) {
+  if (connection->outSent == 0) return;
+  memmove(connection->out, &connection->out[connection->outSent],
+          connection->outSize - connection->outSent);
+  connection->outSize -= connection->outSent;
+  connection->outSent = 0;
+}
+
+/**
+ * Returns the connection with the given id, NULL if it was closed since
+ */
+ServerConnection* Server_findConnection(Server* server, unsigned long id) {
+  for (int i = 0; i < server->connectionCount; i++)
+    if (server->connections[i].id == id) return &server->connections[i];
+  return NULL;
+}
+
+/**
+ * Checks the values of a request, returns the status of its reply
+ */
+uint32_t Server_validate(Server* server, ServerRequest* request) {
+  if (request->scene >= (uint32_t)server->sceneCount)
+    return SERVER_UNKNOWN_SCENE;
+  if (request->width < 1 || request->height < 1 ||
+      request->width > SERVER_MAX_SIZE || request->height > SERVER_MAX_SIZE)
+    return SERVER_INVALID_SIZE;
+  if (request->format != SERVER_FORMAT_RAW &&
+      request->format != SERVER_FORMAT_PNG)
+    return SERVER_INVALID_FORMAT;
+
+  for (int i = 0; i < 3; i++)
+    if (!isfinite(request->pos[i]) || !isfinite(request->look[i]) ||
+        !isfinite(request->up[i]))
+      return SERVER_INVALID_CAMERA;
+  if (!(request->hFov > 0 && request->hFov < M_PI && request->vFov > 0 &&
+        request->vFov < M_PI))
+    return SERVER_INVALID_CAMERA;
+  // The look direction can not be parallel to the up direction
+  Camera cam = Server_camera(server, request);
+  Vec3 side = Vec3_cross(&cam.lookDirection, &cam.up);
+  if (!(Vec3_sqLength(&side) > 0)) return SERVER_INVALID_CAMERA;
+  return SERVER_OK;
+}
+
+/**
+ * Returns the camera of a request
+ */
+Camera Server_camera(Server* server, ServerRequest* request) {
+  Vec3 pos = Vec3_new(request->pos[0], request->pos[1], request->pos[2]);
+  if (request->flags & SERVER_POSE_RELATIVE)
+    Vec3_mult(&pos, server->radii[request->scene]);
+  Vec3 up = Vec3_new(request->up[0], request->up[1], request->up[2]);
+  if (Vec3_sqLength(&up) == 0) up = Vec3_new(0, 1, 0);
+  Vec3_setLength(&up, 1);
+  Vec3 look = Vec3_new(request->look[0], request->look[1], request->look[2]);
+  Camera cam = Camera_new(pos, up, request->width, request->height,
+                          request->hFov, request->vFov);
+  Camera_setLookDirection(&cam, &look);
+  return cam;
+}
+
+/**
+ * The render thread: takes the oldest waiting requests as a batch, renders
+ * them and hands the replies over to the I/O thread
+ */
+void* Server_renderThread(void* _server) {
+  Server* server = (Server*)_server;
+  pthread_mutex_lock(&server->lock);
+  while (true) {
+    while (server->pending.count == 0 && !server->quit)
+      pthread_cond_wait(&server->jobsAvailable, &server->lock);
+    if (server->quit) break;
+    long int count = server->pending.count < SERVER_MAX_BATCH
+                         ? server->pending.count
+                         : SERVER_MAX_BATCH;
+    server->batch.count = 0;
+    for (long int i = 0; i < count; i++)
+      Server_push(&server->batch, &server->pending.jobs[i]);
+    server->pending.count -= count;
+    memmove(server->pending.jobs, &server->pending.jobs[count],
+            server->pending.count * sizeof(ServerJob));
+    pthread_mutex_unlock(&server->lock);
+
+    Server_renderBatch(server);
+
+    pthread_mutex_lock(&server->lock);
+    for (long int i = 0; i < server->batch.count; i++)
+      Server_push(&server->done, &server->batch.jobs[i]);
+    // A full pipe already has a wake up waiting in it
+    if (write(server->wake[1], "", 1) < 0) continue;
+  }
+  pthread_mutex_unlock(&server->lock);
+  return NULL;
+}
+
+/**
+ * Renders the valid requests of the batch with the batch of their scene, then
+ * encodes the replies on the worker pool
+ */
+void Server_renderBatch(Server* server) {
+  ServerQueue* jobs = &server->batch;
+  for (int scene = 0; scene < server->sceneCount; scene++) {
+    int views = 0;
+    for (long int i = 0; i < jobs->count; i++)
+      views += jobs->jobs[i].status == SERVER_OK &&
+               jobs->jobs[i].request.scene == (uint32_t)scene;
+    if (views == 0) continue;
+
+    Batch* batch = server->batches[scene];
+    Batch_setViewCount(batch, views);
+    int view = 0;
+    for (long int i = 0; i < jobs->count; i++) {
+      ServerJob* job = &jobs->jobs[i];
+      if (job->status != SERVER_OK || job->request.scene != (uint32_t)scene)
+        continue;
+      Batch_setCamera(batch, view, Server_camera(server, &job->request));
+      job->frame = &batch->views[view++].target;
+    }
+    Batch_render(batch);
+  }
+  WorkerPool_run(server->workers, Server_encodeJob, server, jobs->count);
+}
+
+/**
+ * Job of the worker pool building the reply of the index-th request of the
+ * batch
+ */
+void Server_encodeJob(void* _server, int index) {
+  Server* server = (Server*)_server;
+  ServerJob* job = &server->batch.jobs[index];
+  ServerReply reply;
+  reply.status = job->status;
+  reply.format = job->request.format;
+  reply.width = job->request.width;
+  reply.height = job->request.height;
+  reply.tag = job->request.tag;
+  reply.size = 0;
+
+  const uint8_t* frame = NULL;
+  uint8_t* png = NULL;
+  if (job->status == SERVER_OK) {
+    Framebuffer* fb = job->frame;
+    size_t size = (size_t)fb->width * fb->height * 4;
+    frame = (const uint8_t*)fb->pixels;
+    if (job->request.format == SERVER_FORMAT_PNG) {
+      png = Png_encode(frame, fb->width, fb->height, &size);
+      frame = png;
+    }
+    reply.size = size;
+  }
+  job->replySize = sizeof(ServerReply) + reply.size;
+  job->reply = (uint8_t*)malloc(job->replySize);
+  memcpy(job->reply, &reply, sizeof(ServerReply));
+  if (reply.size > 0)
+    memcpy(&job->reply[sizeof(ServerReply)], frame, reply.size);
+  free(png);
+}
+
+/**
+ * Adds a copy of the job to the end of the queue
+ */
+void Server_push(ServerQueue* queue, ServerJob* job) {
+  if (queue->count == queue->allocated) {
+    long int allocate = queue->allocated * 2;
+    if (allocate < 16) allocate = 16;
+    queue->jobs =
+        (ServerJob*)realloc(queue->jobs, allocate * sizeof(ServerJob));
+    queue->allocated = allocate;
+  }
+  queue->jobs[queue->count++] = *job;
+}
+
+/**
+ * Appends the data to a growing buffer
+ */
+void Server_append(uint8_t** buffer, size_t* size, size_t* allocated,
+                   const uint8_t* data, size_t length) {
+  if (*size + length > *allocated) {
+    size_t allocate = *allocated * 2;
+    if (allocate < *size + length) allocate = *size + length;
+    *buffer = (uint8_t*)realloc(*buffer, allocate);
+    *allocated = allocate;
+  }
+  memcpy(&(*buffer)[*size], data, length);
+  *size += length;
+}
+
+#endif
+
+/**
+ * Load generator: sends the given number of requests for thumbnails of scene
+ * 0 on a number of connections, each keeping depth requests in flight, then
+ * prints the requests per second and the distribution of the latencies
+ * The camera goes around the scene a degree per request
+ * Returns false if the server could not be reached or a request failed
+ */
+bool Server_generateLoad(const char* socketPath, long int requests,
+                         int connections, int depth, uint32_t format,
+                         int size) {
+#ifndef SERVER_SUPPORTED
+  fprintf(stderr, "The load generator needs Unix domain sockets\n");
+  return false;
+#else
+  if (connections < 1) connections = 1;
+  if (depth < 1) depth = 1;
+  signal(SIGPIPE, SIG_IGN);
+  ServerClient* clients =
+      (ServerClient*)malloc(connections * sizeof(ServerClient));
+  pthread_t* threads = (pthread_t*)malloc(connections * sizeof(pthread_t));
+  double start = Bench_now();
+  for (int i = 0; i < connections; i++) {
+    ServerClient* client = &clients[i];
+    client->socketPath = socketPath;
+    client->requests = requests / connections + (i < requests % connections);
+    client->depth = depth;
+    client->format = format;
+    client->size = size;
+    client->latencies = (double*)malloc(client->requests * sizeof(double));
+    client->bytes = 0;
+    client->failed = false;
+    pthread_create(&threads[i], NULL, Server_clientThread, client);
+  }
+  for (int i = 0; i < connections; i++) pthread_join(threads[i], NULL);
+  double time = Bench_now() - start;
+
+  double* latencies = (double*)malloc(requests * sizeof(double));
+  long int count = 0;
+  uint64_t bytes = 0;
+  bool failed = false;
+  for (int i = 0; i < connections; i++) {
+    memcpy(&latencies[count], clients[i].latencies,
+           clients[i].requests * sizeof(double));
+    count += clients[i].requests;
+    bytes += clients[i].bytes;
+    failed |= clients[i].failed;
+    free(clients[i].latencies);
+  }
+  if (failed) {
+    fprintf(stderr, "Requests to %s failed\n", socketPath);
+  } else if (count > 0) {
+    qsort(latencies, count, sizeof(double), Server_compareTimes);
+    printf("%ld requests on %d connections, %d in flight on each: "
+           "%.1f requests/s, %.1f MB/s\n",
+           count, connections, depth, count / time, bytes / time / 1e6);
+    printf("latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           latencies[count / 2] * 1000, latencies[count * 9 / 10] * 1000,
+           latencies[count * 99 / 100] * 1000, latencies[count - 1] * 1000);
+  }
+  free(latencies);
+  free(clients);
+  free(threads);
+  return !failed;
+#endif
+}
+
+#ifdef SERVER_SUPPORTED
+
+/**
+ * Thread of one connection of the load generator, the latency of a request
+ * is measured from sending it to receiving the end of its reply
+ */
+void* Server_clientThread(void* _client) {
+  ServerClient* client = (ServerClient*)_client;
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, client->socketPath, sizeof(address.sun_path) - 1);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0 ||
+      connect(server, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    if (server >= 0) close(server);
+    client->failed = true;
+    return NULL;
+  }
+
+  double* sent = (double*)malloc(client->depth * sizeof(double));
+  uint8_t* frame = NULL;
+  size_t allocatedFrame = 0;
+  long int next = 0, finished = 0;
+  while (finished < client->requests && !client->failed) {
+    while (next < client->requests && next - finished < client->depth) {
+      ServerRequest request;
+      memset(&request, 0, sizeof(request));
+      request.width = request.height = client->size;
+      request.format = client->format;
+      request.flags = SERVER_POSE_RELATIVE;
+      request.tag = next;
+      double angle = 2 * M_PI * (next % 360) / 360;
+      Vec3 pos = Vec3_cylindrical(1, angle, 1 / 1.2);
+      request.pos[0] = pos.x;
+      request.pos[1] = pos.y;
+      request.pos[2] = pos.z;
+      request.look[0] = -pos.x;
+      request.look[1] = -pos.y;
+      request.look[2] = -pos.z;
+      request.hFov = request.vFov = 3.14 / 3;
+      sent[next % client->depth] = Bench_now();
+      if (!Server_sendAll(server, &request, sizeof(request))) break;
+      next++;
+    }
+
+    ServerReply reply;
+    client->failed = !Server_receiveAll(server, &reply, sizeof(reply)) ||
+                     reply.status != SERVER_OK ||
+                     reply.tag != (uint64_t)finished;
+    if (client->failed) break;
+    if (reply.size > allocatedFrame) {
+      allocatedFrame = reply.size;
+      frame = (uint8_t*)realloc(frame, allocatedFrame);
+    }
+    client->failed = !Server_receiveAll(server, frame, reply.size);
+    client->latencies[finished] = Bench_now() - sent[finished % client->depth];
+    client->bytes += reply.size;
+    finished++;
+  }
+
+  close(server);
+  free(sent);
+  free(frame);
+  return NULL;
+}
+
+/**
+ * Sends all the data on a blocking socket, returns false on failure
+ */
+bool Server_sendAll(int socket, const void* data, size_t size) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  while (size > 0) {
+    ssize_t count = send(socket, bytes, size, 0);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+/**
+ * Receives the given number of bytes from a blocking socket, returns false
+ * if the connection ended before
+ */
+bool Server_receiveAll(int socket, void* data, size_t size) {
+  uint8_t* bytes = (uint8_t*)data;
+  while (size > 0) {
+    ssize_t count = recv(socket, bytes, size, 0);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    bytes += count;
+    size -= count;
+  }
+  return true;
+}
+
+/**
+ * Orders latencies from the shortest
+ */
+int Server_compareTimes(const void* t1, const void* t2) {
+  double a = *(const double*)t1, b = *(const double*)t2;
+  return (a > b) - (a < b);
+}
+
+#endif
\ No newline at end of file
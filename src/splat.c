@@ -0,0 +1,196 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <splat.h>
+#include <simd.h>
+
+/**
+ * Sets the default settings: single pixel points with depth test
+ */
+void Splat_init(Splat* splat) {
+  splat->pointSize = 1;
+  splat->depthTest = true;
+  splat->fogDistance = 1;
+  splat->depth = NULL;
+  splat->depthSize = 0;
+}
+
+/**
+ * Frees up the depth buffer
+ */
+void Splat_free(Splat* splat) {
+  free(splat->depth);
+  splat->depth = NULL;
+  splat->depthSize = 0;
+}
+
+/**
+ * Draws every vertex of the scene into the target with the given pixel color
+ * (in the framebuffer's format), seen by the scene's camera
+ */
+void Splat_draw(Splat* splat, Scene* scene, Framebuffer* target,
+                uint32_t pixel) {
+  splat->scene = scene;
+  splat->target = target;
+  Transform view = Camera_viewTransform(&(scene->cam));
+  splat->view = Transform_multiply(&view, &(scene->model));
+  splat->pixel = pixel;
+
+  long int size = (long int)target->width * target->height;
+  if (splat->depthTest) {
+    if (splat->depthSize != size) {
+      free(splat->depth);
+      splat->depth = (uint32_t*)malloc(size * sizeof(uint32_t));
+      splat->depthSize = size;
+    }
+    memset(splat->depth, 0xFF, size * sizeof(uint32_t));
+  }
+
+  WorkerPool* workers = scene->workers;
+  int blocks = (scene->verticesCount + SPLAT_BLOCK - 1) / SPLAT_BLOCK;
+  if (workers != NULL && blocks > 1) {
+    WorkerPool_run(workers, Splat_block, splat, blocks);
+  } else {
+    Splat_range(splat, 0, scene->verticesCount);
+  }
+  if (!splat->depthTest) return;
+
+  int rowBlocks = (target->height + SPLAT_ROWS - 1) / SPLAT_ROWS;
+  if (workers != NULL && rowBlocks > 1) {
+    WorkerPool_run(workers, Splat_resolveRows, splat, rowBlocks);
+  } else {
+    for (int i = 0; i < rowBlocks; i++) Splat_resolveRows(splat, i);
+  }
+}
+
+/**
+ * Job of the worker pool splatting the index-th block of vertices
+ */
+void Splat_block(void* _splat, int index) {
+  Splat* splat = (Splat*)_splat;
+  long int begin = (long int)index * SPLAT_BLOCK;
+  long int end = begin + SPLAT_BLOCK;
+  if (end > splat->scene->verticesCount) end = splat->scene->verticesCount;
+  Splat_range(splat, begin, end);
+}
+
+/**
+ * Projects the vertices with indices in [begin, end) two at a time with the
+ * same transformation as Scene_projectRange, then writes the points in front
+ * of the camera
+ */
+void Splat_range(Splat* splat, long int begin, long int end) {
+  Vec3* vertices = splat->scene->vertices;
+  double(*m)[4] = splat->view.m;
+  double w = splat->scene->cam.hRes, h = splat->scene->cam.vRes;
+  SimdF64 halfW = Simd_splat(w / 2), halfH = Simd_splat(h / 2);
+  SimdF64 r[3][4];
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 4; j++) r[i][j] = Simd_splat(m[i][j]);
+
+  long int i = begin;
+  for (; i + 1 < end; i += 2) {
+    Vec3* v = &(vertices[i]);
+    SimdF64 vx = Simd_set(v[0].x, v[1].x);
+    SimdF64 vy = Simd_set(v[0].y, v[1].y);
+    SimdF64 vz = Simd_set(v[0].z, v[1].z);
+    SimdF64 c[3];
+    for (int k = 0; k < 3; k++)
+      c[k] = Simd_madd(r[k][0], vx,
+                       Simd_madd(r[k][1], vy, Simd_madd(r[k][2], vz, r[k][3])));
+    SimdF64 scale = Simd_div(halfW, c[2]);
+    double x[2], y[2], z[2];
+    Simd_store(x, Simd_madd(c[0], scale, halfW));
+    Simd_store(y, Simd_madd(c[1], scale, halfH));
+    Simd_store(z, c[2]);
+    Splat_write(splat, x[0], y[0], z[0]);
+    Splat_write(splat, x[1], y[1], z[1]);
+  }
+  for (; i < end; i++) {
+    Vec3 c = Transform_apply(&(splat->view), &(vertices[i]));
+    Splat_write(splat, w / 2 + (w / 2) * c.x / c.z,
+                h / 2 + (w / 2) * c.y / c.z, c.z);
+  }
+}
+
+/**
+ * Writes a projected point as a square of pointSize pixels, or only its depth
+ * if the depth test is on
+ */
+void Splat_write(Splat* splat, double x, double y, double z) {
+  Framebuffer* target = splat->target;
+  int size = splat->pointSize, half = splat->pointSize / 2;
+  // Points behind the camera and off the screen are dropped, NaN coordinates
+  // fail the comparisons too
+  if (!(z > 0 && x >= -half && y >= -half && x < target->width + half &&
+        y < target->height + half))
+    return;
+  // Points left of or above the screen edge are floored, not truncated
+  // towards it, so their squares do not shift by a pixel
+  int left = (int)floor(x) - half, top = (int)floor(y) - half;
+  int right = left + size, bottom = top + size;
+  if (left < 0) left = 0;
+  if (top < 0) top = 0;
+  if (right > target->width) right = target->width;
+  if (bottom > target->height) bottom = target->height;
+
+  float depth = (float)z;
+  uint32_t depthBits;
+  memcpy(&depthBits, &depth, sizeof(depthBits));
+  for (int row = top; row < bottom; row++) {
+    long int offset = (long int)row * target->width;
+    for (int col = left; col < right; col++) {
+      if (splat->depthTest)
+        Splat_depthMin(&(splat->depth[offset + col]), depthBits);
+      else
+        __atomic_store_n(&(target->pixels[offset + col]), splat->pixel,
+                         __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/**
+ * Job of the worker pool coloring the pixels covered by points in the
+ * index-th block of rows, the brightness falls with the depth
+ */
+void Splat_resolveRows(void* _splat, int index) {
+  Splat* splat = (Splat*)_splat;
+  Framebuffer* target = splat->target;
+  int top = index * SPLAT_ROWS, bottom = top + SPLAT_ROWS;
+  if (bottom > target->height) bottom = target->height;
+  long int begin = (long int)top * target->width;
+  long int end = (long int)bottom * target->width;
+  uint8_t color[4];
+  memcpy(color, &(splat->pixel), sizeof(color));
+
+  for (long int i = begin; i < end; i++) {
+    if (splat->depth[i] == SPLAT_EMPTY) continue;
+    float depth;
+    memcpy(&depth, &(splat->depth[i]), sizeof(depth));
+    double brightness = 1 - 0.75 * depth / splat->fogDistance;
+    if (brightness < 0.25) brightness = 0.25;
+    // The framebuffer stores the bytes in R, G, B, A order
+    uint8_t shaded[4] = {color[0] * brightness, color[1] * brightness,
+                         color[2] * brightness, color[3]};
+    memcpy(&(target->pixels[i]), shaded, sizeof(shaded));
+  }
+}
+
+/**
+ * Lowers the stored depth to the value if it is nearer, safe to call from
+ * several threads at once
+ * The depths are positive floats, their bits compare the same way as the
+ * values do
+ */
+void Splat_depthMin(uint32_t* depth, uint32_t value) {
+  uint32_t current = __atomic_load_n(depth, __ATOMIC_RELAXED);
+  while (value < current &&
+         !__atomic_compare_exchange_n(depth, &current, value, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
\ No newline at end of file
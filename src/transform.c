@@ -0,0 +1,95 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <transform.h>
+
+// External definition of the inline function of the header
+extern inline Vec3 Transform_apply(Transform* t, Vec3* v);
+
+/**
+ * Returns the transformation that leaves every point in place
+ */
+Transform Transform_identity() {
+  Transform t;
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 4; j++) t.m[i][j] = (i == j) ? 1 : 0;
+  return t;
+}
+
+/**
+ * Returns the transformation that takes points into the coordinate system
+ * with the given origin and (orthonormal) axes
+ * Used for getting from world space to camera space
+ */
+Transform Transform_fromBasis(Vec3* xAxis, Vec3* yAxis, Vec3* zAxis,
+                              Vec3* origin) {
+  Transform t;
+  Vec3* axes[3] = {xAxis, yAxis, zAxis};
+  for (int i = 0; i < 3; i++) {
+    t.m[i][0] = axes[i]->x;
+    t.m[i][1] = axes[i]->y;
+    t.m[i][2] = axes[i]->z;
+    t.m[i][3] = -Vec3_dot(axes[i], origin);
+  }
+  return t;
+}
+
+/**
+ * Returns the transformation that applies t2 first then t1
+ */
+Transform Transform_multiply(Transform* t1, Transform* t2) {
+  Transform t;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      t.m[i][j] = t1->m[i][0] * t2->m[0][j] + t1->m[i][1] * t2->m[1][j] +
+                  t1->m[i][2] * t2->m[2][j];
+    }
+    t.m[i][3] += t1->m[i][3];
+  }
+  return t;
+}
+
+/**
+ * Returns the length of the longest transformed axis, the factor a bounding
+ * sphere has to be scaled with to contain the transformed points
+ */
+double Transform_scale(Transform* t) {
+  double max = 0;
+  for (int j = 0; j < 3; j++) {
+    double length = t->m[0][j] * t->m[0][j] + t->m[1][j] * t->m[1][j] +
+                    t->m[2][j] * t->m[2][j];
+    max = length > max ? length : max;
+  }
+  return sqrt(max);
+}
+
+/**
+ * Returns the inverse of the transformation (which has to be invertible)
+ */
+Transform Transform_invert(Transform* t) {
+  double(*m)[4] = t->m;
+  Transform inverse;
+  double(*r)[4] = inverse.m;
+  // The inverse of the linear part from the cofactors
+  r[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+  r[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+  r[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+  r[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+  r[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+  r[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+  r[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+  r[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+  r[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+  double det = m[0][0] * r[0][0] + m[0][1] * r[1][0] + m[0][2] * r[2][0];
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++) r[i][j] /= det;
+  // Then the translation is undone in the rotated space
+  for (int i = 0; i < 3; i++)
+    r[i][3] = -(r[i][0] * m[0][3] + r[i][1] * m[1][3] + r[i][2] * m[2][3]);
+  return inverse;
+}
\ No newline at end of file
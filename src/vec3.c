@@ -8,101 +8,26 @@
 
 #include <vec3.h>
 
-/**
- * Creates a new 3-dimensional vector
- */
-Vec3 Vec3_new(double _x, double _y, double _z) {
-  Vec3 v;
-  v.x = _x;
-  v.y = _y;
-  v.z = _z;
-  return v;
-}
-
-/**
- * Copies the value of a vector into a new variable and returrns it
- */
-Vec3 Vec3_copy(Vec3 *src) {
-  Vec3 ret;
-  ret.x = src->x;
-  ret.y = src->y;
-  ret.z = src->z;
-  return ret;
-}
-
-/**
- * Compares two vectors and returns true if they are the same
- */
-bool Vec3_equals(Vec3 *v, Vec3 *w) {
-  return (v->x == w->x) && (v->y == w->y) && (v->z == w->z);
-}
-
-/**
- * Returns the length (magnitude) of the given vector
- */
-double Vec3_length(Vec3 *v) {
-  return sqrt(v->x * v->x + v->y * v->y + v->z * v->z);
-}
-
-/**
- * Returns the length of the given vector squared
- * A lot faster than getting the actual length
- * Useful for comparing two vetors' lengths
- */
-double Vec3_sqLength(Vec3 *v) {
-  return (v->x * v->x + v->y * v->y + v->z * v->z);
-}
-
-/**
- * Multiplies the vector by the given number
- */
-void Vec3_mult(Vec3 *v, double num) {
-  v->x *= num;
-  v->y *= num;
-  v->z *= num;
-}
-
-/**
- * Divides the vector by the given number
- * When divided by 0, nothing happens
- */
-void Vec3_div(Vec3 *v, double num) {
-  if (num == 0) return;
-  v->x /= num;
-  v->y /= num;
-  v->z /= num;
-}
-
-/**
- * Returns the dot product of the given vectors
- */
-double Vec3_dot(Vec3 *v1, Vec3 *v2) {
-  return v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
-}
+// External definitions of the inline functions of the header
+extern inline Vec3 Vec3_new(double _x, double _y, double _z);
+extern inline Vec3 Vec3_copy(Vec3 *src);
+extern inline bool Vec3_equals(Vec3 *v, Vec3 *w);
+extern inline double Vec3_length(Vec3 *v);
+extern inline double Vec3_sqLength(Vec3 *v);
+extern inline void Vec3_mult(Vec3 *v, double num);
+extern inline void Vec3_div(Vec3 *v, double num);
+extern inline double Vec3_dot(Vec3 *v1, Vec3 *v2);
+extern inline void Vec3_add(Vec3 *v1, Vec3 *v2);
+extern inline void Vec3_sub(Vec3 *v1, Vec3 *v2);
+extern inline Vec3 Vec3_lerp(Vec3 *v1, Vec3 *v2, double t);
+extern inline void Vec3_setLength(Vec3 *v, double lenToSet);
+extern inline Vec3 Vec3_cross(Vec3 *v1, Vec3 *v2);
 
 /**
  * Returns the square of the dot product of the given vectors
  */
 double Vec3_dotSq(Vec3 *v1, Vec3 *v2) { return pow(Vec3_dot(v1, v2), 2); }
 
-/**
- * Adds the second vector to the first one
- */
-void Vec3_add(Vec3 *v1, Vec3 *v2) {
-  v1->x += v2->x;
-  v1->y += v2->y;
-  v1->z += v2->z;
-}
-
-/**
- * Subtracts the second vector from the first one
- */
-void Vec3_sub(Vec3 *v1, Vec3 *v2) {
-  v1->x -= v2->x;
-  v1->y -= v2->y;
-  v1->z -= v2->z;
-}
-
 /**
  * Calculates the angle between the given vectors
  * Uses their dot products and acos to calculate it
@@ -112,33 +37,6 @@ double Vec3_angle(Vec3 *v, Vec3 *w) {
   return acos((Vec3_dot(v, w)) / (Vec3_length(v) * Vec3_length(w)));
 }
 
-/**
- * Linearly interpolates between two given vectors and returns the newly created
- * one If t = 1 then the returned vector equals v2 And if t = 0 the returned
- * vector equals v1 If t is outside [0, 1], the function is extrapolating
- */
-Vec3 Vec3_lerp(Vec3 *v1, Vec3 *v2, double t) {
-  Vec3 ret = Vec3_copy(v1);
-  ret.x += (v2->x - v1->x) * t;
-  ret.y += (v2->y - v1->y) * t;
-  ret.z += (v2->z - v1->z) * t;
-  return ret;
-}
-
-/**
- * Keeps the direction of vector v but sets it's length to the given number
- * In case the length to be set to is negative, the resulting vector is going to
- * flip direction
- */
-void Vec3_setLength(Vec3 *v, double lenToSet) {
-  double len = Vec3_length(v);
-  if (len == 0) return;
-  double mult = lenToSet / len;
-  v->x *= mult;
-  v->y *= mult;
-  v->z *= mult;
-}
-
 /**
  * Rotates the vector around the X axis by the angle that is in radians
  */
@@ -194,17 +92,6 @@ void Vec3_rotateAroundAxis(Vec3 *v, Vec3 *axis, double angle) {
          z * (cosA + u.z * u.z * (1 - cosA));
 }
 
-/**
- * Calculates the cross product of the two given vectors and returns the product
- */
-Vec3 Vec3_cross(Vec3 *v1, Vec3 *v2) {
-  Vec3 v;
-  v.x = v1->y * v2->z - v1->z * v2->y;
-  v.y = v1->z * v2->x - v1->x * v2->z;
-  v.z = v1->x * v2->y - v1->y * v2->x;
-  return v;
-}
-
 /**
  * Returns the vector given by coordinates in cylindrical coordinates
  * Angle is of course has to be in radians
@@ -0,0 +1,149 @@
+/**
+ * Copyright 2020 Ákos Seres
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+
+#include <stdlib.h>
+#include <workers.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+EM_JS(int, getHardwareConcurrency, (),
+      { return navigator.hardwareConcurrency || 1; });
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * Returns the number of logical processors, which is the default pool size
+ * In the browser it is read from navigator.hardwareConcurrency
+ */
+int WorkerPool_defaultSize() {
+  int count;
+#ifdef __EMSCRIPTEN__
+  count = getHardwareConcurrency();
+#elif defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  count = info.dwNumberOfProcessors;
+#else
+  count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return count < 1 ? 1 : count;
+}
+
+#ifndef WORKERS_NO_THREADS
+
+/**
+ * Takes jobs from the current batch until there are none left
+ * Has to be called with the lock held, returns with the lock held
+ */
+void WorkerPool_takeJobs(WorkerPool* pool) {
+  while (pool->nextJob < pool->jobCount) {
+    int index = pool->nextJob++;
+    pool->runningJobs++;
+    pthread_mutex_unlock(&pool->lock);
+    pool->job(pool->data, index);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->runningJobs == 0 && pool->nextJob >= pool->jobCount)
+      pthread_cond_broadcast(&pool->workDone);
+  }
+}
+
+/**
+ * The function the threads of the pool run, they sleep until a new batch of
+ * jobs arrives
+ */
+void* WorkerPool_thread(void* _pool) {
+  WorkerPool* pool = (WorkerPool*)_pool;
+  unsigned long lastBatch = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  while (!pool->quit) {
+    if (pool->batch == lastBatch) {
+      pthread_cond_wait(&pool->workAvailable, &pool->lock);
+      continue;
+    }
+    lastBatch = pool->batch;
+    WorkerPool_takeJobs(pool);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+#endif
+
+/**
+ * Creates a pool of the given size and starts its threads
+ */
+WorkerPool* WorkerPool_create(int size) {
+  WorkerPool* pool = malloc(sizeof(WorkerPool));
+  pool->size = size < 1 ? 1 : size;
+#ifdef WORKERS_NO_THREADS
+  pool->size = 1;
+#else
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->workAvailable, NULL);
+  pthread_cond_init(&pool->workDone, NULL);
+  pool->jobCount = pool->nextJob = pool->runningJobs = 0;
+  pool->batch = 0;
+  pool->quit = false;
+  pool->threads = malloc(pool->size * sizeof(pthread_t));
+  for (int i = 1; i < pool->size; i++) {
+    // Fall back to fewer threads if they can not be created
+    if (pthread_create(&pool->threads[i], NULL, WorkerPool_thread, pool) != 0) {
+      pool->size = i;
+      break;
+    }
+  }
+#endif
+  return pool;
+}
+
+/**
+ * Runs jobs with indices from 0 to jobCount - 1 on the pool and returns when
+ * all of them are finished
+ */
+void WorkerPool_run(WorkerPool* pool, workerJobFunc job, void* data,
+                    int jobCount) {
+#ifndef WORKERS_NO_THREADS
+  if (pool->size > 1 && jobCount > 1) {
+    pthread_mutex_lock(&pool->lock);
+    pool->job = job;
+    pool->data = data;
+    pool->jobCount = jobCount;
+    pool->nextJob = 0;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->workAvailable);
+    WorkerPool_takeJobs(pool);
+    while (pool->runningJobs > 0)
+      pthread_cond_wait(&pool->workDone, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+#endif
+  for (int i = 0; i < jobCount; i++) job(data, i);
+}
+
+/**
+ * Stops the threads of the pool and frees it
+ */
+void WorkerPool_destroy(WorkerPool* pool) {
+#ifndef WORKERS_NO_THREADS
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = true;
+  pthread_cond_broadcast(&pool->workAvailable);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 1; i < pool->size; i++) pthread_join(pool->threads[i], NULL);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->workAvailable);
+  pthread_cond_destroy(&pool->workDone);
+  free(pool->threads);
+#endif
+  free(pool);
+}
\ No newline at end of file
@@ -3,4 +3,28 @@ mkdir test/bin
 gcc test/vec3_test.c src/vec3.c -o test/bin/vec3_test -Iinclude/ -Itest/ -lm
 ./test/bin/vec3_test
 
+gcc test/objparser_test.c src/objparser.c src/decompress.c src/scene.c src/vec3.c src/point.c src/camera.c src/transform.c src/workers.c -o test/bin/objparser_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/objparser_test
+
+gcc test/scene_test.c src/scene.c src/objparser.c src/decompress.c src/vec3.c src/point.c src/camera.c src/transform.c src/workers.c -o test/bin/scene_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/scene_test
+
+gcc test/decompress_test.c src/decompress.c src/objparser.c src/scene.c src/vec3.c src/point.c src/camera.c src/transform.c src/workers.c src/png.c -o test/bin/decompress_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/decompress_test
+
+gcc test/meshfile_test.c src/meshfile.c src/scene.c src/objparser.c src/decompress.c src/vec3.c src/point.c src/camera.c src/transform.c src/workers.c -o test/bin/meshfile_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/meshfile_test
+
+gcc test/png_test.c src/png.c src/decompress.c -o test/bin/png_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/png_test
+
+gcc test/server_test.c src/server.c src/batch.c src/bench.c src/framebuffer.c src/meshfile.c src/png.c src/scene.c src/objparser.c src/decompress.c src/vec3.c src/point.c src/camera.c src/transform.c src/workers.c -o test/bin/server_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/server_test
+
+gcc test/chunkstore_test.c src/chunkstore.c src/scene.c src/objparser.c src/decompress.c src/vec3.c src/point.c src/camera.c src/transform.c src/workers.c -o test/bin/chunkstore_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/chunkstore_test
+
+gcc test/instances_test.c src/instances.c src/meshfile.c src/scene.c src/objparser.c src/decompress.c src/vec3.c src/point.c src/camera.c src/transform.c src/workers.c -o test/bin/instances_test -Iinclude/ -Itest/ -lm -lpthread
+./test/bin/instances_test
+
 rm -rf test/bin
\ No newline at end of file
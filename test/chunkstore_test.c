@@ -0,0 +1,146 @@
+#include <chunkstore.h>
+#include <stdio.h>
+#include <tester.h>
+
+unsigned int test_build();
+unsigned int test_longLines();
+unsigned int test_invalid();
+
+int main() {
+  tester_init();
+  eval(test_build);
+  eval(test_longLines);
+  eval(test_invalid);
+  return 0;
+}
+
+// Writes a grid of quads with the given number of vertices on a side
+bool writeGrid(const char* fileName, int side) {
+  FILE* file = fopen(fileName, "w");
+  if (file == NULL) return false;
+  for (int y = 0; y < side; y++)
+    for (int x = 0; x < side; x++) fprintf(file, "v %d %d 0\n", x, y);
+  for (int y = 0; y + 1 < side; y++)
+    for (int x = 0; x + 1 < side; x++) {
+      int v = y * side + x + 1;
+      fprintf(file, "f %d %d %d %d\n", v, v + 1, v + side + 1, v + side);
+    }
+  return fclose(file) == 0;
+}
+
+// Reads the whole file, it has to be freed
+unsigned char* readFile(const char* fileName, size_t* size) {
+  FILE* file = fopen(fileName, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char* data = (unsigned char*)malloc(*size);
+  if (fread(data, 1, *size, file) != *size) *size = 0;
+  fclose(file);
+  return data;
+}
+
+bool writeFile(const char* fileName, const unsigned char* data, size_t size) {
+  FILE* file = fopen(fileName, "wb");
+  if (file == NULL) return false;
+  bool written = fwrite(data, 1, size, file) == size;
+  return (fclose(file) == 0) && written;
+}
+
+unsigned int test_build() {
+  // 100 vertices and 180 edges in chunks of about 16 edges
+  if (!writeGrid("test/bin/grid.obj", 10)) return 1;
+  if (!ChunkStore_build("test/bin/grid.obj", "test/bin/grid.chunks", 16))
+    return 2;
+  ChunkStore* store = ChunkStore_open("test/bin/grid.chunks", 1 << 20);
+  if (store == NULL) return 3;
+  if (store->chunkCount < 2 || store->header->edgeCount != 180) return 4;
+  long int edges = 0;
+  for (long int i = 0; i < store->chunkCount; i++) {
+    ChunkStore_load(store, i);
+    Scene* scene = &store->chunks[i].scene;
+    edges += scene->edgeCount;
+    for (long int k = 0; k < scene->edgeCount; k++)
+      if (scene->edges[k].a >= scene->verticesCount ||
+          scene->edges[k].b >= scene->verticesCount)
+        return 5;
+  }
+  if (edges != 180) return 6;
+  ChunkStore_close(store);
+  return 0;
+}
+
+unsigned int test_longLines() {
+  // A polyline through 64 vertices, with the numbers padded to a line of
+  // more than 6000 bytes
+  FILE* file = fopen("test/bin/long.obj", "w");
+  if (file == NULL) return 1;
+  for (int i = 0; i < 64; i++) fprintf(file, "v %d %d 0\n", i, i % 2);
+  fprintf(file, "l");
+  for (int i = 1; i <= 64; i++) fprintf(file, " %0100d", i);
+  fprintf(file, "\nf 1 2 3\n");
+  if (fclose(file) != 0) return 2;
+  if (!ChunkStore_build("test/bin/long.obj", "test/bin/long.chunks", 16))
+    return 3;
+  ChunkStore* store = ChunkStore_open("test/bin/long.chunks", 1 << 20);
+  if (store == NULL) return 4;
+  // The triangle adds the edge from 1 to 3 to the ones of the polyline
+  if (store->header->vertexCount < 64 || store->header->edgeCount != 64)
+    return 5;
+  ChunkStore_close(store);
+  return 0;
+}
+
+unsigned int test_invalid() {
+  size_t size;
+  unsigned char* data = readFile("test/bin/grid.chunks", &size);
+  if (data == NULL || size == 0) return 1;
+  ChunkFileHeader* header = (ChunkFileHeader*)data;
+  ChunkInfo* infos = (ChunkInfo*)(data + sizeof(ChunkFileHeader));
+  const char* fileName = "test/bin/invalid.chunks";
+  unsigned int result = 0;
+
+  // Cut off the end of the last chunk
+  if (!writeFile(fileName, data, size - 16)) result = 2;
+  if (result == 0 && ChunkStore_open(fileName, 1 << 20) != NULL) result = 3;
+
+  // Chunks reaching past the end, or starting before the file
+  ChunkInfo last = infos[header->chunkCount - 1];
+  infos[header->chunkCount - 1].edgeCount = last.edgeCount + 1000;
+  if (result == 0 && !writeFile(fileName, data, size)) result = 4;
+  if (result == 0 && ChunkStore_open(fileName, 1 << 20) != NULL) result = 5;
+  infos[header->chunkCount - 1] = last;
+  infos[0].vertexOffset = -(int64_t)sizeof(Vec3);
+  if (result == 0 && !writeFile(fileName, data, size)) result = 6;
+  if (result == 0 && ChunkStore_open(fileName, 1 << 20) != NULL) result = 7;
+  infos[0].vertexOffset = last.vertexOffset + 4;
+  if (result == 0 && !writeFile(fileName, data, size)) result = 8;
+  if (result == 0 && ChunkStore_open(fileName, 1 << 20) != NULL) result = 9;
+  header->chunkCount = INT64_MAX / 2;
+  if (result == 0 && !writeFile(fileName, data, size)) result = 10;
+  if (result == 0 && ChunkStore_open(fileName, 1 << 20) != NULL) result = 11;
+
+  // An edge referring to a vertex outside of its chunk is found when the
+  // chunk is loaded, it is left empty
+  free(data);
+  data = readFile("test/bin/grid.chunks", &size);
+  infos = (ChunkInfo*)(data + sizeof(ChunkFileHeader));
+  ChunkStore* store = NULL;
+  if (result == 0) {
+    int64_t* edges = (int64_t*)(data + infos[0].edgeOffset);
+    edges[1] = infos[0].vertexCount;
+    if (!writeFile(fileName, data, size)) result = 12;
+    store = ChunkStore_open(fileName, 1 << 20);
+    if (result == 0 && store == NULL) result = 13;
+  }
+  if (result == 0) {
+    ChunkStore_load(store, 0);
+    ChunkStore_load(store, 1);
+    if (store->chunks[0].scene.edgeCount != 0) result = 14;
+    if (store->chunks[1].scene.edgeCount == 0) result = 15;
+  }
+  ChunkStore_close(store);
+  free(data);
+  return result;
+}
\ No newline at end of file
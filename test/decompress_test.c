@@ -0,0 +1,327 @@
+#include <decompress.h>
+#include <objparser.h>
+#include <png.h>
+#include <stdio.h>
+#include <tester.h>
+
+unsigned int test_stored();
+unsigned int test_fixed();
+unsigned int test_dynamic();
+unsigned int test_members();
+unsigned int test_errors();
+unsigned int test_objPull();
+unsigned int test_objSplit();
+unsigned int test_stop();
+
+// gzip -9 of the text of makeObj(20, false), a block with dynamic
+// codes
+const uint8_t dynamicMember[] = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x2D, 0x8E,
+    0xD1, 0x11, 0xC0, 0x20, 0x0C, 0x42, 0xFF, 0x3B, 0x05, 0x23, 0x88, 0x9A,
+    0xA8, 0x8B, 0x39, 0x7F, 0x21, 0xED, 0xE5, 0x03, 0xEE, 0xC2, 0x23, 0xB9,
+    0x68, 0x9E, 0xE7, 0x82, 0x1E, 0x69, 0xC7, 0x44, 0x97, 0x0E, 0x1C, 0x0C,
+    0xE9, 0x04, 0x13, 0x53, 0x26, 0xB0, 0x11, 0xD2, 0x54, 0x24, 0xA5, 0x0B,
+    0x8C, 0x22, 0x37, 0x38, 0x0A, 0x3D, 0x36, 0x66, 0xD9, 0xBC, 0x33, 0x4D,
+    0xBA, 0xD0, 0xA6, 0xFF, 0xB8, 0xB3, 0x59, 0x05, 0x9C, 0x22, 0xEA, 0x74,
+    0xF8, 0x8A, 0x4D, 0xEA, 0x89, 0x2A, 0x58, 0xFA, 0xAA, 0x78, 0x95, 0x7F,
+    0xFC, 0x51, 0x26, 0x9E, 0x17, 0x23, 0xB0, 0x9F, 0x04, 0xB0, 0x00, 0x00,
+    0x00};
+
+int main() {
+  tester_init();
+  eval(test_stored);
+  eval(test_fixed);
+  eval(test_dynamic);
+  eval(test_members);
+  eval(test_errors);
+  eval(test_objPull);
+  eval(test_objSplit);
+  eval(test_stop);
+  return 0;
+}
+
+// Writes an .obj file of the given number of vertices with a triangle after
+// every 500 of them, the text has to be freed
+char* makeObj(long int vertexCount, bool faces, size_t* size) {
+  char* text = (char*)malloc(vertexCount * 48 + 1);
+  size_t length = 0;
+  for (long int i = 0; i < vertexCount; i++) {
+    length += sprintf(text + length, "v %ld %ld %ld\n", i, i * i % 17, i % 7);
+    if (faces && i % 500 == 499)
+      length += sprintf(text + length, "f %ld %ld %ld\n", i - 1, i, i + 1);
+  }
+  *size = length;
+  return text;
+}
+
+// Wraps the data into a gzip member, compressed into stored blocks or into a
+// block with fixed codes by the PNG encoder
+size_t gzipMember(const uint8_t* data, size_t size, bool stored,
+                  uint8_t* out) {
+  const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+  PngEncoder encoder;
+  Png_init(&encoder);
+  encoder.out = out;
+  memcpy(out, header, 10);
+  encoder.size = 10;
+  if (stored) {
+    size_t i = 0;
+    do {
+      size_t length = size - i < 65535 ? size - i : 65535;
+      out[encoder.size++] = i + length == size;
+      uint16_t fields[2] = {(uint16_t)length, (uint16_t)~length};
+      for (int k = 0; k < 2; k++) {
+        out[encoder.size++] = fields[k] & 0xFF;
+        out[encoder.size++] = fields[k] >> 8;
+      }
+      memcpy(&out[encoder.size], &data[i], length);
+      encoder.size += length;
+      i += length;
+    } while (i < size);
+  } else {
+    Png_deflate(&encoder, data, size);
+  }
+  uint32_t trailer[2] = {Png_crc(&encoder, data, size), (uint32_t)size};
+  for (int k = 0; k < 8; k++)
+    out[encoder.size++] = (uint8_t)(trailer[k / 4] >> (8 * (k % 4)));
+  return encoder.size;
+}
+
+// Decompresses the gzip data through the ring of buffers of a decompressor,
+// the data is handed over as the prefix of an empty input
+size_t decompress(const uint8_t* data, size_t size, uint8_t* out,
+                  size_t capacity, bool* failed) {
+  int fds[2];
+  if (pipe(fds) != 0) return 0;
+  close(fds[1]);
+  Decompressor* stream =
+      Decompress_start(fds[0], Decompress_formatOf(data, size), data, size);
+  size_t length = 0;
+  const char* chunk;
+  long int chunkLength;
+  while ((chunkLength = Decompress_next(stream, &chunk, true)) > 0) {
+    if (length + chunkLength <= capacity)
+      memcpy(&out[length], chunk, chunkLength);
+    length += chunkLength;
+    Decompress_release(stream);
+  }
+  *failed = stream->failed;
+  Decompress_stop(stream);
+  close(fds[0]);
+  return length;
+}
+
+// Compresses the text into a member and checks that it comes back the same
+unsigned int roundTrip(const char* text, size_t size, bool stored) {
+  uint8_t* compressed = (uint8_t*)malloc(size + size / 8 + 1024);
+  uint8_t* out = (uint8_t*)malloc(size + 1);
+  size_t compressedSize =
+      gzipMember((const uint8_t*)text, size, stored, compressed);
+  bool failed;
+  size_t length = decompress(compressed, compressedSize, out, size, &failed);
+  unsigned int result = 0;
+  if (failed) result = 1;
+  if (length != size || memcmp(out, text, size) != 0) result = 2;
+  if (!stored && compressedSize > size / 2) result = 3;
+  free(compressed);
+  free(out);
+  return result;
+}
+
+unsigned int test_stored() {
+  // Several blocks and more than one buffer of the ring
+  size_t size;
+  char* text = makeObj(30000, true, &size);
+  unsigned int result = roundTrip(text, size, true);
+  if (result == 0) result = 10 * roundTrip("", 0, true);
+  free(text);
+  return result;
+}
+
+unsigned int test_fixed() {
+  // Matches cut off by the end of a buffer continue in the next one
+  size_t size;
+  char* text = makeObj(30000, true, &size);
+  unsigned int result = roundTrip(text, size, false);
+  free(text);
+  return result;
+}
+
+unsigned int test_dynamic() {
+  size_t size;
+  char* text = makeObj(20, false, &size);
+  char out[1024];
+  bool failed;
+  size_t length = decompress(dynamicMember, sizeof(dynamicMember),
+                             (uint8_t*)out, sizeof(out), &failed);
+  unsigned int result = 0;
+  if ((dynamicMember[10] >> 1 & 3) != 2) result = 1;
+  if (failed) result = 2;
+  if (length != size || memcmp(out, text, size) != 0) result = 3;
+  free(text);
+  return result;
+}
+
+unsigned int test_members() {
+  // A stored member followed by a member with dynamic codes gives the two
+  // texts one after the other
+  size_t size;
+  char* text = makeObj(20, false, &size);
+  uint8_t data[4096], out[4096];
+  size_t first = gzipMember((const uint8_t*)text, size, true, data);
+  memcpy(&data[first], dynamicMember, sizeof(dynamicMember));
+  bool failed;
+  size_t length = decompress(data, first + sizeof(dynamicMember), out,
+                             sizeof(out), &failed);
+  unsigned int result = 0;
+  if (failed) result = 1;
+  if (length != 2 * size) result = 2;
+  if (memcmp(out, text, size) != 0 || memcmp(&out[size], text, size) != 0)
+    result = 3;
+  free(text);
+  return result;
+}
+
+unsigned int test_errors() {
+  uint8_t data[sizeof(dynamicMember)], out[1024];
+  bool failed;
+  // Cut off in the trailer, in the middle of the block and in the header
+  size_t cuts[3] = {sizeof(dynamicMember) - 3, sizeof(dynamicMember) / 2, 6};
+  for (int i = 0; i < 3; i++) {
+    decompress(dynamicMember, cuts[i], out, sizeof(out), &failed);
+    if (!failed) return 1 + i;
+  }
+  // Damaged CRC and size in the trailer
+  for (int i = 0; i < 2; i++) {
+    memcpy(data, dynamicMember, sizeof(data));
+    data[sizeof(data) - 8 + 4 * i] ^= 0x40;
+    decompress(data, sizeof(data), out, sizeof(out), &failed);
+    if (!failed) return 4 + i;
+  }
+  // A damaged byte in the compressed data, either the codes become invalid
+  // or the CRC does not match
+  memcpy(data, dynamicMember, sizeof(data));
+  data[40] ^= 0x10;
+  decompress(data, sizeof(data), out, sizeof(out), &failed);
+  if (!failed) return 6;
+  // Reserved block type
+  memcpy(data, dynamicMember, sizeof(data));
+  data[10] |= 6;
+  decompress(data, sizeof(data), out, sizeof(out), &failed);
+  if (!failed) return 7;
+  return 0;
+}
+
+// Loads the scene like the loaders without a window do
+Scene loadScene(const char* fileName) {
+  Scene scene;
+  Scene_init(&scene, NULL);
+  Scene_loadObj(&scene, fileName);
+  return scene;
+}
+
+unsigned int test_objPull() {
+  // More than the 4 buffers of the ring, so the thread has to wait for the
+  // parser to hand them back
+  size_t size;
+  char* text = makeObj(120000, true, &size);
+  uint8_t* compressed = (uint8_t*)malloc(size + size / 8 + 1024);
+  size_t compressedSize =
+      gzipMember((const uint8_t*)text, size, false, compressed);
+  if (size < DECOMPRESS_BUFFERS * DECOMPRESS_BUFFER_SIZE) return 1;
+  FILE* file = fopen("test/bin/scene.obj", "wb");
+  if (file == NULL) return 2;
+  fwrite(text, 1, size, file);
+  fclose(file);
+  file = fopen("test/bin/scene.obj.gz", "wb");
+  if (file == NULL) return 3;
+  fwrite(compressed, 1, compressedSize, file);
+  fclose(file);
+  free(text);
+  free(compressed);
+
+  Scene plain = loadScene("test/bin/scene.obj");
+  Scene unpacked = loadScene("test/bin/scene.obj.gz");
+  if (plain.verticesCount != 120000 || plain.edgeCount != 720) return 4;
+  if (unpacked.verticesCount != plain.verticesCount ||
+      unpacked.edgeCount != plain.edgeCount)
+    return 5;
+  if (memcmp(unpacked.vertices, plain.vertices,
+             plain.verticesCount * sizeof(Vec3)) != 0 ||
+      memcmp(unpacked.edges, plain.edges, plain.edgeCount * sizeof(Edge)) != 0)
+    return 6;
+  Scene_free(&unpacked);
+
+  // Pulled without waiting, like the app does in every frame
+  Scene_init(&unpacked, NULL);
+  ObjParser* parser = ObjParser_create(&unpacked);
+  int fd = ObjParser_openInput("test/bin/scene.obj.gz", true);
+  while (ObjParser_read(parser, fd) != 0) continue;
+  ObjParser_finish(parser);
+  ObjParser_closeInput(fd);
+  if (unpacked.verticesCount != plain.verticesCount ||
+      memcmp(unpacked.vertices, plain.vertices,
+             plain.verticesCount * sizeof(Vec3)) != 0)
+    return 7;
+  Scene_free(&unpacked);
+  Scene_free(&plain);
+  return 0;
+}
+
+unsigned int test_objSplit() {
+  // The first byte of the member arrives alone on a pipe, the format is only
+  // told once the rest of the magic bytes are there
+  int fds[2];
+  if (pipe(fds) != 0) return 1;
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  Scene scene;
+  Scene_init(&scene, NULL);
+  ObjParser* parser = ObjParser_create(&scene);
+  unsigned int result = 0;
+  if (write(fds[1], dynamicMember, 1) != 1) result = 2;
+  if (result == 0 && ObjParser_read(parser, fds[0]) != -1) result = 3;
+  if (result == 0 && parser->started) result = 4;
+  size_t rest = sizeof(dynamicMember) - 1;
+  if (result == 0 && write(fds[1], &dynamicMember[1], rest) != (long)rest)
+    result = 5;
+  close(fds[1]);
+  while (result == 0 && ObjParser_pull(parser, fds[0], true) > 0) continue;
+  if (result == 0 && parser->decompressor == NULL) result = 6;
+  ObjParser_finish(parser);
+  close(fds[0]);
+  if (result == 0 && scene.verticesCount != 20) result = 7;
+  Scene_free(&scene);
+
+  // Input shorter than the magic bytes is parsed as text
+  if (pipe(fds) != 0) return 8;
+  Scene_init(&scene, NULL);
+  parser = ObjParser_create(&scene);
+  if (write(fds[1], "v 1", 3) != 3) result = 9;
+  close(fds[1]);
+  while (ObjParser_pull(parser, fds[0], true) > 0) continue;
+  ObjParser_finish(parser);
+  close(fds[0]);
+  if (result == 0 && scene.verticesCount != 1) result = 10;
+  Scene_free(&scene);
+  return result;
+}
+
+unsigned int test_stop() {
+  // The thread waits for the rest of the member on a blocking pipe whose
+  // writer stays open, stopping it must not wait for input
+  int fds[2];
+  if (pipe(fds) != 0) return 1;
+  size_t half = sizeof(dynamicMember) / 2;
+  if (write(fds[1], &dynamicMember[10], half - 10) != (long)(half - 10))
+    return 2;
+  Decompressor* stream =
+      Decompress_start(fds[0], DECOMPRESS_GZIP, dynamicMember, 10);
+  const char* chunk;
+  unsigned int result = 0;
+  usleep(100000);
+  if (Decompress_next(stream, &chunk, false) != -1) result = 3;
+  Decompress_stop(stream);
+  close(fds[0]);
+  close(fds[1]);
+  return result;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include <instances.h>
+#include <stdio.h>
+#include <tester.h>
+
+unsigned int test_load();
+unsigned int test_missingMesh();
+
+int main() {
+  tester_init();
+  eval(test_load);
+  eval(test_missingMesh);
+  return 0;
+}
+
+bool writeText(const char* fileName, const char* text) {
+  FILE* file = fopen(fileName, "w");
+  if (file == NULL) return false;
+  fputs(text, file);
+  return fclose(file) == 0;
+}
+
+unsigned int test_load() {
+  // The mesh path is relative to the instance file, lines of a wrong number
+  // of values are skipped
+  if (!writeText("test/bin/part.obj", "v 0 0 0\nv 2 0 0\nv 0 2 0\nf 1 2 3\n"))
+    return 1;
+  if (!writeText("test/bin/parts.instances",
+                 "# parts\nmesh part.obj\ninstance 0 1 2 3\n"
+                 "instance 0 1 0 0 5 0 1 0 0 0 0 1 0\ninstance 0 1 2\n"))
+    return 2;
+  InstanceSet* set = InstanceSet_load("test/bin/parts.instances");
+  if (set == NULL) return 3;
+  unsigned int result = 0;
+  if (set->meshCount != 1 || set->instanceCount != 2) result = 4;
+  if (!around(set->meshes[0].radius, sqrt(2), 1e-9)) result = 5;
+  InstanceSet_free(set);
+  return result;
+}
+
+unsigned int test_missingMesh() {
+  // A mesh that can not be loaded fails the whole file instead of leaving
+  // its instances empty
+  if (!writeText("test/bin/missing.instances",
+                 "mesh part.obj\nmesh missing.obj\ninstance 1 0 0 0\n"))
+    return 1;
+  if (InstanceSet_load("test/bin/missing.instances") != NULL) return 2;
+  if (InstanceSet_load("test/bin/nothing.instances") != NULL) return 3;
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include <meshfile.h>
+#include <stdio.h>
+#include <tester.h>
+
+unsigned int test_formats();
+unsigned int test_ply();
+unsigned int test_plyBlocks();
+unsigned int test_plyErrors();
+unsigned int test_stl();
+unsigned int test_stlErrors();
+
+const int corners[8][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1},
+                           {-1, 1, -1},  {-1, -1, 1}, {1, -1, 1},
+                           {1, 1, 1},    {-1, 1, 1}};
+// Counter-clockwise seen from the outside, 0 based
+const int quads[6][4] = {{3, 2, 1, 0}, {4, 5, 6, 7}, {0, 1, 5, 4},
+                         {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}};
+
+int main() {
+  tester_init();
+  eval(test_formats);
+  eval(test_ply);
+  eval(test_plyBlocks);
+  eval(test_plyErrors);
+  eval(test_stl);
+  eval(test_stlErrors);
+  return 0;
+}
+
+// Little-endian writers of the fixtures, they return the end of the value
+uint8_t* putUint32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+  return out + 4;
+}
+
+uint8_t* putFloat(uint8_t* out, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, 4);
+  return putUint32(out, bits);
+}
+
+uint8_t* putDouble(uint8_t* out, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, 8);
+  out = putUint32(out, (uint32_t)bits);
+  return putUint32(out, (uint32_t)(bits >> 32));
+}
+
+uint8_t* putText(uint8_t* out, const char* text) {
+  size_t length = strlen(text);
+  memcpy(out, text, length);
+  return out + length;
+}
+
+bool writeFile(const char* fileName, const uint8_t* data, size_t size) {
+  FILE* file = fopen(fileName, "wb");
+  if (file == NULL) return false;
+  bool written = fwrite(data, 1, size, file) == size;
+  fclose(file);
+  return written;
+}
+
+Scene emptyScene() {
+  Scene scene;
+  Scene_init(&scene, NULL);
+  return scene;
+}
+
+// The cube with an unused color between the coordinates, a flag before the
+// vertex list of the faces, an element of no interest and the diagonal of the
+// cube as an edge
+size_t makeCubePly(uint8_t* out) {
+  uint8_t* end = putText(
+      out,
+      "ply\r\nformat binary_little_endian 1.0\r\ncomment cube\r\n"
+      "element vertex 8\r\nproperty float x\r\nproperty uchar red\r\n"
+      "property float y\r\nproperty float z\r\n"
+      "element face 6\r\nproperty uchar flags\r\n"
+      "property list uchar int vertex_indices\r\n"
+      "element material 2\r\nproperty double shininess\r\n"
+      "element edge 1\r\nproperty int vertex1\r\nproperty uint vertex2\r\n"
+      "end_header\r\n");
+  for (int i = 0; i < 8; i++) {
+    end = putFloat(end, corners[i][0]);
+    *end++ = 255;
+    end = putFloat(end, corners[i][1]);
+    end = putFloat(end, corners[i][2]);
+  }
+  for (int i = 0; i < 6; i++) {
+    *end++ = 1;
+    *end++ = 4;
+    for (int k = 0; k < 4; k++) end = putUint32(end, quads[i][k]);
+  }
+  end = putDouble(putDouble(end, 0.5), 0.25);
+  end = putUint32(putUint32(end, 0), 6);
+  return end - out;
+}
+
+// Both triangles of every face of the cube, with their corners repeated
+size_t makeCubeStl(uint8_t* out) {
+  memset(out, ' ', 80);
+  memcpy(out, "solid cube", 10);
+  uint8_t* end = putUint32(out + 80, 12);
+  for (int i = 0; i < 6; i++) {
+    for (int t = 0; t < 2; t++) {
+      const int triangle[3] = {quads[i][0], quads[i][1 + t], quads[i][2 + t]};
+      for (int k = 0; k < 3; k++) end = putFloat(end, 0);
+      for (int k = 0; k < 3; k++)
+        for (int c = 0; c < 3; c++)
+          end = putFloat(end, corners[triangle[k]][c]);
+      *end++ = 0;
+      *end++ = 0;
+    }
+  }
+  return end - out;
+}
+
+unsigned int test_formats() {
+  if (MeshFile_formatOf("scan.ply") != MESHFILE_PLY) return 1;
+  if (MeshFile_formatOf("PART.STL") != MESHFILE_STL) return 2;
+  if (MeshFile_formatOf("scene.obj.gz") != MESHFILE_OBJ) return 3;
+  if (MeshFile_formatOf(".stl") != MESHFILE_OBJ) return 4;
+  if (MeshFile_typeOf("uchar") != MESHFILE_UINT8 ||
+      MeshFile_typeOf("float64") != MESHFILE_FLOAT64 ||
+      MeshFile_typeOf("half") != MESHFILE_INVALID)
+    return 5;
+  const uint8_t value[8] = {0xFE, 0xFF, 0xFF, 0xFF, 0, 0, 0xF0, 0x3F};
+  if (MeshFile_value(value, MESHFILE_INT16) != -2 ||
+      MeshFile_value(value, MESHFILE_UINT16) != 65534 ||
+      MeshFile_value(value, MESHFILE_INT32) != -2 ||
+      MeshFile_value(&value[4], MESHFILE_UINT32) != 0x3FF00000 ||
+      MeshFile_value(value, MESHFILE_INT8) != -2)
+    return 6;
+  return 0;
+}
+
+unsigned int test_ply() {
+  uint8_t data[1024];
+  if (!writeFile("test/bin/cube.ply", data, makeCubePly(data))) return 1;
+  Scene scene = emptyScene();
+  if (!MeshFile_load(&scene, "test/bin/cube.ply")) return 2;
+  // The edges shared by two faces are only kept once, the faces are counted
+  // from 1
+  if (scene.verticesCount != 8 || scene.edgeCount != 13) return 3;
+  if (scene.faceCount != 7) return 4;
+  if (!around(scene.vertices[6].x, 1, 1e-9) ||
+      !around(scene.vertices[6].y, 1, 1e-9) ||
+      !around(scene.vertices[6].z, 1, 1e-9))
+    return 5;
+  long int paired = 0;
+  for (long int i = 0; i < scene.edgeCount; i++)
+    paired += scene.edgeFaces[i].a != 0 && scene.edgeFaces[i].b != 0;
+  if (paired != 12) return 6;
+
+  // A second file goes after the geometry already loaded, its indices are
+  // relative to its own vertices
+  if (!MeshFile_load(&scene, "test/bin/cube.ply")) return 7;
+  if (scene.verticesCount != 16 || scene.edgeCount != 26) return 8;
+  if (scene.objectCount != 2 || scene.objects[1].vertexBegin != 8 ||
+      scene.objects[1].edgeBegin != 13)
+    return 9;
+  for (long int i = 13; i < 26; i++)
+    if (scene.edges[i].a < 8 || scene.edges[i].b < 8) return 10;
+  Scene_free(&scene);
+
+  // The edges of the geometry loaded before are not merged again, a
+  // repeated edge stays
+  scene = emptyScene();
+  Scene_beginObject(&scene);
+  Scene_pushVertex(&scene, Vec3_new(0, 0, 0));
+  Scene_pushVertex(&scene, Vec3_new(1, 0, 0));
+  Scene_appendEdge(&scene, 0, 1);
+  Scene_appendEdge(&scene, 0, 1);
+  if (!MeshFile_load(&scene, "test/bin/cube.ply")) return 11;
+  if (scene.edgeCount != 2 + 13 || scene.objects[0].edgeEnd != 2) return 12;
+  if (scene.objects[1].edgeBegin != 2 || scene.objects[1].edgeEnd != 15)
+    return 13;
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_plyBlocks() {
+  // A grid in doubles with a lot of properties that are skipped, so the
+  // vertices take more than a block and records are cut by its end
+  const int n = 100, extra = MESHFILE_MAX_PROPERTIES - 3;
+  size_t size = 4096 + (size_t)(n + 1) * (n + 1) * (3 + extra) * 8 +
+                (size_t)n * n * 19;
+  uint8_t* data = (uint8_t*)malloc(size);
+  char header[4096];
+  int length = sprintf(header,
+                       "ply\nformat binary_little_endian 1.0\n"
+                       "element vertex %d\nproperty double x\n"
+                       "property double y\nproperty double z\n",
+                       (n + 1) * (n + 1));
+  for (int i = 0; i < extra; i++)
+    length += sprintf(header + length, "property float64 extra%d\n", i);
+  sprintf(header + length,
+          "element face %d\nproperty list uint16 uint32 vertex_index\n"
+          "end_header\n",
+          n * n);
+  uint8_t* end = putText(data, header);
+  for (int j = 0; j <= n; j++) {
+    for (int i = 0; i <= n; i++) {
+      end = putDouble(putDouble(putDouble(end, i), j), sin(i + j));
+      for (int k = 0; k < extra; k++) end = putDouble(end, k);
+    }
+  }
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      // uint16 count, then the corners
+      *end++ = 4;
+      *end++ = 0;
+      end = putUint32(end, j * (n + 1) + i);
+      end = putUint32(end, j * (n + 1) + i + 1);
+      end = putUint32(end, (j + 1) * (n + 1) + i + 1);
+      end = putUint32(end, (j + 1) * (n + 1) + i);
+    }
+  }
+  size = end - data;
+  bool written = writeFile("test/bin/grid.ply", data, size);
+  free(data);
+  if (size < 2 * MESHFILE_BLOCK_SIZE) return 1;
+  if (!written) return 2;
+
+  Scene scene = emptyScene();
+  if (!MeshFile_load(&scene, "test/bin/grid.ply")) return 3;
+  if (scene.verticesCount != (n + 1) * (n + 1)) return 4;
+  if (scene.edgeCount != 2 * n * (n + 1) || scene.faceCount != n * n + 1)
+    return 5;
+  Vec3 last = scene.vertices[scene.verticesCount - 1];
+  if (last.x != n || last.y != n || last.z != sin(2 * n)) return 6;
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_plyErrors() {
+  uint8_t data[1024], damaged[1024];
+  size_t size = makeCubePly(data);
+  Scene scene = emptyScene();
+
+  // Faces and the edge with vertices out of range are left out
+  size_t faces = size - 16 - 8 - 6 * 18;
+  memcpy(damaged, data, size);
+  putUint32(&damaged[faces + 2 + 4], 8);
+  putUint32(&damaged[size - 4], 100);
+  writeFile("test/bin/range.ply", damaged, size);
+  if (!MeshFile_load(&scene, "test/bin/range.ply")) return 1;
+  if (scene.verticesCount != 8 || scene.faceCount != 6) return 2;
+  if (scene.edgeCount != 12) return 3;
+  Scene_free(&scene);
+
+  // Truncated in the faces, what was read is kept
+  scene = emptyScene();
+  writeFile("test/bin/cut.ply", data, faces + 40);
+  if (MeshFile_load(&scene, "test/bin/cut.ply")) return 4;
+  if (scene.verticesCount != 8 || scene.faceCount != 3) return 5;
+  Scene_free(&scene);
+
+  // A face longer than MESHFILE_MAX_POLYGON vertices
+  scene = emptyScene();
+  memcpy(damaged, data, size);
+  uint8_t* header = (uint8_t*)strstr((char*)damaged, "uchar int");
+  memcpy(header, "short int", 9);
+  memmove(&damaged[faces + 2], &damaged[faces + 1], size - faces - 1);
+  damaged[faces + 1] = 0x01;
+  damaged[faces + 2] = 0x01;
+  writeFile("test/bin/long.ply", damaged, size + 1);
+  if (MeshFile_load(&scene, "test/bin/long.ply")) return 6;
+  if (scene.faceCount > 1) return 7;
+  Scene_free(&scene);
+
+  // Text and big-endian files and headers without an end are not loaded
+  const char* headers[3] = {
+      "ply\nformat ascii 1.0\nelement vertex 0\nend_header\n",
+      "ply\nformat binary_big_endian 1.0\nelement vertex 0\nend_header\n",
+      "ply\nformat binary_little_endian 1.0\nelement vertex 0\n"};
+  for (int i = 0; i < 3; i++) {
+    scene = emptyScene();
+    writeFile("test/bin/header.ply", (const uint8_t*)headers[i],
+              strlen(headers[i]));
+    if (MeshFile_load(&scene, "test/bin/header.ply")) return 8 + i;
+    if (scene.verticesCount != 0) return 11;
+    Scene_free(&scene);
+  }
+  return 0;
+}
+
+unsigned int test_stl() {
+  uint8_t data[1024];
+  if (!writeFile("test/bin/cube.stl", data, makeCubeStl(data))) return 1;
+  // The scene already has a vertex at a corner of the cube and a repeated
+  // vertex, neither is merged with the new ones
+  Scene scene = emptyScene();
+  Scene_pushVertex(&scene, Vec3_new(1, 1, 1));
+  Scene_pushVertex(&scene, Vec3_new(5, 5, 5));
+  Scene_pushVertex(&scene, Vec3_new(5, 5, 5));
+  Scene_appendEdge(&scene, 0, 2);
+  if (!MeshFile_load(&scene, "test/bin/cube.stl")) return 2;
+  // The 36 corners are merged into the 8 vertices, the edges of the cube and
+  // a diagonal on every face remain
+  if (scene.verticesCount != 3 + 8 || scene.edgeCount != 1 + 18) return 3;
+  if (scene.faceCount != 13) return 4;
+  if (scene.vertices[0].x != 1 || scene.vertices[2].x != 5) return 5;
+  if (scene.edges[0].a != 0 || scene.edges[0].b != 2) return 6;
+  SceneObject* cube = &scene.objects[scene.objectCount - 1];
+  if (cube->vertexBegin != 3 || cube->vertexEnd != 11) return 7;
+  if (cube->edgeBegin != 1 || cube->edgeEnd != 19) return 8;
+  for (long int i = 1; i < scene.edgeCount; i++)
+    if (scene.edgeFaces[i].a == 0 || scene.edgeFaces[i].b == 0) return 9;
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_stlErrors() {
+  uint8_t data[1024];
+  size_t size = makeCubeStl(data);
+  // Text STL starts like the header of a binary one, but its size does not
+  // match the triangle count it would have
+  const char* text =
+      "solid cube\n facet normal 0 0 1\n  outer loop\n"
+      "   vertex 0 0 0\n   vertex 1 0 0\n   vertex 1 1 0\n"
+      "  endloop\n endfacet\nendsolid cube\n";
+  Scene scene = emptyScene();
+  writeFile("test/bin/text.stl", (const uint8_t*)text, strlen(text));
+  if (MeshFile_load(&scene, "test/bin/text.stl")) return 1;
+  if (scene.verticesCount != 0) return 2;
+  writeFile("test/bin/cut.stl", data, size - 60);
+  if (MeshFile_load(&scene, "test/bin/cut.stl")) return 3;
+  if (scene.verticesCount != 0) return 4;
+  writeFile("test/bin/empty.stl", data, 40);
+  if (MeshFile_load(&scene, "test/bin/empty.stl")) return 5;
+  // A binary file of no triangles is valid, even though its header starts
+  // with "solid"
+  putUint32(&data[80], 0);
+  writeFile("test/bin/empty.stl", data, MESHFILE_STL_HEADER);
+  if (!MeshFile_load(&scene, "test/bin/empty.stl")) return 6;
+  if (scene.verticesCount != 0 || scene.edgeCount != 0) return 7;
+  // Text of the same size reads as a count of triangles that is not there
+  memcpy(&data[80], "\n\n\n\n", 4);
+  writeFile("test/bin/empty.stl", data, MESHFILE_STL_HEADER);
+  if (MeshFile_load(&scene, "test/bin/empty.stl")) return 8;
+  Scene_free(&scene);
+  return 0;
+}
\ No newline at end of file
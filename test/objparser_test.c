@@ -0,0 +1,150 @@
+#include <objparser.h>
+#include <stdio.h>
+#include <tester.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+unsigned int test_chunks();
+unsigned int test_lastLine();
+unsigned int test_pipe();
+unsigned int test_objects();
+
+// The faces are wound counter-clockwise seen from the outside
+const char* cube =
+    "# cube\n"
+    "v -1 -1 -1\nv 1 -1 -1\nv 1 1 -1\nv -1 1 -1\n"
+    "v -1 -1 1\nv 1 -1 1\nv 1 1 1\nv -1 1 1\n"
+    "f 4 3 2 1\nf 5 6 7 8\nf 1 2 6 5\nf 2 3 7 6\nf 3 4 8 7\nf 4 1 5 8\n"
+    "l 1 7\n";
+
+int main() {
+  tester_init();
+  eval(test_chunks);
+  eval(test_lastLine);
+  eval(test_pipe);
+  eval(test_objects);
+  return 0;
+}
+
+// Parses the text by feeding it to a parser in chunks of the given size
+Scene parseInChunks(const char* text, size_t chunkSize) {
+  Scene scene;
+  Scene_init(&scene, NULL);
+  scene.minEdgeLength = 0;
+  scene.singlePrecision = false;
+  ObjParser* parser = ObjParser_create(&scene);
+  size_t length = strlen(text);
+  for (size_t i = 0; i < length; i += chunkSize) {
+    size_t size = length - i < chunkSize ? length - i : chunkSize;
+    ObjParser_feed(parser, text + i, size);
+  }
+  ObjParser_finish(parser);
+  return scene;
+}
+
+unsigned int test_chunks() {
+  Scene whole = parseInChunks(cube, 1 << 20);
+  if (whole.verticesCount != 8) return 1;
+  if (whole.edgeCount != 13) return 2;
+  // Lines split at every possible position have to give the same result
+  for (size_t size = 1; size < 32; size++) {
+    Scene scene = parseInChunks(cube, size);
+    if (scene.verticesCount != whole.verticesCount) return 3;
+    if (scene.edgeCount != whole.edgeCount) return 4;
+    if (memcmp(scene.vertices, whole.vertices, 8 * sizeof(Vec3)) != 0)
+      return 5;
+    if (memcmp(scene.edges, whole.edges, 13 * sizeof(Edge)) != 0) return 6;
+    Scene_free(&scene);
+  }
+  Scene_free(&whole);
+  return 0;
+}
+
+unsigned int test_lastLine() {
+  // No line break at the end of the file, the last line is parsed by finish
+  Scene scene = parseInChunks("v 1 2 3\r\nv 4 5 6\r\nv 7 8 9\r\nf 1 2 3", 5);
+  if (scene.verticesCount != 3) return 1;
+  if (!around(scene.vertices[2].z, 9, 1e-9)) return 2;
+  if (scene.edgeCount != 3) return 3;
+  Scene_free(&scene);
+  // Faces referring to vertices that do not exist are skipped
+  scene = parseInChunks("v 0 0 0\nf 1 2 3\nf\n", 3);
+  if (scene.edgeCount != 0) return 4;
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_pipe() {
+#ifndef _WIN32
+  int fds[2];
+  if (pipe(fds) != 0) return 1;
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  Scene scene;
+  Scene_init(&scene, NULL);
+  ObjParser* parser = ObjParser_create(&scene);
+  // Nothing written yet, the reader has to wait instead of finishing
+  if (ObjParser_read(parser, fds[0]) != -1) return 2;
+  if (write(fds[1], "v 1 1 1\nv 2 2", 13) != 13) return 3;
+  if (ObjParser_read(parser, fds[0]) != 13) return 4;
+  if (scene.verticesCount != 1) return 5;
+  if (write(fds[1], " 2\n", 3) != 3) return 6;
+  close(fds[1]);
+  if (ObjParser_read(parser, fds[0]) != 3) return 7;
+  if (ObjParser_read(parser, fds[0]) != 0) return 8;
+  ObjParser_finish(parser);
+  close(fds[0]);
+  if (scene.verticesCount != 2) return 9;
+  Scene_free(&scene);
+
+  // The blocking loader reading a slow pipe from the standard input has to
+  // wait for the rest of the file instead of stopping at the pause, even if
+  // the input was left non-blocking by someone else
+  if (pipe(fds) != 0) return 10;
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  pid_t writer = fork();
+  if (writer == 0) {
+    close(fds[0]);
+    if (write(fds[1], cube, 30) != 30) _exit(1);
+    usleep(200000);
+    size_t rest = strlen(cube) - 30;
+    _exit(write(fds[1], cube + 30, rest) == (long int)rest ? 0 : 1);
+  }
+  close(fds[1]);
+  int input = dup(0);
+  dup2(fds[0], 0);
+  close(fds[0]);
+  Scene_init(&scene, NULL);
+  Scene_loadObj(&scene, "-");
+  bool blocking = (fcntl(0, F_GETFL) & O_NONBLOCK) == 0;
+  dup2(input, 0);
+  close(input);
+  int status;
+  waitpid(writer, &status, 0);
+  if (scene.verticesCount != 8 || scene.edgeCount != 13) return 11;
+  if (!blocking) return 12;
+  Scene_free(&scene);
+#endif
+  return 0;
+}
+
+unsigned int test_objects() {
+  // The second object uses a vertex of the first one, the empty o record
+  // before the g record does not make an object of its own
+  Scene scene = parseInChunks(
+      "o a\nv 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n"
+      "o b\ng b\nv 5 5 5\nv 6 5 5\nl 3 4 5\n"
+      "o c\nv 100 0 0\nv 101 0 0\nl 6 7\n",
+      7);
+  if (scene.objectCount != 3) return 1;
+  SceneObject* a = &scene.objects[0];
+  SceneObject* b = &scene.objects[1];
+  if (a->vertexBegin != 0 || a->vertexEnd != 3) return 2;
+  if (a->edgeBegin != 0 || a->edgeEnd != 3) return 3;
+  if (b->vertexBegin != 2 || b->vertexEnd != 5) return 4;
+  if (b->edgeBegin != 3 || b->edgeEnd != 5) return 5;
+  if (!around(b->min.x, 1, 1e-9) || !around(b->max.x, 6, 1e-9)) return 6;
+  if (!around(b->center.y, 3, 1e-9)) return 7;
+  Scene_free(&scene);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include <decompress.h>
+#include <png.h>
+#include <stdio.h>
+#include <tester.h>
+#include <unistd.h>
+
+unsigned int test_chunks();
+unsigned int test_roundTrip();
+unsigned int test_distances();
+
+int main() {
+  tester_init();
+  eval(test_chunks);
+  eval(test_roundTrip);
+  eval(test_distances);
+  return 0;
+}
+
+// Reads a big endian number of the file
+uint32_t getUint32(const uint8_t* data) {
+  return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+         (uint32_t)data[2] << 8 | data[3];
+}
+
+// Draws a frame like the renderer does: the background with lines and a
+// band of noise, the pixels of every period-th row below the band repeat
+uint8_t* makeImage(int width, int height, int period) {
+  uint8_t* rgba = (uint8_t*)malloc((size_t)width * height * 4);
+  uint32_t random = 12345;
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      uint8_t* pixel = &rgba[((size_t)y * width + x) * 4];
+      random = random * 1103515245 + 12345;
+      uint8_t value = x == y || x == width / 2 ? 0xFF : 0x10;
+      if (y >= height / 2) value = random >> 24;
+      if (y >= height / 2 + period)
+        value = rgba[((size_t)(y - period) * width + x) * 4];
+      pixel[0] = pixel[1] = pixel[2] = value;
+      pixel[3] = 0xFF;
+    }
+  }
+  return rgba;
+}
+
+// Finds the chunk of the given type and returns its data and length, NULL if
+// it is not there
+const uint8_t* findChunk(const uint8_t* png, size_t size, const char* type,
+                         uint32_t* length) {
+  for (size_t i = 8; i + 12 <= size; i += 12 + getUint32(&png[i])) {
+    if (memcmp(&png[i + 4], type, 4) != 0) continue;
+    *length = getUint32(&png[i]);
+    return &png[i + 8];
+  }
+  return NULL;
+}
+
+// Decompresses the deflate data of the IDAT chunk through the inflater of
+// gzip files, by wrapping it into a member with the CRC and size of the
+// expected output
+size_t inflate(const uint8_t* deflate, size_t size, const uint8_t* expected,
+               size_t expectedSize, uint8_t* out, bool* failed) {
+  PngEncoder encoder;
+  Png_init(&encoder);
+  uint8_t* member = (uint8_t*)malloc(size + 18);
+  const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+  memcpy(member, header, 10);
+  memcpy(&member[10], deflate, size);
+  uint32_t trailer[2] = {Png_crc(&encoder, expected, expectedSize),
+                         (uint32_t)expectedSize};
+  for (int k = 0; k < 8; k++)
+    member[10 + size + k] = (uint8_t)(trailer[k / 4] >> (8 * (k % 4)));
+
+  int fds[2];
+  *failed = true;
+  if (pipe(fds) != 0) {
+    free(member);
+    return 0;
+  }
+  close(fds[1]);
+  Decompressor* stream = Decompress_start(
+      fds[0], Decompress_formatOf(member, size + 18), member, size + 18);
+  size_t length = 0;
+  const char* chunk;
+  long int chunkLength;
+  while ((chunkLength = Decompress_next(stream, &chunk, true)) > 0) {
+    if (length + chunkLength <= expectedSize)
+      memcpy(&out[length], chunk, chunkLength);
+    length += chunkLength;
+    Decompress_release(stream);
+  }
+  *failed = stream->failed;
+  Decompress_stop(stream);
+  close(fds[0]);
+  free(member);
+  return length;
+}
+
+// Encodes the image, inflates its IDAT chunk and checks it against the
+// filtered rows and the image by undoing the filters
+unsigned int roundTrip(const uint8_t* rgba, int width, int height) {
+  size_t size;
+  uint8_t* png = Png_encode(rgba, width, height, &size);
+  size_t stride = (size_t)width * 4, rawSize = (stride + 1) * height;
+  uint8_t* raw = (uint8_t*)malloc(rawSize);
+  uint8_t* out = (uint8_t*)malloc(rawSize);
+  Png_filterRows(rgba, width, height, raw);
+
+  unsigned int result = 0;
+  uint32_t length;
+  const uint8_t* idat = findChunk(png, size, "IDAT", &length);
+  bool failed;
+  if (idat == NULL || length < 6) {
+    result = 1;
+  } else if ((idat[0] * 256 + idat[1]) % 31 != 0 || (idat[0] & 0x0F) != 8) {
+    result = 2;
+  } else if (getUint32(&idat[length - 4]) != Png_adler(raw, rawSize)) {
+    result = 3;
+  } else if (inflate(&idat[2], length - 6, raw, rawSize, out, &failed) !=
+                 rawSize ||
+             failed) {
+    result = 4;
+  } else if (memcmp(out, raw, rawSize) != 0) {
+    result = 5;
+  }
+
+  // Undo the none, sub and up filters in place
+  for (int y = 0; y < height && result == 0; y++) {
+    uint8_t* row = &out[y * (stride + 1)];
+    if (row[0] > 2) result = 6;
+    for (size_t i = 0; i < stride && result == 0; i++) {
+      uint8_t* value = &row[i + 1];
+      if (row[0] == 1 && i >= 4) *value += row[i + 1 - 4];
+      if (row[0] == 2 && y > 0) *value += row[i + 1 - (stride + 1)];
+      if (*value != rgba[y * stride + i]) result = 7;
+    }
+  }
+  free(png);
+  free(raw);
+  free(out);
+  return result;
+}
+
+unsigned int test_chunks() {
+  int width = 64, height = 48;
+  uint8_t* rgba = makeImage(width, height, 3);
+  size_t size;
+  uint8_t* png = Png_encode(rgba, width, height, &size);
+  const uint8_t signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+  if (size < 8 || memcmp(png, signature, 8) != 0) return 1;
+
+  // The chunks follow each other to the end of the file with valid CRCs,
+  // IHDR first and IEND last
+  PngEncoder encoder;
+  Png_init(&encoder);
+  const char* types[3] = {"IHDR", "IDAT", "IEND"};
+  size_t i = 8;
+  for (int chunk = 0; chunk < 3; chunk++) {
+    if (i + 12 > size) return 2;
+    uint32_t length = getUint32(&png[i]);
+    if (i + 12 + length > size) return 3;
+    if (memcmp(&png[i + 4], types[chunk], 4) != 0) return 4;
+    uint32_t crc = Png_crc(&encoder, &png[i + 4], length + 4);
+    if (getUint32(&png[i + 8 + length]) != crc) return 5;
+    i += 12 + length;
+  }
+  if (i != size) return 6;
+
+  uint32_t length;
+  const uint8_t* ihdr = findChunk(png, size, "IHDR", &length);
+  if (length != 13 || getUint32(ihdr) != (uint32_t)width ||
+      getUint32(&ihdr[4]) != (uint32_t)height)
+    return 7;
+  if (ihdr[8] != 8 || ihdr[9] != 6 || ihdr[12] != 0) return 8;
+  // The CRC of the empty IEND chunk is known
+  if (getUint32(&png[size - 4]) != 0xAE426082) return 9;
+  free(png);
+  free(rgba);
+  return 0;
+}
+
+unsigned int test_roundTrip() {
+  // Odd sizes, a single pixel and a single column, and a frame that
+  // compresses well
+  const int sizes[4][2] = {{1, 1}, {1, 17}, {33, 7}, {320, 240}};
+  for (int i = 0; i < 4; i++) {
+    uint8_t* rgba = makeImage(sizes[i][0], sizes[i][1], 5);
+    unsigned int result = roundTrip(rgba, sizes[i][0], sizes[i][1]);
+    free(rgba);
+    if (result != 0) return i * 10 + result;
+  }
+  return 0;
+}
+
+unsigned int test_distances() {
+  // Noise that repeats every 7 rows of 4001 bytes, the matches reach back
+  // 28007 bytes and use the longest distance codes
+  int width = 1000, height = 40;
+  uint8_t* rgba = makeImage(width, height, 7);
+  unsigned int result = roundTrip(rgba, width, height);
+  // Only the first 7 rows of noise are written as literals
+  size_t size;
+  uint8_t* png = Png_encode(rgba, width, height, &size);
+  if (result == 0 && size > (size_t)width * 4 * height / 3) result = 10;
+  free(png);
+  free(rgba);
+  return result;
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include <scene.h>
+#include <stdio.h>
+#include <tester.h>
+
+unsigned int test_culling();
+unsigned int test_guardBand();
+unsigned int test_features();
+unsigned int test_precision();
+unsigned int test_weld();
+
+// The faces are wound counter-clockwise seen from the outside
+const char* cube =
+    "v -1 -1 -1\nv 1 -1 -1\nv 1 1 -1\nv -1 1 -1\n"
+    "v -1 -1 1\nv 1 -1 1\nv 1 1 1\nv -1 1 1\n"
+    "f 4 3 2 1\nf 5 6 7 8\nf 1 2 6 5\nf 2 3 7 6\nf 3 4 8 7\nf 4 1 5 8\n"
+    "l 1 7\n";
+
+int main() {
+  tester_init();
+  eval(test_culling);
+  eval(test_guardBand);
+  eval(test_features);
+  eval(test_precision);
+  eval(test_weld);
+  return 0;
+}
+
+// Builds a scene from the lines of the .obj text
+Scene loadText(const char* text) {
+  Scene scene;
+  Scene_init(&scene, NULL);
+  scene.minEdgeLength = 0;
+  scene.singlePrecision = false;
+  char line[256];
+  while (*text != '\0') {
+    size_t length = strcspn(text, "\n");
+    memcpy(line, text, length);
+    line[length] = '\0';
+    Scene_parseObjLine(&scene, line);
+    text += length + (text[length] == '\n');
+  }
+  Scene_markChanged(&scene);
+  return scene;
+}
+
+unsigned int test_culling() {
+  // Two overlapping objects in front of the camera and one far to the side
+  Scene scene = loadText(
+      "o a\nv 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n"
+      "o b\ng b\nv 5 5 5\nv 6 5 5\nl 3 4 5\n"
+      "o c\nv 100 0 0\nv 101 0 0\nl 6 7\n");
+  if (scene.objectCount != 3) return 1;
+
+  // The third object is far to the side of the camera, the vertex ranges of
+  // the other two overlap and are projected together
+  scene.cam = Camera_new(Vec3_new(0.5, 0.5, 3), Vec3_new(0, 1, 0), 100, 100,
+                         3.14 / 3, 3.14 / 3);
+  Vec3 direction = Vec3_new(0, 0, -1);
+  Camera_setLookDirection(&scene.cam, &direction);
+  Scene_projectPoints(&scene);
+  Scene_compactEdges(&scene);
+  if (scene.visibleObjectCount != 2 || scene.visibleObjects[1] != 1) return 2;
+  if (scene.rangeCount != 1 || scene.ranges[0].end != 5) return 3;
+  // The edges of the second object go behind the camera
+  if (scene.visibleEdgeCount != 3) return 4;
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_guardBand() {
+  // From the middle of the screen to far outside of the guard band, and
+  // across the whole screen with both ends outside of it
+  Scene scene = loadText(
+      "v 0.5 0.5 0\nv 500 0.5 0\nv -500 0.6 0\nl 1 2\nl 3 2\n");
+  scene.cam = Camera_new(Vec3_new(0.5, 0.5, 3), Vec3_new(0, 1, 0), 100, 100,
+                         3.14 / 3, 3.14 / 3);
+  Vec3 direction = Vec3_new(0, 0, -1);
+  Camera_setLookDirection(&scene.cam, &direction);
+  Scene_projectPoints(&scene);
+  Scene_compactEdges(&scene);
+  if (scene.visibility[1] & SCENE_VISIBLE_GUARD) return 1;
+  if (scene.visibleEdgeCount != 2 || scene.droppedEdgeCount != 0) return 2;
+
+  // The ends outside are moved onto the border of the band, the rest stays
+  // The screen is mirrored, +x in the scene goes to the left
+  double minX = -SCENE_GUARD_BAND * 100, maxX = (1 + SCENE_GUARD_BAND) * 100;
+  Point a, b;
+  if (!Scene_edgePoints(&scene, scene.visibleEdges[0], &a, &b)) return 3;
+  Point center = scene.projectedPoints[0];
+  if (a.x != center.x || a.y != center.y) return 4;
+  if (!around(b.x, minX, 1e-9) || !around(b.y, center.y, 1e-6)) return 5;
+  if (!Scene_edgePoints(&scene, scene.visibleEdges[1], &a, &b)) return 6;
+  if (!around(fmin(a.x, b.x), minX, 1e-9) ||
+      !around(fmax(a.x, b.x), maxX, 1e-9))
+    return 7;
+
+  // Segments that pass the band, or do not end anywhere, are left out
+  a = Point_new(-1000, 50);
+  b = Point_new(50, -1000);
+  if (Scene_clipToGuardBand(&a, &b, 100, 100)) return 8;
+  a = Point_new(50, 50);
+  b = Point_new(INFINITY, 50);
+  if (Scene_clipToGuardBand(&a, &b, 100, 100)) return 9;
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_features() {
+  Scene scene = loadText(cube);
+  // The faces of the cube meet at right angles, the polyline has no faces
+  for (long int i = 0; i < 12; i++) {
+    if (scene.edgeFaces[i].a == 0 || scene.edgeFaces[i].b == 0) return 1;
+    if (!around(scene.dihedral[i], 0, 1e-6)) return 2;
+  }
+  if (scene.dihedral[12] != SCENE_OPEN_EDGE) return 3;
+
+  // Looking at a corner, three faces are turned towards the camera and the
+  // six edges around them make the silhouette, the edges between them are
+  // only drawn while they count as creases
+  scene.cam = Camera_new(Vec3_new(4, 5, 6), Vec3_new(0, 1, 0), 100, 100,
+                         3.14 / 2, 3.14 / 2);
+  Vec3 direction = Vec3_new(-4, -5, -6);
+  Camera_setLookDirection(&scene.cam, &direction);
+  scene.featureEdges = true;
+  scene.creaseAngle = M_PI / 4;
+  Scene_projectPoints(&scene);
+  Scene_compactEdges(&scene);
+  if (scene.visibleEdgeCount != 13) return 4;
+  scene.creaseAngle = M_PI * 3 / 4;
+  Scene_markChanged(&scene);
+  Scene_projectPoints(&scene);
+  Scene_compactEdges(&scene);
+  // The silhouette and the polyline
+  if (scene.visibleEdgeCount != 7) return 5;
+  // Without features only the edges next to the three faces turned away
+  // from the camera are culled, the polyline is kept
+  scene.featureEdges = false;
+  scene.backfaceCulling = true;
+  Scene_markChanged(&scene);
+  Scene_projectPoints(&scene);
+  Scene_compactEdges(&scene);
+  if (scene.visibleEdgeCount != 10 || scene.culledEdgeCount != 3) return 6;
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_precision() {
+  // A 10 m wide patch of a scan with coordinates in the millions (as in
+  // georeferenced data), seen from a few meters away, with a vertex count
+  // that leaves some vertices for the scalar loop
+  Scene scene = loadText("");
+  Vec3 offset = Vec3_new(650000.25, 5200000.75, 310.5);
+  for (int i = 0; i < 23; i++) {
+    for (int j = 0; j < 23; j++) {
+      Vec3 v = Vec3_new(i * 0.45, j * 0.45, sin(i + j) * 0.3);
+      Vec3_add(&v, &offset);
+      Scene_pushVertex(&scene, v);
+    }
+  }
+  // The model transform is applied in both paths
+  scene.model.m[0][3] = 2;
+  scene.model.m[1][3] = -1;
+
+  scene.cam = Camera_new(Vec3_new(offset.x + 7, offset.y + 4, offset.z + 6),
+                         Vec3_new(0, 1, 0), 1000, 1000, 3.14 / 2, 3.14 / 2);
+  Vec3 direction = Vec3_new(0.1, 0.2, -1);
+  Camera_setLookDirection(&scene.cam, &direction);
+  Scene_projectPoints(&scene);
+  long int count = scene.verticesCount;
+  Point* reference = (Point*)malloc(count * sizeof(Point));
+  unsigned char* mask = (unsigned char*)malloc(count);
+  memcpy(reference, scene.projectedPoints, count * sizeof(Point));
+  memcpy(mask, scene.visibility, count);
+
+  // The single precision points have to be within a hundredth of a pixel
+  scene.singlePrecision = true;
+  Scene_markChanged(&scene);
+  Scene_projectPoints(&scene);
+  if (scene.localCount != count) return 1;
+  long int visible = 0;
+  for (long int i = 0; i < count; i++) {
+    if (scene.visibility[i] != mask[i]) return 2;
+    if (!(mask[i] & SCENE_VISIBLE_FRONT)) continue;
+    if (!around(scene.projectedPoints[i].x, reference[i].x, 0.01)) return 3;
+    if (!around(scene.projectedPoints[i].y, reference[i].y, 0.01)) return 4;
+    visible += (mask[i] & SCENE_VISIBLE) == SCENE_VISIBLE;
+  }
+  if (visible < count / 2) return 5;
+
+  // Vertices added later are converted with the same origin
+  Vec3 origin = scene.origin;
+  Scene_pushVertex(&scene, Vec3_new(offset.x + 3, offset.y + 3, offset.z));
+  Scene_markChanged(&scene);
+  Scene_projectPoints(&scene);
+  if (scene.localCount != count + 1 || !Vec3_equals(&origin, &scene.origin))
+    return 6;
+  scene.singlePrecision = false;
+  Scene_markChanged(&scene);
+  Scene_projectPoints(&scene);
+  Point p = scene.projectedPoints[count];
+  scene.singlePrecision = true;
+  Scene_markChanged(&scene);
+  Scene_projectPoints(&scene);
+  if (!around(scene.projectedPoints[count].x, p.x, 0.01) ||
+      !around(scene.projectedPoints[count].y, p.y, 0.01))
+    return 7;
+
+  free(reference);
+  free(mask);
+  Scene_free(&scene);
+  return 0;
+}
+
+unsigned int test_weld() {
+  // The cube as exported with the vertices repeated for every face, then an
+  // object behind the camera with a repeated vertex and a repeated line
+  const int corners[8][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1},
+                             {-1, 1, -1},  {-1, -1, 1}, {1, -1, 1},
+                             {1, 1, 1},    {-1, 1, 1}};
+  const int faces[6][4] = {{4, 3, 2, 1}, {5, 6, 7, 8}, {1, 2, 6, 5},
+                           {2, 3, 7, 6}, {3, 4, 8, 7}, {4, 1, 5, 8}};
+  char text[2048];
+  size_t length = 0;
+  for (int i = 0; i < 6; i++) {
+    for (int k = 0; k < 4; k++) {
+      const int* v = corners[faces[i][k] - 1];
+      length += sprintf(text + length, "v %d %d %d\n", v[0], v[1], v[2]);
+    }
+    length += sprintf(text + length, "f %d %d %d %d\n", 4 * i + 1, 4 * i + 2,
+                      4 * i + 3, 4 * i + 4);
+  }
+  strcpy(text + length,
+         "o b\nv 50 60 70\nv 50 60 70\nv 51 60 70\nl 25 27\nl 26 27\n");
+  Scene scene = loadText(text);
+  if (scene.verticesCount != 27 || scene.edgeCount != 26) return 1;
+  if (Scene_weld(&scene, 0) != 17) return 2;
+  if (scene.verticesCount != 10 || scene.edgeCount != 13) return 3;
+
+  // The ranges of the objects are rebuilt from the vertices kept
+  SceneObject* cube = &scene.objects[0];
+  SceneObject* b = &scene.objects[1];
+  if (cube->vertexBegin != 0 || cube->vertexEnd != 8) return 4;
+  if (cube->edgeBegin != 0 || cube->edgeEnd != 12) return 5;
+  if (b->vertexBegin != 8 || b->vertexEnd != 10) return 6;
+  if (b->edgeBegin != 12 || b->edgeEnd != 13) return 7;
+  if (!around(cube->max.x, 1, 1e-9) || !around(b->min.x, 50, 1e-9)) return 8;
+
+  // The seams got the faces of both sides, so the silhouettes and creases
+  // are found as on the cube that shares its vertices
+  for (long int i = 0; i < 12; i++) {
+    if (scene.edgeFaces[i].a == 0 || scene.edgeFaces[i].b == 0) return 9;
+    if (!around(scene.dihedral[i], 0, 1e-6)) return 10;
+  }
+  if (scene.dihedral[12] != SCENE_OPEN_EDGE) return 11;
+  scene.cam = Camera_new(Vec3_new(4, 5, 6), Vec3_new(0, 1, 0), 100, 100,
+                         3.14 / 2, 3.14 / 2);
+  Vec3 direction = Vec3_new(-4, -5, -6);
+  Camera_setLookDirection(&scene.cam, &direction);
+  scene.featureEdges = true;
+  scene.creaseAngle = M_PI * 3 / 4;
+  Scene_projectPoints(&scene);
+  Scene_compactEdges(&scene);
+  if (scene.visibleEdgeCount != 6) return 12;
+  Scene_free(&scene);
+
+  // At epsilon 0 only equal positions are welded, -0 and 0 among them
+  scene = loadText("v 0 0 0\nv -0 0 0\nv 1 0 0\nv 1.000001 0 0\n");
+  if (Scene_weld(&scene, 0) != 1 || scene.verticesCount != 3) return 13;
+  Scene_free(&scene);
+  // Close vertices on both sides of a cell boundary are found in the
+  // neighbouring cell, farther ones are kept
+  scene = loadText(
+      "v 0.999999 0 0\nv 1.000001 0 0\nv 1 -0.000001 0.000001\n"
+      "v 1.02 0 0\nl 1 4\nl 2 4\nl 1 2\n");
+  if (Scene_weld(&scene, 0.01) != 2 || scene.verticesCount != 2) return 14;
+  // The lines became one, the one between the welded vertices is gone
+  if (scene.edgeCount != 1) return 15;
+  if (scene.edges[0].a != 0 || scene.edges[0].b != 1) return 16;
+  Scene_free(&scene);
+  return 0;
+}
\ No newline at end of file
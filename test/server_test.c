@@ -0,0 +1,224 @@
+#include <server.h>
+#include <stdio.h>
+#include <tester.h>
+#ifdef SERVER_SUPPORTED
+#include <sys/wait.h>
+#endif
+
+unsigned int test_validate();
+unsigned int test_protocol();
+unsigned int test_compact();
+
+int main() {
+  tester_init();
+  eval(test_validate);
+  eval(test_protocol);
+  eval(test_compact);
+  return 0;
+}
+
+#ifdef SERVER_SUPPORTED
+// A request of a frame of the scene looking at its center from the front
+ServerRequest makeRequest(uint32_t width, uint32_t height, uint32_t format,
+                          uint64_t tag) {
+  ServerRequest request;
+  memset(&request, 0, sizeof(request));
+  request.width = width;
+  request.height = height;
+  request.format = format;
+  request.flags = SERVER_POSE_RELATIVE;
+  request.tag = tag;
+  request.pos[1] = 0.5;
+  request.pos[2] = 2;
+  request.look[1] = -0.5;
+  request.look[2] = -2;
+  request.hFov = request.vFov = 3.14 / 3;
+  return request;
+}
+#endif
+
+unsigned int test_validate() {
+#ifdef SERVER_SUPPORTED
+  Server server;
+  double radius = 2;
+  server.sceneCount = 1;
+  server.radii = &radius;
+  ServerRequest request = makeRequest(64, 48, SERVER_FORMAT_PNG, 0);
+  if (Server_validate(&server, &request) != SERVER_OK) return 1;
+  // An up direction of zero means (0, 1, 0)
+  if (Server_camera(&server, &request).up.y != 1) return 2;
+
+  request.scene = 1;
+  if (Server_validate(&server, &request) != SERVER_UNKNOWN_SCENE) return 3;
+  request = makeRequest(0, 48, SERVER_FORMAT_RAW, 0);
+  if (Server_validate(&server, &request) != SERVER_INVALID_SIZE) return 4;
+  request = makeRequest(64, SERVER_MAX_SIZE + 1, SERVER_FORMAT_RAW, 0);
+  if (Server_validate(&server, &request) != SERVER_INVALID_SIZE) return 5;
+  request = makeRequest(64, 48, SERVER_FORMAT_PNG + 1, 0);
+  if (Server_validate(&server, &request) != SERVER_INVALID_FORMAT) return 6;
+
+  // Cameras that can not be set up
+  request = makeRequest(64, 48, SERVER_FORMAT_RAW, 0);
+  request.pos[0] = NAN;
+  if (Server_validate(&server, &request) != SERVER_INVALID_CAMERA) return 7;
+  request = makeRequest(64, 48, SERVER_FORMAT_RAW, 0);
+  request.up[0] = INFINITY;
+  if (Server_validate(&server, &request) != SERVER_INVALID_CAMERA) return 8;
+  request = makeRequest(64, 48, SERVER_FORMAT_RAW, 0);
+  request.hFov = M_PI;
+  if (Server_validate(&server, &request) != SERVER_INVALID_CAMERA) return 9;
+  request = makeRequest(64, 48, SERVER_FORMAT_RAW, 0);
+  request.vFov = 0;
+  if (Server_validate(&server, &request) != SERVER_INVALID_CAMERA) return 10;
+  request = makeRequest(64, 48, SERVER_FORMAT_RAW, 0);
+  request.look[1] = 1;
+  request.look[2] = 0;
+  if (Server_validate(&server, &request) != SERVER_INVALID_CAMERA) return 11;
+#endif
+  return 0;
+}
+
+unsigned int test_protocol() {
+#ifdef SERVER_SUPPORTED
+  const char* fileName = "test/bin/server.obj";
+  const char* socketPath = "test/bin/server.sock";
+  FILE* file = fopen(fileName, "w");
+  if (file == NULL) return 1;
+  fprintf(file,
+          "v -1 -1 -1\nv 1 -1 -1\nv 1 1 -1\nv -1 1 -1\n"
+          "v -1 -1 1\nv 1 -1 1\nv 1 1 1\nv -1 1 1\n"
+          "f 4 3 2 1\nf 5 6 7 8\nf 1 2 6 5\nf 2 3 7 6\nf 3 4 8 7\n"
+          "f 4 1 5 8\n");
+  fclose(file);
+  unlink(socketPath);
+
+  // The server runs until it is killed
+  fflush(stdout);
+  pid_t child = fork();
+  if (child < 0) return 2;
+  if (child == 0) {
+    if (freopen("/dev/null", "w", stdout) == NULL) _exit(1);
+    char* fileNames[1] = {(char*)fileName};
+    Server_run(socketPath, fileNames, 1);
+    _exit(1);
+  }
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socketPath);
+  int server = -1;
+  for (int i = 0; i < 500 && server < 0; i++) {
+    server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(server, (struct sockaddr*)&address, sizeof(address)) != 0) {
+      close(server);
+      server = -1;
+      usleep(10000);
+    }
+  }
+
+  // The first request arrives in two parts, the second one is not valid,
+  // the replies come back in the order of the requests
+  unsigned int result = 0;
+  ServerRequest requests[3] = {makeRequest(32, 24, SERVER_FORMAT_RAW, 7),
+                               makeRequest(32, 24, SERVER_FORMAT_RAW, 8),
+                               makeRequest(16, 16, SERVER_FORMAT_PNG, 9)};
+  requests[1].scene = 3;
+  size_t half = sizeof(ServerRequest) / 2;
+  if (server < 0) {
+    result = 3;
+  } else if (Server_listen(socketPath) != -1) {
+    // The socket of the running server is not taken over
+    result = 13;
+  } else if (!Server_sendAll(server, &requests[0], half)) {
+    result = 4;
+  } else {
+    usleep(50000);
+    if (!Server_sendAll(server, (uint8_t*)&requests[0] + half,
+                        sizeof(ServerRequest) - half) ||
+        !Server_sendAll(server, &requests[1], 2 * sizeof(ServerRequest)))
+      result = 4;
+  }
+
+  const uint32_t statuses[3] = {SERVER_OK, SERVER_UNKNOWN_SCENE, SERVER_OK};
+  const uint64_t sizes[3] = {32 * 24 * 4, 0, 0};
+  for (int i = 0; i < 3 && result == 0; i++) {
+    ServerReply reply;
+    if (!Server_receiveAll(server, &reply, sizeof(reply))) {
+      result = 5;
+      break;
+    }
+    if (reply.status != statuses[i] || reply.tag != requests[i].tag ||
+        reply.format != requests[i].format ||
+        reply.width != requests[i].width ||
+        reply.height != requests[i].height)
+      result = 6;
+    if (sizes[i] > 0 && reply.size != sizes[i]) result = 7;
+    if (statuses[i] != SERVER_OK && reply.size != 0) result = 8;
+    if (statuses[i] == SERVER_OK && reply.size == 0) result = 9;
+    if (result != 0) break;
+    uint8_t* frame = (uint8_t*)malloc(reply.size + 1);
+    if (!Server_receiveAll(server, frame, reply.size)) result = 10;
+    // The cube is drawn over the background of the raw frame
+    bool raw = reply.size > 0 && reply.format == SERVER_FORMAT_RAW;
+    bool drawn = false;
+    for (uint64_t k = 4; raw && k < reply.size; k += 4)
+      drawn |= memcmp(&frame[k], frame, 4) != 0;
+    if (result == 0 && raw && !drawn) result = 11;
+    const uint8_t signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    if (result == 0 && reply.format == SERVER_FORMAT_PNG &&
+        (reply.size < 8 || memcmp(frame, signature, 8) != 0))
+      result = 12;
+    free(frame);
+  }
+
+  if (server >= 0) close(server);
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+  unlink(socketPath);
+  return result;
+#else
+  return 0;
+#endif
+}
+
+unsigned int test_compact() {
+#ifdef SERVER_SUPPORTED
+  // A client that read 150 bytes of 200 gets a reply of 10 more, the sent
+  // bytes are dropped instead of growing the buffer
+  Server server;
+  memset(&server, 0, sizeof(server));
+  pthread_mutex_init(&server.lock, NULL);
+  ServerConnection connection;
+  memset(&connection, 0, sizeof(connection));
+  connection.id = 1;
+  connection.out = (uint8_t*)malloc(200);
+  for (int i = 0; i < 200; i++) connection.out[i] = i;
+  connection.outSize = connection.allocatedOut = 200;
+  connection.outSent = 150;
+  connection.inFlight = 1;
+  server.connections = &connection;
+  server.connectionCount = 1;
+  ServerJob job;
+  memset(&job, 0, sizeof(job));
+  job.connection = 1;
+  job.replySize = 10;
+  job.reply = (uint8_t*)calloc(10, 1);
+  Server_push(&server.done, &job);
+  ServerQueue replies = {NULL, 0, 0};
+  Server_collectReplies(&server, &replies);
+
+  unsigned int result = 0;
+  if (connection.outSent != 0 || connection.outSize != 60) result = 1;
+  if (connection.allocatedOut != 200 || connection.inFlight != 0) result = 2;
+  if (connection.out[0] != 150 || connection.out[49] != 199 ||
+      connection.out[50] != 0)
+    result = 3;
+  free(connection.out);
+  free(replies.jobs);
+  free(server.done.jobs);
+  pthread_mutex_destroy(&server.lock);
+  return result;
+#else
+  return 0;
+#endif
+}
\ No newline at end of file